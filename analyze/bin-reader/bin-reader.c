@@ -1,68 +1,363 @@
 #include <stdio.h>
+#include <string.h>
+
+/*
+ * Dumps a profile written by the kremlin runtime. Handles both the current
+ * format (version 2) and the older headerless version 1 format, as well as
+ * checkpoint files; see runtime/src/ProfileFormat.h for the layouts.
+ */
 
 typedef signed long long    Int64;
+typedef unsigned long long  UInt64;
+typedef unsigned int        UInt32;
+
+#define PROFILE_MAGIC           "KREMPROF"
+#define PROFILE_MAGIC_SIZE      8
+#define PROFILE_FORMAT_VERSION  2
+#define PROFILE_BYTE_ORDER_MARK 0x01020304
+#define CHECKPOINT_MAGIC        "KREMCKPT"
+#define CHECKPOINT_FORMAT_VERSION 1
+#define PROFILE_FLAG_SKETCHES   0x2
+#define SAMPLED_NODE_FLAG       0x100
+#define SKETCH_NUM_METRICS      3
+#define SKETCH_NUM_BUCKETS      32
+#define INDEX_ENTRY_SIZE        16
+
+static int truncated = 0;
+
+static UInt64 swap64(UInt64 v) {
+	UInt64 r = 0;
+	int i;
+	for (i = 0; i < 8; ++i) {
+		r = (r << 8) | (v & 0xff);
+		v >>= 8;
+	}
+	return r;
+}
+
+static UInt32 swap32(UInt32 v) {
+	return (v >> 24) | ((v >> 8) & 0xff00) | ((v << 8) & 0xff0000) | (v << 24);
+}
+
+/* version 1 fields are raw 64-bit little endian values */
+static UInt64 readRaw(FILE* fp) {
+	unsigned char b[8];
+	UInt64 v = 0;
+	int i;
+	if (fread(b, 1, 8, fp) != 8) {
+		truncated = 1;
+		return 0;
+	}
+	for (i = 7; i >= 0; --i) v = (v << 8) | b[i];
+	return v;
+}
+
+static UInt64 readVarint(FILE* fp) {
+	UInt64 v = 0;
+	int shift = 0;
+	int b;
+	do {
+		b = getc(fp);
+		if (b == EOF) {
+			truncated = 1;
+			return 0;
+		}
+		v |= (UInt64)(b & 0x7f) << shift;
+		shift += 7;
+	} while (b & 0x80);
+	return v;
+}
+
+static Int64 readSignedVarint(FILE* fp) {
+	UInt64 u = readVarint(fp);
+	return (Int64)(u >> 1) ^ -(Int64)(u & 1);
+}
+
+static void printNode(UInt64 id, UInt64 sid, UInt64 callSite, UInt64 type,
+						UInt64 recursionTarget, UInt64 numInstance,
+						UInt64 doall) {
+	printf("id = %llu, sid = %llu, callSite = %llu\n", id, sid, callSite);
+	printf("\ttype = %llu%s, recursionTarget = %llu, numInstance = %llu, doall = %llu\n",
+		type & ~(UInt64)SAMPLED_NODE_FLAG,
+		(type & SAMPLED_NODE_FLAG) ? " (sampled)" : "",
+		recursionTarget, numInstance, doall);
+}
+
+static void printStat(UInt64 fields[9]) {
+	printf("\tnumInstance = %llu, totalWork = %llu, tpWork = %llu, spWork = %llu\n",
+		fields[0], fields[1], fields[2], fields[3]);
+	printf("\tminSP = %llu, maxSP = %llu, ", fields[4], fields[5]);
+	printf("totalChildren = %llu, minChildren = %lld, maxChildren = %llu\n",
+		fields[6], (Int64)fields[7], fields[8]);
+}
+
+/*
+ * Estimates a quantile from sketch buckets by interpolating linearly within
+ * the bucket it falls in. min and max (if known) bound the result.
+ */
+static double sketchQuantile(UInt64 buckets[SKETCH_NUM_BUCKETS], double q,
+								double min, double max) {
+	UInt64 total = 0, seen = 0;
+	double target, lo, hi, est;
+	int b;
+
+	for (b = 0; b < SKETCH_NUM_BUCKETS; ++b) total += buckets[b];
+	if (total == 0) return 0;
+
+	target = q * total;
+	for (b = 0; b < SKETCH_NUM_BUCKETS - 1; ++b) {
+		if (seen + buckets[b] >= target && buckets[b] > 0) break;
+		seen += buckets[b];
+	}
+
+	if (b == 0) return 0;
+	lo = (double)(1ULL << (b - 1));
+	hi = (b == SKETCH_NUM_BUCKETS - 1) ? max : (double)(1ULL << b);
+	est = lo + (hi - lo) * (target - seen) / buckets[b];
+	if (est < min) est = min;
+	if (max > 0 && est > max) est = max;
+	return est;
+}
+
+static void readSketches(FILE* fp) {
+	static const char* names[SKETCH_NUM_METRICS] = { "work", "cp", "selfPar" };
+	UInt64 num_sketches = readVarint(fp);
+	UInt64 n;
+	int m, b;
+
+	printf("num_sketches = %llu\n", num_sketches);
+	for (n = 0; n < num_sketches && !truncated; ++n) {
+		UInt64 id = readVarint(fp);
+		UInt64 bounds[4];
+		UInt64 buckets[SKETCH_NUM_BUCKETS];
+		for (b = 0; b < 4; ++b) bounds[b] = readVarint(fp);
+		printf("sketch id = %llu, work = [%llu, %llu], cp = [%llu, %llu]\n",
+			id, bounds[0], bounds[1], bounds[2], bounds[3]);
+
+		for (m = 0; m < SKETCH_NUM_METRICS; ++m) {
+			/* self-parallelism is stored * 100 and has no recorded bounds */
+			double scale = (m == 2) ? 100.0 : 1.0;
+			double min = (m == 2) ? 0 : (double)bounds[2 * m];
+			double max = (m == 2) ? 0 : (double)bounds[2 * m + 1];
+			for (b = 0; b < SKETCH_NUM_BUCKETS; ++b) buckets[b] = readVarint(fp);
+			printf("\t%s: p50 = %.2f, p90 = %.2f, p99 = %.2f\n", names[m],
+				sketchQuantile(buckets, 0.50, min, max) / scale,
+				sketchQuantile(buckets, 0.90, min, max) / scale,
+				sketchQuantile(buckets, 0.99, min, max) / scale);
+		}
+	}
+}
+
+static void readVersion1(FILE* fp) {
+	while (1) {
+		UInt64 id, sid, callSite, type, target, numInstance, doall;
+		UInt64 num_children, num_stats, i, j;
+		UInt64 fields[9];
+
+		int c = getc(fp);
+		if (c == EOF) break;
+		ungetc(c, fp);
+
+		id = readRaw(fp);
+		sid = readRaw(fp);
+		callSite = readRaw(fp);
+		type = readRaw(fp);
+		target = readRaw(fp);
+		numInstance = readRaw(fp);
+		doall = readRaw(fp);
+		printNode(id, sid, callSite, type, target, numInstance, doall);
+
+		num_children = readRaw(fp);
+		printf("\tnum_children = %llu\n", num_children);
+		for (i = 0; i < num_children && !truncated; ++i) {
+			printf("\t\tchild_id[%llu] = %llu\n", i, readRaw(fp));
+		}
+
+		num_stats = readRaw(fp);
+		for (i = 0; i < num_stats && !truncated; ++i) {
+			for (j = 0; j < 9; ++j) fields[j] = readRaw(fp);
+			printStat(fields);
+		}
+
+		if (truncated) break;
+	}
+}
+
+/* reads and prints a version 2 node record */
+static void readNodeRecord(FILE* fp, UInt64* prev_id) {
+	UInt64 id, sid, callSite, type, target, numInstance, doall;
+	UInt64 num_children, num_stats, i, j;
+	Int64 recursion;
+	UInt64 fields[9];
+
+	id = *prev_id + readSignedVarint(fp);
+	*prev_id = id;
+	sid = readVarint(fp);
+	callSite = readVarint(fp);
+	type = readVarint(fp);
+	recursion = readSignedVarint(fp);
+	target = (recursion == 0) ? 0 : id + recursion;
+	numInstance = readVarint(fp);
+	doall = readVarint(fp);
+	printNode(id, sid, callSite, type, target, numInstance, doall);
+
+	num_children = readVarint(fp);
+	printf("\tnum_children = %llu\n", num_children);
+	for (i = 0; i < num_children && !truncated; ++i) {
+		printf("\t\tchild_id[%llu] = %llu\n", i, id + readSignedVarint(fp));
+	}
+
+	num_stats = readVarint(fp);
+	for (i = 0; i < num_stats && !truncated; ++i) {
+		for (j = 0; j < 9; ++j) fields[j] = readVarint(fp);
+		printStat(fields);
+	}
+}
+
+static void readVersion2(FILE* fp) {
+	UInt32 version, byte_order;
+	UInt64 flags, num_nodes, index_offset, n;
+	UInt64 prev_id = 0;
+	int swap = 0;
+
+	if (fread(&version, 4, 1, fp) != 1 || fread(&byte_order, 4, 1, fp) != 1
+		|| fread(&flags, 8, 1, fp) != 1 || fread(&num_nodes, 8, 1, fp) != 1
+		|| fread(&index_offset, 8, 1, fp) != 1) {
+		printf("truncated header\n");
+		return;
+	}
+
+	if (byte_order == swap32(PROFILE_BYTE_ORDER_MARK)) {
+		swap = 1;
+		version = swap32(version);
+		flags = swap64(flags);
+		num_nodes = swap64(num_nodes);
+		index_offset = swap64(index_offset);
+	}
+	else if (byte_order != PROFILE_BYTE_ORDER_MARK) {
+		printf("bad byte order mark: 0x%x\n", byte_order);
+		return;
+	}
+
+	printf("version = %u%s, flags = 0x%llx, num_nodes = %llu, index_offset = %llu\n",
+		version, swap ? " (byte swapped)" : "", flags, num_nodes, index_offset);
+	if (version != PROFILE_FORMAT_VERSION) {
+		printf("unsupported version\n");
+		return;
+	}
+
+	for (n = 0; n < num_nodes && !truncated; ++n) {
+		readNodeRecord(fp, &prev_id);
+	}
+
+	if ((flags & PROFILE_FLAG_SKETCHES) && !truncated) {
+		if (fseek(fp, index_offset + num_nodes * INDEX_ENTRY_SIZE, SEEK_SET) != 0) {
+			truncated = 1;
+			return;
+		}
+		readSketches(fp);
+	}
+}
+
+/*
+ * Prints every epoch of a checkpoint file. A node's record in a later epoch
+ * supersedes its records in earlier ones. An epoch cut short by the program
+ * dying while it was appended is reported and ignored.
+ */
+static void readCheckpoint(FILE* fp) {
+	UInt32 version, byte_order;
+	UInt64 flags, hdr[3], n;
+	long start;
+	int swap = 0, k;
+
+	if (fread(&version, 4, 1, fp) != 1 || fread(&byte_order, 4, 1, fp) != 1
+		|| fread(&flags, 8, 1, fp) != 1) {
+		printf("truncated header\n");
+		return;
+	}
+
+	if (byte_order == swap32(PROFILE_BYTE_ORDER_MARK)) {
+		swap = 1;
+		version = swap32(version);
+		flags = swap64(flags);
+	}
+	else if (byte_order != PROFILE_BYTE_ORDER_MARK) {
+		printf("bad byte order mark: 0x%x\n", byte_order);
+		return;
+	}
+
+	printf("checkpoint version = %u%s, flags = 0x%llx\n",
+		version, swap ? " (byte swapped)" : "", flags);
+	if (version != CHECKPOINT_FORMAT_VERSION) {
+		printf("unsupported version\n");
+		return;
+	}
+
+	while (1) {
+		UInt64 prev_id = 0;
+		size_t got = fread(hdr, 8, 3, fp);
+		if (got == 0 && feof(fp)) break;
+		if (got != 3) {
+			printf("last epoch is incomplete, ignored\n");
+			break;
+		}
+		if (swap) {
+			for (k = 0; k < 3; ++k) hdr[k] = swap64(hdr[k]);
+		}
+
+		/* make sure the whole epoch made it to disk before printing it */
+		start = ftell(fp);
+		if (fseek(fp, 0, SEEK_END) != 0 || ftell(fp) - start < (long)hdr[2]) {
+			printf("epoch %llu is incomplete, ignored\n", hdr[0]);
+			break;
+		}
+		fseek(fp, start, SEEK_SET);
+
+		printf("epoch = %llu, num_nodes = %llu, size = %llu\n",
+			hdr[0], hdr[1], hdr[2]);
+		for (n = 0; n < hdr[1] && !truncated; ++n) {
+			readNodeRecord(fp, &prev_id);
+			printf("\tnumSkipped = %llu, ", readVarint(fp));
+			printf("skippedWork = %llu\n", readVarint(fp));
+		}
+		if (truncated) break;
+	}
+}
 
 int main(int argc, char* argv[]) {
-	Int64 id, sid, callSite, numInstance, totalWork, tpWork, spWork;
-	Int64 minSPInt, maxSPInt, readCnt, writeCnt, loadCnt, storeCnt;
+	char magic[PROFILE_MAGIC_SIZE];
+	int has_magic;
 
 	if(argc < 2) {
 		fprintf(stderr,"need to specify the bin file to read\n");
 		return 1;
 	}
 
-	//FILE* fp = fopen("kremlin.bin", "r");
 	printf("using file: %s\n",argv[1]);
-	FILE* fp = fopen(argv[1], "r");
+	FILE* fp = fopen(argv[1], "rb");
 	if(!fp) {
 		printf("couldn't open %s\n",argv[1]);
 		return 1;
 	}
 
-	while(!feof(fp)) {
-		fread(&id, sizeof(Int64), 1, fp);
-		printf("id = %llu, ",id);
-		fread(&sid, sizeof(Int64), 1, fp);
-		printf("sid = %llu, ",sid);
-		fread(&callSite, sizeof(Int64), 1, fp);
-		printf("callSite = %llu\n",callSite);
-		fread(&numInstance, sizeof(Int64), 1, fp);
-		printf("\tnumInstance = %lld, ",numInstance);
-		fread(&totalWork, sizeof(Int64), 1, fp);
-		printf("totalWork = %lld, ",totalWork);
-		fread(&tpWork, sizeof(Int64), 1, fp);
-		printf("tpWork = %lld, ",tpWork);
-		fread(&spWork, sizeof(Int64), 1, fp);
-		printf("spWork = %lld\n",spWork);
-
-		fread(&minSPInt, sizeof(Int64), 1, fp);
-		printf("\tminSP = %lld, ",minSPInt);
-		fread(&maxSPInt, sizeof(Int64), 1, fp);
-		printf("maxSP = %lld, ",maxSPInt);
-		fread(&readCnt, sizeof(Int64), 1, fp);
-		printf("readCnt = %lld, ",readCnt);
-		fread(&writeCnt, sizeof(Int64), 1, fp);
-		printf("writeCnt = %lld, ",writeCnt);
-		fread(&loadCnt, sizeof(Int64), 1, fp);
-		printf("loadCnt = %lld, ",loadCnt);
-		fread(&storeCnt, sizeof(Int64), 1, fp);
-		printf("storeCnt = %lld\n",storeCnt);
-
-		Int64 num_children, child_id;
-
-		fread(&num_children, sizeof(Int64), 1, fp);
-		printf("\tnum_children = %lld\n",num_children);
-
-		int i;
-		for (i=0; i<num_children; ++i) {
-			fread(&child_id, sizeof(Int64), 1, fp);    
-			printf("\t\tchild_id[%d] = %lld, ",i,child_id);
-		}
+	has_magic = fread(magic, 1, PROFILE_MAGIC_SIZE, fp) == PROFILE_MAGIC_SIZE;
+	if (has_magic && memcmp(magic, PROFILE_MAGIC, PROFILE_MAGIC_SIZE) == 0) {
+		readVersion2(fp);
+	}
+	else if (has_magic
+			&& memcmp(magic, CHECKPOINT_MAGIC, PROFILE_MAGIC_SIZE) == 0) {
+		readCheckpoint(fp);
+	}
+	else {
+		printf("no header: reading as version 1\n");
+		rewind(fp);
+		readVersion1(fp);
+	}
 
-		if(num_children != 0) {
-			printf("\n");
-		}
+	if (truncated) {
+		printf("file is truncated\n");
 	}
 
 	fclose(fp);
+	return truncated;
 }
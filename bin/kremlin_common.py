@@ -56,6 +56,13 @@ def create_kremlin_mk(src_lang):
     parser.add_argument("--kremlin-print-sconstruct", action='store_true', \
 						dest="print_scons_file", \
 						help="Print the resulting SConstruct.kremlin to stdout")
+    parser.add_argument("--kremlin-no-inline-runtime", action='store_false', \
+						dest="inline_runtime", \
+						help="Call into the runtime library rather than linking \
+								its bitcode into the program before optimizing")
+    parser.add_argument("--kremlin-lib-costs", dest="lib_costs", default="", \
+						help="File with the costs of library functions that \
+								aren't instrumented")
 
     # Output file target
     parser.add_argument("-o", dest="target", help="Place output in file.")
@@ -242,6 +249,11 @@ def create_kremlin_mk(src_lang):
             write("make_output_file = \'" + options.gen_make_target + "\'")
         else:
             write("make_output_file = \'\'")
+        write("inline_runtime = " + str(options.inline_runtime))
+        if options.lib_costs:
+            write("lib_costs = \'" + os.path.abspath(options.lib_costs) + "\'")
+        else:
+            write("lib_costs = \'\'")
 
         #if options.krem_debug:
         #    write("DEBUG = 1")
@@ -265,7 +277,8 @@ def create_kremlin_mk(src_lang):
         """
 
         #write("include " + sys.path[0] + "/../instrument/make/kremlin.mk")
-        to_export = ['env','input_files','target','output_file','make_output_file']
+        to_export = ['env','input_files','target','output_file','make_output_file',
+                    'inline_runtime','lib_costs']
         write("Export(\'" + " ".join(to_export) + "\')")
         write("SConscript(\'" + sys.path[0] + "/../instrument/make/SConscript\')")
 
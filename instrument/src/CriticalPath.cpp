@@ -2,6 +2,7 @@
 
 #include "llvm/Pass.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/ErrorHandling.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/Dominators.h"
@@ -29,6 +30,8 @@
 #include "StoreInstHandler.h"
 #include "CallableHandler.h"
 #include "DynamicMemoryHandler.h"
+#include "LibCosts.h"
+#include "LibraryCallHandler.h"
 #include "PhiHandler.h"
 #include "FunctionArgsHandler.h"
 #include "ReturnHandler.h"
@@ -41,6 +44,7 @@ using namespace llvm;
 using namespace boost;
 
 static cl::opt<std::string> opCostFile("op-costs",cl::desc("File containing mapping between ops and their costs."),cl::value_desc("filename"),cl::init("__none__"));
+static cl::opt<std::string> libCostFile("lib-costs",cl::desc("File containing the costs of library functions that aren't instrumented."),cl::value_desc("filename"),cl::init("__none__"));
 
 /**
  * Runner for calculating the critical path.
@@ -55,12 +59,18 @@ struct CriticalPath : public ModulePass
 
     PassLog& log;
 
+    LibCosts lib_costs;
+
     boost::ptr_vector<InstrumentationCall> instrumentationCalls;
 
     CriticalPath() : ModulePass(ID), log(PassLog::get()) {}
     virtual ~CriticalPath() {}
 
     virtual bool runOnModule(Module &m) {
+        std::string error;
+        if(libCostFile != "__none__" && !lib_costs.parseFromFile(libCostFile, error))
+            report_fatal_error(error);
+
         // Instrument the module
         instrumentModule(m);
 
@@ -185,12 +195,27 @@ struct CriticalPath : public ModulePass
 			ignored.push_back("realloc");
 			ignored.push_back("free");
 
+			// DynamicMemoryHandler handles these as bulk copies/sets
+			ignored.push_back("memcpy");
+			ignored.push_back("memmove");
+			ignored.push_back("memset");
+
 			// ignore C++ exception handling functions
 			ignored.push_back("__cxa_allocate_exception");
 			ignored.push_back("__cxa_throw");
 			ignored.push_back("__cxa_begin_catch");
 			ignored.push_back("__cxa_end_catch");
 			ignored.push_back("__gxx_personality_v0");
+
+			// LibraryCallHandler handles calls to library functions with a
+			// known cost, unless they are defined (and instrumented) here
+			std::vector<std::string> lib_funcs;
+			lib_costs.getNames(lib_funcs);
+			foreach(std::string& name, lib_funcs) {
+				Function* lib_func = m.getFunction(name);
+				if(lib_func == NULL || lib_func->isDeclaration())
+					ignored.push_back(name);
+			}
 			cih.addIgnore(ignored);
             placer.registerHandler(cih);
 
@@ -202,6 +227,9 @@ struct CriticalPath : public ModulePass
             DynamicMemoryHandler dmh(placer);
             placer.registerHandler(dmh);
 
+            LibraryCallHandler lch(placer, lib_costs);
+            placer.registerHandler(lch);
+
             FunctionArgsHandler func_args(placer);
             placer.registerHandler(func_args);
 
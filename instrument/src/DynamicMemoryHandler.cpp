@@ -1,4 +1,5 @@
 #include <llvm/IR/Instructions.h>
+#include <llvm/IR/IntrinsicInst.h>
 #include <llvm/IR/Module.h>
 #include <llvm/IR/CallSite.h>
 #include <llvm/IR/Constants.h>
@@ -52,6 +53,38 @@ DynamicMemoryHandler::DynamicMemoryHandler(TimestampPlacer& ts_placer) :
 	delete aref;
     free_func = cast<Function>(
         m.getOrInsertFunction("_KFree", free_call));
+
+	args.clear();
+
+	args.push_back(types.pi8());
+	args.push_back(types.pi8());
+	args.push_back(types.i64());
+	aref = new ArrayRef<Type*>(args);
+    FunctionType* memcopy_call = FunctionType::get(types.voidTy(), *aref, false);
+	delete aref;
+    memcopy_func = cast<Function>(
+        m.getOrInsertFunction("_KMemCopy", memcopy_call));
+
+	args.clear();
+
+	args.push_back(types.i32());
+	args.push_back(types.pi8());
+	args.push_back(types.i64());
+	aref = new ArrayRef<Type*>(args);
+    FunctionType* memset_call = FunctionType::get(types.voidTy(), *aref, false);
+	delete aref;
+    memset_func = cast<Function>(
+        m.getOrInsertFunction("_KMemSet", memset_call));
+
+	args.clear();
+
+	args.push_back(types.pi8());
+	args.push_back(types.i64());
+	aref = new ArrayRef<Type*>(args);
+    FunctionType* memset_const_call = FunctionType::get(types.voidTy(), *aref, false);
+	delete aref;
+    memset_const_func = cast<Function>(
+        m.getOrInsertFunction("_KMemSetConst", memset_const_call));
 }
 
 const TimestampPlacerHandler::Opcodes& DynamicMemoryHandler::getOpcodes()
@@ -76,6 +109,60 @@ Instruction* DynamicMemoryHandler::getNextInst(Instruction *inst) {
 	return bb_it;
 }
 
+Value* DynamicMemoryHandler::castToI8Pointer(Value *val, const char *name,
+												Instruction *insert_before) {
+	if(isNBitIntPointer(val,8)) return val;
+
+	LLVMTypes types(val->getContext());
+	return CastInst::CreatePointerCast(val,types.pi8(),name,insert_before);
+}
+
+Value* DynamicMemoryHandler::castToI64(Value *val, const char *name,
+										Instruction *insert_before) {
+	LLVMTypes types(val->getContext());
+	if(val->getType() == types.i64()) return val;
+
+	// sizes are unsigned (size_t)
+	return CastInst::CreateZExtOrBitCast(val,types.i64(),name,insert_before);
+}
+
+void DynamicMemoryHandler::handleMemOp(CallInst& call_inst, bool is_set,
+										Value *dest, Value *src, 
+										Value *size) {
+    LLVMTypes types(call_inst.getContext());
+    vector<Value*> args;
+	Function *func_to_call = NULL;
+
+	// For memset, src is the byte value written.
+	if(is_set) {
+		if(isa<Constant>(src)) {
+			func_to_call = memset_const_func;
+		}
+		else {
+			func_to_call = memset_func;
+			args.push_back(ConstantInt::get(types.i32(),ts_placer.getId(*src))); // src ID
+		}
+	}
+	else {
+		func_to_call = memcopy_func;
+	}
+
+	args.push_back(castToI8Pointer(dest,"memop_dest_recast",&call_inst));
+	if(!is_set) {
+		args.push_back(castToI8Pointer(src,"memop_src_recast",&call_inst));
+	}
+	args.push_back(castToI64(size,"memop_size",&call_inst));
+
+	ArrayRef<Value*> *aref = new ArrayRef<Value*>(args);
+	CallInst* memop_call = CallInst::Create(func_to_call, *aref, "");
+	delete aref;
+
+	// XXX: same trick as for _KMalloc to get this right after the call
+	ts_placer.constrainInstPlacement(*memop_call, *getNextInst(&call_inst));
+	if(func_to_call == memset_func)
+		ts_placer.requireValTimestampBeforeUser(*src, *memop_call);
+}
+
 void DynamicMemoryHandler::handle(llvm::Instruction& inst)
 {
 	LOG_DEBUG() << "handling: " << inst << "\n";
@@ -88,8 +175,35 @@ void DynamicMemoryHandler::handle(llvm::Instruction& inst)
 	Function *called_func = CallableHandler<CallInst>::untangleCall(call_inst);
 	ArrayRef<Value*> *aref = NULL;
 
-	// We don't handle LLVM intrinsics now, even their malloc, free stuff
-	if (called_func == NULL || called_func->isIntrinsic()) return;
+	// llvm.memcpy/memmove/memset get the same treatment as the libc calls
+	if (MemTransferInst* mem_transfer = dyn_cast<MemTransferInst>(&call_inst)) {
+		LOG_DEBUG() << "inst is a memcpy/memmove intrinsic\n";
+		handleMemOp(call_inst, false, mem_transfer->getRawDest(), 
+					mem_transfer->getRawSource(), mem_transfer->getLength());
+	}
+	else if (MemSetInst* mem_set = dyn_cast<MemSetInst>(&call_inst)) {
+		LOG_DEBUG() << "inst is a memset intrinsic\n";
+		handleMemOp(call_inst, true, mem_set->getRawDest(), 
+					mem_set->getValue(), mem_set->getLength());
+	}
+
+	// We don't handle other LLVM intrinsics now, even their malloc, free stuff
+	else if (called_func == NULL || called_func->isIntrinsic()) return;
+
+	// calls to memcpy/memmove (dest, src, n) and memset (dest, c, n)
+	else if (called_func->getName().compare("memcpy") == 0 
+			|| called_func->getName().compare("memmove") == 0
+			|| called_func->getName().compare("memset") == 0
+	  		) {
+		LOG_DEBUG() << "inst is a call to memcpy/memmove/memset\n";
+		if (call_inst.getNumArgOperands() == 3) {
+			handleMemOp(call_inst, 
+						called_func->getName().compare("memset") == 0,
+						call_inst.getArgOperand(0), 
+						call_inst.getArgOperand(1), 
+						call_inst.getArgOperand(2));
+		}
+	}
 
 	// calls to malloc and calloc get _KMalloc(addr, size) call
 	else if (called_func->getName().compare("malloc") == 0 
@@ -101,8 +215,13 @@ void DynamicMemoryHandler::handle(llvm::Instruction& inst)
 		LOG_DEBUG() << "adding return value of inst as arg to _KMalloc\n";
 		args.push_back(&call_inst);
 
-		// insert size (arg 0 of func)
+		// insert size (arg 0 of malloc, arg 0 * arg 1 of calloc)
 		Value* sizeOperand = call_inst.getArgOperand(0);
+		if (called_func->getName().compare("calloc") == 0) {
+			sizeOperand = BinaryOperator::CreateMul(sizeOperand, 
+								call_inst.getArgOperand(1), "calloc_size", 
+								&call_inst);
+		}
 		LOG_DEBUG() << "pushing arg: " << PRINT_VALUE(*sizeOperand) << "\n";
 		args.push_back(sizeOperand);
 
@@ -19,12 +19,28 @@ class DynamicMemoryHandler : public TimestampPlacerHandler
     private:
 	bool isNBitIntPointer(llvm::Value *val, unsigned n);
 	llvm::Instruction* getNextInst(llvm::Instruction *inst);
+	llvm::Value* castToI8Pointer(llvm::Value *val, const char *name, 
+									llvm::Instruction *insert_before);
+	llvm::Value* castToI64(llvm::Value *val, const char *name, 
+							llvm::Instruction *insert_before);
+
+	/*!
+	 * Adds a _KMemCopy after a memcpy or memmove, or a _KMemSet (or
+	 * _KMemSetConst) after a memset, whether it is a call to the libc
+	 * function or to the LLVM intrinsic.
+	 */
+	void handleMemOp(llvm::CallInst& call_inst, bool is_set, 
+						llvm::Value *dest, llvm::Value *src, 
+						llvm::Value *size);
 
     uint32_t call_idx;
     PassLog& log;
     llvm::Function* malloc_func;
     llvm::Function* realloc_func;
     llvm::Function* free_func;
+    llvm::Function* memcopy_func;
+    llvm::Function* memset_func;
+    llvm::Function* memset_const_func;
 
     Opcodes opcodes;
     TimestampPlacer& ts_placer;
@@ -166,6 +166,20 @@ namespace {
 			kremlib_calls.insert("_KTimestamp0");
 			kremlib_calls.insert("_KTimestamp1");
 			kremlib_calls.insert("_KTimestamp2");
+			kremlib_calls.insert("_KTimestamp3");
+			kremlib_calls.insert("_KTimestamp4");
+			kremlib_calls.insert("_KTimestamp5");
+			kremlib_calls.insert("_KTimestamp6");
+			kremlib_calls.insert("_KTimestamp7");
+			kremlib_calls.insert("_KTimestamp8");
+			kremlib_calls.insert("_KTimestamp9");
+			kremlib_calls.insert("_KTimestamp10");
+			kremlib_calls.insert("_KTimestamp11");
+			kremlib_calls.insert("_KTimestamp12");
+			kremlib_calls.insert("_KTimestamp13");
+			kremlib_calls.insert("_KTimestamp14");
+			kremlib_calls.insert("_KTimestamp15");
+			kremlib_calls.insert("_KTimestamp16");
 			kremlib_calls.insert("_KAssign");
 			kremlib_calls.insert("_KAssignConst");
 			kremlib_calls.insert("_KInsertVal");
@@ -176,16 +190,43 @@ namespace {
 			kremlib_calls.insert("_KLoad2");
 			kremlib_calls.insert("_KLoad3");
 			kremlib_calls.insert("_KLoad4");
+			kremlib_calls.insert("_KLoad5");
+			kremlib_calls.insert("_KLoad6");
+			kremlib_calls.insert("_KLoad7");
+			kremlib_calls.insert("_KLoad8");
+			kremlib_calls.insert("_KLoad9");
+			kremlib_calls.insert("_KLoad10");
+			kremlib_calls.insert("_KLoad11");
+			kremlib_calls.insert("_KLoad12");
+			kremlib_calls.insert("_KLoad13");
+			kremlib_calls.insert("_KLoad14");
+			kremlib_calls.insert("_KLoad15");
+			kremlib_calls.insert("_KLoad16");
 			kremlib_calls.insert("_KStore");
 			kremlib_calls.insert("_KStoreConst");
 			kremlib_calls.insert("_KMalloc");
 			kremlib_calls.insert("_KRealloc");
 			kremlib_calls.insert("_KFree");
+			kremlib_calls.insert("_KMemCopy");
+			kremlib_calls.insert("_KMemSet");
+			kremlib_calls.insert("_KMemSetConst");
 			kremlib_calls.insert("_KPhi");
 			kremlib_calls.insert("_KPhi1To1");
 			kremlib_calls.insert("_KPhi2To1");
 			kremlib_calls.insert("_KPhi3To1");
 			kremlib_calls.insert("_KPhi4To1");
+			kremlib_calls.insert("_KPhi5To1");
+			kremlib_calls.insert("_KPhi6To1");
+			kremlib_calls.insert("_KPhi7To1");
+			kremlib_calls.insert("_KPhi8To1");
+			kremlib_calls.insert("_KPhi9To1");
+			kremlib_calls.insert("_KPhi10To1");
+			kremlib_calls.insert("_KPhi11To1");
+			kremlib_calls.insert("_KPhi12To1");
+			kremlib_calls.insert("_KPhi13To1");
+			kremlib_calls.insert("_KPhi14To1");
+			kremlib_calls.insert("_KPhi15To1");
+			kremlib_calls.insert("_KPhi16To1");
 			kremlib_calls.insert("_KPhiCond4To1");
 			kremlib_calls.insert("_KPhiAddCond");
 			kremlib_calls.insert("_KPushCDep");
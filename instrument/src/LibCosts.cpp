@@ -0,0 +1,120 @@
+#include "LibCosts.h"
+
+#include <fstream>
+#include <sstream>
+#include <iterator>
+
+/**
+ * Converts token to an unsigned int.
+ *
+ * @return False if token isn't a non-negative integer.
+ */
+static bool parseUnsigned(const std::string& token, unsigned int& value) {
+	if(token.empty() || token.find_first_not_of("0123456789") != std::string::npos)
+		return false;
+
+	std::istringstream ss(token);
+	ss >> value;
+	return !ss.fail();
+}
+
+/**
+ * Parses library function costs from a file.
+ *
+ * Each line of the file has the name of a function, whitespace, and its
+ * fixed cost as an integer. This can be followed by a per unit cost and the
+ * index of the argument (counting from 0) that gives the number of units,
+ * e.g. "sqrt 15" or "strlen 2 1 0". Empty lines and lines starting with #
+ * are skipped.
+ *
+ * The costs can be followed by the memory the function reads or writes
+ * through its pointer arguments, each as "reads ARG for SIZE_ARG" or
+ * "writes ARG for SIZE_ARG": the function reads (or writes) as many bytes as
+ * the value of argument SIZE_ARG, starting at the address in argument ARG.
+ * For example, "strncpy 2 1 2 writes 0 for 2 reads 1 for 2".
+ *
+ * @param filename The filename to read and parse costs from.
+ * @param[out] error Describes the first problem found, if any.
+ * @return False if the file couldn't be opened or has a malformed line.
+ */
+bool LibCosts::parseFromFile(const std::string& filename, std::string& error) {
+	std::string line;
+	std::ifstream libcosts_file;
+
+	libcosts_file.open(filename.c_str());
+
+	if(!libcosts_file.is_open()) {
+		error = "library costs file (" + filename + ") could not be opened";
+		return false;
+	}
+
+	unsigned int line_no = 0;
+	while(getline(libcosts_file,line)) {
+		++line_no;
+
+		// tokenize the whitespace separated fields of this line
+		std::istringstream iss(line);
+
+		std::vector<std::string> tokens;
+		std::copy(std::istream_iterator<std::string>(iss), std::istream_iterator<std::string>(), std::back_inserter<std::vector<std::string> >(tokens));
+
+		// skip empty lines and comments
+		if(tokens.empty() || tokens[0][0] == '#') { continue; }
+
+		std::ostringstream where;
+		where << filename << ":" << line_no << ": ";
+
+		// should be of format "FUNC_NAME fixed_cost [per_unit_cost size_arg]"
+		// followed by any number of "reads|writes ARG for SIZE_ARG"
+		LibCost cost;
+		if(tokens.size() < 2 || !parseUnsigned(tokens[1], cost.fixed_cost)) {
+			error = where.str() + "expected a function name and its cost";
+			return false;
+		}
+
+		unsigned int next = 2;
+		if(tokens.size() >= 4 && tokens[2] != "reads" && tokens[2] != "writes") {
+			unsigned int size_arg;
+			if(!parseUnsigned(tokens[2], cost.per_unit_cost)
+				|| !parseUnsigned(tokens[3], size_arg)) {
+				error = where.str() + "per unit cost and size argument must be non-negative integers";
+				return false;
+			}
+			cost.size_arg = size_arg;
+			next = 4;
+		}
+
+		while(next < tokens.size()) {
+			LibMemAccess access;
+			access.is_write = tokens[next] == "writes";
+			if((tokens[next] != "reads" && !access.is_write)
+				|| next + 4 > tokens.size()
+				|| tokens[next + 2] != "for"
+				|| !parseUnsigned(tokens[next + 1], access.arg)
+				|| !parseUnsigned(tokens[next + 3], access.size_arg)) {
+				error = where.str() + "expected \"reads ARG for SIZE_ARG\" or \"writes ARG for SIZE_ARG\" at \"" + tokens[next] + "\"";
+				return false;
+			}
+			cost.mem_accesses.push_back(access);
+			next += 4;
+		}
+
+		costs[tokens[0]] = cost;
+	}
+
+	libcosts_file.close();
+	return true;
+}
+
+const LibCost* LibCosts::lookup(const std::string& func_name) const {
+	std::map<std::string, LibCost>::const_iterator it = costs.find(func_name);
+	if(it == costs.end()) return NULL;
+	return &it->second;
+}
+
+void LibCosts::getNames(std::vector<std::string>& names) const {
+	for(std::map<std::string, LibCost>::const_iterator it = costs.begin(),
+			it_end = costs.end(); it != it_end; ++it) {
+		names.push_back(it->first);
+	}
+}
@@ -0,0 +1,67 @@
+#ifndef LIB_COSTS_H
+#define LIB_COSTS_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ * Memory that a library function reads or writes through one of its
+ * pointer arguments: as many bytes as the value of the size_arg'th argument,
+ * starting at the arg'th one (both counting from 0).
+ */
+struct LibMemAccess {
+	unsigned int arg;
+	unsigned int size_arg;
+	bool is_write;
+};
+
+/**
+ * The estimated cost of one call to a library function.
+ *
+ * The cost is fixed_cost plus per_unit_cost times the value of the call's
+ * size_arg'th argument (counting from 0). If size_arg is negative, the cost
+ * is just fixed_cost.
+ */
+struct LibCost {
+	unsigned int fixed_cost;
+	unsigned int per_unit_cost;
+	int size_arg;
+	std::vector<LibMemAccess> mem_accesses;
+
+	LibCost() : fixed_cost(0), per_unit_cost(0), size_arg(-1) {}
+};
+
+/**
+ * Holds the costs of library functions that aren't instrumented, e.g. those
+ * in libm or a BLAS library. Calls to these are turned into calls to
+ * _KCallLib instead of being treated as calls into uninstrumented code.
+ */
+class LibCosts {
+	public:
+	/**
+	 * Adds the costs in a file.
+	 *
+	 * @param[out] error What is wrong with the file if it can't be parsed.
+	 * @return False if the file couldn't be opened or parsed.
+	 */
+	bool parseFromFile(const std::string& filename, std::string& error);
+
+	/**
+	 * @return The cost of the function with the given name, or NULL if it
+	 * has none.
+	 */
+	const LibCost* lookup(const std::string& func_name) const;
+
+	/**
+	 * Appends the names of all the functions with a cost to names.
+	 */
+	void getNames(std::vector<std::string>& names) const;
+
+	bool empty() const { return costs.empty(); }
+
+	private:
+	std::map<std::string, LibCost> costs;
+};
+
+#endif // LIB_COSTS_H
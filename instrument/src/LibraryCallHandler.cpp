@@ -0,0 +1,181 @@
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/CallSite.h>
+#include <llvm/IR/Constants.h>
+#include "foreach.h"
+#include "LLVMTypes.h"
+#include "LibraryCallHandler.h"
+#include "ReturnsRealValue.h"
+
+// for untangle() function
+#include "CallableHandler.h"
+
+using namespace llvm;
+using namespace std;
+
+// must match KREM_NO_DEST_REG in the runtime
+#define NO_DEST_REG 0xFFFFFFFF
+
+LibraryCallHandler::LibraryCallHandler(TimestampPlacer& ts_placer,
+										const LibCosts& lib_costs) :
+    log(PassLog::get()),
+    lib_costs(lib_costs),
+    ts_placer(ts_placer)
+{
+    opcodes.push_back(Instruction::Call);
+    opcodes.push_back(Instruction::Invoke);
+
+    Module& m = *ts_placer.getFunc().getParent();
+    LLVMTypes types(m.getContext());
+    vector<Type*> args;
+
+	// cost, dest ID, number of source IDs, number of ranges read, number of
+	// ranges written, followed by the source IDs and then the (address, size)
+	// of each range read and written
+	args.push_back(types.i64());
+	args.push_back(types.i32());
+	args.push_back(types.i32());
+	args.push_back(types.i32());
+	args.push_back(types.i32());
+	ArrayRef<Type*> *aref = new ArrayRef<Type*>(args);
+    FunctionType* call_lib_call = FunctionType::get(types.voidTy(), *aref, true);
+	delete aref;
+    call_lib_func = cast<Function>(
+        m.getOrInsertFunction("_KCallLib", call_lib_call));
+}
+
+const TimestampPlacerHandler::Opcodes& LibraryCallHandler::getOpcodes()
+{
+    return opcodes;
+}
+
+Value* LibraryCallHandler::getCost(Instruction& inst, const LibCost& cost)
+{
+    LLVMTypes types(inst.getContext());
+    CallSite call_site(&inst);
+
+	if(cost.size_arg < 0 || cost.per_unit_cost == 0) {
+		return ConstantInt::get(types.i64(), cost.fixed_cost);
+	}
+
+	if((unsigned)cost.size_arg >= call_site.arg_size()
+		|| !isa<IntegerType>(call_site.getArgument(cost.size_arg)->getType())
+	  ) {
+		LOG_WARN() << "size argument " << cost.size_arg
+			<< " of library call isn't an integer, using fixed cost: "
+			<< inst << "\n";
+		return ConstantInt::get(types.i64(), cost.fixed_cost);
+	}
+
+	Value* size = call_site.getArgument(cost.size_arg);
+
+	// sizes are unsigned (size_t)
+	if(ConstantInt* const_size = dyn_cast<ConstantInt>(size)) {
+		return ConstantInt::get(types.i64(), cost.fixed_cost
+					+ cost.per_unit_cost * const_size->getZExtValue());
+	}
+
+	size = CastInst::CreateIntegerCast(size, types.i64(), false,
+										"libcall_size", &inst);
+	Value* unit_cost = BinaryOperator::CreateMul(size,
+							ConstantInt::get(types.i64(), cost.per_unit_cost),
+							"libcall_unit_cost", &inst);
+	return BinaryOperator::CreateAdd(unit_cost,
+				ConstantInt::get(types.i64(), cost.fixed_cost),
+				"libcall_cost", &inst);
+}
+
+void LibraryCallHandler::handle(llvm::Instruction& inst)
+{
+	LOG_DEBUG() << "examining: " << inst << "\n";
+
+    LLVMTypes types(inst.getContext());
+
+	Function *called_func = NULL;
+	if(CallInst* call_inst = dyn_cast<CallInst>(&inst))
+		called_func = CallableHandler<CallInst>::untangleCall(*call_inst);
+	else
+		called_func = CallableHandler<InvokeInst>::untangleCall(*cast<InvokeInst>(&inst));
+
+	// Functions defined in this module are instrumented like any other.
+	if(called_func == NULL || !called_func->isDeclaration()) return;
+
+	const LibCost* cost = lib_costs.lookup(called_func->getName().str());
+	if(cost == NULL) return;
+
+	LOG_DEBUG() << "inst is a call to library function " << called_func->getName() << "\n";
+
+    vector<Value*> args;
+	args.push_back(getCost(inst, *cost));
+
+	bool returns_real_value = isa<CallInst>(inst)
+		? ReturnsRealValue()(*cast<CallInst>(&inst))
+		: ReturnsRealValue()(*cast<InvokeInst>(&inst));
+	if(returns_real_value)
+		args.push_back(ConstantInt::get(types.i32(),ts_placer.getId(inst))); // dest ID
+	else
+		args.push_back(ConstantInt::get(types.i32(),NO_DEST_REG));
+
+	// Non-pointer arguments are tracked like the args linked by
+	// CallableHandler. What pointer arguments point to is only tracked if
+	// the cost file says how much of it is read or written.
+	vector<Value*> srcs;
+    CallSite call_site(&inst);
+    for(CallSite::arg_iterator arg_it = call_site.arg_begin(), arg_end = call_site.arg_end(); arg_it != arg_end; ++arg_it)
+    {
+		Value* call_arg = *arg_it;
+		if(!isa<PointerType>(call_arg->getType()) && !isa<Constant>(call_arg))
+			srcs.push_back(call_arg);
+	}
+
+	// Memory read and written through pointer arguments, as given by the
+	// cost file.
+	vector<Value*> reads;
+	vector<Value*> writes;
+	foreach(const LibMemAccess& access, cost->mem_accesses) {
+		if(access.arg >= call_site.arg_size()
+			|| access.size_arg >= call_site.arg_size()
+			|| !isa<PointerType>(call_site.getArgument(access.arg)->getType())
+			|| !isa<IntegerType>(call_site.getArgument(access.size_arg)->getType())
+		  ) {
+			LOG_WARN() << "argument " << access.arg << " of library call isn't a pointer"
+				<< " or its size argument " << access.size_arg
+				<< " isn't an integer, ignoring it: " << inst << "\n";
+			continue;
+		}
+
+		vector<Value*>& ranges = access.is_write ? writes : reads;
+		Value* addr = call_site.getArgument(access.arg);
+		if(addr->getType() != types.pi8())
+			addr = CastInst::CreatePointerCast(addr, types.pi8(),
+												"libcall_addr", &inst);
+		ranges.push_back(addr);
+
+		// sizes are unsigned (size_t)
+		Value* size = call_site.getArgument(access.size_arg);
+		if(size->getType() != types.i64())
+			size = CastInst::CreateZExtOrBitCast(size, types.i64(),
+												"libcall_mem_size", &inst);
+		ranges.push_back(size);
+	}
+
+	args.push_back(ConstantInt::get(types.i32(),srcs.size())); // num srcs
+	args.push_back(ConstantInt::get(types.i32(),reads.size() / 2)); // num reads
+	args.push_back(ConstantInt::get(types.i32(),writes.size() / 2)); // num writes
+	foreach(Value* src, srcs) {
+		args.push_back(ConstantInt::get(types.i32(),ts_placer.getId(*src))); // src ID
+	}
+	args.insert(args.end(), reads.begin(), reads.end());
+	args.insert(args.end(), writes.begin(), writes.end());
+
+	ArrayRef<Value*> *aref = new ArrayRef<Value*>(args);
+	CallInst* call_lib_call = CallInst::Create(call_lib_func, *aref, "");
+	delete aref;
+
+	// Nothing here needs the result of the call so it goes right before it,
+	// just like a _KLinkReturn would.
+	ts_placer.constrainInstPlacement(*call_lib_call, inst);
+	foreach(Value* src, srcs) {
+		ts_placer.requireValTimestampBeforeUser(*src, *call_lib_call);
+	}
+}
@@ -0,0 +1,42 @@
+#ifndef LIBRARY_CALL_HANDLER
+#define LIBRARY_CALL_HANDLER
+
+#include <vector>
+#include "TimestampPlacerHandler.h"
+#include "TimestampPlacer.h"
+#include "LibCosts.h"
+#include "PassLog.h"
+
+/**
+ * Adds a _KCallLib before each call to a library function that has a cost
+ * in lib_costs. The call's result depends on its non-pointer arguments and
+ * is ready once the cost of the function has passed. Memory read or written
+ * through pointer arguments is only tracked if lib_costs lists it; the
+ * result then also depends on what is read, and what is written gets the
+ * result's timestamps.
+ */
+class LibraryCallHandler : public TimestampPlacerHandler
+{
+    public:
+    LibraryCallHandler(TimestampPlacer& ts_placer, const LibCosts& lib_costs);
+    virtual ~LibraryCallHandler() {};
+
+    virtual const Opcodes& getOpcodes();
+    virtual void handle(llvm::Instruction& inst);
+
+    private:
+	/**
+	 * Creates the cost of a call as an i64, computing it right before the
+	 * call if it depends on one of the arguments.
+	 */
+	llvm::Value* getCost(llvm::Instruction& inst, const LibCost& cost);
+
+    PassLog& log;
+    const LibCosts& lib_costs;
+    llvm::Function* call_lib_func;
+
+    Opcodes opcodes;
+    TimestampPlacer& ts_placer;
+};
+
+#endif // LIBRARY_CALL_HANDLER
@@ -7,7 +7,9 @@
 #include "LLVMTypes.h"
 #include "MemoryInstHelper.h"
 
-#define MAX_SPECIALIZED 5
+// _KLoad0 through _KLoad16 exist in the runtime; must match
+// MAX_SPECIALIZED_SRCS in KremlinProfiler.hpp
+#define MAX_SPECIALIZED 17
 
 using namespace llvm;
 using namespace boost;
@@ -5,7 +5,9 @@
 #include "PhiHandler.h"
 #include "LLVMTypes.h"
 
-#define MAX_SPECIALIZED 5
+// _KPhi1To1 through _KPhi16To1 exist in the runtime; must match
+// MAX_SPECIALIZED_SRCS in KremlinProfiler.hpp
+#define MAX_SPECIALIZED 17
 
 using namespace llvm;
 using namespace boost;
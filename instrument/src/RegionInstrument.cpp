@@ -8,6 +8,7 @@
 #include <llvm/IR/GlobalVariable.h>
 #include <llvm/IR/Instruction.h>
 #include <llvm/IR/Instructions.h>
+#include <llvm/IR/Intrinsics.h>
 #include <llvm/IR/Module.h>
 #include <llvm/Pass.h>
 #include <llvm/IR/CallSite.h>
@@ -308,9 +309,10 @@ namespace {
 
 			std::vector<Value*> op_args;
 
-			// set up args for call to _KEnterRegion(region_id,region_type) in the preheader
+			// set up args for call to _KEnterRegion(region_id,region_type,stack_ptr) in the preheader
 			op_args.push_back(ConstantInt::get(types.i64(),region_id));
 			op_args.push_back(ConstantInt::get(types.i32(),Region::REGION_TYPE_LOOP)); // 2nd arg = 1 means that this is a loop region
+			op_args.push_back(ConstantPointerNull::get(types.pi8())); // only function regions pass a stack pointer
 
 			// insert call right before we jump to the actual header
 			ArrayRef<Value*> *aref = new ArrayRef<Value*>(op_args);
@@ -332,6 +334,7 @@ namespace {
 			//std::string loop_body_name = loop->getHeader()->getName().str() + "_body";
 			op_args_loop_body.push_back(ConstantInt::get(types.i64(),body_region_id));
 			op_args_loop_body.push_back(ConstantInt::get(types.i32(),Region::REGION_TYPE_LOOP_BODY)); // loop body regions have type ID = 2
+			op_args_loop_body.push_back(ConstantPointerNull::get(types.pi8()));
 
 			SmallVector<BasicBlock*,16> exiting_bbs;
 			loop->getExitingBlocks(exiting_bbs);
@@ -870,14 +873,24 @@ namespace {
 			args.push_back(types.i32()); // 2nd arg is the region type
 
 			ArrayRef<Type*> *aref = new ArrayRef<Type*>(args);
+			logLandingPad_func = cast<Function>(m.getOrInsertFunction("_KLandingPad", FunctionType::get(types.voidTy(), *aref, false)));
+			delete aref;
+
+			// 3rd arg is the instrumented function's stack pointer (NULL for
+			// loops). The runtime reclaims the shadow memory of callee
+			// frames with it, so it has to come from the function itself
+			// rather than from a handler that may be inlined into it.
+			args.push_back(types.pi8());
+
+			aref = new ArrayRef<Type*>(args);
 			if(add_logRegionEntry_func) {
 				logRegionEntry_func = cast<Function>(m.getOrInsertFunction("_KEnterRegion", FunctionType::get(types.voidTy(), *aref, false)));
 				logRegionExit_func = cast<Function>(m.getOrInsertFunction("_KExitRegion", FunctionType::get(types.voidTy(), *aref, false)));
 			}
-
-			logLandingPad_func = cast<Function>(m.getOrInsertFunction("_KLandingPad", FunctionType::get(types.voidTy(), *aref, false)));
 			delete aref;
 
+			Function* stackSave_func = Intrinsic::getDeclaration(&m, Intrinsic::stacksave);
+
 			args.clear();
 
 
@@ -1070,6 +1083,7 @@ namespace {
 						if(add_logRegionExit_func) {
 							op_args.push_back(ConstantInt::get(types.i64(),func_region_id));
 							op_args.push_back(ConstantInt::get(types.i32(),Region::REGION_TYPE_FUNC));
+							op_args.push_back(CallInst::Create(stackSave_func, "kremlin_sp", insert_before));
 							ArrayRef<Value*> *aref = new ArrayRef<Value*>(op_args);
 							CallInst::Create(logRegionExit_func, *aref, "", insert_before);
 							delete aref;
@@ -1117,8 +1131,10 @@ namespace {
 					// finally, we insert call to _KEnterRegion() for the beginning of this function
 					op_args.push_back(ConstantInt::get(types.i64(),func_region_id));
 					op_args.push_back(ConstantInt::get(types.i32(),Region::REGION_TYPE_FUNC)); // 0 for 2nd arg means this is a function region
+					CallInst* stack_ptr = CallInst::Create(stackSave_func, "kremlin_sp", func.getEntryBlock().getFirstNonPHI());
+					op_args.push_back(stack_ptr);
 					ArrayRef<Value*> *aref = new ArrayRef<Value*>(op_args);
-					CallInst::Create(logRegionEntry_func, *aref, "", func.getEntryBlock().getFirstNonPHI());
+					CallInst::Create(logRegionEntry_func, *aref, "")->insertAfter(stack_ptr);
 					delete aref;
 					op_args.clear();
 				}
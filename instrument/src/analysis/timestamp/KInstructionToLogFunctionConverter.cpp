@@ -10,7 +10,9 @@
 #include "LLVMTypes.h"
 #include "foreach.h"
 
-#define NUM_SPECIALIZED 8
+// _KTimestamp0 through _KTimestamp16 exist in the runtime; must match
+// MAX_SPECIALIZED_SRCS in KremlinProfiler.hpp
+#define NUM_SPECIALIZED 17
 
 using namespace llvm;
 using namespace boost;
@@ -13,6 +13,7 @@ public class TraceEntry {
 	long recursionTarget;
 	long totalChildCnt, minChildCnt, maxChildCnt;
 	boolean pbit;
+	boolean sampled; // stats are extrapolated from a sample
 	Set<Long> childrenSet;
 	List<CRegionStat> statList;
 	
@@ -28,8 +29,8 @@ public class TraceEntry {
 	}
 
 	public String toString() {
-		return String.format("id: %d sid: %16x cid: %16x type: %d rtarget: %d instance: %4d pbit %s nChildren: %d nStats: %d",
-				uid, sid, callsiteID, type, recursionTarget, cnt, pbit, childrenSet.size(), statList.size());
+		return String.format("id: %d sid: %16x cid: %16x type: %d rtarget: %d instance: %4d pbit %s sampled %s nChildren: %d nStats: %d",
+				uid, sid, callsiteID, type, recursionTarget, cnt, pbit, sampled, childrenSet.size(), statList.size());
 	}
 	
 	TraceEntry setNumInstance(long instance) {
@@ -47,6 +48,11 @@ public class TraceEntry {
 		return this;
 	}
 	
+	TraceEntry setSampled(boolean s) {
+		this.sampled = s;
+		return this;
+	}
+	
 	TraceEntry addStat(CRegionStat stat) {
 		statList.add(stat);
 		return this;
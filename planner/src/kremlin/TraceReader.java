@@ -1,52 +1,152 @@
 package kremlin;
 
+import java.io.BufferedInputStream;
 import java.io.DataInputStream;
+import java.io.EOFException;
 import java.io.FileInputStream;
+import java.io.IOException;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
 import java.util.*;
 
 /*
  * Class to create TraceEntries out of our profiling output file.
+ * Reads both the current (version 2) format and the older headerless
+ * version 1 format; see runtime/src/ProfileFormat.h for both layouts.
  */
 public class TraceReader {
 	List<TraceEntry> list; // list of all trace entries we read in
 	Map<Long, TraceEntry> map; // mapping from unique id to trace entry
 
+	// set in the node type of entries whose stats were extrapolated from a
+	// sample of their instances
+	static final long SAMPLED_FLAG = 0x100;
+
+	static final byte[] MAGIC = { 'K', 'R', 'E', 'M', 'P', 'R', 'O', 'F' };
+	static final int HEADER_SIZE = 32; // not counting the magic
+	static final int BYTE_ORDER_MARK = 0x01020304;
+	static final int FORMAT_VERSION = 2;
+
 	public TraceReader(String file) {
 		list = new ArrayList<TraceEntry>();
 		map = new HashMap<Long, TraceEntry>();
 
 		try {
-			DataInputStream input =  new DataInputStream(new FileInputStream(file));			
-		
-			while(true) {				
+			DataInputStream input = new DataInputStream(
+				new BufferedInputStream(new FileInputStream(file), 1 << 20));
+
+			if (hasMagic(input))
+				readVersion2(input);
+			else
+				readVersion1(input);
+
+			input.close();
+
+		} catch(Exception e) {
+			e.printStackTrace();
+			assert(false);
+		}
+	}
+
+	/*
+	 * Checks whether the file starts with the version 2 magic. If not, the
+	 * stream is rewound to the beginning.
+	 */
+	private static boolean hasMagic(DataInputStream input) throws IOException {
+		input.mark(MAGIC.length);
+		byte[] magic = new byte[MAGIC.length];
+		try {
+			input.readFully(magic);
+		} catch (EOFException e) {
+			input.reset();
+			return false;
+		}
+		if (Arrays.equals(magic, MAGIC)) return true;
+		input.reset();
+		return false;
+	}
+
+	private void readVersion2(DataInputStream input) throws IOException {
+		byte[] headerBytes = new byte[HEADER_SIZE];
+		input.readFully(headerBytes);
+		ByteBuffer header = ByteBuffer.wrap(headerBytes).order(ByteOrder.LITTLE_ENDIAN);
+		if (header.getInt(4) != BYTE_ORDER_MARK)
+			header.order(ByteOrder.BIG_ENDIAN);
+
+		int version = header.getInt(0);
+		if (version != FORMAT_VERSION || header.getInt(4) != BYTE_ORDER_MARK)
+			throw new IOException("unsupported profile version " + version);
+		long nNodes = header.getLong(16);
+
+		// the node index that follows the records is only needed for random
+		// access, so we stop after the last record
+		long prevUid = 0;
+		for (long n = 0; n < nNodes; n++) {
+			long uid = prevUid + readSignedVarint(input);
+			prevUid = uid;
+			long sid = readVarint(input);
+			long callsiteID = readVarint(input);
+			TraceEntry entry = newEntry(uid, sid, callsiteID, readVarint(input));
+
+			long recurse = readSignedVarint(input);
+			if (recurse != 0)
+				entry.setRecursionTarget(uid + recurse);
+
+			long cnt = readVarint(input);
+			long pbit = readVarint(input);
+			entry.setNumInstance(cnt).setPBit(pbit != 0);
+
+			long nChildren = readVarint(input);
+			for (long i = 0; i < nChildren; i++)
+				entry.addChild(uid + readSignedVarint(input));
+
+			long nStats = readVarint(input);
+			for (long i = 0; i < nStats; i++) {
+				long nInstance = readVarint(input);
+				long work = readVarint(input);
+				long tpWork = readVarint(input);
+				long spWork = readVarint(input);
+				double minSP = readVarint(input) / 100.0;
+				double maxSP = readVarint(input) / 100.0;
+				long totalIter = readVarint(input);
+				long minIter = readVarint(input);
+				long maxIter = readVarint(input);
+				entry.addStat(new CRegionStat(nInstance, work, tpWork, spWork, minSP, maxSP, totalIter, minIter, maxIter));
+			}
+
+			addEntry(entry);
+		}
+	}
+
+	private void readVersion1(DataInputStream input) throws IOException {
+		try {
+			while(true) {
 				//Map<Long, Long> childrenMap = new HashMap<Long, Long>();
 				long uid = Long.reverseBytes(input.readLong());
 				long sid = Long.reverseBytes(input.readLong());
 				long callsiteID = Long.reverseBytes(input.readLong());
 				long type = Long.reverseBytes(input.readLong());
-				assert(type >=0 && type <= 2);
-				
-				TraceEntry entry = new TraceEntry(uid, sid, callsiteID, type);
-				map.put(uid, entry);
+
+				TraceEntry entry = newEntry(uid, sid, callsiteID, type);
 				long recurse = Long.reverseBytes(input.readLong());
 				if (recurse != 0)
 					entry.setRecursionTarget(recurse);
-				
+
 				long cnt = Long.reverseBytes(input.readLong());
-				long pbit = Long.reverseBytes(input.readLong());				
+				long pbit = Long.reverseBytes(input.readLong());
 				entry.setNumInstance(cnt).setPBit(pbit != 0);
-				
+
 				long nChildren = Long.reverseBytes(input.readLong());
 				for (int i=0; i<nChildren; i++) {
 					long childUid = Long.reverseBytes(input.readLong());
 					entry.addChild(childUid);
 					//System.out.printf(" %d ", childUid);
-				}				
-				
+				}
+
 				long nStats = Long.reverseBytes(input.readLong());
 				//System.out.printf("\nid: %d sid: %x cid: %x type: %d rtarget: %d instance: %d pbit %d nChildren: %d nStats: %d\n",
 						//uid, sid, callsiteID, type, recurse, cnt, pbit, nChildren, nStats);
-				
+
 				// Create a CRegionStat for each stat and add that to the list
 				// of stats for the current TraceEntry.
 				for (int i=0; i<nStats; i++) {
@@ -56,43 +156,71 @@ public class TraceReader {
 					long spWork = Long.reverseBytes(input.readLong());
 					double minSP = (Long.reverseBytes(input.readLong())) / 100.0;
 					double maxSP = (Long.reverseBytes(input.readLong())) / 100.0;
-					long totalIter = Long.reverseBytes(input.readLong());				
+					long totalIter = Long.reverseBytes(input.readLong());
 					long minIter = Long.reverseBytes(input.readLong());
 					long maxIter = Long.reverseBytes(input.readLong());
 					CRegionStat toAdd = new CRegionStat(nInstance, work, tpWork, spWork, minSP, maxSP, totalIter, minIter, maxIter);
 					entry.addStat(toAdd);
 					//System.out.printf("\tinstances: %d, work: %d, cp = %d, spWork = %d, minSP = %.2f, maxSP =  %.2f, totalIter = %d, %d, %d\n", nInstance, work, tpWork, spWork, minSP, maxSP, totalIter, minIter, maxIter);
 				}
-				
+
 				//System.out.printf("[%d %d %d] instance = %d\n", totalChildCnt, minChildCnt, maxChildCnt, cnt);
-				//, cnt, work, tpWork, spWork, childrenSet);				
-
-				// TODO: XXX FIXME WTF is with these next 6 lines of code?
-				long totalChildCnt = 0;
-				long minChildCnt = 0;
-				long maxChildCnt = 0;
-				entry.totalChildCnt = totalChildCnt;
-				entry.minChildCnt = minChildCnt;
-				entry.maxChildCnt = maxChildCnt;
-				
-				list.add(entry);
-			}
-			
-		} catch(Exception e) {			
-			if (e instanceof java.io.EOFException == false) {
-				e.printStackTrace();
-				assert(false);
+				//, cnt, work, tpWork, spWork, childrenSet);
+
+				addEntry(entry);
 			}
+		} catch(EOFException e) {
+			// end of the profile
 		}
 	}
-	
+
+	/*
+	 * Creates an entry, splitting the sampled flag off the node type.
+	 */
+	private TraceEntry newEntry(long uid, long sid, long callsiteID, long type) {
+		boolean sampled = (type & SAMPLED_FLAG) != 0;
+		type &= ~SAMPLED_FLAG;
+		assert(type >=0 && type <= 2);
+
+		TraceEntry entry = new TraceEntry(uid, sid, callsiteID, type);
+		entry.setSampled(sampled);
+		map.put(uid, entry);
+		return entry;
+	}
+
+	private void addEntry(TraceEntry entry) {
+		// TODO: XXX FIXME WTF is with these next 6 lines of code?
+		long totalChildCnt = 0;
+		long minChildCnt = 0;
+		long maxChildCnt = 0;
+		entry.totalChildCnt = totalChildCnt;
+		entry.minChildCnt = minChildCnt;
+		entry.maxChildCnt = maxChildCnt;
+
+		list.add(entry);
+	}
+
+	private static long readVarint(DataInputStream input) throws IOException {
+		long value = 0;
+		for (int shift = 0; ; shift += 7) {
+			int b = input.readUnsignedByte();
+			value |= (long)(b & 0x7f) << shift;
+			if (b < 0x80) return value;
+		}
+	}
+
+	private static long readSignedVarint(DataInputStream input) throws IOException {
+		long u = readVarint(input);
+		return (u >>> 1) ^ -(u & 1);
+	}
+
 	List<TraceEntry> getTraceList() { return list; }
-	
+
 	/*
 	 * Given a unique id, return associated trace entry.
 	 */
 	TraceEntry getEntry(long id) { return map.get(id); }
-	
+
 	/*
 	 * Prints out all trace entries we read in.
 	 */
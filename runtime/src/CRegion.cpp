@@ -1,5 +1,15 @@
 #include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <map>
 #include <stack>
+#include <vector>
+#include <string>
+#include <algorithm> // for std::sort
 #include <utility> // for std::pair
 #include <sstream>
 
@@ -10,20 +20,67 @@
 #include "CRegion.h"
 #include "ProfileNode.hpp"
 #include "ProfileNodeStats.hpp"
-
-static std::stack<ProfileNode*> c_region_stack;
+#include "ProfileNodeSketch.hpp"
+#include "ProfileFormat.h"
 
 static void pushOnRegionStack(ProfileNode* node);
 static ProfileNode* popFromRegionStack();
 
+static UInt64 extrapolateSampledStats(ProfileNode* node, double parent_scale);
 static void writeProgramStats(const char* filename);
-static void writeRegionStats(FILE* fp, ProfileNode* node, UInt level);
+class ProfileWriter;
+static void writeRegionStats(ProfileWriter& out, ProfileNode* node, UInt level);
+static void writeSketches(ProfileWriter& out);
 
 /******************************** 
  * CPosition Management 
  *********************************/
-static ProfileNode* region_tree_root; // TODO: make member var of profiler?
-static ProfileNode* curr_region_node; // TODO: make mem var of profiler?
+struct RegionTree {
+	ProfileNode* root;
+	ProfileNode* curr; //!< The currently active region node.
+	std::stack<ProfileNode*> stack;
+	bool checkpointed; //!< True if changed nodes are tracked for checkpoints.
+	std::vector<ProfileNode*> dirty; //!< Nodes changed since the last checkpoint.
+
+	RegionTree() : root(NULL), curr(NULL), checkpointed(false) {}
+};
+
+// TRICKY: threads share the tree of the thread that runs main unless threads
+// are profiled separately, in which case each worker gets its own tree.
+static RegionTree* main_region_tree; // TODO: make member var of profiler?
+static __thread RegionTree* thread_region_tree;
+
+static void writeRegionTree(FILE* fp, RegionTree* tree);
+static void writeCheckpointRecords(FILE* fp, std::vector<ProfileNode*>& nodes);
+
+static inline RegionTree* getRegionTree() {
+	return thread_region_tree != NULL ? thread_region_tree : main_region_tree;
+}
+
+/*!
+ * Remembers that a node changed so that the next checkpoint includes it.
+ * Nothing is tracked unless the tree is being checkpointed.
+ */
+static inline void markDirty(RegionTree* tree, ProfileNode* node) {
+	if (!tree->checkpointed || node->checkpoint_dirty || node == tree->root)
+		return;
+	node->checkpoint_dirty = true;
+	tree->dirty.push_back(node);
+}
+
+// Region trees of worker threads that have finished, waiting to be merged
+// into the main thread's tree when the profile is written.
+static std::vector<ProfileNode*> finished_thread_trees;
+static unsigned num_running_thread_trees = 0; // started but not finished
+static bool profile_written = false;
+static pthread_mutex_t finished_trees_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void mergeThreadTrees();
+static void takeCheckpoint(RegionTree* tree);
+
+// Set by the checkpoint thread when a checkpoint is due.
+static volatile int checkpoint_requested = 0;
+static pthread_t checkpoint_owner; // thread whose tree is checkpointed
 
 /*!
  * Returns a string representing the ID of the curent region node.
@@ -32,7 +89,7 @@ static ProfileNode* curr_region_node; // TODO: make mem var of profiler?
  * currently active (or 0 if no region is active).
  */
 static const char* getCurrentRegionIDString() {
-	ProfileNode* node = curr_region_node;
+	ProfileNode* node = getRegionTree()->curr;
 	UInt64 nodeId = (node == NULL) ? 0 : node->id;
 	std::stringstream ss;
 	ss << "<" << nodeId << ">";
@@ -44,7 +101,7 @@ static const char* getCurrentRegionIDString() {
  */
 static void printCurrRegionNode() {
 	MSG(DEBUG_CREGION, "Curr %s Node: %s\n", getCurrentRegionIDString(), 
-			curr_region_node->toString());
+			getRegionTree()->curr->toString());
 }
 
 
@@ -53,129 +110,218 @@ static void printCurrRegionNode() {
  *********************************/
 
 void initRegionTree() {
-	assert(region_tree_root == NULL);
-	region_tree_root = new ProfileNode(0, 0, RegionFunc);
-	curr_region_node = region_tree_root;
-	assert(region_tree_root != NULL);
-	assert(region_tree_root == curr_region_node);
+	RegionTree* tree = new RegionTree();
+	if (main_region_tree == NULL) main_region_tree = tree;
+	else {
+		thread_region_tree = tree;
+		pthread_mutex_lock(&finished_trees_lock);
+		num_running_thread_trees++;
+		pthread_mutex_unlock(&finished_trees_lock);
+	}
+
+	assert(getRegionTree() == tree);
+	tree->root = new ProfileNode(0, 0, RegionFunc);
+	tree->curr = tree->root;
+	assert(tree->root != NULL);
+	assert(tree->root == tree->curr);
 }
 
 void printProfiledData(const char* filename) {
 	assert(filename != NULL);
-	assert(region_tree_root != NULL);
-	assert(!c_region_stack.empty());
+	assert(getRegionTree()->root != NULL);
+	assert(!getRegionTree()->stack.empty());
+	if (kremlin_config.profileThreads()) mergeThreadTrees();
 	writeProgramStats(filename);
 }
 
+/*!
+ * Deletes the calling thread's region tree state (but not the nodes).
+ */
+static void releaseRegionTree() {
+	if (thread_region_tree != NULL) {
+		delete thread_region_tree;
+		thread_region_tree = NULL;
+	}
+	else {
+		delete main_region_tree;
+		main_region_tree = NULL;
+	}
+}
+
 void deinitRegionTree() {
-	assert(region_tree_root != NULL);
-	assert(curr_region_node == region_tree_root);
-	delete region_tree_root;
-	curr_region_node = region_tree_root = NULL;
+	RegionTree* tree = getRegionTree();
+	assert(tree->root != NULL);
+	assert(tree->curr == tree->root);
+	delete tree->root;
+	releaseRegionTree();
 }
 
-void openRegionContext(SID region_static_id, CID region_callsite_id, 
-						RegionType region_type) {
-	assert(region_tree_root != NULL);
-	assert(curr_region_node != NULL);
-	unsigned prev_stack_size = c_region_stack.size();
+void detachRegionTree() {
+	assert(thread_region_tree != NULL);
+	assert(thread_region_tree->root != NULL);
+	assert(thread_region_tree->curr == thread_region_tree->root);
 
-	ProfileNode* parent = curr_region_node;
+	pthread_mutex_lock(&finished_trees_lock);
+	num_running_thread_trees--;
+	if (profile_written) {
+		// This thread outlived main so there is nothing left to merge into.
+		delete thread_region_tree->root;
+	}
+	else {
+		finished_thread_trees.push_back(thread_region_tree->root);
+	}
+	pthread_mutex_unlock(&finished_trees_lock);
 
-	MSG(DEBUG_CREGION, "openRegionContext: static_id: 0x%llx -> 0x%llx, callSite: 0x%llx\n", 
-		parent->static_id, region_static_id, region_callsite_id);
+	releaseRegionTree();
+}
 
+/*!
+ * Returns the child of a node with the given static and callsite ID, creating
+ * a new ProfileNode for it if there is no such child yet.
+ */
+static ProfileNode* getOrCreateChild(RegionTree* tree, ProfileNode* parent, 
+										SID region_static_id, 
+										CID region_callsite_id, 
+										RegionType region_type) {
 	ProfileNode* child = parent->getChild(region_static_id, region_callsite_id);
-
-	// If no child was found with this static and callsite ID, we'll create a
-	// new ProfileNode for this child.
 	if (child == NULL) {
-		// TODO: make body of this if statement a separate function
 		child = new ProfileNode(region_static_id, region_callsite_id, region_type); // XXX: mem leak
 		parent->addChild(child);
 		if (kremlin_config.summarizeRecursiveRegions())
 			child->handleRecursion();
+
+		markDirty(tree, parent);
+		markDirty(tree, child);
+		if (child->recursion != NULL) markDirty(tree, child->recursion);
 	} 
+	return child;
+}
+
+void openRegionContext(SID region_static_id, CID region_callsite_id, 
+						RegionType region_type) {
+	RegionTree* tree = getRegionTree();
+	assert(tree->root != NULL);
+	assert(tree->curr != NULL);
+#ifndef NDEBUG
+	unsigned prev_stack_size = tree->stack.size();
+#endif
+
+	ProfileNode* parent = tree->curr;
+
+	MSG(DEBUG_CREGION, "openRegionContext: static_id: 0x%llx -> 0x%llx, callSite: 0x%llx\n", 
+		parent->static_id, region_static_id, region_callsite_id);
 
+	ProfileNode* child = getOrCreateChild(tree, parent, region_static_id, 
+											region_callsite_id, region_type);
 	child->moveToNextStats();
 
 	// set position, push the current region to the current tree
 	switch (child->node_type) {
 		case R_INIT:
-			curr_region_node = child;
+			tree->curr = child;
 			break;
 		case R_SINK:
 			assert(child->recursion != NULL);
-			curr_region_node = child->recursion;
+			tree->curr = child->recursion;
 			child->recursion->moveToNextStats();
 			break;
 		case NORMAL:
-			curr_region_node = child;
+			tree->curr = child;
 			break;
 	}
 	pushOnRegionStack(child);
 	printCurrRegionNode();
 
 	MSG(DEBUG_CREGION, "openRegionContext: End\n"); 
-	assert(!c_region_stack.empty());
+	assert(!tree->stack.empty());
 	assert(child->curr_stat_index >= 0);
-	assert(c_region_stack.size() == prev_stack_size+1);
+	assert(tree->stack.size() == prev_stack_size+1);
 	assert(child->node_type != R_SINK);
 }
 
 void closeRegionContext(RegionStats *region_stats) {
+	RegionTree* tree = getRegionTree();
 	assert(region_stats != NULL);
-	assert(!c_region_stack.empty());
-	assert(region_tree_root != NULL);
-	assert(curr_region_node != NULL);
-	assert(curr_region_node->curr_stat_index >= 0);
-	assert(curr_region_node != region_tree_root);
-	assert(curr_region_node->parent != NULL); // redundant with curr != root?
-	unsigned prev_stack_size = c_region_stack.size();
+	assert(!tree->stack.empty());
+	assert(tree->root != NULL);
+	assert(tree->curr != NULL);
+	assert(tree->curr->curr_stat_index >= 0);
+	assert(tree->curr != tree->root);
+	assert(tree->curr->parent != NULL); // redundant with curr != root?
+#ifndef NDEBUG
+	unsigned prev_stack_size = tree->stack.size();
+#endif
 
 	MSG(DEBUG_CREGION, "closeRegionContext: Begin\n"); 
-	MSG(DEBUG_CREGION, "Curr %s Node: %s\n", getCurrentRegionIDString(), curr_region_node->toString());
+	MSG(DEBUG_CREGION, "Curr %s Node: %s\n", getCurrentRegionIDString(), tree->curr->toString());
 
 #if 0
 	// don't update stats if we didn't give it any region_stats
 	// this happens when we are out of range for logging
 	if (region_stats != NULL) {
-		assert(curr_region_node != NULL);
-		curr_region_node->update(region_stats);
+		assert(tree->curr != NULL);
+		tree->curr->update(region_stats);
 	}
 #endif
 
-	curr_region_node->addStats(region_stats);
+	tree->curr->addStats(region_stats);
+	markDirty(tree, tree->curr);
 
-	MSG(DEBUG_CREGION, "Updating Current Node - ID: %llu, Stat Index: %d\n", curr_region_node->id, 
-		curr_region_node->curr_stat_index);
-	curr_region_node->moveToPrevStats();
+	MSG(DEBUG_CREGION, "Updating Current Node - ID: %llu, Stat Index: %d\n", tree->curr->id, 
+		tree->curr->curr_stat_index);
+	tree->curr->moveToPrevStats();
 
-	// By construction, curr_region_node will never be an R_SINK: it will
+	// By construction, the current node will never be an R_SINK: it will
 	// always move to the associated R_INIT. Also, a node will only be an
 	// R_INIT if it has a corresponding R_SINK. Therefore, if the current node
 	// is an R_INIT, then we don't want to go to the parent node of the
 	// current node, we want the parent node of the region that is at the top
 	// of the region stack (i.e. the parent of the R_SINK node).
 	ProfileNode* exited_region = popFromRegionStack();
-	if (curr_region_node->node_type == R_INIT) {
-		curr_region_node = exited_region->parent;
+	if (tree->curr->node_type == R_INIT) {
+		tree->curr = exited_region->parent;
 	}
 	else {
-		curr_region_node = curr_region_node->parent;
+		tree->curr = tree->curr->parent;
 	}
 
 	if (exited_region->node_type == R_SINK) {
 		exited_region->addStats(region_stats);
+		markDirty(tree, exited_region);
 		MSG(DEBUG_CREGION, "Updating R_SINK Node - ID: %llu, Stat Index: %d\n", exited_region->id, 
 			exited_region->curr_stat_index);
 		exited_region->moveToPrevStats();
 	} 
 	printCurrRegionNode();
 	MSG(DEBUG_CREGION, "closeRegionContext: End \n"); 
-	assert(c_region_stack.size() == prev_stack_size-1);
+	assert(tree->stack.size() == prev_stack_size-1);
+
+	if (checkpoint_requested && pthread_equal(pthread_self(), checkpoint_owner))
+		takeCheckpoint(tree);
+}
+
+UInt64 getNumRegionContextInstances(SID region_static_id, 
+									CID region_callsite_id) {
+	RegionTree* tree = getRegionTree();
+	assert(tree->curr != NULL);
+	ProfileNode* child = tree->curr->getChild(region_static_id, region_callsite_id);
+	return (child == NULL) ? 0 : child->num_instances;
 }
 
+void skipRegionContext(SID region_static_id, CID region_callsite_id, 
+						RegionType region_type, UInt64 work) {
+	RegionTree* tree = getRegionTree();
+	assert(tree->curr != NULL);
+
+	MSG(DEBUG_CREGION, "skipRegionContext: static_id: 0x%llx, work: %llu\n", 
+		region_static_id, work);
+
+	ProfileNode* child = getOrCreateChild(tree, tree->curr, region_static_id, 
+											region_callsite_id, region_type);
+	child->num_skipped++;
+	child->skipped_work += work;
+	markDirty(tree, child);
+}
 
 
 /*!
@@ -186,12 +332,13 @@ void closeRegionContext(RegionStats *region_stats) {
  * @post The region stack will not be empty.
  */
 void pushOnRegionStack(ProfileNode* node) {
+	RegionTree* tree = getRegionTree();
 	assert(node != NULL);
 	MSG(DEBUG_CREGION, "pushOnRegionStack: ");
 	MSG(DEBUG_CREGION, "%s\n", node->toString());
 
-	c_region_stack.push(node);
-	assert(!c_region_stack.empty());
+	tree->stack.push(node);
+	assert(!tree->stack.empty());
 }
 
 /*!
@@ -202,11 +349,12 @@ void pushOnRegionStack(ProfileNode* node) {
  * @post The returned node will be non-NULL.
  */
 ProfileNode* popFromRegionStack() {
-	assert(!c_region_stack.empty());
+	RegionTree* tree = getRegionTree();
+	assert(!tree->stack.empty());
 	MSG(DEBUG_CREGION, "popFromRegionStack: ");
 
-	ProfileNode* ret = c_region_stack.top();
-	c_region_stack.pop();
+	ProfileNode* ret = tree->stack.top();
+	tree->stack.pop();
 	MSG(DEBUG_CREGION, "%s\n", ret->toString());
 
 	assert(ret != NULL);
@@ -216,6 +364,360 @@ ProfileNode* popFromRegionStack() {
 
 
 
+/*!
+ * Folds the region trees of all finished worker threads into the tree of the
+ * calling (i.e. main) thread. Each top-level region of a worker (usually the
+ * thread's start function) becomes a child of the main region that ran
+ * concurrently with it (see ProfileNodeStats::addConcurrentChild). Workers
+ * that haven't finished yet are left out and reported.
+ *
+ * @pre The region tree has been initialized (i.e. is non-NULL)
+ * @pre There is exactly one child of the root region (i.e. main)
+ * @post No finished thread trees remain.
+ */
+static void mergeThreadTrees() {
+	RegionTree* tree = getRegionTree();
+	assert(tree->root != NULL);
+	assert(tree->root->getNumChildren() == 1);
+
+	pthread_mutex_lock(&finished_trees_lock);
+	profile_written = true;
+
+	if (num_running_thread_trees > 0) {
+		fprintf(stderr, "[kremlin] WARNING: %u threads were still running "
+				"when main exited; their regions aren't in the profile\n", 
+				num_running_thread_trees);
+	}
+
+	ProfileNode* main_node = tree->root->children[0];
+	assert(main_node->getStatSize() > 0);
+	ProfileNodeStats* main_stats = main_node->stats[0];
+
+	std::map<ProfileNode*, ProfileNode*> merged;
+	for (unsigned i = 0; i < finished_thread_trees.size(); ++i) {
+		ProfileNode* thread_root = finished_thread_trees[i];
+		MSG(DEBUG_CREGION, "mergeThreadTrees: merging tree of thread %u\n", i);
+
+		for (unsigned j = 0; j < thread_root->children.size(); ++j) {
+			ProfileNode* top = thread_root->children[j];
+			// deeper stats are for recursive instances nested in these
+			if (top->getStatSize() > 0)
+				main_stats->addConcurrentChild(top->stats[0]);
+
+			ProfileNode* match = main_node->getChild(top->static_id, top->callsite_id);
+			if (match == NULL) {
+				main_node->addChild(top);
+			}
+			else {
+				match->mergeFrom(top, merged);
+				delete top;
+			}
+		}
+		thread_root->releaseChildren();
+		delete thread_root;
+	}
+	finished_thread_trees.clear();
+	pthread_mutex_unlock(&finished_trees_lock);
+
+	tree->root->redirectRecursionTargets(merged);
+}
+
+/******************************** 
+ * Checkpoints
+ *********************************/
+
+/*
+ * The checkpoint thread sets checkpoint_requested once every period. The
+ * owning thread encodes the nodes of its tree that changed since the last
+ * checkpoint (see markDirty) when it sees the flag (see closeRegionContext)
+ * and hands them to the checkpoint thread as a new epoch, which the
+ * checkpoint thread appends to the checkpoint file (see ProfileFormat.h).
+ *
+ * Only the changed nodes are encoded, so the owning thread's cost at that
+ * region exit is proportional to how much of the tree was active during the
+ * period rather than to the size of the tree. The file I/O happens on the
+ * checkpoint thread. The time spent encoding is printed when checkpoints
+ * stop.
+ */
+
+/*!
+ * The records of one checkpoint, waiting to be appended.
+ */
+struct CheckpointEpoch {
+	UInt64 epoch;
+	UInt64 num_nodes;
+	char* records;
+	size_t size;
+};
+
+struct CheckpointState {
+	std::string filename;
+	FILE* fp;
+	unsigned period;
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	bool running;
+	bool stopping;
+	std::vector<CheckpointEpoch> pending; //!< Epochs not yet appended.
+	unsigned num_taken;
+	unsigned num_written;
+	UInt64 num_records; //!< Node records over all epochs.
+	UInt64 serialize_ns_total; //!< Time the owner spent in takeCheckpoint.
+	UInt64 serialize_ns_max;
+
+	CheckpointState() : fp(NULL), period(0), running(false), stopping(false), 
+						num_taken(0), num_written(0), num_records(0),
+						serialize_ns_total(0), serialize_ns_max(0) {
+		pthread_mutex_init(&lock, NULL);
+		pthread_cond_init(&cond, NULL);
+	}
+};
+
+static CheckpointState checkpoints;
+
+/*!
+ * Encodes the nodes that changed since the last checkpoint and hands them
+ * to the checkpoint thread as the next epoch.
+ */
+static void takeCheckpoint(RegionTree* tree) {
+	checkpoint_requested = 0;
+
+	struct timespec start, end;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	CheckpointEpoch epoch;
+	epoch.epoch = checkpoints.num_taken;
+	epoch.num_nodes = tree->dirty.size();
+	epoch.records = NULL;
+	epoch.size = 0;
+	FILE* fp = open_memstream(&epoch.records, &epoch.size);
+	if (fp == NULL) return;
+	writeCheckpointRecords(fp, tree->dirty);
+	fclose(fp);
+
+	for (unsigned i = 0; i < tree->dirty.size(); ++i)
+		tree->dirty[i]->checkpoint_dirty = false;
+	tree->dirty.clear();
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	UInt64 ns = (end.tv_sec - start.tv_sec) * 1000000000ULL 
+				+ end.tv_nsec - start.tv_nsec;
+
+	MSG(DEBUG_CREGION, "takeCheckpoint: %llu nodes, %llu bytes in %llu ns\n", 
+		(unsigned long long)epoch.num_nodes, (unsigned long long)epoch.size,
+		(unsigned long long)ns);
+
+	pthread_mutex_lock(&checkpoints.lock);
+	checkpoints.num_taken++;
+	checkpoints.num_records += epoch.num_nodes;
+	checkpoints.serialize_ns_total += ns;
+	if (ns > checkpoints.serialize_ns_max) checkpoints.serialize_ns_max = ns;
+	checkpoints.pending.push_back(epoch);
+	pthread_cond_signal(&checkpoints.cond);
+	pthread_mutex_unlock(&checkpoints.lock);
+}
+
+/*!
+ * Appends an epoch to the checkpoint file and syncs it to disk.
+ */
+static void appendCheckpointEpoch(const CheckpointEpoch& epoch) {
+	if (checkpoints.fp == NULL) return;
+
+	ProfileCheckpointEpoch header;
+	header.epoch = epoch.epoch;
+	header.num_nodes = epoch.num_nodes;
+	header.size = epoch.size;
+
+	bool ok = fwrite(&header, sizeof(header), 1, checkpoints.fp) == 1;
+	ok = (fwrite(epoch.records, 1, epoch.size, checkpoints.fp) == epoch.size) && ok;
+	ok = (fflush(checkpoints.fp) == 0) && ok;
+	ok = (fsync(fileno(checkpoints.fp)) == 0) && ok;
+
+	if (ok) {
+		checkpoints.num_written++;
+		MSG(0, "checkpoint %llu written (%llu nodes, %llu bytes)\n", 
+			(unsigned long long)epoch.epoch, (unsigned long long)epoch.num_nodes,
+			(unsigned long long)epoch.size);
+	}
+	else {
+		// later epochs depend on this one so there is no point going on
+		fprintf(stderr, "[kremlin] WARNING: couldn't write checkpoint file %s\n", 
+			checkpoints.filename.c_str());
+		fclose(checkpoints.fp);
+		checkpoints.fp = NULL;
+	}
+}
+
+static void* checkpointThreadMain(void* arg) {
+	pthread_mutex_lock(&checkpoints.lock);
+
+	struct timespec next_checkpoint;
+	clock_gettime(CLOCK_REALTIME, &next_checkpoint);
+	next_checkpoint.tv_sec += checkpoints.period;
+
+	while (!checkpoints.stopping) {
+		if (!checkpoints.pending.empty()) {
+			std::vector<CheckpointEpoch> epochs;
+			epochs.swap(checkpoints.pending);
+
+			pthread_mutex_unlock(&checkpoints.lock);
+			for (unsigned i = 0; i < epochs.size(); ++i) {
+				appendCheckpointEpoch(epochs[i]);
+				free(epochs[i].records);
+			}
+			pthread_mutex_lock(&checkpoints.lock);
+			continue;
+		}
+
+		int rc = pthread_cond_timedwait(&checkpoints.cond, &checkpoints.lock, 
+										&next_checkpoint);
+		if (rc == ETIMEDOUT) {
+			checkpoint_requested = 1;
+			clock_gettime(CLOCK_REALTIME, &next_checkpoint);
+			next_checkpoint.tv_sec += checkpoints.period;
+		}
+	}
+
+	pthread_mutex_unlock(&checkpoints.lock);
+	return NULL;
+}
+
+void startCheckpoints(const char* filename, unsigned period_in_secs) {
+	assert(filename != NULL);
+	assert(period_in_secs > 0);
+	assert(!checkpoints.running);
+
+	FILE* fp = fopen(filename, "w");
+	if (fp == NULL) {
+		fprintf(stderr, "[kremlin] WARNING: couldn't open checkpoint file %s\n", 
+			filename);
+		return;
+	}
+
+	ProfileCheckpointHeader header;
+	memcpy(header.magic, CHECKPOINT_MAGIC, PROFILE_MAGIC_SIZE);
+	header.version = CHECKPOINT_FORMAT_VERSION;
+	header.byte_order = PROFILE_BYTE_ORDER_MARK;
+	header.flags = kremlin_config.sampleRegions() ? PROFILE_FLAG_SAMPLED : 0;
+	if (fwrite(&header, sizeof(header), 1, fp) != 1 || fflush(fp) != 0) {
+		fprintf(stderr, "[kremlin] WARNING: couldn't write checkpoint file %s\n", 
+			filename);
+		fclose(fp);
+		return;
+	}
+
+	checkpoints.filename = filename;
+	checkpoints.fp = fp;
+	checkpoints.period = period_in_secs;
+	checkpoints.stopping = false;
+	checkpoint_owner = pthread_self();
+
+	// every node made from here on is in the first epoch
+	RegionTree* tree = getRegionTree();
+	tree->checkpointed = true;
+
+	if (pthread_create(&checkpoints.thread, NULL, checkpointThreadMain, NULL) != 0) {
+		fprintf(stderr, "[kremlin] WARNING: couldn't start checkpoint thread\n");
+		tree->checkpointed = false;
+		fclose(checkpoints.fp);
+		checkpoints.fp = NULL;
+		return;
+	}
+	checkpoints.running = true;
+}
+
+void stopCheckpoints() {
+	if (!checkpoints.running) return;
+
+	pthread_mutex_lock(&checkpoints.lock);
+	checkpoints.stopping = true;
+	pthread_cond_signal(&checkpoints.cond);
+	pthread_mutex_unlock(&checkpoints.lock);
+	pthread_join(checkpoints.thread, NULL);
+
+	checkpoints.running = false;
+	checkpoint_requested = 0;
+	for (unsigned i = 0; i < checkpoints.pending.size(); ++i)
+		free(checkpoints.pending[i].records);
+	checkpoints.pending.clear();
+	if (checkpoints.fp != NULL) {
+		fclose(checkpoints.fp);
+		checkpoints.fp = NULL;
+	}
+
+	RegionTree* tree = getRegionTree();
+	tree->checkpointed = false;
+	for (unsigned i = 0; i < tree->dirty.size(); ++i)
+		tree->dirty[i]->checkpoint_dirty = false;
+	tree->dirty.clear();
+
+	if (checkpoints.num_taken > 0) {
+		fprintf(stderr, "[kremlin] %u checkpoints taken (%u written), "
+				"%llu node records, encoding took %.2f ms max, %.2f ms total\n",
+				checkpoints.num_taken, checkpoints.num_written,
+				(unsigned long long)checkpoints.num_records,
+				checkpoints.serialize_ns_max / 1e6, 
+				checkpoints.serialize_ns_total / 1e6);
+	}
+
+	// the final profile supersedes the checkpoint
+	unlink(checkpoints.filename.c_str());
+}
+
+static UInt64 scaleCount(UInt64 count, double scale) {
+	if (scale == 1.0) return count;
+	return (UInt64)(count * scale + 0.5);
+}
+
+/*!
+ * Sets the factors by which the stats of a node and its subtree are scaled
+ * up when written to account for instances that weren't sampled. The stats
+ * themselves are left alone so this can be redone whenever the tree is
+ * written.
+ *
+ * The work of a skipped instance is known exactly (it is measured even
+ * though nothing inside it is profiled) so total work is rebuilt exactly.
+ * Everything else that skipped instances would have contributed (instance
+ * counts of regions inside them, critical paths and parallelism) is
+ * extrapolated by assuming they look like the sampled instances.
+ *
+ * @param node The node whose scale factors will be set.
+ * @param parent_scale Ratio of all instances of the parent to the instances
+ * that were sampled (1 if all were).
+ * @return The work inside sampled instances of the node's parent that is
+ * missing from the node's stats because it was skipped.
+ * @pre node is non-NULL
+ */
+static UInt64 extrapolateSampledStats(ProfileNode* node, double parent_scale) {
+	assert(node != NULL);
+
+	UInt64 num_sampled = node->num_instances;
+	UInt64 num_total = num_sampled + node->num_skipped;
+	double scale = parent_scale;
+	if (num_sampled > 0)
+		scale *= (double)num_total / num_sampled;
+
+	UInt64 missing_work = node->skipped_work;
+	for (unsigned i = 0; i < node->children.size(); ++i)
+		missing_work += extrapolateSampledStats(node->children[i], scale);
+
+	// nodes whose instances were all skipped aren't emitted
+	if (node->getStatSize() == 0) return missing_work;
+
+	UInt64 sampled_work = node->stats[0]->total_work;
+	double work_scale = parent_scale;
+	if (sampled_work > 0)
+		work_scale *= (double)(sampled_work + missing_work) / sampled_work;
+
+	MSG(DEBUG_CREGION, "extrapolateSampledStats: node %llu scale %.2f work scale %.2f\n", 
+		node->id, scale, work_scale);
+
+	node->instance_scale = scale;
+	node->work_scale = work_scale;
+	return missing_work;
+}
+
 /*
  * Emit Related 
  */
@@ -223,6 +725,127 @@ ProfileNode* popFromRegionStack() {
 static int numEntries = 0;
 static int numEntriesLeaf = 0;
 static int numCreated = 0;
+static int numSampled = 0;
+
+// Buffer size used for the output file so that it is written in large
+// blocks rather than one field at a time.
+static const size_t OUTPUT_BUFFER_SIZE = 4 * 1024 * 1024;
+
+/*!
+ * @brief Encodes node records in the format described in ProfileFormat.h
+ * and keeps track of what is needed for the index.
+ */
+class ProfileWriter {
+private:
+	FILE* fp;
+	UInt64 offset; //!< Number of bytes written so far.
+	UInt64 prev_id; //!< ID of the last node record written.
+	std::vector<unsigned char> record; //!< The record being encoded.
+
+public:
+	std::vector<ProfileIndexEntry> index;
+	std::vector<ProfileNode*> sketched; //!< Written nodes with a sketch.
+
+	ProfileWriter(FILE* fp) : fp(fp), offset(0), prev_id(0) {}
+
+	void putVarint(UInt64 value) {
+		while (value >= 0x80) {
+			record.push_back((unsigned char)(value | 0x80));
+			value >>= 7;
+		}
+		record.push_back((unsigned char)value);
+	}
+
+	void putSignedVarint(Int64 value) {
+		putVarint(((UInt64)value << 1) ^ (UInt64)(value >> 63));
+	}
+
+	/*!
+	 * Starts the record of a node, which begins with its ID.
+	 */
+	void beginRecord(UInt64 id) {
+		assert(record.empty());
+		ProfileIndexEntry entry = { id, offset };
+		index.push_back(entry);
+		putSignedVarint((Int64)(id - prev_id));
+		prev_id = id;
+	}
+
+	/*!
+	 * Writes out everything encoded since the last call.
+	 */
+	void endRecord() {
+		fwrite(&record[0], 1, record.size(), fp);
+		offset += record.size();
+		record.clear();
+	}
+
+	/*!
+	 * Writes raw bytes (e.g. the header) outside of any record.
+	 */
+	void writeRaw(const void* data, size_t size) {
+		assert(record.empty());
+		fwrite(data, 1, size, fp);
+		offset += size;
+	}
+
+	UInt64 getOffset() { return offset; }
+};
+
+static bool compareIndexEntries(const ProfileIndexEntry& a, 
+								const ProfileIndexEntry& b) {
+	return a.id < b.id;
+}
+
+/*!
+ * Writes stats for all nodes in the region tree, extrapolating sampled stats
+ * if needed.
+ *
+ * @remark fp must be seekable: the header is rewritten at the end once the
+ * number of nodes and the index offset are known.
+ *
+ * @param fp File pointer for file we want to write data to.
+ * @param tree The region tree to write.
+ * @pre There is exactly one child of the root region (i.e. main)
+ */
+static void writeRegionTree(FILE* fp, RegionTree* tree) {
+	assert(fp != NULL);
+	assert(tree->root != NULL);
+	assert(tree->root->getNumChildren() == 1);
+
+	numEntries = numEntriesLeaf = numCreated = numSampled = 0;
+	if (kremlin_config.sampleRegions())
+		extrapolateSampledStats(tree->root->children[0], 1.0);
+
+	ProfileFileHeader header;
+	memcpy(header.magic, PROFILE_MAGIC, PROFILE_MAGIC_SIZE);
+	header.version = PROFILE_FORMAT_VERSION;
+	header.byte_order = PROFILE_BYTE_ORDER_MARK;
+	header.flags = kremlin_config.sampleRegions() ? PROFILE_FLAG_SAMPLED : 0;
+	header.num_nodes = 0;
+	header.index_offset = 0;
+
+	ProfileWriter out(fp);
+	out.writeRaw(&header, sizeof(header));
+	writeRegionStats(out, tree->root->children[0], 0);
+
+	header.num_nodes = out.index.size();
+	header.index_offset = out.getOffset();
+	std::sort(out.index.begin(), out.index.end(), compareIndexEntries);
+	if (!out.index.empty()) {
+		out.writeRaw(&out.index[0], out.index.size() * sizeof(ProfileIndexEntry));
+	}
+	if (kremlin_config.summarizeStats()) {
+		header.flags |= PROFILE_FLAG_SKETCHES;
+		writeSketches(out);
+	}
+
+	// TRICKY: go back to the end with SEEK_SET since a memstream (used for
+	// checkpoints) takes its size from the final position
+	fseek(fp, 0, SEEK_SET);
+	fwrite(&header, sizeof(header), 1, fp);
+	fseek(fp, out.getOffset(), SEEK_SET);
+}
 
 /*!
  * Writes statistics for all nodes in the region tree to a specified file.
@@ -233,9 +856,10 @@ static int numCreated = 0;
  * @pre There is exactly one child of the root region (i.e. main)
  */
 static void writeProgramStats(const char* filename) {
+	RegionTree* tree = getRegionTree();
 	assert(filename != NULL);
-	assert(region_tree_root != NULL);
-	assert(region_tree_root->getNumChildren() == 1);
+	assert(tree->root != NULL);
+	assert(tree->root->getNumChildren() == 1);
 
 	FILE* fp = fopen(filename, "w");
 	if(fp == NULL) {
@@ -244,10 +868,18 @@ static void writeProgramStats(const char* filename) {
 		// for the correct filename
 		exit(1);
 	}
-	writeRegionStats(fp, region_tree_root->children[0], 0);
+	setvbuf(fp, NULL, _IOFBF, OUTPUT_BUFFER_SIZE);
+	writeRegionTree(fp, tree);
 	fclose(fp);
 	fprintf(stderr, "[kremlin] Created File %s : %d Regions Emitted (all %d leaves %d)\n", 
 		filename, numCreated, numEntries, numEntriesLeaf);
+	if (kremlin_config.sampleRegions()) {
+		fprintf(stderr, "[kremlin] %d Regions Have Sampled Stats\n", numSampled);
+	}
+	if (kremlin_config.summarizeStats()) {
+		fprintf(stderr, "[kremlin] %llu bytes of stats, %u Regions Had Recursive Stats Folded\n", 
+			(unsigned long long)ProfileNodeStats::getMemoryInUse(), ProfileNode::getNumFoldedNodes());
+	}
 
 	// TODO: make DOT printing a command line option
 #if 0
@@ -264,127 +896,100 @@ static bool isEmittable(Level level) {
 }
 
 /*!
- * Writes profiling stats associated with a given node to a file.
- *
- * @remark The output for the node will contain 8C + 40 bytes, in the
- * following format:
+ * Encodes the node part of a node's record (everything up to its stats),
+ * as described in ProfileFormat.h.
  *
- * 1. 64bit ID
- * 2. 64bit SID
- * 3. 64bit CID
- * 4. 64bit node_type
- * 5. 64bit recurse id
- * 6. 64bit # of instances
- * 7. 64bit DOALL flag
- * 8. 64bit child count (C)
- * 9. C * 64bit ID for children
+ * @remark Nodes with no stats (i.e. whose instances were all skipped by
+ * sampling) are left out, both here and as children.
  *
- * @remark The data will be written in binary format.
- *
- * @param fp File pointer for file we want to write data to.
+ * @param out The writer the record is being encoded with.
  * @param node The node whose stats will be written.
- * @pre fp is non-NULL
  * @pre node is non-NULL
  */
-static void writeNodeStats(FILE* fp, ProfileNode* node) {
-	assert(fp != NULL);
+static void writeNodeStats(ProfileWriter& out, ProfileNode* node) {
 	assert(node != NULL);
 
 	MSG(DEBUG_CREGION, "dyn_id: %llx, static_id: %llx callsite_id: %llx, node_type: %d, num_instances: %llu nChildren: %u DOALL: %llu\n", 
 		node->id, node->static_id, node->callsite_id, node->node_type, 
 		node->num_instances, node->children.size(), node->is_doall);
 
-	fwrite(&node->id, sizeof(Int64), 1, fp);
-	fwrite(&node->static_id, sizeof(Int64), 1, fp);
-	fwrite(&node->callsite_id, sizeof(Int64), 1, fp);
-
 	assert(node->node_type >=0 && node->node_type <= 2);
 	UInt64 nodeType = node->node_type;
-	fwrite(&nodeType, sizeof(Int64), 1, fp);
-	
-	UInt64 target_id = (node->recursion == NULL) ? 0 : node->recursion->id;
-	fwrite(&target_id, sizeof(Int64), 1, fp);
-	fwrite(&node->num_instances, sizeof(Int64), 1, fp);
-	fwrite(&node->is_doall, sizeof(Int64), 1, fp);
-	UInt64 num_children = node->children.size();
-	fwrite(&num_children, sizeof(Int64), 1, fp);
+	if (node->isSampled()) {
+		nodeType |= SAMPLED_NODE_FLAG;
+		numSampled++;
+	}
 
-	// TRICKY: not sure this is necessary but we go in reverse order to mimic
-	// the behavior when we had a C linked-list for children
-	for (int i = num_children-1; i >= 0; --i) {
+	UInt64 num_children = 0;
+	for (unsigned i = 0; i < node->children.size(); ++i) {
+		if (node->children[i]->getStatSize() > 0) num_children++;
+	}
+
+	out.putVarint(node->static_id);
+	out.putVarint(node->callsite_id);
+	out.putVarint(nodeType);
+	out.putSignedVarint((node->recursion == NULL) ? 0 : 
+						(Int64)(node->recursion->id - node->id));
+	out.putVarint(scaleCount(node->num_instances, node->instance_scale));
+	out.putVarint(node->is_doall);
+	out.putVarint(num_children);
+
+	for (unsigned i = 0; i < node->children.size(); ++i) {
 		ProfileNode* child = node->children[i];
-		fwrite(&child->id, sizeof(Int64), 1, fp);    
+		if (child->getStatSize() == 0) continue;
+		out.putSignedVarint((Int64)(child->id - node->id));
 	}
 
 	numCreated++;
 }
 
 /*!
- * Write statistics in a given ProfileNodeStats to a specified file.
- *
- * @remark A total of 64 bytes will be written to the file, in the following
- * order:
- *
- * - 64bit work
- * - 64bit total_par_per_work (work after total-parallelism is applied)
- * - 64bit self_par_per_work (work after self-parallelism is applied)
- * - 64bit minimum SP
- * - 64bit maximum SP
- * - 64bit total iteration count
- * - 64bit min iteration count
- * - 64bit max iteration count
- *
- * @remark The data will be written in binary format.
+ * Encodes the statistics in a given ProfileNodeStats, in the order given in
+ * ProfileFormat.h.
  *
- * @param fp File pointer for file we want to write data to.
+ * @param out The writer the record is being encoded with.
  * @param node The ProfileNodeStats whose contents will be written.
- * @pre fp is non-NULL
+ * @param instance_scale Factor applied to instance counts.
+ * @param work_scale Factor applied to work.
  * @pre stat is non-NULL
  */
-static void emitStat(FILE *fp, ProfileNodeStats *stat) {
-	assert(fp != NULL);
+static void emitStat(ProfileWriter& out, ProfileNodeStats *stat, 
+						double instance_scale, double work_scale) {
 	assert(stat != NULL);
 
 	MSG(DEBUG_CREGION, "\tstat: work = %llu, spWork = %llu, nInstance = %llu\n", 
 		stat->total_work, stat->self_par_per_work, stat->num_instances);
-		
-	fwrite(&stat->num_instances, sizeof(Int64), 1, fp);
-	fwrite(&stat->total_work, sizeof(Int64), 1, fp);
-	fwrite(&stat->total_par_per_work, sizeof(Int64), 1, fp);
-	fwrite(&stat->self_par_per_work, sizeof(Int64), 1, fp);
 
-	UInt64 minSPInt = (UInt64)(stat->min_self_par * 100.0);
-	UInt64 maxSPInt = (UInt64)(stat->max_self_par * 100.0);
-	fwrite(&minSPInt, sizeof(Int64), 1, fp);
-	fwrite(&maxSPInt, sizeof(Int64), 1, fp);
-
-	fwrite(&stat->num_dynamic_child_regions, sizeof(Int64), 1, fp);
-	fwrite(&stat->min_dynamic_child_regions, sizeof(Int64), 1, fp);
-	fwrite(&stat->max_dynamic_child_regions, sizeof(Int64), 1, fp);
+	out.putVarint(scaleCount(stat->num_instances, instance_scale));
+	out.putVarint(scaleCount(stat->total_work, work_scale));
+	out.putVarint(scaleCount(stat->total_par_per_work, work_scale));
+	out.putVarint(scaleCount(stat->self_par_per_work, work_scale));
+	out.putVarint((UInt64)(stat->min_self_par * 100.0));
+	out.putVarint((UInt64)(stat->max_self_par * 100.0));
+	out.putVarint(scaleCount(stat->num_dynamic_child_regions, instance_scale));
+	out.putVarint(stat->min_dynamic_child_regions);
+	out.putVarint(stat->max_dynamic_child_regions);
 }
 
 /*!
  * Write stats for a region--including all children--as long as the region is
  * within the range of depths we are profiling.
  *
- * For each region, the output format is:
+ * For each region, the record is:
  *  - Node Info (writeNodeStats)
- *  - N (64bit), which is # of stats
+ *  - N, which is # of stats
  *  - N * Stat Info (emitStat)
  *
- * @remark The data will be written in binary format.
- * 
- * @param fp File pointer for file we want to write data to.
+ * @param out The writer used to encode the records.
  * @param node The node whose stats will be written.
  * @param level The depth in the region tree of the node.
- * @pre fp is non-NULL
  * @pre node is non-NULL
- * @pre There is at least one ProfileNodeStats associated with the node.
  */
-static void writeRegionStats(FILE *fp, ProfileNode *node, UInt level) {
-    assert(fp != NULL);
+static void writeRegionStats(ProfileWriter& out, ProfileNode *node, UInt level) {
     assert(node != NULL);
-	assert(node->getStatSize() > 0);
+
+	// never profiled because no instance was sampled
+	if (node->getStatSize() == 0) return;
 
 	UInt64 stat_size = node->getStatSize();
 	MSG(DEBUG_CREGION, "Emitting Node %llu with %llu stats\n", node->id, stat_size);
@@ -394,21 +999,88 @@ static void writeRegionStats(FILE *fp, ProfileNode *node, UInt level) {
 		if(node->children.empty())  
 			numEntriesLeaf++; 
 
-		writeNodeStats(fp, node);
+		out.beginRecord(node->id);
+		writeNodeStats(out, node);
 
-		fwrite(&stat_size, sizeof(Int64), 1, fp);
-		// FIXME: run through stats in reverse?
+		out.putVarint(stat_size);
 		for (unsigned i = 0; i < stat_size; ++i) {
 			ProfileNodeStats *s = node->stats[i];
-			emitStat(fp, s);	
+			emitStat(out, s, node->instance_scale, node->work_scale);
 		}
+		out.endRecord();
+
+		if (node->sketch != NULL) out.sketched.push_back(node);
 	}
 
-	// TRICKY: not sure this is necessary but we go in reverse order to mimic
-	// the behavior when we had a C linked-list for children
-	for (int i = node->children.size()-1; i >= 0; --i) {
+	for (unsigned i = 0; i < node->children.size(); ++i) {
 		ProfileNode* child = node->children[i];
-		writeRegionStats(fp, child, level+1);
+		writeRegionStats(out, child, level+1);
+	}
+}
+
+/*!
+ * Writes the sketch section (see ProfileFormat.h) for the nodes collected
+ * in out.sketched by writeRegionStats.
+ *
+ * @param out The writer used to encode the records.
+ */
+static void writeSketches(ProfileWriter& out) {
+	out.putVarint(out.sketched.size());
+	out.endRecord();
+
+	for (unsigned i = 0; i < out.sketched.size(); ++i) {
+		ProfileNode* node = out.sketched[i];
+		ProfileNodeSketch* sketch = node->sketch;
+		assert(sketch != NULL);
+
+		out.putVarint(node->id);
+		out.putVarint(sketch->min_work);
+		out.putVarint(sketch->max_work);
+		out.putVarint(sketch->min_cp);
+		out.putVarint(sketch->max_cp);
+		for (unsigned m = 0; m < ProfileNodeSketch::NUM_METRICS; ++m) {
+			for (unsigned b = 0; b < ProfileNodeSketch::NUM_BUCKETS; ++b) {
+				out.putVarint(sketch->buckets[m][b]);
+			}
+		}
+		out.endRecord();
+	}
+}
+
+/*!
+ * Encodes a checkpoint record (see ProfileFormat.h) for each of the given
+ * nodes. Unlike writeRegionStats, counts are written as measured, without
+ * extrapolating for sampling, and followed by the number and work of the
+ * skipped instances so that a reader can extrapolate them itself.
+ *
+ * @param fp File pointer for file we want to write the records to.
+ * @param nodes The nodes to write, in any order.
+ */
+static void writeCheckpointRecords(FILE* fp, std::vector<ProfileNode*>& nodes) {
+	assert(fp != NULL);
+
+	ProfileWriter out(fp);
+	for (unsigned n = 0; n < nodes.size(); ++n) {
+		ProfileNode* node = nodes[n];
+		out.beginRecord(node->id);
+		out.putVarint(node->static_id);
+		out.putVarint(node->callsite_id);
+		out.putVarint(node->node_type);
+		out.putSignedVarint((node->recursion == NULL) ? 0 : 
+							(Int64)(node->recursion->id - node->id));
+		out.putVarint(node->num_instances);
+		out.putVarint(node->is_doall);
+		out.putVarint(node->children.size());
+		for (unsigned i = 0; i < node->children.size(); ++i)
+			out.putSignedVarint((Int64)(node->children[i]->id - node->id));
+
+		out.putVarint(node->getStatSize());
+		for (unsigned i = 0; i < node->getStatSize(); ++i)
+			emitStat(out, node->stats[i], 1.0, 1.0);
+
+		out.putVarint(node->num_skipped);
+		out.putVarint(node->skipped_work);
+		out.endRecord();
 	}
 }
 
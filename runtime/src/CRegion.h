@@ -40,6 +40,17 @@ void initRegionTree();
  */
 void deinitRegionTree();
 
+/*!
+ * Hands the calling thread's region tree over to be merged into the main
+ * thread's tree when the profile is written. Used instead of
+ * deinitRegionTree by worker threads when threads are profiled separately.
+ *
+ * @pre The region tree root is non NULL.
+ * @pre The current region it the tree root.
+ * @post Both the root and the current node will be NULL.
+ */
+void detachRegionTree();
+
 /*!
  * Writes profiled data to file whose location is specified.
  *
@@ -51,6 +62,30 @@ void deinitRegionTree();
  */
 void printProfiledData(const char* filename);
 
+/*!
+ * Starts a background thread that periodically has the changes to the
+ * calling thread's region tree appended to a checkpoint file (see
+ * ProfileFormat.h), so that the regions finished so far can be recovered if
+ * the program dies.
+ *
+ * @remark The nodes that changed since the last checkpoint are encoded by
+ * the calling thread the next time it exits a region after a checkpoint is
+ * due; only the file I/O is done in the background.
+ *
+ * @param filename The checkpoint file.
+ * @param period_in_secs Time between checkpoints.
+ * @pre filename is non-NULL and period_in_secs is positive.
+ * @pre Checkpoints aren't already running.
+ * @pre The calling thread's region tree has only its root.
+ */
+void startCheckpoints(const char* filename, unsigned period_in_secs);
+
+/*!
+ * Stops the checkpoint thread and removes the checkpoint file. Meant to be
+ * called once the final profile has been written.
+ */
+void stopCheckpoints();
+
 /*!
  * Updates the profiled region tree based on entering a program region.
  *
@@ -83,4 +118,31 @@ void openRegionContext(SID region_static_id, CID region_callsite_id,
  */
 void closeRegionContext(RegionStats *info);
 
+/*!
+ * Returns the number of (sampled) instances of a child of the current region
+ * so far.
+ *
+ * @param region_static_id The static ID of the child region.
+ * @param region_callsite_id The callsite ID of the child region.
+ * @return The number of times the child region was entered and profiled in
+ * the current context; 0 if it never was.
+ * @pre The current region node exists (i.e. is non-NULL).
+ */
+UInt64 getNumRegionContextInstances(SID region_static_id, 
+									CID region_callsite_id);
+
+/*!
+ * Records an instance of a child of the current region that ran without
+ * being profiled because it wasn't sampled. The current region doesn't
+ * change.
+ *
+ * @param region_static_id The static ID of the skipped region.
+ * @param region_callsite_id The callsite ID of the skipped region.
+ * @param region_type The type of the skipped region.
+ * @param work The work done by the skipped region (including its children).
+ * @pre The current region node exists (i.e. is non-NULL).
+ */
+void skipRegionContext(SID region_static_id, CID region_callsite_id, 
+						RegionType region_type, UInt64 work);
+
 #endif
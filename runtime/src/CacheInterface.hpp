@@ -11,11 +11,33 @@ protected:
 	MShadowSkadu *mem_shadow;
 
 public:
+	virtual ~CacheInterface() {}
+
 	virtual void init(int size, bool compress, MShadowSkadu* mshadow) = 0;
 	virtual void deinit() = 0;
 
+	void enableCompression() { use_compression = true; }
+
 	virtual void set(Addr addr, Index size, Version* vArray, Time* tArray, TimeTable::TableType type) = 0;
 	virtual Time* get(Addr addr, Index size, Version* vArray, TimeTable::TableType type) = 0;
+
+	/*!
+	 * Drops any cached timestamps for addresses in [start, end) without
+	 * writing them back.
+	 */
+	virtual void invalidate(Addr start, Addr end) = 0;
+
+	/*!
+	 * Writes any cached timestamps for addresses in [start, end) back to
+	 * shadow memory and drops them from the cache, so the range can be
+	 * read straight from shadow memory.
+	 */
+	virtual void writeBack(Addr start, Addr end, Version* vArray) = 0;
+
+	/*!
+	 * @return The number of words the cache can hold, 0 if it is bypassed.
+	 */
+	virtual UInt64 getNumLines() = 0;
 };
 
 #endif // _CACHEINTERFACE_HPP_
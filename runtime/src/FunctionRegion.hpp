@@ -2,7 +2,8 @@
 #define FUNCTION_REGION_HPP
 
 #include "MemMapAllocator.h"
-#include "Table.h" // for delete of table in destructor
+#include "Table.h"
+#include "RegisterFrameArena.hpp"
 
 class FunctionRegion {
 private:
@@ -12,6 +13,11 @@ private:
 	CID call_site_id;
 	UInt32 error_checking_code;
 
+	Table register_table; // storage comes from a RegisterFrameArena
+	RegisterFrameArena::Mark frame_mark; // arena top before the frame
+	Addr stack_top; // runtime's frame address at entry, just below this
+					// function's stack frame
+
 public:
 	Table* table; // TODO: make this private
 
@@ -21,20 +27,79 @@ public:
 	}
 
 	FunctionRegion(CID callsite_id) { 
+		this->error_checking_code = FunctionRegion::ERROR_CHECK_CODE;
+		init(callsite_id);
+	}
+
+	~FunctionRegion() {
+		assert(this->table == NULL);
+	}
+
+	/*!
+	 * Readies this object for a new call, so objects can be reused rather
+	 * than reallocated.
+	 *
+	 * @pre The register table has been released.
+	 */
+	void init(CID callsite_id) {
 		this->table = NULL;
 		this->return_register = FunctionRegion::DUMMY_RETURN_REG;
-		this->error_checking_code = FunctionRegion::ERROR_CHECK_CODE;
 		this->call_site_id = callsite_id;
+		this->stack_top = NULL;
 	}
 
-	~FunctionRegion() {
-		assert(this->table != NULL);
-		delete this->table;
+	/*!
+	 * Allocates a row x col versioned register table on top of the arena.
+	 * Only the first num_zero_cols columns are cleared: the rest belong to
+	 * regions that are not active yet, which get versions newer than any
+	 * stamp already in the arena, so those entries read as stale.
+	 *
+	 * @pre num_zero_cols is no larger than col.
+	 */
+	void allocRegisterTable(RegisterFrameArena& arena, int row, int col,
+							int num_zero_cols) {
+		assert(this->table == NULL);
+		frame_mark = arena.getTop();
+		Version* versions;
+		Time* times = arena.alloc(row * col, versions);
+		register_table.attach(row, col, times, versions);
+		register_table.zeroLeadingColumns(num_zero_cols);
+		this->table = &register_table;
+	}
+
+	/*!
+	 * Returns the register table's storage to the arena. Does nothing if
+	 * no table was allocated.
+	 *
+	 * @pre The table is the most recently allocated one in arena.
+	 */
+	void releaseRegisterTable(RegisterFrameArena& arena) {
+		if (this->table == NULL) return;
+		arena.release(frame_mark);
 		this->table = NULL;
 	}
 
+	Addr getStackTop() { return this->stack_top; }
+	void setStackTop(Addr top) { this->stack_top = top; }
+
 	CID getCallSiteID() { return this->call_site_id; }
 	Reg getReturnRegister() { return this->return_register; }
+
+	/*!
+	 * @return True if setReturnRegister was called since the last callee's
+	 * return value was written.
+	 */
+	bool hasReturnRegister() { 
+		return this->return_register != (Reg)FunctionRegion::DUMMY_RETURN_REG;
+	}
+
+	/*!
+	 * Forgets the return register once the callee's return value has been
+	 * written to it, so a later call that returns nothing can't write to it.
+	 */
+	void clearReturnRegister() { 
+		this->return_register = FunctionRegion::DUMMY_RETURN_REG;
+	}
 	Table* getTable() { return this->table; }
 
 	void sanityCheck() {
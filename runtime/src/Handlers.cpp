@@ -1,3 +1,7 @@
+#include <cstring> // for memcpy
+#include <map>
+#include <pthread.h>
+
 #include "debug.h"
 #include "config.h"
 #include "KremlinProfiler.hpp"
@@ -5,12 +9,27 @@
 #include "FunctionRegion.hpp"
 #include "CRegion.h"
 #include "MShadow.h"
+#include "MShadowSkadu.h"
+#include "MShadowFlat.h"
 #include "Table.h"
+#include "TimeVector.h"
 
-Table *KremlinProfiler::shadow_reg_file = NULL;
+/*
+ * Lowest stack address at which a function region was entered on this
+ * thread since the shadow memory below it was last reclaimed.
+ */
+static __thread UInt64 stack_low_watermark = 0xFFFFFFFFFFFFFFFF;
 
 void KremlinProfiler::addFunctionToStack(CID callsite_id) {
-	FunctionRegion* func = new FunctionRegion(callsite_id);
+	FunctionRegion* func;
+	if (free_function_regions.empty()) {
+		func = new FunctionRegion(callsite_id);
+	}
+	else {
+		func = free_function_regions.back();
+		free_function_regions.pop_back();
+		func->init(callsite_id);
+	}
 	callstack.push_back(func);
 
 	MSG(3, "addFunctionToStack at 0x%x CID 0x%x\n", func, callsite_id);
@@ -25,7 +44,23 @@ void KremlinProfiler::callstackPop() {
 	MSG(3, "callstackPop at 0x%x CID 0x%x\n", func, func->getCallSiteID());
 
 	callstack.pop_back();
-	delete func;
+	func->releaseRegisterTable(register_frames);
+	free_function_regions.push_back(func);
+}
+
+void KremlinProfiler::deinitFunctionRegions() {
+	// functions can still be active if profiling was turned off early
+	while (!callstackIsEmpty()) {
+		FunctionRegion* func = callstack.back();
+		callstack.pop_back();
+		func->releaseRegisterTable(register_frames);
+		delete func;
+	}
+
+	for (unsigned i = 0; i < free_function_regions.size(); ++i) {
+		delete free_function_regions[i];
+	}
+	free_function_regions.clear();
 }
 
 /*****************************************************************
@@ -72,15 +107,14 @@ unsigned KremlinProfiler::getShadowRegisterFileDepth() {
 	return shadow_reg_file->getCol();
 }
 
-void KremlinProfiler::zeroRegistersAtIndex(Index index) {
-	assert(index < getShadowRegisterFileDepth());
+Time* KremlinProfiler::getValidRegisterTimes(Reg reg) {
 	assert(shadow_reg_file != NULL);
+	assert(reg < getCurrNumShadowRegisters());	
+	assert(getCurrNumInstrumentedLevels() <= getShadowRegisterFileDepth());
 
-	MSG(3, "zeroRegistersAtIndex col [%d] in table [%d, %d]\n",
-		index, shadow_reg_file->getRow(), shadow_reg_file->getCol());
-	for (Reg i = 0; i < getCurrNumShadowRegisters(); ++i) {
-		setRegisterTimeAtIndex(0ULL, i, index);
-	}
+	return shadow_reg_file->getValidRow(reg, 
+								getVersionAtLevel(getLevelForIndex(0)),
+								getCurrNumInstrumentedLevels());
 }
 
 Time KremlinProfiler::getRegisterTimeAtIndex(Reg reg, Index index) {
@@ -91,7 +125,8 @@ Time KremlinProfiler::getRegisterTimeAtIndex(Reg reg, Index index) {
 	MSG(3, "RShadowGet [%u, %u] in table [%u, %u]\n",
 		reg, index, shadow_reg_file->getRow(), shadow_reg_file->getCol());
 
-	Time ret = shadow_reg_file->getValue(reg, index);
+	Version curr_version = *getVersionAtLevel(getLevelForIndex(index));
+	Time ret = shadow_reg_file->getValidValue(reg, index, curr_version);
 	return ret;
 }
 
@@ -103,26 +138,127 @@ void KremlinProfiler::setRegisterTimeAtIndex(Time time, Reg reg, Index index) {
 	MSG(3, "RShadowSet [%d, %d] in table [%d, %d]\n",
 		reg, index, shadow_reg_file->getRow(), shadow_reg_file->getCol());
 
-	shadow_reg_file->setValue(time, reg, index);
+	Version curr_version = *getVersionAtLevel(getLevelForIndex(index));
+	shadow_reg_file->setValidValue(time, reg, index, curr_version);
 }
 
 /*****************************************************************
  * Timestamp update functions.
  *****************************************************************/
 
-template <unsigned num_data_deps, unsigned data_dep, bool ignore_offset>
-Time KremlinProfiler::calcMaxTime(Time curr_time, UInt32 reg, UInt32 offset, Level l) {
-	assert(shadow_reg_file != NULL);
-	assert(reg < getCurrNumShadowRegisters());	
-	assert(l < getShadowRegisterFileDepth());
+inline Time* KremlinProfiler::getShadowTimes(Addr addr, Index size, 
+												Version* versions, 
+												UInt32 width) {
+	switch (shadow_mem_type) {
+		case ShadowMemorySkadu:
+			return static_cast<MShadowSkadu*>(shadow_mem)->MShadowSkadu::get(
+						addr, size, versions, width);
+		case ShadowMemoryFlat:
+			return static_cast<MShadowFlat*>(shadow_mem)->MShadowFlat::get(
+						addr, size, versions, width);
+		default:
+			return shadow_mem->get(addr, size, versions, width);
+	}
+}
 
+inline void KremlinProfiler::setShadowTimes(Addr addr, Index size, 
+											Version* versions, Time* times, 
+											UInt32 width) {
+	switch (shadow_mem_type) {
+		case ShadowMemorySkadu:
+			static_cast<MShadowSkadu*>(shadow_mem)->MShadowSkadu::set(
+				addr, size, versions, times, width);
+			break;
+		case ShadowMemoryFlat:
+			static_cast<MShadowFlat*>(shadow_mem)->MShadowFlat::set(
+				addr, size, versions, times, width);
+			break;
+		default:
+			shadow_mem->set(addr, size, versions, times, width);
+	}
+}
+
+template <unsigned num_data_deps, unsigned data_dep, bool ignore_offset>
+void KremlinProfiler::addDataDependence(const Time** srcs, Time* offsets, 
+										unsigned& num_srcs, 
+										UInt32 reg, UInt32 offset) {
 	if (num_data_deps > data_dep) {
-		Time dep_time = getRegisterTimeAtIndex(reg, l);
-		if (!ignore_offset) dep_time += offset;
-		return MAX(curr_time, dep_time);
+		assert(shadow_reg_file != NULL);
+		assert(reg < getCurrNumShadowRegisters());	
+		srcs[num_srcs] = getValidRegisterTimes(reg);
+		offsets[num_srcs] = ignore_offset ? 0 : offset;
+		++num_srcs;
 	}
-	else
-		return curr_time;
+}
+
+template <bool use_ctrl_dependence, bool use_shadow_mem_dependence>
+void KremlinProfiler::addCommonDependences(const Time** srcs, Time* offsets, 
+											unsigned& num_srcs, 
+											Addr src_addr, 
+											UInt32 mem_access_size) {
+	Index end_index = getCurrNumInstrumentedLevels();
+
+	if (use_ctrl_dependence) {
+		srcs[num_srcs] = cdt_current_base;
+		offsets[num_srcs] = 0;
+		++num_srcs;
+	}
+
+	if (use_shadow_mem_dependence) {
+		Level min_level = getLevelForIndex(0); // XXX: this doesn't seem right (-sat)
+		srcs[num_srcs] = getShadowTimes(src_addr, end_index, getVersionAtLevel(min_level), mem_access_size);
+		offsets[num_srcs] = 0;
+		++num_srcs;
+	}
+
+#ifndef NDEBUG
+    for (Index index = 0; index < end_index; ++index) {
+		ProgramRegion region = getRegionAtLevel(getLevelForIndex(index));
+		if (use_ctrl_dependence) {
+			assert(getControlDependenceAtIndex(index) <= getCurrentTime() - region.start);
+		}
+		if (use_shadow_mem_dependence) {
+			// XXX: Why check timestamp here? Looks like this only occurs in KLoad
+			// insts. If this is necessary, we might need to add checkTimestamp to
+			// each src time.
+			checkTimestamp(index, region, srcs[num_srcs - 1][index]);
+		}
+	}
+#endif
+}
+
+template <bool update_cp>
+void KremlinProfiler::propagateTimestamps(UInt32 dest_reg, const Time** srcs,
+											const Time* offsets, 
+											unsigned num_srcs, Time post_add) {
+	Index end_index = getCurrNumInstrumentedLevels();
+	if (end_index == 0) return;
+	assert(end_index <= getShadowRegisterFileDepth());
+
+	Time* dest_times = shadow_reg_file->getElementAddr(dest_reg, 0);
+
+	TimeVectorMax(dest_times, srcs, offsets, num_srcs, post_add, end_index);
+	shadow_reg_file->stampRow(dest_reg, getVersionAtLevel(getLevelForIndex(0)),
+								end_index);
+
+	if (update_cp) updateCriticalPathLengths(dest_times, end_index);
+}
+
+void KremlinProfiler::updateCriticalPathLengths(const Time* times, Index end_index) {
+	if (end_index == 0) return;
+	assert(getLevelForIndex(end_index - 1) < program_regions.size());
+
+	Time* cps = &program_regions.cps[getLevelForIndex(0)];
+	const Time* srcs[2] = {cps, times};
+	const Time offsets[2] = {0, 0};
+	TimeVectorMax(cps, srcs, offsets, 2, 0, end_index);
+
+#ifndef NDEBUG
+	for (Index index = 0; index < end_index; ++index) {
+		ProgramRegion region = getRegionAtLevel(getLevelForIndex(index));
+		checkTimestamp(index, region, times[index]);
+	}
+#endif
 }
 
 // TODO: once C++11 is widespread, give use_shadow_mem_dependence 
@@ -157,53 +293,62 @@ void KremlinProfiler::timestampUpdater(UInt32 dest_reg,
 	assert(!use_shadow_mem_dependence 
 			|| (mem_access_size > 0 && mem_access_size <= 8));
 
-	Time* src_addr_times = NULL;
-	Index end_index = getCurrNumInstrumentedLevels();
+	// control dependence + shadow mem + data deps
+	const Time* srcs[7];
+	Time offsets[7];
+	unsigned num_srcs = 0;
 
-	if (use_shadow_mem_dependence) {
-		Index region_depth = getCurrNumInstrumentedLevels();
-		Level min_level = getLevelForIndex(0); // XXX: this doesn't seem right (-sat)
-		src_addr_times = getShadowMemory()->get(src_addr, end_index, getVersionAtLevel(min_level), mem_access_size);
+	addCommonDependences<use_ctrl_dependence, use_shadow_mem_dependence>
+						(srcs, offsets, num_srcs, src_addr, mem_access_size);
 
-//#ifdef KREMLIN_DEBUG
-//		printLoadDebugInfo(src_addr, dest_reg, src_addr_times, end_index);
-//#endif
-	}
+	const bool ignore_offset = use_shadow_mem_dependence;
+	addDataDependence<num_data_deps, 0, ignore_offset>(srcs, offsets, num_srcs, src0_reg, src0_offset);
+	addDataDependence<num_data_deps, 1, ignore_offset>(srcs, offsets, num_srcs, src1_reg, src1_offset);
+	addDataDependence<num_data_deps, 2, ignore_offset>(srcs, offsets, num_srcs, src2_reg, src2_offset);
+	addDataDependence<num_data_deps, 3, ignore_offset>(srcs, offsets, num_srcs, src3_reg, src3_offset);
+	addDataDependence<num_data_deps, 4, ignore_offset>(srcs, offsets, num_srcs, src4_reg, src4_offset);
 
-    for (Index index = 0; index < end_index; ++index) {
-		Level i = getLevelForIndex(index);
-		ProgramRegion* region = getRegionAtLevel(i);
+	propagateTimestamps<update_cp>(dest_reg, srcs, offsets, num_srcs,
+								use_shadow_mem_dependence ? LOAD_COST : 0);
+}
 
-		Time dest_time = 0;
-		
-		if (use_ctrl_dependence) {
-			Time cdep_time = dest_time = getControlDependenceAtIndex(index);
-			assert(cdep_time <= getCurrentTime() - region->start);
-		}
+template <bool use_ctrl_dependence, bool update_cp, unsigned num_data_deps, bool use_shadow_mem_dependence>
+void KremlinProfiler::timestampUpdaterN(UInt32 dest_reg, 
+										const UInt32* src_regs,
+										const UInt32* src_offsets,
+										Addr src_addr,
+										UInt32 mem_access_size
+										) {
 
-		if (use_shadow_mem_dependence) {
-			// XXX: Why check timestamp here? Looks like this only occurs in KLoad
-			// insts. If this is necessary, we might need to add checkTimestamp to
-			// each src time (below).
-			checkTimestamp(index, region, src_addr_times[index]);
-			dest_time = MAX(dest_time, src_addr_times[index]);
-		}
+	assert(shadow_reg_file != NULL);
+	assert(shadow_mem != NULL);
+	assert(dest_reg < getCurrNumShadowRegisters());	
+	assert(num_data_deps == 0 || src_regs != NULL);
+	assert(use_shadow_mem_dependence || (src_addr == NULL && mem_access_size == 0));
+	assert(!use_shadow_mem_dependence 
+			|| (mem_access_size > 0 && mem_access_size <= 8));
+#ifndef NDEBUG
+	for (unsigned d = 0; d < num_data_deps; ++d) {
+		assert(src_regs[d] < getCurrNumShadowRegisters());
+	}
+#endif
 
-		const bool ignore_offset = use_shadow_mem_dependence;
-		dest_time = calcMaxTime<num_data_deps, 0, ignore_offset>(dest_time, src0_reg, src0_offset, index);
-		dest_time = calcMaxTime<num_data_deps, 1, ignore_offset>(dest_time, src1_reg, src1_offset, index);
-		dest_time = calcMaxTime<num_data_deps, 2, ignore_offset>(dest_time, src2_reg, src2_offset, index);
-		dest_time = calcMaxTime<num_data_deps, 3, ignore_offset>(dest_time, src3_reg, src3_offset, index);
-		dest_time = calcMaxTime<num_data_deps, 4, ignore_offset>(dest_time, src4_reg, src4_offset, index);
+	const Time* srcs[num_data_deps + 2];
+	Time offsets[num_data_deps + 2];
+	unsigned num_srcs = 0;
 
-		if (use_shadow_mem_dependence) dest_time += LOAD_COST;
+	addCommonDependences<use_ctrl_dependence, use_shadow_mem_dependence>
+						(srcs, offsets, num_srcs, src_addr, mem_access_size);
 
-		setRegisterTimeAtIndex(dest_time, dest_reg, index);
+	const bool use_offsets = !use_shadow_mem_dependence && src_offsets != NULL;
+	for (unsigned d = 0; d < num_data_deps; ++d) {
+		srcs[num_srcs] = getValidRegisterTimes(src_regs[d]);
+		offsets[num_srcs] = use_offsets ? src_offsets[d] : 0;
+		++num_srcs;
+	}
 
-		if (update_cp) {
-			region->updateCriticalPathLength(dest_time);
-		}
-    }
+	propagateTimestamps<update_cp>(dest_reg, srcs, offsets, num_srcs,
+								use_shadow_mem_dependence ? LOAD_COST : 0);
 }
 
 template <bool use_ctrl_dependence, 
@@ -290,11 +435,11 @@ void KremlinProfiler::handleVariableNumArgs(UInt32 dest_reg, UInt32 src_reg,
 
 /* BEGIN UNAUDITED CODE */
 
-void KremlinProfiler::checkTimestamp(int index, ProgramRegion* region, Timestamp value) {
+void KremlinProfiler::checkTimestamp(int index, ProgramRegion& region, Timestamp value) {
 #ifndef NDEBUG
-	if (value > getCurrentTime() - region->start) {
+	if (value > getCurrentTime() - region.start) {
 		fprintf(stderr, "index = %d, value = %lld, current time = %lld, region start = %lld\n", 
-		index, value, getCurrentTime(), region->start);
+		index, value, getCurrentTime(), region.start);
 		assert(0);
 	}
 #endif
@@ -317,20 +462,6 @@ static void checkRegion() {
 }
 
 
-void ProgramRegion::updateCriticalPathLength(Timestamp value) {
-	this->cp = MAX(value, this->cp);
-	MSG(3, "updateCriticalPathLength : value = %llu\n", this->cp);	
-	this->sanityCheck();
-#ifndef NDEBUG
-	if (value > profiler->getCurrentTime() - this->start) {
-		fprintf(stderr, "value = %lld, current time = %lld, region start = %lld\n", 
-		value, profiler->getCurrentTime(), this->start);
-		assert(0);
-	}
-#endif
-}
-
-
 // BEGIN: move to iteractive debugger file
 static inline void printTArray(Time* times, Index depth) {
 	Index index;
@@ -365,23 +496,24 @@ void KremlinProfiler::timestampUpdaterStore(Addr dest_addr, UInt32 mem_access_si
 	Time* dest_addr_times = getLevelTimes();
 
 	Index end_index = getCurrNumInstrumentedLevels();
-    for (Index index = 0; index < end_index; ++index) {
-		Level i = getLevelForIndex(index);
-		ProgramRegion* region = getRegionAtLevel(i);
-
-		Time control_dep_time = getControlDependenceAtIndex(index);
-        Time dest_time = control_dep_time + STORE_COST;
-		if (!store_const) {
-			Time src_time = getRegisterTimeAtIndex(src_reg, index);
-        	dest_time = MAX(control_dep_time,src_time) + STORE_COST;
-		}
-		dest_addr_times[index] = dest_time;
-        region->updateCriticalPathLength(dest_time);
+
+	const Time* srcs[2];
+	Time offsets[2] = {0, 0};
+	unsigned num_srcs = 0;
+	srcs[num_srcs++] = cdt_current_base;
+	if (!store_const) {
+		assert(src_reg < getCurrNumShadowRegisters());
+		srcs[num_srcs++] = getValidRegisterTimes(src_reg);
+	}
+
+	TimeVectorMax(dest_addr_times, srcs, offsets, num_srcs, STORE_COST, end_index);
+	updateCriticalPathLengths(dest_addr_times, end_index);
 
 #ifdef EXTRA_STATS
-        region->storeCnt++;
-#endif
+    for (Index index = 0; index < end_index; ++index) {
+        getRegionAtLevel(getLevelForIndex(index)).storeCnt++;
     }
+#endif
 
 #ifdef KREMLIN_DEBUG
 	if (store_const)
@@ -391,41 +523,129 @@ void KremlinProfiler::timestampUpdaterStore(Addr dest_addr, UInt32 mem_access_si
 #endif
 
 	Level min_level = getLevelForIndex(0); // XXX: see notes in KLoads
-	getShadowMemory()->set(dest_addr, end_index, getVersionAtLevel(min_level), dest_addr_times, mem_access_size);
+	setShadowTimes(dest_addr, end_index, getVersionAtLevel(min_level), dest_addr_times, mem_access_size);
+}
+
+
+bool KremlinProfiler::shouldSampleRegion(SID region_id, CID callsite_id) {
+	UInt64 clock = kremlin_config.sampleInVirtualTime() ? 
+					curr_time + skipped_time : num_regions_entered;
+
+	UInt64 off_length = kremlin_config.getSampleOffLength();
+	if (off_length > 0 && clock >= sample_phase_end) {
+		in_sample_burst = !in_sample_burst;
+		sample_phase_end = clock + (in_sample_burst ? 
+						kremlin_config.getSampleOnLength() : off_length);
+		MSG(0, "sampling: burst %s at %llu\n", 
+			in_sample_burst ? "started" : "ended", clock);
+	}
+	if (!in_sample_burst) return false;
+
+	UInt64 max_instances = kremlin_config.getSampleFirstInstances();
+	if (max_instances > 0 
+		&& getNumRegionContextInstances(region_id, callsite_id) >= max_instances)
+		return false;
+
+	return true;
+}
+
+void KremlinProfiler::beginSkippedRegion(SID region_id, CID callsite_id, 
+											RegionType type) {
+	assert(!isSkippingRegion());
+	MSG(0, "[+++] skipped region [type %u, level %d, sid 0x%llx] start: %llu\n",
+        type, getCurrentLevel() + 1, region_id, getCurrentTime());
+
+	skip_region_id = region_id;
+	skip_callsite_id = callsite_id;
+	skip_region_type = type;
+	skip_start_time = curr_time;
+	skipped_regions.push_back(region_id);
+	disable();
 }
 
+void KremlinProfiler::endSkippedRegion() {
+	assert(!isSkippingRegion());
+	Time work = curr_time - skip_start_time;
+	MSG(0, "[---] skipped region [sid 0x%llx] work %llu\n", 
+		skip_region_id, work);
+
+	skipped_time += work;
+	curr_time = skip_start_time;
+
+	// The parent still counts it as a child so that the number of children
+	// per instance isn't skewed.
+	Level level = getCurrentLevel() + 1;
+	if (level > min_level) {
+		getRegionAtLevel(level - 1).childCount++;
+	}
+
+	// A skipped function never ran _KReturn, so the register its caller
+	// keeps the return value in would still hold whatever was there before
+	// the call. The value can't be ready before the call's control
+	// dependence, so that's what it gets.
+	if (skip_region_type == RegionFunc) {
+		FunctionRegion* caller = getCurrentFunction();
+		if (caller != NULL && caller->table != NULL 
+			&& caller->hasReturnRegister())
+			setReturnToControlDependence(caller);
+	}
+
+	skipRegionContext(skip_region_id, skip_callsite_id, skip_region_type, work);
+	enable();
+}
 
-void KremlinProfiler::handleRegionEntry(SID regionId, RegionType regionType) {
+void KremlinProfiler::handleRegionEntry(SID regionId, RegionType regionType, Addr sp) {
 	iDebugHandlerRegionEntry(regionId);
 	idbgAction(KREM_REGION_ENTRY,"## KEnterRegion(regionID=%llu,regionType=%u)\n",regionId,regionType);
 
+	if (isSkippingRegion()) {
+		++num_regions_entered;
+		skipped_regions.push_back(regionId);
+		return;
+	}
+
     if (!enabled) return; 
 
+	if (sampling) {
+		CID callsite_id = getLastCallsiteID();
+		if (regionType != RegionFunc) {
+			FunctionRegion* func = getCurrentFunction();
+			callsite_id = (func == NULL) ? 0x0 : func->getCallSiteID();
+		}
+		bool sample = shouldSampleRegion(regionId, callsite_id);
+		++num_regions_entered;
+		if (!sample) {
+			beginSkippedRegion(regionId, callsite_id, regionType);
+			return;
+		}
+	}
+
     incrementLevel();
     Level level = getCurrentLevel();
 	if (level == getNumRegions()) {
 		doubleNumRegions();
 	}
 	
-	ProgramRegion* region = getRegionAtLevel(level);
+	ProgramRegion region = getRegionAtLevel(level);
 	issueVersionToLevel(level);
-	region->init(regionId, regionType, level, getCurrentTime());
+	region.init(regionId, regionType, level, getCurrentTime());
 
 	MSG(0, "\n");
 	MSG(0, "[+++] region [type %u, level %d, sid 0x%llx] start: %llu\n",
-        region->regionType, level, region->regionId, getCurrentTime());
+        region.regionType, level, region.regionId, getCurrentTime());
     incIndentTab(); // only affects debug printing
 
 	// func region allocates a new RShadow Table.
-	// for other region types, it needs to "clean" previous region's timestamps
+	// other region types don't need to "clean" the previous region's
+	// timestamps: the new version issued above makes them stale.
     if(regionType == RegionFunc) {
         addFunctionToStack(getLastCallsiteID());
         waitForRegisterTableSetup();
 
-    } else {
-		if (shouldInstrumentCurrLevel())
-			zeroRegistersAtIndex(getCurrentLevelIndex());
-	}
+		getCurrentFunction()->setStackTop(sp);
+		if (sp != NULL && (UInt64)sp < stack_low_watermark) 
+			stack_low_watermark = (UInt64)sp;
+    }
 
     FunctionRegion* funcHead = getCurrentFunction();
 	CID callSiteId = (funcHead == NULL) ? 0x0 : funcHead->getCallSiteID();
@@ -442,7 +662,7 @@ void KremlinProfiler::handleRegionEntry(SID regionId, RegionType regionType) {
 /**
  * Creates RegionStats and fills it based on inputs.
  */
-static RegionStats fillRegionStats(UInt64 work, UInt64 cp, CID callSiteId, UInt64 spWork, UInt64 is_doall, ProgramRegion* region_info) {
+static RegionStats fillRegionStats(UInt64 work, UInt64 cp, CID callSiteId, UInt64 spWork, UInt64 is_doall, ProgramRegion& region_info) {
 	RegionStats stats;
 
     stats.work = work;
@@ -450,25 +670,50 @@ static RegionStats fillRegionStats(UInt64 work, UInt64 cp, CID callSiteId, UInt6
 	stats.callSite = callSiteId;
 	stats.spWork = spWork;
 	stats.is_doall = is_doall; 
-	stats.childCnt = region_info->childCount;
+	stats.childCnt = region_info.childCount;
 
 #ifdef EXTRA_STATS
-    stats.loadCnt = region_info->loadCnt;
-    stats.storeCnt = region_info->storeCnt;
-    stats.readCnt = region_info->readCnt;
-    stats.writeCnt = region_info->writeCnt;
-    stats.readLineCnt = region_info->readLineCnt;
-    stats.writeLineCnt = region_info->writeLineCnt;
+    stats.loadCnt = region_info.loadCnt;
+    stats.storeCnt = region_info.storeCnt;
+    stats.readCnt = region_info.readCnt;
+    stats.writeCnt = region_info.writeCnt;
+    stats.readLineCnt = region_info.readLineCnt;
+    stats.writeLineCnt = region_info.writeLineCnt;
     assert(work >= stats.readCnt && work >= stats.writeCnt);
 #endif
 
 	return stats;
 }
 
+void KremlinProfiler::reclaimStackFrames(FunctionRegion* func, Addr sp) {
+	UInt64 top = (UInt64)func->getStackTop();
+
+	// Threads that share a profiler share its callstack too, so func may
+	// have been entered on another thread's stack.
+	UInt64 drift = (top > (UInt64)sp) ? top - (UInt64)sp : (UInt64)sp - top;
+	if (top == 0 || sp == NULL || drift > MAX_STACK_DRIFT) return;
+
+	if (stack_low_watermark < top 
+		&& top - stack_low_watermark <= MAX_STACK_RECLAIM) {
+		UInt64 size = top - stack_low_watermark;
+		MSG(1, "reclaiming stack shadow 0x%llx - 0x%llx\n", 
+			stack_low_watermark, top);
+		Level min_level = getLevelForIndex(0);
+		getShadowMemory()->clear((Addr)stack_low_watermark, size, 
+									getVersionAtLevel(min_level));
+		num_stack_reclaims++;
+		stack_bytes_reclaimed += size;
+	}
+	stack_low_watermark = top;
+}
+
 /**
  * Does the clean up work when exiting a function region.
  */
-void KremlinProfiler::handleFunctionExit() {
+void KremlinProfiler::handleFunctionExit(Addr sp) {
+	if (kremlin_config.reclaimStackShadowMem()) 
+		reclaimStackFrames(getCurrentFunction(), sp);
+
 	callstackPop();
 
 	// root function
@@ -482,24 +727,31 @@ void KremlinProfiler::handleFunctionExit() {
 	setRegisterFileTable(funcHead->table); 
 }
 
-void KremlinProfiler::handleRegionExit(SID regionId, RegionType regionType) {
+void KremlinProfiler::handleRegionExit(SID regionId, RegionType regionType, Addr stack_ptr) {
 	idbgAction(KREM_REGION_EXIT, "## KExitRegion(regionID=%llu,regionType=%u)\n",regionId,regionType);
 
+	if (isSkippingRegion()) {
+		assert(skipped_regions.back() == regionId);
+		skipped_regions.pop_back();
+		if (!isSkippingRegion()) endSkippedRegion();
+		return;
+	}
+
     if (!enabled) return; 
 
     Level level = getCurrentLevel();
-	ProgramRegion* region = getRegionAtLevel(level);
+	ProgramRegion region = getRegionAtLevel(level);
     SID sid = regionId;
 	SID parentSid = 0;
-    UInt64 work = getCurrentTime() - region->start;
+    UInt64 work = getCurrentTime() - region.start;
 	decIndentTab(); // applies only to debug printing
 	MSG(0, "\n");
     MSG(0, "[---] region [type %u, level %u, sid 0x%llx] time %llu cp %llu work %llu\n",
-        regionType, level, regionId, getCurrentTime(), region->cp, work);
+        regionType, level, regionId, getCurrentTime(), region.cp, work);
 
-	assert(region->regionId == regionId);
-    UInt64 cp = region->cp;
-	UInt64 is_doall = (cp - region->childMaxCP) < doall_threshold ? 1 : 0;
+	assert(region.regionId == regionId);
+    UInt64 cp = region.cp;
+	UInt64 is_doall = (cp - region.childMaxCP) < doall_threshold ? 1 : 0;
 	if (regionType != RegionLoop)
 		is_doall = 0;
 	//fprintf(stderr, "is_doall = %d\n", is_doall);
@@ -512,7 +764,7 @@ void KremlinProfiler::handleRegionExit(SID regionId, RegionType regionType) {
 	}
 	if (level < getMaxLevel() && level >= getMinLevel()) {
 		assert(work >= cp);
-		assert(work >= region->childrenWork);
+		assert(work >= region.childrenWork);
 	}
 #endif
 
@@ -523,16 +775,16 @@ void KremlinProfiler::handleRegionExit(SID regionId, RegionType regionType) {
 	// so no need to compare with max level.
 
 	if (level > getMinLevel()) {
-		ProgramRegion* parentRegion = getRegionAtLevel(level - 1);
-    	parentSid = parentRegion->regionId;
-		parentRegion->childrenWork += work;
-		parentRegion->childrenCP += cp;
-		parentRegion->childCount++;
-		if (parentRegion->childMaxCP < cp) 
-			parentRegion->childMaxCP = cp;
+		ProgramRegion parentRegion = getRegionAtLevel(level - 1);
+    	parentSid = parentRegion.regionId;
+		parentRegion.childrenWork += work;
+		parentRegion.childrenCP += cp;
+		parentRegion.childCount++;
+		if (parentRegion.childMaxCP < cp) 
+			parentRegion.childMaxCP = cp;
 	} 
 
-	double spTemp = (work - region->childrenWork + region->childrenCP) / (double)cp;
+	double spTemp = (work - region.childrenWork + region.childrenCP) / (double)cp;
 	double sp = (work > 0) ? spTemp : 1.0;
 
 #ifdef KREMLIN_DEBUG
@@ -541,13 +793,13 @@ void KremlinProfiler::handleRegionExit(SID regionId, RegionType regionType) {
     if (shouldInstrumentCurrLevel() && cp == 0 && work > 0) {
         fprintf(stderr, "cp should be a non-zero number when work is non-zero\n");
         fprintf(stderr, "region [type: %u, level: %u, sid: %llu] parent [%llu] cp %llu work %llu\n",
-            regionType, level, regionId,  parentSid,  region->cp, work);
+            regionType, level, regionId,  parentSid,  region.cp, work);
         assert(0);
     }
 
 	if (level < getMaxLevel() && sp < 0.999) {
 		fprintf(stderr, "sp = %.2f sid=%llu work=%llu childrenWork = %llu childrenCP=%lld cp=%lld\n", sp, sid, work,
-			region->childrenWork, region->childrenCP, region->cp);
+			region.childrenWork, region.childrenCP, region.cp);
 		assert(0);
 	}
 #endif
@@ -564,7 +816,7 @@ void KremlinProfiler::handleRegionExit(SID regionId, RegionType regionType) {
 	closeRegionContext(&stats);
         
     if (regionType == RegionFunc) { 
-		handleFunctionExit(); 
+		handleFunctionExit(stack_ptr); 
 	}
 
     decrementLevel();
@@ -574,6 +826,15 @@ void KremlinProfiler::handleRegionExit(SID regionId, RegionType regionType) {
 void KremlinProfiler::handleLandingPad(SID regionId, RegionType regionType) {
 	idbgAction(KREM_REGION_EXIT, "## KLandingPad(regionID=%llu,regionType=%u)\n",regionId,regionType);
 
+	if (isSkippingRegion()) {
+		// unwind skipped regions; if the landing pad isn't in any of them
+		// we also need to unwind profiled regions below
+		while (isSkippingRegion() && skipped_regions.back() != regionId)
+			skipped_regions.pop_back();
+		if (isSkippingRegion()) return;
+		endSkippedRegion();
+	}
+
     if (!enabled) return;
 
 	SID sid = 0;
@@ -581,7 +842,7 @@ void KremlinProfiler::handleLandingPad(SID regionId, RegionType regionType) {
 	// find deepest level with region id that matches parameter regionId
 	Level end_level = getCurrentLevel()+1;
 	for (unsigned i = getCurrentLevel(); i >= 0; --i) {
-		if (getRegionAtLevel(i)->regionId == regionId) {
+		if (getRegionAtLevel(i).regionId == regionId) {
 			end_level = i;
 			break;
 		}
@@ -590,18 +851,18 @@ void KremlinProfiler::handleLandingPad(SID regionId, RegionType regionType) {
 	
 	while (getCurrentLevel() > end_level) {
 		Level level = getCurrentLevel();
-		ProgramRegion* region = getRegionAtLevel(level);
+		ProgramRegion region = getRegionAtLevel(level);
 
-		sid = region->regionId;
-		UInt64 work = getCurrentTime() - region->start;
+		sid = region.regionId;
+		UInt64 work = getCurrentTime() - region.start;
 		decIndentTab(); // applies only to debug printing
 		MSG(0, "\n");
 		MSG(0, "[!---] region [type %u, level %u, sid 0x%llx] time %llu cp %llu work %llu\n",
-			region->regionType, level, sid, getCurrentTime(), region->cp, work);
+			region.regionType, level, sid, getCurrentTime(), region.cp, work);
 
-		UInt64 cp = region->cp;
-		UInt64 is_doall = (cp - region->childMaxCP) < doall_threshold ? 1 : 0;
-		if (region->regionType != RegionLoop)
+		UInt64 cp = region.cp;
+		UInt64 is_doall = (cp - region.childMaxCP) < doall_threshold ? 1 : 0;
+		if (region.regionType != RegionLoop)
 			is_doall = 0;
 		//fprintf(stderr, "is_doall = %d\n", is_doall);
 
@@ -613,7 +874,7 @@ void KremlinProfiler::handleLandingPad(SID regionId, RegionType regionType) {
 		}
 		if (level < getMaxLevel() && level >= getMinLevel()) {
 			assert(work >= cp);
-			assert(work >= region->childrenWork);
+			assert(work >= region.childrenWork);
 		}
 #endif
 
@@ -625,16 +886,16 @@ void KremlinProfiler::handleLandingPad(SID regionId, RegionType regionType) {
 
 		SID parentSid = 0;
 		if (level > getMinLevel()) {
-			ProgramRegion* parentRegion = getRegionAtLevel(level - 1);
-			parentSid = parentRegion->regionId;
-			parentRegion->childrenWork += work;
-			parentRegion->childrenCP += cp;
-			parentRegion->childCount++;
-			if (parentRegion->childMaxCP < cp) 
-				parentRegion->childMaxCP = cp;
+			ProgramRegion parentRegion = getRegionAtLevel(level - 1);
+			parentSid = parentRegion.regionId;
+			parentRegion.childrenWork += work;
+			parentRegion.childrenCP += cp;
+			parentRegion.childCount++;
+			if (parentRegion.childMaxCP < cp) 
+				parentRegion.childMaxCP = cp;
 		} 
 
-		double spTemp = (work - region->childrenWork + region->childrenCP) / (double)cp;
+		double spTemp = (work - region.childrenWork + region.childrenCP) / (double)cp;
 		double sp = (work > 0) ? spTemp : 1.0;
 
 #ifdef KREMLIN_DEBUG
@@ -643,13 +904,13 @@ void KremlinProfiler::handleLandingPad(SID regionId, RegionType regionType) {
 		if (shouldInstrumentCurrLevel() && cp == 0 && work > 0) {
 			fprintf(stderr, "cp should be a non-zero number when work is non-zero\n");
 			fprintf(stderr, "region [type: %u, level: %u, sid: %llu] parent [%llu] cp %llu work %llu\n",
-				regionType, level, regionId,  parentSid,  region->cp, work);
+				regionType, level, regionId,  parentSid,  region.cp, work);
 			assert(0);
 		}
 
 		if (level < getMaxLevel() && sp < 0.999) {
 			fprintf(stderr, "sp = %.2f sid=%llu work=%llu childrenWork=%llu childrenCP=%lld cp=%lld\n", sp, sid, work,
-				region->childrenWork, region->childrenCP, region->cp);
+				region.childrenWork, region.childrenCP, region.cp);
 			assert(0);
 		}
 #endif
@@ -665,8 +926,8 @@ void KremlinProfiler::handleLandingPad(SID regionId, RegionType regionType) {
 							spWork, is_doall, region);
 		closeRegionContext(&stats);
 			
-		if (region->regionType == RegionFunc) { 
-			handleFunctionExit(); 
+		if (region.regionType == RegionFunc) { 
+			handleFunctionExit(NULL); 
 		}
 
 		decrementLevel();
@@ -791,50 +1052,15 @@ src4_reg, UInt32 src4_offset, UInt32 src5_reg, UInt32 src5_offset) {
 										src5_reg, src5_offset);
 }
 
-void KremlinProfiler::handleTimestamp6(UInt32 dest_reg, UInt32 src1_reg, UInt32 src1_offset, UInt32
-src2_reg, UInt32 src2_offset, UInt32 src3_reg, UInt32 src3_offset, UInt32
-src4_reg, UInt32 src4_offset, UInt32 src5_reg, UInt32 src5_offset, UInt32
-src6_reg, UInt32 src6_offset) {
-    MSG(3, "KTimestamp6 ts[%u] = max(ts[%u] + %u,ts[%u] + %u, ts[%u] + %u,"
-	"ts[%u] + %u, ts[%u] + %u, ts[%u] + %u)\n",
-	  dest_reg, src1_reg, src1_offset, src2_reg, src2_offset, src3_reg,
-	  src3_offset,src4_reg,src4_offset,src5_reg,src5_offset,src6_reg,src6_offset);
-	// TODO: fix next line
-	//idbgAction(KREM_TS,"## _KTimestamp(dest_reg=%u,src1_reg=%u,src1_offset=%u,src2_reg=%u,src2_offset=%u)\n",dest_reg,src1_reg,src1_offset,src2_reg,src2_offset);
-
-    if (!enabled) return;
-
-	timestampUpdater<true, false, 5, false>(dest_reg, src1_reg, src1_offset, 
-										src2_reg, src2_offset, 
-										src3_reg, src3_offset, 
-										src4_reg, src4_offset, 
-										src5_reg, src5_offset);
-	timestampUpdater<false, true, 2, false>(dest_reg, dest_reg, 0, 
-										src6_reg, src6_offset);
-}
-
-void KremlinProfiler::handleTimestamp7(UInt32 dest_reg, UInt32 src1_reg, UInt32 src1_offset, UInt32
-src2_reg, UInt32 src2_offset, UInt32 src3_reg, UInt32 src3_offset, UInt32
-src4_reg, UInt32 src4_offset, UInt32 src5_reg, UInt32 src5_offset, UInt32
-src6_reg, UInt32 src6_offset, UInt32 src7_reg, UInt32 src7_offset) {
-    MSG(3, "KTimestamp7 ts[%u] = max(ts[%u] + %u,ts[%u] + %u, ts[%u] + %u,"
-	"ts[%u] + %u, ts[%u] + %u, ts[%u] + %u, ts[%u] + %u)\n",
-	  dest_reg, src1_reg, src1_offset, src2_reg, src2_offset, src3_reg,
-	  src3_offset, src4_reg, src4_offset, src5_reg, src5_offset,
-	  src6_reg, src6_offset, src7_reg, src7_offset);
-	// TODO: fix next line
-	//idbgAction(KREM_TS,"## _KTimestamp(dest_reg=%u,src1_reg=%u,src1_offset=%u,src2_reg=%u,src2_offset=%u)\n",dest_reg,src1_reg,src1_offset,src2_reg,src2_offset);
+template <unsigned num_srcs>
+void KremlinProfiler::handleTimestampN(UInt32 dest_reg, const UInt32* src_regs, const UInt32* src_offsets) {
+    MSG(3, "KTimestamp%u ts[%u] = max(ts[%u] + %u, ...)\n",
+	  num_srcs, dest_reg, src_regs[0], src_offsets[0]);
+	idbgAction(KREM_TS,"## _KTimestamp%u(dest_reg=%u,...)\n",num_srcs,dest_reg);
 
     if (!enabled) return;
 
-	timestampUpdater<true, false, 5, false>(dest_reg, src1_reg, src1_offset, 
-										src2_reg, src2_offset, 
-										src3_reg, src3_offset, 
-										src4_reg, src4_offset, 
-										src5_reg, src5_offset);
-	timestampUpdater<false, true, 3, false>(dest_reg, dest_reg, 0, 
-										src6_reg, src6_offset, 
-										src7_reg, src7_offset);
+	timestampUpdaterN<true, true, num_srcs, false>(dest_reg, src_regs, src_offsets);
 }
 
 void KremlinProfiler::handleLoad(Addr src_addr, Reg dest_reg, UInt32 mem_access_size, UInt32 num_srcs, va_list args) {
@@ -871,6 +1097,17 @@ void KremlinProfiler::handleLoad1(Addr src_addr, Reg dest_reg, Reg src_reg, UInt
 											src_addr, mem_access_size);
 }
 
+template <unsigned num_srcs>
+void KremlinProfiler::handleLoadN(Addr src_addr, Reg dest_reg, const Reg* src_regs, UInt32 mem_access_size) {
+    MSG(1, "load%u ts[%u] = max(ts[0x%x],ts[%u],...) + %u\n", num_srcs, dest_reg, src_addr, src_regs[0], LOAD_COST);
+	idbgAction(KREM_LOAD,"## KLoad%u(Addr=0x%x,dest_reg=%u,mem_access_size=%u,...)\n",num_srcs,src_addr,dest_reg,mem_access_size);
+
+    if (!enabled) return;
+
+	timestampUpdaterN<true, true, num_srcs, true>(dest_reg, src_regs, NULL,
+												src_addr, mem_access_size);
+}
+
 void KremlinProfiler::handleStore(Reg src_reg, Addr dest_addr, UInt32 mem_access_size) {
     MSG(1, "store size %d ts[0x%x] = ts[%u] + %u\n", mem_access_size, dest_addr, src_reg, STORE_COST);
 	idbgAction(KREM_STORE,"## KStore(src_reg=%u,dest_addr=0x%x,mem_access_size=%u)\n",src_reg,dest_addr,mem_access_size);
@@ -894,6 +1131,347 @@ void KremlinProfiler::handleStoreConst(Addr dest_addr, UInt32 mem_access_size) {
     MSG(1, "store const mem[0x%x] completed\n", dest_addr);
 }
 
+/*
+ * Live heap blocks and their sizes, shared by all threads. Blocks are
+ * spread over HEAP_SHARDS tables by address, each with its own lock, so
+ * threads allocating and freeing at the same time rarely wait for each
+ * other. (The size can't come from malloc_usable_size: _KFree and
+ * _KRealloc run after the block has already been freed.)
+ */
+static const unsigned HEAP_SHARD_SHIFT = 6;
+static const unsigned HEAP_SHARDS = 1 << HEAP_SHARD_SHIFT;
+
+struct HeapShard {
+	pthread_mutex_t lock;
+	std::map<Addr, UInt64> blocks;
+	UInt64 num_allocs;
+	UInt64 num_frees;
+	UInt64 num_untracked_frees; //!< Blocks we never saw allocated
+	char padding[64]; //!< Keeps neighbouring locks off the same cache line
+};
+
+static HeapShard heap_shards[HEAP_SHARDS];
+static pthread_once_t heap_shards_once = PTHREAD_ONCE_INIT;
+static volatile UInt64 heap_bytes_live = 0;
+static UInt64 heap_bytes_peak = 0;
+
+static void initHeapShards() {
+	for (unsigned i = 0; i < HEAP_SHARDS; ++i) {
+		pthread_mutex_init(&heap_shards[i].lock, NULL);
+		heap_shards[i].num_allocs = 0;
+		heap_shards[i].num_frees = 0;
+		heap_shards[i].num_untracked_frees = 0;
+	}
+}
+
+static HeapShard* getHeapShard(Addr addr) {
+	// malloc'ed blocks are 16-byte aligned so the low bits say nothing
+	UInt64 key = ((UInt64)addr >> 4) * 0x9E3779B97F4A7C15ULL;
+	pthread_once(&heap_shards_once, initHeapShards);
+	return &heap_shards[key >> (64 - HEAP_SHARD_SHIFT)];
+}
+
+static void addHeapBlock(Addr addr, UInt64 size) {
+	HeapShard* shard = getHeapShard(addr);
+	pthread_mutex_lock(&shard->lock);
+	shard->blocks[addr] = size;
+	shard->num_allocs++;
+	pthread_mutex_unlock(&shard->lock);
+
+	// the peak is only for the stats, so a race that loses an update is fine
+	UInt64 live = __sync_add_and_fetch(&heap_bytes_live, size);
+	if (live > heap_bytes_peak) heap_bytes_peak = live;
+}
+
+/*!
+ * Forgets a block.
+ *
+ * @param[out] size The size it was allocated with.
+ * @return False if the block was never recorded.
+ */
+static bool removeHeapBlock(Addr addr, UInt64* size) {
+	HeapShard* shard = getHeapShard(addr);
+	pthread_mutex_lock(&shard->lock);
+	std::map<Addr, UInt64>::iterator it = shard->blocks.find(addr);
+	bool found = (it != shard->blocks.end());
+	if (found) {
+		*size = it->second;
+		shard->blocks.erase(it);
+		shard->num_frees++;
+	}
+	else shard->num_untracked_frees++;
+	pthread_mutex_unlock(&shard->lock);
+
+	if (found) __sync_sub_and_fetch(&heap_bytes_live, *size);
+	return found;
+}
+
+static void printHeapStats() {
+	UInt64 num_heap_allocs = 0;
+	UInt64 num_heap_frees = 0;
+	UInt64 num_heap_untracked_frees = 0;
+	for (unsigned i = 0; i < HEAP_SHARDS; ++i) {
+		num_heap_allocs += heap_shards[i].num_allocs;
+		num_heap_frees += heap_shards[i].num_frees;
+		num_heap_untracked_frees += heap_shards[i].num_untracked_frees;
+	}
+
+	if (num_heap_allocs == 0) return;
+	fprintf(stderr, "[kremlin] Heap: %llu blocks allocated, %llu freed (%llu unknown frees), peak %.1f MB live\n",
+		(unsigned long long)num_heap_allocs, (unsigned long long)num_heap_frees, 
+		(unsigned long long)num_heap_untracked_frees,
+		heap_bytes_peak / 1048576.0);
+}
+
+void KremlinProfiler::copyShadowMemory(Addr dest, Addr src, UInt64 size) {
+	Index end_index = getCurrNumInstrumentedLevels();
+	if (end_index == 0) return;
+
+	Level min_level = getLevelForIndex(0);
+	Version* versions = getVersionAtLevel(min_level);
+	Time* times = getLevelTimes();
+
+	for (UInt64 offset = 0; offset < size; offset += 8) {
+		Time* src_times = getShadowTimes((Addr)((UInt64)src + offset),
+											end_index, versions, 8);
+		// timestamps only shrink with depth so this word was never written
+		if (src_times[0] == 0) continue;
+
+		// TRICKY: src_times may point into the cache line that set reuses
+		memcpy(times, src_times, sizeof(Time) * end_index);
+		setShadowTimes((Addr)((UInt64)dest + offset), end_index, 
+						versions, times, 8);
+	}
+}
+
+void KremlinProfiler::handleMalloc(Addr addr, size_t size, UInt dest) {
+    MSG(1, "KMalloc addr=0x%x size=%llu\n", addr, (UInt64)size);
+	idbgAction(KREM_MALLOC,"## KMalloc(addr=0x%x,size=%llu,dest=%u)\n",addr,(UInt64)size,dest);
+
+    // Don't do anything if malloc returned NULL
+	if (addr == NULL) return;
+
+	// Recorded even while disabled so the block can be cleared when it is
+	// freed later on.
+	addHeapBlock(addr, size);
+}
+
+void KremlinProfiler::handleFree(Addr addr) {
+    MSG(1, "KFree addr=0x%x\n", addr);
+	idbgAction(KREM_FREE,"## KFree(addr=0x%x)\n",addr);
+
+    // Calls to free with NULL just return.
+	if (addr == NULL) return;
+
+	UInt64 size;
+	if (!removeHeapBlock(addr, &size)) {
+		MSG(1, "KFree: 0x%x wasn't allocated by instrumented code\n", addr);
+		return;
+	}
+
+	// The block's memory is dead even if nothing is being profiled right
+	// now (e.g. inside a skipped region): stale timestamps left behind
+	// would be picked up by whatever reuses it once profiling resumes.
+	if (!initialized) return;
+
+	Level min_level = getLevelForIndex(0);
+	getShadowMemory()->clear(addr, size, getVersionAtLevel(min_level));
+}
+
+void KremlinProfiler::handleRealloc(Addr old_addr, Addr new_addr, size_t size, UInt dest) {
+    MSG(1, "KRealloc old_addr=0x%x new_addr=0x%x size=%llu\n", old_addr, new_addr, (UInt64)size);
+	idbgAction(KREM_REALLOC,"## KRealloc(old_addr=0x%x,new_addr=0x%x,size=%llu,dest=%u)\n",old_addr,new_addr,(UInt64)size,dest);
+
+	if (old_addr == NULL) {
+		handleMalloc(new_addr, size, dest);
+		return;
+	}
+
+	if (new_addr == NULL) {
+		// realloc(p, 0) may free p; otherwise it failed and p is untouched
+		if (size == 0) handleFree(old_addr);
+		return;
+	}
+
+	UInt64 old_size;
+	if (!removeHeapBlock(old_addr, &old_size)) {
+		MSG(1, "KRealloc: 0x%x wasn't allocated by instrumented code\n", old_addr);
+		addHeapBlock(new_addr, size);
+		return;
+	}
+	addHeapBlock(new_addr, size);
+
+	// as in handleFree, the old block is dead whether or not we are enabled
+	if (!initialized) return;
+
+	Level min_level = getLevelForIndex(0);
+	Version* versions = getVersionAtLevel(min_level);
+
+	if (new_addr == old_addr) {
+		// resized in place: only a dropped tail is dead
+		UInt64 live_end = ((UInt64)size + 7) & ~(UInt64)0x7;
+		if (live_end < old_size) {
+			getShadowMemory()->clear((Addr)((UInt64)old_addr + live_end), 
+										old_size - live_end, versions);
+		}
+		return;
+	}
+
+	copyShadowMemory(new_addr, old_addr, (size < old_size) ? size : old_size);
+	getShadowMemory()->clear(old_addr, old_size, versions);
+}
+
+/*!
+ * @return The number of 8-byte words that size bytes at addr touch.
+ */
+static inline UInt64 getNumWordsTouched(Addr addr, UInt64 size) {
+	if (size == 0) return 0;
+	UInt64 start = (UInt64)addr & ~(UInt64)0x7;
+	return ((UInt64)addr + size - start + 7) >> 3;
+}
+
+void KremlinProfiler::handleMemCopy(Addr dest_addr, Addr src_addr, UInt64 size) {
+    MSG(1, "KMemCopy ts[0x%x..] = ts[0x%x..] + %u (size: %llu)\n", dest_addr, src_addr, LOAD_COST + STORE_COST, size);
+	idbgAction(KREM_MEMCOPY,"## _KMemCopy(dest_addr=0x%x,src_addr=0x%x,size=%llu)\n",dest_addr,src_addr,size);
+
+	// the words are loaded and stored even if we aren't profiling them
+	curr_time += getNumWordsTouched(dest_addr, size) * (LOAD_COST + STORE_COST);
+
+    if (!enabled) return;
+
+	Index end_index = getCurrNumInstrumentedLevels();
+	if (size == 0 || end_index == 0) return;
+
+	Time* max_times = getLevelTimes();
+	Level min_level = getLevelForIndex(0);
+	getShadowMemory()->copyRange(dest_addr, src_addr, size, end_index, 
+									getVersionAtLevel(min_level), 
+									cdt_current_base, LOAD_COST + STORE_COST, 
+									max_times);
+	updateCriticalPathLengths(max_times, end_index);
+}
+
+template <bool store_const>
+void KremlinProfiler::timestampUpdaterMemSet(Addr dest_addr, UInt64 size, Reg src_reg) {
+	Index end_index = getCurrNumInstrumentedLevels();
+	if (size == 0 || end_index == 0) return;
+
+	Time* dest_addr_times = getLevelTimes();
+
+	const Time* srcs[2];
+	Time offsets[2] = {0, 0};
+	unsigned num_srcs = 0;
+	srcs[num_srcs++] = cdt_current_base;
+	if (!store_const) {
+		assert(src_reg < getCurrNumShadowRegisters());
+		srcs[num_srcs++] = getValidRegisterTimes(src_reg);
+	}
+
+	// every word gets the same timestamps
+	TimeVectorMax(dest_addr_times, srcs, offsets, num_srcs, STORE_COST, end_index);
+	updateCriticalPathLengths(dest_addr_times, end_index);
+
+	Level min_level = getLevelForIndex(0);
+	getShadowMemory()->setRange(dest_addr, size, end_index, 
+								getVersionAtLevel(min_level), dest_addr_times);
+}
+
+void KremlinProfiler::handleMemSet(Reg src_reg, Addr dest_addr, UInt64 size) {
+    MSG(1, "KMemSet ts[0x%x..] = ts[%u] + %u (size: %llu)\n", dest_addr, src_reg, STORE_COST, size);
+	idbgAction(KREM_MEMSET,"## _KMemSet(src_reg=%u,dest_addr=0x%x,size=%llu)\n",src_reg,dest_addr,size);
+
+	curr_time += getNumWordsTouched(dest_addr, size) * STORE_COST;
+
+    if (!enabled) return;
+
+	timestampUpdaterMemSet<false>(dest_addr, size, src_reg);
+}
+
+void KremlinProfiler::handleMemSetConst(Addr dest_addr, UInt64 size) {
+    MSG(1, "KMemSetConst ts[0x%x..] = %u (size: %llu)\n", dest_addr, STORE_COST, size);
+	idbgAction(KREM_MEMSET,"## _KMemSetConst(dest_addr=0x%x,size=%llu)\n",dest_addr,size);
+
+	curr_time += getNumWordsTouched(dest_addr, size) * STORE_COST;
+
+    if (!enabled) return;
+
+	timestampUpdaterMemSet<true>(dest_addr, size, 0);
+}
+
+void KremlinProfiler::handleCallLib(UInt64 cost, Reg dest_reg, UInt32 num_srcs, 
+									UInt32 num_reads, UInt32 num_writes, 
+									va_list args) {
+    MSG(1, "KCallLib ts[%u] = max(ts[src0]..ts[src%u], %u ranges) + %llu\n", dest_reg, num_srcs, num_reads, cost);
+	idbgAction(KREM_CALL_LIB,"## _KCallLib(cost=%llu,dest_reg=%u,num_srcs=%u,num_reads=%u,num_writes=%u,...)\n",cost,dest_reg,num_srcs,num_reads,num_writes);
+
+	// the library does this work whether or not we profile it
+	curr_time += cost;
+
+    if (!enabled) return;
+
+	Index end_index = getCurrNumInstrumentedLevels();
+	if (end_index == 0) return;
+
+	// Fold the sources into lib_times a few at a time so there is no limit
+	// on how many arguments the call has.
+	Time* lib_times = getLevelTimes();
+	const Time* srcs[5];
+	Time offsets[5] = {0, 0, 0, 0, 0};
+	srcs[0] = cdt_current_base;
+	unsigned num_batch = 1;
+
+	for (unsigned s = 0; s < num_srcs; ++s) {
+		Reg src_reg = va_arg(args, UInt32);
+		assert(src_reg < getCurrNumShadowRegisters());
+		srcs[num_batch++] = getValidRegisterTimes(src_reg);
+
+		if (num_batch == 5) {
+			TimeVectorMax(lib_times, srcs, offsets, num_batch, 0, end_index);
+			srcs[0] = lib_times;
+			num_batch = 1;
+		}
+	}
+
+	// Copying a range onto itself leaves its timestamps as they were and
+	// gives the latest of them.
+	static const Time no_min_times[arraySize] = {0};
+	Level min_level = getLevelForIndex(0);
+	for (unsigned r = 0; r < num_reads; ++r) {
+		Addr addr = va_arg(args, Addr);
+		UInt64 size = va_arg(args, UInt64);
+		if (size == 0) continue;
+
+		getShadowMemory()->copyRange(addr, addr, size, end_index, 
+										getVersionAtLevel(min_level), 
+										no_min_times, 0, range_times);
+		srcs[num_batch++] = range_times;
+		TimeVectorMax(lib_times, srcs, offsets, num_batch, 0, end_index);
+		srcs[0] = lib_times;
+		num_batch = 1;
+	}
+
+	Time* result_times = lib_times;
+	if (dest_reg != KREM_NO_DEST_REG) {
+		assert(dest_reg < getCurrNumShadowRegisters());
+		propagateTimestamps<true>(dest_reg, srcs, offsets, num_batch, cost);
+		result_times = getValidRegisterTimes(dest_reg);
+	}
+	else {
+		// nothing gets the result but it still ends when the call does
+		TimeVectorMax(lib_times, srcs, offsets, num_batch, cost, end_index);
+		updateCriticalPathLengths(lib_times, end_index);
+	}
+
+	// what the function writes is ready when its result is
+	for (unsigned w = 0; w < num_writes; ++w) {
+		Addr addr = va_arg(args, Addr);
+		UInt64 size = va_arg(args, UInt64);
+		getShadowMemory()->setRange(addr, size, end_index, 
+									getVersionAtLevel(min_level), 
+									result_times);
+	}
+}
+
 void KremlinProfiler::handlePhi(Reg dest_reg, Reg src_reg, UInt32 num_ctrls, va_list args) {
     MSG(1, "KPhi ts[%u] = max(ts[%u],ts[ctrl0]...ts[ctrl%u])\n", dest_reg, src_reg,num_ctrls);
 	idbgAction(KREM_PHI,"## KPhi (dest_reg=%u,src_reg=%u,num_ctrls=%u)\n",dest_reg,src_reg,num_ctrls);
@@ -956,6 +1534,21 @@ void KremlinProfiler::handlePhi4To1(Reg dest_reg, Reg src_reg, Reg ctrl1_reg, Re
 										ctrl4_reg, 0);
 }
 
+template <unsigned num_ctrls>
+void KremlinProfiler::handlePhiNTo1(Reg dest_reg, Reg src_reg, const Reg* ctrl_regs) {
+    MSG(1, "KPhi%uTo1 ts[%u] = max(ts[%u], ts[%u], ...)\n", num_ctrls, dest_reg, src_reg, ctrl_regs[0]);
+	idbgAction(KREM_PHI,"## KPhi%uTo1 (dest_reg=%u,src_reg=%u,...)\n",num_ctrls,dest_reg,src_reg);
+
+    if (!enabled) return;
+
+	// src_reg is just one more data dependence, so put it at the front
+	Reg src_regs[num_ctrls + 1];
+	src_regs[0] = src_reg;
+	for (unsigned i = 0; i < num_ctrls; ++i) src_regs[i+1] = ctrl_regs[i];
+
+	timestampUpdaterN<false, false, num_ctrls + 1, false>(dest_reg, src_regs, NULL);
+}
+
 void KremlinProfiler::handlePhiCond4To1(Reg dest_reg, Reg ctrl1_reg, Reg ctrl2_reg, Reg ctrl3_reg, Reg ctrl4_reg) {
     MSG(1, "KPhi4To1 ts[%u] = max(ts[%u], ts[%u], ts[%u], ts[%u], ts[%u])\n", 
 		dest_reg, dest_reg, ctrl1_reg, ctrl2_reg, ctrl3_reg, ctrl4_reg);
@@ -1008,6 +1601,9 @@ void KremlinProfiler::handlePushCDep(Reg cond) {
 	//assert(lTable->getCol() >= indexSize);
 	//assert(control_dependence_table->getCol() >= indexSize);
 
+	// the control dependence table isn't versioned so clear stale times
+	// before copying
+	getValidRegisterTimes(cond);
 	lTable->copyToDest(control_dependence_table, cdt_read_ptr, cond, 0, indexSize);
 	cdt_current_base = control_dependence_table->getElementAddr(cdt_read_ptr, 0);
 	assert(cdt_read_ptr < control_dependence_table->getRow());
@@ -1099,10 +1695,17 @@ void KremlinProfiler::handlePrepRTable(UInt num_virt_regs, UInt nested_depth) {
     if (!enabled) return; 
 
     assert(waitingForRegisterTableSetup());
-    Table* table = new Table(tableHeight, tableWidth);
     FunctionRegion* funcHead = getCurrentFunction();
 	assert(funcHead != NULL);
-    funcHead->table = table;
+
+	// Stale stamps left in the arena can only match the versions of
+	// regions that were already active before this call, so only the
+	// columns of our callers' regions need to be cleared.
+	int num_zero_cols = getCurrNumInstrumentedLevels();
+	if (shouldInstrumentCurrLevel()) --num_zero_cols;
+	num_zero_cols = MIN(num_zero_cols, tableWidth);
+	funcHead->allocRegisterTable(register_frames, tableHeight, tableWidth,
+									num_zero_cols);
 
     setRegisterFileTable(funcHead->table);
     finishRegisterTableSetup();
@@ -1135,11 +1738,11 @@ void KremlinProfiler::handleReturn(Reg src) {
     FunctionRegion* caller = getCallingFunction();
 
 	// main function does not have a return point
-	if (caller == NULL)
+	if (caller == NULL || !caller->hasReturnRegister())
 		return;
 
 	Reg ret = caller->getReturnRegister();
-	assert(ret >= 0);
+	caller->clearReturnRegister();
 
 	// current level time does not need to be copied
 	int indexSize = getCurrNumInstrumentedLevels() - 1;
@@ -1159,14 +1762,24 @@ void KremlinProfiler::handleReturnConst() {
 	FunctionRegion* caller = getCallingFunction();
 
 	// main function does not have a return point
-	if (caller == NULL)
+	if (caller == NULL || !caller->hasReturnRegister())
 		return;
 
+	setReturnToControlDependence(caller);
+}
+
+void KremlinProfiler::setReturnToControlDependence(FunctionRegion* caller) {
+	// columns of inactive levels are stale no matter what's written there
+	Index end_index = MIN(getCurrNumInstrumentedLevels(), 
+							(Index)caller->table->getCol());
 	Index index;
-    for (index = 0; index < caller->table->getCol(); index++) {
+    for (index = 0; index < end_index; index++) {
 		Time cdt = getControlDependenceAtIndex(index);
-		caller->table->setValue(cdt, caller->getReturnRegister(), index);
+		Version curr_version = *getVersionAtLevel(getLevelForIndex(index));
+		caller->table->setValidValue(cdt, caller->getReturnRegister(), index,
+										curr_version);
     }
+	caller->clearReturnRegister();
 }
 
 void KremlinProfiler::init() {
@@ -1174,15 +1787,24 @@ void KremlinProfiler::init() {
 		return;
     }
 	initialized = true;
-	DebugInit();
+	if (!worker_thread) DebugInit();
 
     MSG(0, "Profile Level = (%d, %d), Index Size = %d\n", 
         getMinLevel(), getMaxLevel(), getArraySize());
     MSG(0, "kremlinInit running....");
 
+	TimeVectorInit();
+	sampling = kremlin_config.sampleRegions();
+	if (sampling) sample_phase_end = kremlin_config.getSampleOnLength();
 	initFunctionArgQueue();
 	initControlDependences();
 	initRegionTree();
+	if (!worker_thread && kremlin_config.getCheckpointPeriod() > 0) {
+		std::string checkpoint_filename(kremlin_config.getProfileOutputFilename());
+		checkpoint_filename += ".checkpoint";
+		startCheckpoints(checkpoint_filename.c_str(), 
+							kremlin_config.getCheckpointPeriod());
+	}
 
 	initShadowMemory();
 	initProgramRegions(INIT_NUM_REGIONS);
@@ -1194,10 +1816,15 @@ void KremlinProfiler::init() {
    KExitRegion() calls for active regions
  */
 void KremlinProfiler::cleanup() {
+	if (isSkippingRegion()) {
+		skipped_regions.clear();
+		endSkippedRegion();
+	}
+
     Level level = getCurrentLevel();
 	for (int i = level; i >= 0; --i) {
-		ProgramRegion* region = getRegionAtLevel(i);
-		handleRegionExit(region->regionId, region->regionType);
+		ProgramRegion region = getRegionAtLevel(i);
+		handleRegionExit(region.regionId, region.regionType, NULL);
 	}
 }
 
@@ -1209,16 +1836,84 @@ void KremlinProfiler::deinit() {
     }
 	initialized = false;
 
-	fprintf(stderr,"[kremlin] max active level = %d\n", 
-		getMaxActiveLevel());	
-
 	disable();
-	printProfiledData(kremlin_config.getProfileOutputFilename());
-	deinitRegionTree();
+	if (worker_thread) {
+		detachRegionTree();
+	}
+	else {
+		fprintf(stderr,"[kremlin] max active level = %d\n", 
+			getMaxActiveLevel());	
+
+		printProfiledData(kremlin_config.getProfileOutputFilename());
+		stopCheckpoints();
+		deinitRegionTree();
+	}
 	deinitShadowMemory();
 	deinitFunctionArgQueue();
 	deinitControlDependences();
 	deinitProgramRegions();
+	deinitFunctionRegions();
 	
-	DebugDeinit();
+	if (num_stack_reclaims > 0) {
+		fprintf(stderr, "[kremlin] Stack shadow: reclaimed %llu times, %.1f MB in all\n",
+			(unsigned long long)num_stack_reclaims, 
+			stack_bytes_reclaimed / 1048576.0);
+	}
+	if (!worker_thread) {
+		printHeapStats();
+		MemPoolPrintStats();
+		DebugDeinit();
+	}
 }
+
+/*
+ * The exact-arity handlers are called from kremlin.cpp so they need to be
+ * explicitly instantiated here, one for each specialized entry point.
+ */
+#define INSTANTIATE_TIMESTAMP_N(n) \
+	template void KremlinProfiler::handleTimestampN<n>(UInt32, const UInt32*, const UInt32*);
+#define INSTANTIATE_LOAD_N(n) \
+	template void KremlinProfiler::handleLoadN<n>(Addr, Reg, const Reg*, UInt32);
+#define INSTANTIATE_PHI_N_TO_1(n) \
+	template void KremlinProfiler::handlePhiNTo1<n>(Reg, Reg, const Reg*);
+
+INSTANTIATE_TIMESTAMP_N(6)
+INSTANTIATE_TIMESTAMP_N(7)
+INSTANTIATE_TIMESTAMP_N(8)
+INSTANTIATE_TIMESTAMP_N(9)
+INSTANTIATE_TIMESTAMP_N(10)
+INSTANTIATE_TIMESTAMP_N(11)
+INSTANTIATE_TIMESTAMP_N(12)
+INSTANTIATE_TIMESTAMP_N(13)
+INSTANTIATE_TIMESTAMP_N(14)
+INSTANTIATE_TIMESTAMP_N(15)
+INSTANTIATE_TIMESTAMP_N(16)
+
+INSTANTIATE_LOAD_N(2)
+INSTANTIATE_LOAD_N(3)
+INSTANTIATE_LOAD_N(4)
+INSTANTIATE_LOAD_N(5)
+INSTANTIATE_LOAD_N(6)
+INSTANTIATE_LOAD_N(7)
+INSTANTIATE_LOAD_N(8)
+INSTANTIATE_LOAD_N(9)
+INSTANTIATE_LOAD_N(10)
+INSTANTIATE_LOAD_N(11)
+INSTANTIATE_LOAD_N(12)
+INSTANTIATE_LOAD_N(13)
+INSTANTIATE_LOAD_N(14)
+INSTANTIATE_LOAD_N(15)
+INSTANTIATE_LOAD_N(16)
+
+INSTANTIATE_PHI_N_TO_1(5)
+INSTANTIATE_PHI_N_TO_1(6)
+INSTANTIATE_PHI_N_TO_1(7)
+INSTANTIATE_PHI_N_TO_1(8)
+INSTANTIATE_PHI_N_TO_1(9)
+INSTANTIATE_PHI_N_TO_1(10)
+INSTANTIATE_PHI_N_TO_1(11)
+INSTANTIATE_PHI_N_TO_1(12)
+INSTANTIATE_PHI_N_TO_1(13)
+INSTANTIATE_PHI_N_TO_1(14)
+INSTANTIATE_PHI_N_TO_1(15)
+INSTANTIATE_PHI_N_TO_1(16)
@@ -4,13 +4,15 @@
 #include <vector>
 #include <stdarg.h> /* for variable length args */
 #include "ktypes.h"
+#include "config.h"
 #include "PoolAllocator.hpp"
+#include "ProgramRegion.hpp"
+#include "RegisterFrameArena.hpp"
 
 #define MIN(a, b)   (((a) < (b)) ? (a) : (b))
 #define MAX(a, b)   (((a) > (b)) ? (a) : (b))
 
 class MShadow;
-class ProgramRegion;
 class FunctionRegion;
 class Table;
 
@@ -19,28 +21,41 @@ private:
 	static const unsigned LOAD_COST = 4;
 	static const unsigned STORE_COST = 1;
 
+	// Largest number of sources that has its own entry point (e.g.
+	// _KTimestamp16); anything larger goes through the vararg handlers.
+	static const unsigned MAX_SPECIALIZED_SRCS = 16;
+
 	bool enabled; // true if profiling is on (i.e. enabled), false otherwise
 	bool initialized; // true iff init was called without corresponding deinit
+	bool worker_thread; // true iff this profiles a thread other than main's
 
 	Time curr_time; // the current time of the profiler (virtual)
 	Level curr_level; // current level 
 	Level min_level; // minimum level to instrument
 	Level max_level; // maximum level to instrument
+	Level pending_max_level; // max_level once no deeper region is active
 	Level max_active_level; // max level we have seen thusfar
 
 	Index curr_num_instrumented_levels; // number of regions currently instrumented
 	bool instrument_curr_level; // whether we should instrument the current level
 
 	// program region management
-	std::vector<ProgramRegion*, MPoolLib::PoolAllocator<ProgramRegion*> > program_regions;
-	Version* level_versions;
+	ProgramRegionTable program_regions;
 	Time* level_times;
+	Time* range_times; // latest time in a range of memory at each level
 	static const unsigned int arraySize = 512;
 	Version nextVersion;
 
 	// A vector used to represent the call stack.
 	std::vector<FunctionRegion*, MPoolLib::PoolAllocator<FunctionRegion*> > callstack;
 
+	// FunctionRegions that were popped off the callstack, kept for reuse.
+	std::vector<FunctionRegion*, MPoolLib::PoolAllocator<FunctionRegion*> > free_function_regions;
+
+	// Storage for the shadow register tables of the functions on the
+	// callstack; see RegisterFrameArena.
+	RegisterFrameArena register_frames;
+
 	CID last_callsite_id;
 
 	static const unsigned int FUNC_ARG_QUEUE_SIZE = 64;
@@ -58,13 +73,33 @@ private:
 
 	unsigned int doall_threshold;
 
+	// Sampling (see shouldSampleRegion). A region that isn't sampled runs
+	// with profiling disabled, along with every region inside it;
+	// skipped_regions holds the IDs of these regions while they are active.
+	bool sampling;
+	bool in_sample_burst;
+	UInt64 sample_phase_end; // sample clock value when the burst/gap ends
+	UInt64 num_regions_entered;
+	Time skipped_time; // total work of all skipped regions
+	Time skip_start_time;
+	SID skip_region_id;
+	CID skip_callsite_id;
+	RegionType skip_region_type;
+	std::vector<SID, MPoolLib::PoolAllocator<SID> > skipped_regions;
+
 	// Width and height of control dependence table.
 	static const unsigned CDEP_ROW = 256;
 	static const unsigned CDEP_COL = 64;
 
 	static const unsigned INIT_NUM_REGIONS = 64;
-	ProgramRegion* getRegionAtLevel(Level l);
-	void increaseNumRegions(unsigned num_new);
+	ProgramRegion getRegionAtLevel(Level l) {
+		assert(l < program_regions.size());
+		return ProgramRegion(program_regions, l);
+	}
+
+	void increaseNumRegions(unsigned num_new) {
+		program_regions.grow(num_new);
+	}
 
 	unsigned getNumRegions() { return program_regions.size(); }
 	void doubleNumRegions() {
@@ -75,27 +110,31 @@ private:
 		assert(program_regions.empty());
 		increaseNumRegions(num_regions);
 
-		initVersionArray();
 		initTimeArray();
 	}
 
-	void deinitProgramRegions();
-
-	void initVersionArray() {
-		level_versions = new Version[arraySize];
-		for (unsigned i = 0; i < arraySize; ++i) level_versions[i] = 0;
+	void deinitProgramRegions() {
+		program_regions.clear();
+		delete [] level_times;
+		level_times = NULL;
+		delete [] range_times;
+		range_times = NULL;
 	}
 
 	void initTimeArray() {
 		level_times = new Time[arraySize];
-		for (unsigned i = 0; i < arraySize; ++i) level_times[i] = 0;
+		range_times = new Time[arraySize];
+		for (unsigned i = 0; i < arraySize; ++i) {
+			level_times[i] = 0;
+			range_times[i] = 0;
+		}
 	}
 
 	Time* getLevelTimes() { return level_times; }
-	Version* getVersionAtLevel(Level level) { return &level_versions[level]; }
+	Version* getVersionAtLevel(Level level) { return &program_regions.versions[level]; }
 
 	void issueVersionToLevel(Level level) {
-		level_versions[level] = nextVersion++;	
+		program_regions.versions[level] = nextVersion++;	
 	}
 
 	/*!
@@ -126,8 +165,45 @@ private:
 	 */
 	void initRegionControlDependences(Index index);
 
-	static Table *shadow_reg_file;
+	Table *shadow_reg_file;
 	MShadow *shadow_mem;
+	ShadowMemoryType shadow_mem_type; //!< Which subclass shadow_mem is
+
+	/*!
+	 * Same as shadow_mem->get() and shadow_mem->set(), but Skadu and Flat
+	 * shadow memory are called directly rather than through the vtable, so
+	 * that the bitcode build can inline them into the instrumented program.
+	 */
+	Time* getShadowTimes(Addr addr, Index size, Version* versions, 
+							UInt32 width);
+	void setShadowTimes(Addr addr, Index size, Version* versions, 
+						Time* times, UInt32 width);
+
+	/*
+	 * Each function region remembers where the stack was when it was
+	 * entered. When it exits, the frames of the functions it called are
+	 * dead, so the shadow memory of everything from the lowest stack
+	 * address entered since the last reclamation up to there is cleared.
+	 */
+	static const UInt64 MAX_STACK_RECLAIM = 8 << 20; //!< Bytes per exit
+	static const UInt64 MAX_STACK_DRIFT = 1 << 16; //!< Between entry and exit
+	UInt64 num_stack_reclaims;
+	UInt64 stack_bytes_reclaimed;
+
+	/*!
+	 * Clears the shadow memory of the stack frames func's callees used.
+	 *
+	 * Stack positions are the stack pointers the instrumentation pass reads
+	 * in the instrumented function (llvm.stacksave) and passes to
+	 * _KEnterRegion/_KExitRegion of function regions. They stay below the
+	 * function's own frame whether or not the handlers are inlined. Nothing
+	 * is reclaimed for exits without one (landing pads, cleanup).
+	 *
+	 * @param func The function region about to be popped.
+	 * @param sp Stack pointer at exit, to check func was entered on this
+	 * thread's stack.
+	 */
+	void reclaimStackFrames(FunctionRegion* func, Addr sp);
 
 	/*!
 	 * @brief Returns number of shadow registers in the current function.
@@ -144,14 +220,19 @@ private:
 	unsigned getShadowRegisterFileDepth();
 
 	/*!
-	 * @brief Sets to zero the timestamp in all registers at the given index 
-	 * (i.e. depth).
+	 * @brief Returns the timestamps of a register at all instrumented
+	 * levels, after clearing the ones that were set in an earlier instance
+	 * of their region.
+	 *
+	 * Entering a region doesn't touch the register file: register
+	 * timestamps are stamped with the version of the region they were
+	 * written in, and stale ones are only zeroed when they are read.
 	 *
-	 * @param index The level at which to set all register timestamps to 0.
+	 * @param reg The shadow register number.
 	 * @pre shadow_reg_file is non-NULL
-	 * @pre index is not larger than the shadow register's depth
+	 * @pre reg is less than the current number of shadow registers.
 	 */
-	void zeroRegistersAtIndex(Index index);
+	Time* getValidRegisterTimes(Reg reg);
 
 	void updateCurrLevelInstrumentableStatus() {
 		if (curr_level >= min_level && curr_level <= max_level)
@@ -161,26 +242,59 @@ private:
 	}
 
 	/*!
-	 * Calculates the maximum of the specified current time and the value
-	 * stored in a specified shadow register at a given depth plus an
-	 * additional offset. The additional offset is optional, being used only
-	 * when specified by the template parameter.
+	 * Adds a shadow register to the list of sources used by
+	 * propagateTimestamps. Does nothing if data_dep isn't less than
+	 * num_data_deps so callers can unconditionally add all of their
+	 * (possibly unused) source registers.
 	 *
 	 * @tparam num_data_deps The number of data dependencies.
 	 * @tparam data_dep The index of the current data dependency.
 	 * @tparam ignore_offset Should we add the offset to the data dependence
 	 * time?
-	 * @param curr_time The current time.
+	 * @param srcs The list of source arrays to append to.
+	 * @param offsets The list of offsets to append to.
+	 * @param num_srcs The number of entries in srcs and offsets; incremented
+	 * if the register is added.
 	 * @param reg The shadow register number.
 	 * @param offset The additional time added to value stored in reg.
-	 * @param l The level (depth) of the shadow register.
-	 * @return The calculated maximum (see description).
 	 * @pre shadow_reg_file is non-NULL.
 	 * @pre reg is less than the current number of shadow registers.
-	 * @pre l is less than the shadow register's depth.
 	 */
 	template <unsigned num_data_deps, unsigned data_dep, bool ignore_offset>
-	Time calcMaxTime(Time curr_time, UInt32 reg, UInt32 offset, Level l);
+	void addDataDependence(const Time** srcs, Time* offsets, unsigned& num_srcs,
+							UInt32 reg, UInt32 offset);
+
+	/*!
+	 * Adds the current control dependence and/or the shadow memory times of
+	 * src_addr (as selected by the template parameters) to the list of
+	 * sources used by propagateTimestamps.
+	 */
+	template <bool use_ctrl_dependence, bool use_shadow_mem_dependence>
+	void addCommonDependences(const Time** srcs, Time* offsets, 
+								unsigned& num_srcs, 
+								Addr src_addr, UInt32 mem_access_size);
+
+	/*!
+	 * Sets the timestamp of dest_reg at every instrumented level to the max
+	 * of the given sources (plus their offsets) plus post_add, using the
+	 * vectorized TimeVectorMax. If update_cp is set, the critical path of the
+	 * region at each level is then updated with the new timestamp.
+	 *
+	 * @param srcs Arrays of per-index times (e.g. shadow register rows).
+	 * @param offsets The offset added to each source.
+	 * @param num_srcs The number of sources.
+	 * @param post_add Time added after taking the max.
+	 */
+	/*!
+	 * Updates the critical path length of the region at each instrumented
+	 * level with the time at the same index of times.
+	 */
+	void updateCriticalPathLengths(const Time* times, Index end_index);
+
+	template <bool update_cp>
+	void propagateTimestamps(UInt32 dest_reg, const Time** srcs,
+								const Time* offsets, unsigned num_srcs,
+								Time post_add);
 
 	/*!
 	 * @brief Updates the timestamp of the destination register based on a
@@ -235,6 +349,32 @@ private:
 							Addr src_addr=NULL,
 							UInt32 mem_access_size=0);
 
+	/*!
+	 * @brief Same as timestampUpdater, but with the data dependences given
+	 * as arrays so that any number of them (up to MAX_SPECIALIZED_SRCS) can
+	 * be handled with a single pass over the levels.
+	 *
+	 * Because num_data_deps is a template parameter, the loop over the
+	 * sources has a constant trip count and is fully unrolled.
+	 *
+	 * @param src_regs Array of num_data_deps shadow registers used as
+	 * dependences.
+	 * @param src_offsets Array of num_data_deps offsets for src_regs, or NULL
+	 * if all offsets are 0.
+	 *
+	 * @pre num_data_deps is no more than MAX_SPECIALIZED_SRCS.
+	 * @pre All other preconditions are the same as timestampUpdater.
+	 */
+	template <bool use_ctrl_dependence, 
+				bool update_cp, 
+				unsigned num_data_deps, 
+				bool use_shadow_mem_dependence>
+	void timestampUpdaterN(UInt32 dest_reg, 
+							const UInt32* src_regs,
+							const UInt32* src_offsets,
+							Addr src_addr=NULL,
+							UInt32 mem_access_size=0);
+
 	/*
 	 * @brief Handles timestamp update when we have an unspecified number of
 	 * data dependencies.
@@ -288,6 +428,19 @@ private:
 	template <bool store_const>
 	void timestampUpdaterStore(Addr dest_addr, UInt32 mem_access_size, Reg src_reg);
 
+	/*!
+	 * Copies the timestamps of size bytes at src to dest, e.g. because
+	 * realloc moved them. Words that were never written are skipped.
+	 */
+	void copyShadowMemory(Addr dest, Addr src, UInt64 size);
+
+	/*!
+	 * Sets the timestamps of every word in size bytes at dest_addr as a
+	 * store of src_reg (or of a constant) to each word would.
+	 */
+	template <bool store_const>
+	void timestampUpdaterMemSet(Addr dest_addr, UInt64 size, Reg src_reg);
+
 	/*!
 	 * Pushes new function region  onto function call stack.
 	 *
@@ -302,6 +455,56 @@ private:
 	 */
 	void callstackPop();
 
+	/*!
+	 * Frees the FunctionRegions kept for reuse, along with any still on the
+	 * callstack.
+	 */
+	void deinitFunctionRegions();
+
+	bool isSkippingRegion() { return !skipped_regions.empty(); }
+
+	/*!
+	 * Decides whether to profile a region that is being entered.
+	 *
+	 * With --kremlin-sample=ON:OFF, regions are profiled in bursts: those
+	 * entered in the first ON units of the sample clock are profiled, those
+	 * entered in the next OFF units are skipped, and so on. The clock counts
+	 * either region entries or virtual time (including the work of skipped
+	 * regions). With --kremlin-sample-first=N, only the first N instances of
+	 * each region (in each context of the region tree) are profiled.
+	 *
+	 * @param region_id The static ID of the region being entered.
+	 * @param callsite_id The callsite ID of the region being entered.
+	 * @return True if the region should be profiled.
+	 */
+	bool shouldSampleRegion(SID region_id, CID callsite_id);
+
+	/*!
+	 * Starts running a region that wasn't sampled without profiling it.
+	 * Profiling is disabled until the region exits.
+	 *
+	 * @pre No region is being skipped.
+	 */
+	void beginSkippedRegion(SID region_id, CID callsite_id, RegionType type);
+
+	/*!
+	 * Finishes skipping a region: records it in the region tree, rewinds
+	 * the virtual time to when the region was entered (so it doesn't count
+	 * toward the work of the regions around it) and reenables profiling.
+	 *
+	 * @pre skipped_regions is empty but beginSkippedRegion has been called.
+	 */
+	void endSkippedRegion();
+
+	/*!
+	 * Sets the register that holds the return value in caller to the
+	 * current control dependence at each level, as for a function that
+	 * returns a constant.
+	 *
+	 * @pre caller has a register table and a return register.
+	 */
+	void setReturnToControlDependence(FunctionRegion* caller);
+
 	Table* getRegisterFileTable() { return shadow_reg_file; }
 
 	void setRegisterFileTable(Table* table) { 
@@ -314,10 +517,12 @@ public:
 	KremlinProfiler(Level min, Level max) :
 		enabled(false),
 		initialized(false),
+		worker_thread(false),
 		curr_time(0),
 		curr_level(-1),
 		min_level(min),
 		max_level(max),
+		pending_max_level(max),
 		max_active_level(0),
 		curr_num_instrumented_levels(0),
 		instrument_curr_level(false),
@@ -327,8 +532,21 @@ public:
 		control_dependence_table(NULL),
 		cdt_read_ptr(0),
 		cdt_current_base(NULL),
+		doall_threshold(5),
+		sampling(false),
+		in_sample_burst(true),
+		sample_phase_end(0),
+		num_regions_entered(0),
+		skipped_time(0),
+		skip_start_time(0),
+		skip_region_id(0),
+		skip_callsite_id(0),
+		skip_region_type(RegionFunc),
+		shadow_reg_file(NULL),
 		shadow_mem(NULL),
-		doall_threshold(5) {}
+		shadow_mem_type(ShadowMemoryDummy),
+		num_stack_reclaims(0),
+		stack_bytes_reclaimed(0) {}
 
 	~KremlinProfiler() {}
 
@@ -336,6 +554,19 @@ public:
 	void deinit();
 	void cleanup();
 
+	/*!
+	 * Marks this profiler as profiling a worker thread. On deinit, a worker's
+	 * region tree is handed off to be merged into the main thread's profile
+	 * rather than being written out.
+	 *
+	 * @pre init has not been called yet.
+	 */
+	void markAsWorkerThread() { 
+		assert(!initialized);
+		worker_thread = true; 
+	}
+	bool isWorkerThread() { return worker_thread; }
+
 	/*!
 	 * @brief Gets the timestamp in the specified register at the given index
 	 * (i.e. depth).
@@ -399,8 +630,43 @@ public:
 	}
 	void decrementLevel() { 
 		--curr_level;
+		if (pending_max_level < max_level) applyPendingMaxLevel();
+		updateCurrLevelInstrumentableStatus();
+		updateCurrNumInstrumentedLevels();
+	}
+
+	/*! \brief Lowers max_level to pending_max_level unless a region deeper
+	 * than that is active, in which case it's retried on region exit.
+	 *
+	 * Regions that are active when the level changes must stay instrumented
+	 * until they exit, or their timestamps would be half-tracked.
+	 */
+	void applyPendingMaxLevel() {
+		if (curr_level > pending_max_level) return;
+
+		max_level = pending_max_level;
+		// Keep regions at dropped levels out of the profile too.
+		if (kremlin_config.getMaxProfiledLevel() > max_level)
+			kremlin_config.setMaxProfiledLevel(max_level);
+	}
+
+	/*! \brief Stops instrumenting the deepest level instrumented so far.
+	 *
+	 * Used to save shadow memory. Timestamps are no longer kept for that
+	 * level nor for deeper ones, and none of them are written to the
+	 * profile.
+	 *
+	 * @return False if only the minimum level would be left to profile.
+	 */
+	bool dropDeepestLevel() {
+		Level deepest = MIN(pending_max_level, max_active_level);
+		if (deepest <= min_level + 1) return false;
+
+		pending_max_level = deepest - 1;
+		applyPendingMaxLevel();
 		updateCurrLevelInstrumentableStatus();
 		updateCurrNumInstrumentedLevels();
+		return true;
 	}
 
 	/*! \brief Update number of levels being instrumented based on our current
@@ -458,9 +724,9 @@ public:
 	void initShadowMemory();
 	void deinitShadowMemory();
 
-	void handleRegionEntry(SID regionId, RegionType regionType);
-	void handleRegionExit(SID regionId, RegionType regionType);
-	void handleFunctionExit();
+	void handleRegionEntry(SID regionId, RegionType regionType, Addr sp);
+	void handleRegionExit(SID regionId, RegionType regionType, Addr stack_ptr);
+	void handleFunctionExit(Addr sp);
 	void handleLandingPad(SID regionId, RegionType regionType);
 	void handleAssignConst(UInt dest_reg);
 	void handleInduction(UInt dest_reg);
@@ -474,24 +740,59 @@ public:
 	void handleTimestamp5(UInt32 dest_reg, UInt32 src1_reg, UInt32 src1_offset, UInt32
 				src2_reg, UInt32 src2_offset, UInt32 src3_reg, UInt32 src3_offset, UInt32
 				src4_reg, UInt32 src4_offset, UInt32 src5_reg, UInt32 src5_offset);
-	void handleTimestamp6(UInt32 dest_reg, UInt32 src1_reg, UInt32 src1_offset, UInt32
-				src2_reg, UInt32 src2_offset, UInt32 src3_reg, UInt32 src3_offset, UInt32
-				src4_reg, UInt32 src4_offset, UInt32 src5_reg, UInt32 src5_offset, UInt32
-				src6_reg, UInt32 src6_offset);
-	void handleTimestamp7(UInt32 dest_reg, UInt32 src1_reg, UInt32 src1_offset, UInt32
-				src2_reg, UInt32 src2_offset, UInt32 src3_reg, UInt32 src3_offset, UInt32
-				src4_reg, UInt32 src4_offset, UInt32 src5_reg, UInt32 src5_offset, UInt32
-				src6_reg, UInt32 src6_offset, UInt32 src7_reg, UInt32 src7_offset);
+
+	/*!
+	 * Handles a timestamp update with exactly num_srcs register sources.
+	 * Used for every arity above 5 that is no more than MAX_SPECIALIZED_SRCS;
+	 * the vararg handleTimestamp is only used past that.
+	 */
+	template <unsigned num_srcs>
+	void handleTimestampN(UInt32 dest_reg, const UInt32* src_regs, const UInt32* src_offsets);
 	void handleLoad(Addr src_addr, Reg dest_reg, UInt32 mem_access_size, UInt32 num_srcs, va_list args);
 	void handleLoad0(Addr src_addr, Reg dest_reg, UInt32 mem_access_size);
 	void handleLoad1(Addr src_addr, Reg dest_reg, Reg src_reg, UInt32 mem_access_size);
+
+	/*!
+	 * Handles a load whose address depends on exactly num_srcs registers.
+	 */
+	template <unsigned num_srcs>
+	void handleLoadN(Addr src_addr, Reg dest_reg, const Reg* src_regs, UInt32 mem_access_size);
+
 	void handleStore(Reg src_reg, Addr dest_addr, UInt32 mem_access_size);
 	void handleStoreConst(Addr dest_addr, UInt32 mem_access_size);
+
+	/*!
+	 * Heap allocations are tracked for the whole process since a block can
+	 * be freed by another thread than the one that allocated it. Freeing a
+	 * block clears its shadow memory and realloc moves the timestamps along
+	 * with the data.
+	 */
+	void handleMalloc(Addr addr, size_t size, UInt dest);
+	void handleFree(Addr addr);
+	void handleRealloc(Addr old_addr, Addr new_addr, size_t size, UInt dest);
+
+	/*!
+	 * memcpy/memmove and memset are handled as a load and store (or just a
+	 * store) of every word they touch, done as range operations on shadow
+	 * memory rather than one word at a time. Their work is counted here
+	 * since the instrumented call itself has none.
+	 */
+	void handleMemCopy(Addr dest_addr, Addr src_addr, UInt64 size);
+	void handleMemSet(Reg src_reg, Addr dest_addr, UInt64 size);
+	void handleMemSetConst(Addr dest_addr, UInt64 size);
 	void handlePhi(Reg dest_reg, Reg src_reg, UInt32 num_ctrls, va_list args);
 	void handlePhi1To1(Reg dest_reg, Reg src_reg, Reg ctrl_reg);
 	void handlePhi2To1(Reg dest_reg, Reg src_reg, Reg ctrl1_reg, Reg ctrl2_reg);
 	void handlePhi3To1(Reg dest_reg, Reg src_reg, Reg ctrl1_reg, Reg ctrl2_reg, Reg ctrl3_reg);
 	void handlePhi4To1(Reg dest_reg, Reg src_reg, Reg ctrl1_reg, Reg ctrl2_reg, Reg ctrl3_reg, Reg ctrl4_reg);
+
+	/*!
+	 * Handles a phi with exactly num_ctrls control registers. Like the other
+	 * phi handlers, this ignores the current control dependence.
+	 */
+	template <unsigned num_ctrls>
+	void handlePhiNTo1(Reg dest_reg, Reg src_reg, const Reg* ctrl_regs);
+
 	void handlePhiCond4To1(Reg dest_reg, Reg ctrl1_reg, Reg ctrl2_reg, Reg ctrl3_reg, Reg ctrl4_reg);
 	void handlePhiAddCond(Reg dest_reg, Reg src_reg);
 
@@ -504,10 +805,27 @@ public:
 	void handleDequeueArgument(Reg dest);
 	void handlePrepRTable(UInt num_virt_regs, UInt nested_depth);
 	void handleLinkReturn(Reg dest);
+
+	/*!
+	 * Handles a call to a library function that isn't instrumented. The
+	 * result (if any) is ready cost after the latest of the source
+	 * registers, the memory the function reads and the current control
+	 * dependence, and cost is counted as work. The memory the function
+	 * writes gets the result's timestamps.
+	 *
+	 * @param dest_reg The register getting the result, or KREM_NO_DEST_REG
+	 * if the call doesn't return a value.
+	 * @param num_srcs The number of source registers in args.
+	 * @param num_reads The number of (Addr, UInt64 size) ranges read, given
+	 * in args after the source registers.
+	 * @param num_writes The number of ranges written, given after those.
+	 */
+	void handleCallLib(UInt64 cost, Reg dest_reg, UInt32 num_srcs, 
+						UInt32 num_reads, UInt32 num_writes, va_list args);
 	void handleReturn(Reg src);
 	void handleReturnConst();
 
-	void checkTimestamp(int index, ProgramRegion* region, Timestamp value);
+	void checkTimestamp(int index, ProgramRegion& region, Timestamp value);
 
 };
 
@@ -1,4 +1,5 @@
 #include <cassert>
+#include <cstdlib> // for free
 #include "debug.h"
 #include "ktypes.h"
 #include "MShadowStat.h" // for mshadow event counters
@@ -13,35 +14,30 @@ void LevelTable::operator delete(void* ptr) {
 	MemPoolFreeSmall(ptr, sizeof(LevelTable));
 }
 
-LevelTable::LevelTable() : code(0xDEADBEEF) {
+LevelTable::LevelTable() : compressed(false), gc_dirty(false), 
+							gc_survivor(false), cbuffer_referenced(false), 
+							cbuffer_slot(0), spilled(false), spill_seq(0),
+							spill_offset(0), code(0xDEADBEEF) {
 	memset(this->versions, 0, LevelTable::MAX_LEVEL * sizeof(Version));
 	memset(this->time_tables, 0, LevelTable::MAX_LEVEL * sizeof(TimeTable*));
 }
 
 LevelTable::~LevelTable() {
 	for (unsigned i = 0; i < LevelTable::MAX_LEVEL; ++i) {
-		TimeTable *t = time_tables[i];
-		if (t != NULL) {
-			delete t;
-			t = NULL;
-		}
+		if (time_tables[i] != NULL)
+			deleteTimeTable(i);
 	}
 }
 
-Time LevelTable::getTimeForAddrAtLevel(Index level, Addr addr, Version curr_ver) {
-	assert(level < LevelTable::MAX_LEVEL);
-
-	TimeTable *table = this->getTimeTableAtLevel(level);
-	Version stored_ver = this->versions[level];
-
-	Time ret = 0;
-	if (table != NULL && stored_ver == curr_ver) {
-		ret = table->getTimeAtAddr(addr);
-		MSG(0, "\t\tlv %d: \tversion = [%d, %d] value = %d\n", 
-			level, stored_ver, curr_ver, ret);
-	} 
-
-	return ret;
+void LevelTable::deleteTimeTable(Index level) {
+	TimeTable *t = this->time_tables[level];
+	assert(t != NULL);
+	if (isCompressed()) {
+		free(t->array);
+		t->array = NULL;
+	}
+	delete t;
+	this->time_tables[level] = NULL;
 }
 
 void LevelTable::setTimeForAddrAtLevel(Index level, Addr addr, 
@@ -82,6 +78,37 @@ void LevelTable::setTimeForAddrAtLevel(Index level, Addr addr,
 	this->setVersionAtLevel(level, curr_ver);
 }
 
+void LevelTable::getTimesForRangeAtLevel(Index level, Addr start, 
+											unsigned num_words, 
+											Version curr_ver, Time *times) {
+	assert(level < LevelTable::MAX_LEVEL);
+
+	TimeTable *table = this->getTimeTableAtLevel(level);
+	if (table == NULL || this->versions[level] != curr_ver) {
+		memset(times, 0, sizeof(Time) * num_words);
+		return;
+	}
+	table->getTimesForRange(start, num_words, times);
+}
+
+TimeTable* LevelTable::getTimeTableForWrite(Index level, Version curr_ver) {
+	assert(level < LevelTable::MAX_LEVEL);
+	assert(!isCompressed());
+
+	TimeTable *table = this->getTimeTableAtLevel(level);
+	eventLevelWrite(level);
+
+	if (table == NULL) {
+		table = new TimeTable(TimeTable::TYPE_64BIT);
+		this->setTimeTableAtLevel(level, table); 
+		eventTimeTableNewAlloc(level, TimeTable::TYPE_64BIT);
+	} 
+	else if (this->versions[level] != curr_ver) {
+		table->clean();
+	}
+	this->setVersionAtLevel(level, curr_ver);
+	return table;
+}
 
 unsigned LevelTable::findLowestInvalidIndex(Version *curr_versions) {
 	assert(curr_versions != NULL);
@@ -97,22 +124,38 @@ unsigned LevelTable::findLowestInvalidIndex(Version *curr_versions) {
 	return lowest_valid;
 }
 
-void LevelTable::cleanTimeTablesFromLevel(Index start_level) {
+unsigned LevelTable::cleanTimeTablesFromLevel(Index start_level) {
+	unsigned num_cleaned = 0;
 	for(unsigned i = start_level; i < LevelTable::MAX_LEVEL; ++i) {
-		TimeTable *t = this->time_tables[i];
-		if (t != NULL) {
-			delete t;
-			t = NULL;
-			this->time_tables[i] = NULL;
+		if (this->time_tables[i] != NULL) {
+			deleteTimeTable(i);
+			++num_cleaned;
+		}
+	}
+	return num_cleaned;
+}
+
+void LevelTable::clearRange(Addr start, Addr end) {
+	assert(!isCompressed());
+	assert(((UInt64)start & 0x7) == 0);
+
+	for (unsigned i = 0; i < LevelTable::MAX_LEVEL; ++i) {
+		TimeTable *table = this->time_tables[i];
+		if (table == NULL)
+			continue;
+
+		for (UInt64 addr = (UInt64)start; addr < (UInt64)end; addr += 8) {
+			table->setTimeAtAddr((Addr)addr, 0, TimeTable::TYPE_64BIT);
 		}
 	}
 }
 
-void LevelTable::collectGarbageWithinBounds(Version *curr_versions, 
-											unsigned end_index) {
+unsigned LevelTable::collectGarbageWithinBounds(Version *curr_versions, 
+												unsigned end_index) {
 	assert(curr_versions != NULL);
 	assert(end_index < LevelTable::MAX_LEVEL);
 
+	unsigned num_collected = 0;
 	for (unsigned i = 0; i < end_index; ++i) {
 		TimeTable *table = this->time_tables[i];
 		if (table == NULL)
@@ -121,13 +164,20 @@ void LevelTable::collectGarbageWithinBounds(Version *curr_versions,
 		Version ver = this->versions[i];
 		if (ver < curr_versions[i]) {
 			// out of date
-			delete table;
-			table = NULL;
-			this->time_tables[i] = NULL;
+			deleteTimeTable(i);
+			++num_collected;
 		}
 	}
 
-	this->cleanTimeTablesFromLevel(end_index);
+	return num_collected + this->cleanTimeTablesFromLevel(end_index);
+}
+
+bool LevelTable::hasTimeTables() {
+	for (unsigned i = 0; i < LevelTable::MAX_LEVEL; ++i) {
+		if (this->time_tables[i] != NULL)
+			return true;
+	}
+	return false;
 }
 
 void LevelTable::collectGarbageUnbounded(Version *curr_versions) {
@@ -151,8 +201,8 @@ UInt64 LevelTable::compress() {
 	}
 
 	UInt64 compressionSavings = 0;
-	lzo_uint srcLen = sizeof(Time)*TimeTable::TIMETABLE_SIZE/2; // XXX assumes 8 bytes
-	lzo_uint compLen = 0;
+	UInt64 srcLen = sizeof(Time)*TimeTable::TIMETABLE_SIZE/2; // XXX assumes 8 bytes
+	UInt64 compLen = 0;
 
 	Time* diffBuffer = (Time*)MemPoolAlloc();
 	void* compressedData;
@@ -174,7 +224,7 @@ UInt64 LevelTable::compress() {
 
 		// step 2: compress diffs
 		makeDiff(diffBuffer);
-		compressedData = compressData((UInt8*)diffBuffer, srcLen, &compLen);
+		compressedData = compressData(diffBuffer, srcLen, &compLen);
 		compressionSavings += (srcLen - compLen);
 		tt2->size = compLen;
 
@@ -185,7 +235,7 @@ UInt64 LevelTable::compress() {
 	Time* level0Array = (Time*)MemPoolAlloc();
 	memcpy(level0Array, tt1->array, srcLen);
 	makeDiff(tt1->array);
-	compressedData = compressData((UInt8*)tt1->array, srcLen, &compLen);
+	compressedData = compressData(tt1->array, srcLen, &compLen);
 	MemPoolFree(tt1->array);
 	//Time* level0Array = tt1->array;
 	tt1->array = (Time*)compressedData;
@@ -209,8 +259,7 @@ UInt64 LevelTable::decompress() {
 
 	//fprintf(stderr,"[LevelTable] decompressing LevelTable (%p)\n",this);
 	UInt64 decompressionCost = 0;
-	lzo_uint srcLen = sizeof(Time)*TimeTable::TIMETABLE_SIZE/2;
-	lzo_uint uncompLen = srcLen;
+	UInt64 srcLen = sizeof(Time)*TimeTable::TIMETABLE_SIZE/2;
 
 	// for now, we'll always diff based on level 0
 	TimeTable* tt1 = this->time_tables[0];
@@ -221,7 +270,7 @@ UInt64 LevelTable::decompress() {
 	int compressedSize = tt1->size;
 
 	Time* decompedArray = (Time*)MemPoolAlloc();
-	decompressData((UInt8*)decompedArray, (UInt8*)tt1->array, compressedSize, &uncompLen);
+	decompressData(decompedArray, (UInt8*)tt1->array, compressedSize, srcLen);
 	restoreDiff((Time*)decompedArray);
 
 	tt1->array = decompedArray;
@@ -243,10 +292,8 @@ UInt64 LevelTable::decompress() {
 
 		// step 1: decompress time different table, 
 		// the src buffer will be freed in decompressData
-		uncompLen = srcLen;
-		decompressData((UInt8*)diffBuffer, (UInt8*)tt2->array, tt2->size, &uncompLen);
+		decompressData(diffBuffer, (UInt8*)tt2->array, tt2->size, srcLen);
 		restoreDiff((Time*)diffBuffer);
-		assert(srcLen == uncompLen);
 		decompressionCost += (srcLen - tt2->size);
 
 		// step 2: add diffs to base TimeTable
@@ -275,6 +322,54 @@ UInt64 LevelTable::decompress() {
 	return decompressionCost;
 }
 
+UInt64 LevelTable::getCompressedSize() {
+	assert(isCompressed());
+
+	UInt64 size = 0;
+	for (unsigned i = 0; i < LevelTable::MAX_LEVEL; ++i) {
+		if (this->time_tables[i] != NULL)
+			size += this->time_tables[i]->size;
+	}
+	return size;
+}
+
+void LevelTable::spill(UInt8 *dest, UInt64 offset) {
+	assert(dest != NULL);
+	assert(isCompressed());
+	assert(!isSpilled());
+
+	for (unsigned i = 0; i < LevelTable::MAX_LEVEL; ++i) {
+		TimeTable* t = this->time_tables[i];
+		if (t == NULL)
+			continue;
+
+		memcpy(dest, t->array, t->size);
+		dest += t->size;
+		free(t->array);
+		t->array = NULL;
+	}
+
+	this->spill_offset = offset;
+	this->spilled = true;
+}
+
+void LevelTable::unspill(UInt8 *src) {
+	assert(src != NULL);
+	assert(isSpilled());
+
+	for (unsigned i = 0; i < LevelTable::MAX_LEVEL; ++i) {
+		TimeTable* t = this->time_tables[i];
+		if (t == NULL)
+			continue;
+
+		t->array = (Time*)malloc(t->size);
+		memcpy(t->array, src, t->size);
+		src += t->size;
+	}
+
+	this->spilled = false;
+}
+
 void LevelTable::makeDiff(Time *array) {
 	assert(array != NULL);
 	unsigned size = TimeTable::TIMETABLE_SIZE / 2;
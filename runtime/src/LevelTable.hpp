@@ -12,6 +12,13 @@ private:
 	Version	versions[LevelTable::MAX_LEVEL];	//!< version for each level
 	TimeTable* time_tables[LevelTable::MAX_LEVEL];	//!< TimeTable for each level
 	bool compressed; //!< Indicates if this table has compressed TimeTables
+	bool gc_dirty; //!< Written since the garbage collector last saw it
+	bool gc_survivor; //!< Still had TimeTables when last collected
+	bool cbuffer_referenced; //!< CLOCK reference bit in the CBuffer
+	UInt32 cbuffer_slot; //!< Position in the CBuffer ring
+	bool spilled; //!< Compressed TimeTables are in the spill file
+	UInt32 spill_seq; //!< Changed each time the SpillTier takes this table
+	UInt64 spill_offset; //!< Where the spill file holds this table
 	UInt32 code; // TODO: this should be debug-only or just go away
 
 public:
@@ -25,6 +32,39 @@ public:
 
 	bool isCompressed() { return this->compressed; }
 
+	/*!
+	 * The garbage collector keeps a list of tables written since it last
+	 * collected them and a list of tables that still had TimeTables
+	 * afterwards. These flags record whether this table is on each list.
+	 */
+	bool isGCDirty() { return this->gc_dirty; }
+	void setGCDirty(bool dirty) { this->gc_dirty = dirty; }
+	bool isGCSurvivor() { return this->gc_survivor; }
+	void setGCSurvivor(bool survivor) { this->gc_survivor = survivor; }
+
+	/*!
+	 * While a table is uncompressed it sits in a slot of the compression
+	 * buffer's CLOCK ring; these hold its slot and reference bit.
+	 */
+	bool isCBufferReferenced() { return this->cbuffer_referenced; }
+	void setCBufferReferenced(bool ref) { this->cbuffer_referenced = ref; }
+	UInt32 getCBufferSlot() { return this->cbuffer_slot; }
+	void setCBufferSlot(UInt32 slot) { this->cbuffer_slot = slot; }
+
+	/*!
+	 * While a table is compressed the SpillTier may move its TimeTables'
+	 * arrays to a file; only the TimeTables themselves stay in memory.
+	 */
+	bool isSpilled() { return this->spilled; }
+	UInt32 getSpillSeq() { return this->spill_seq; }
+	void setSpillSeq(UInt32 seq) { this->spill_seq = seq; }
+	UInt64 getSpillOffset() { return this->spill_offset; }
+
+	/*!
+	 * @return True if any level has a TimeTable.
+	 */
+	bool hasTimeTables();
+
 	/*!
 	 * Returns version at specified level.
 	 *
@@ -75,6 +115,8 @@ public:
 		time_tables[level] = table;
 	}
 
+	static unsigned getMaxLevel() { return MAX_LEVEL; }
+
 	/*!
 	 * Returns timestamp associated with a given address and level. The
 	 * returned timestamp will be 0 either if there is no entry for the given
@@ -86,7 +128,12 @@ public:
 	 * @param curr_ver The current version value.
 	 * @pre level < MAX_LEVEL
 	 */
-	Time getTimeForAddrAtLevel(Index level, Addr addr, Version curr_ver);
+	Time getTimeForAddrAtLevel(Index level, Addr addr, Version curr_ver) {
+		assert(level < LevelTable::MAX_LEVEL);
+		TimeTable *table = time_tables[level];
+		if (table == NULL || versions[level] != curr_ver) return 0;
+		return table->getTimeAtAddr(addr);
+	}
 
 	/*!
 	 * Sets timestamp associated with a given address and level to a specified
@@ -103,6 +150,34 @@ public:
 								Version curr_ver, Time value, 
 								TimeTable::TableType type);
 
+	/*!
+	 * Copies the timestamps of consecutive words at a level into times. As
+	 * with getTimeForAddrAtLevel, they are all 0 if there is no TimeTable at
+	 * that level or it is out of date.
+	 *
+	 * @param level The level to read.
+	 * @param start The address of the first word, 8-byte aligned.
+	 * @param num_words The number of words, all within this table's 4KB.
+	 * @param curr_ver The current version value.
+	 * @param[out] times Where to put the num_words timestamps.
+	 * @pre level < MAX_LEVEL
+	 */
+	void getTimesForRangeAtLevel(Index level, Addr start, unsigned num_words,
+									Version curr_ver, Time *times);
+
+	/*!
+	 * Gets the TimeTable at a level ready to be written with the current
+	 * version: one is created if there is none and an out of date one is
+	 * zeroed first.
+	 *
+	 * @param level The level that will be written.
+	 * @param curr_ver The current version value.
+	 * @return The TimeTable at level, never NULL.
+	 * @pre level < MAX_LEVEL
+	 * @pre This LevelTable is not compressed.
+	 */
+	TimeTable* getTimeTableForWrite(Index level, Version curr_ver);
+
 	/*!
 	 * @brief Returns the shallowest depth at which the level table is invalid.
 	 *
@@ -121,8 +196,19 @@ public:
 	 * @brief Removed all TimeTables from the given depth down to MAX_LEVEL.
 	 *
 	 * @param start_level The level to start the cleaning.
+	 * @return The number of TimeTables removed.
+	 */
+	unsigned cleanTimeTablesFromLevel(Index start_level);
+
+	/*!
+	 * @brief Zeroes the timestamps of [start, end) at every level.
+	 *
+	 * @param start First address to clear, 8-byte aligned.
+	 * @param end Address past the last one to clear.
+	 * @pre This LevelTable is not compressed.
+	 * @pre start and end are within the 4KB this table covers.
 	 */
-	void cleanTimeTablesFromLevel(Index start_level);
+	void clearRange(Addr start, Addr end);
 
 	/*!
 	 * @brief Performs garbage collection on the TimeTables in this level table
@@ -135,10 +221,12 @@ public:
 	 *
 	 * @param curr_versions The array of current versions.
 	 * @param end_index The maximum level to garbage collect for.
+	 * @return The number of TimeTables deleted.
 	 * @pre curr_versions is non-NULL.
 	 * @pre end_index < MAX_LEVEL
 	 */
-	void collectGarbageWithinBounds(Version *curr_versions, unsigned end_index);
+	unsigned collectGarbageWithinBounds(Version *curr_versions, 
+										unsigned end_index);
 
 	/*!
 	 * @brief Removes all "garbage" TimeTables in this LevelTable.
@@ -171,10 +259,55 @@ public:
 	 */
 	UInt64 decompress();
 
+	/*! @brief Get the number of bytes in the compressed TimeTables.
+	 *
+	 * @pre This LevelTable is compressed.
+	 */
+	UInt64 getCompressedSize();
+
+	/*! @brief Moves the compressed TimeTables' arrays to dest, one after
+	 * the other, and frees them.
+	 *
+	 * @param dest Where to copy the arrays; getCompressedSize() bytes.
+	 * @param offset Where dest is in the spill file, for the SpillTier.
+	 * @pre This LevelTable is compressed and not spilled.
+	 * @post spilled is true.
+	 */
+	void spill(UInt8 *dest, UInt64 offset);
+
+	/*! @brief Reads back the arrays moved to src by spill().
+	 *
+	 * @param src The copy made by spill().
+	 * @pre This LevelTable is spilled.
+	 * @post spilled is false.
+	 */
+	void unspill(UInt8 *src);
+
+	/*! @brief Forgets the arrays moved out by spill() without reading them
+	 * back, for when the TimeTables are about to be deleted anyway.
+	 *
+	 * @pre This LevelTable is spilled.
+	 * @post spilled is false and every TimeTable's array is NULL.
+	 */
+	void discardSpilled() {
+		assert(isSpilled());
+		this->spilled = false;
+	}
+
 	static void* operator new(size_t size);
 	static void operator delete(void* ptr);
 
 private:
+	/*! @brief Deletes the TimeTable at a level.
+	 *
+	 * Arrays of a compressed table come from the codec rather than the
+	 * memory pool, so they are freed here before the TimeTable is deleted.
+	 *
+	 * @param level The level of the TimeTable to delete.
+	 * @pre There is a TimeTable at level.
+	 */
+	void deleteTimeTable(Index level);
+
 	/*! @brief Modify array so elements are difference between that element 
 	 * and the previous element.
 	 *
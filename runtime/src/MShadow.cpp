@@ -0,0 +1,59 @@
+#include <cassert>
+#include <vector>
+
+#include "MShadow.h"
+
+void MShadow::setRange(Addr addr, UInt64 size, Index depth, 
+						Version* versions, Time* times) {
+	setRangeByWord(addr, size, depth, versions, times);
+}
+
+void MShadow::copyRange(Addr dest, Addr src, UInt64 size, Index depth, 
+						Version* versions, const Time* min_times, 
+						Time cost, Time* max_times) {
+	copyRangeByWord(dest, src, size, depth, versions, min_times, cost, 
+					max_times);
+}
+
+void MShadow::setRangeByWord(Addr addr, UInt64 size, Index depth, 
+								Version* versions, Time* times) {
+	if (size == 0 || depth == 0) return;
+
+	UInt64 start = (UInt64)addr & ~(UInt64)0x7;
+	UInt64 end = (UInt64)addr + size;
+	for (UInt64 word = start; word < end; word += 8) {
+		set((Addr)word, depth, versions, times, 8);
+	}
+}
+
+void MShadow::copyRangeByWord(Addr dest, Addr src, UInt64 size, Index depth, 
+								Version* versions, const Time* min_times, 
+								Time cost, Time* max_times) {
+	for (Index i = 0; i < depth; ++i) {
+		max_times[i] = 0;
+	}
+	if (size == 0 || depth == 0) return;
+
+	UInt64 dest_start = (UInt64)dest & ~(UInt64)0x7;
+	UInt64 num_words = ((UInt64)dest + size - dest_start + 7) >> 3;
+
+	// Like memmove, go backwards if going forwards would overwrite words of
+	// src before they are read.
+	bool backwards = (UInt64)dest > (UInt64)src 
+						&& (UInt64)dest < (UInt64)src + size;
+
+	std::vector<Time> times(depth);
+	for (UInt64 n = 0; n < num_words; ++n) {
+		UInt64 k = backwards ? num_words - 1 - n : n;
+		Addr src_word = (Addr)(((UInt64)src + (k << 3)) & ~(UInt64)0x7);
+		Addr dest_word = (Addr)(dest_start + (k << 3));
+
+		Time* src_times = get(src_word, depth, versions, 8);
+		for (Index i = 0; i < depth; ++i) {
+			Time t = src_times[i] > min_times[i] ? src_times[i] : min_times[i];
+			times[i] = t + cost;
+			if (times[i] > max_times[i]) max_times[i] = times[i];
+		}
+		set(dest_word, depth, versions, &times[0], 8);
+	}
+}
@@ -5,10 +5,56 @@
 
 class MShadow {
 public:
+	virtual ~MShadow() {}
+
 	virtual void init() = 0;
 	virtual void deinit() = 0;
 
 	virtual Time* get(Addr addr, Index size, Version* versions, UInt32 width) = 0;
 	virtual void set(Addr addr, Index size, Version* versions, Time* times, UInt32 width) = 0;
+
+	/*!
+	 * Forgets the timestamps of size bytes starting at addr, e.g. because
+	 * that memory was freed, releasing whatever shadow memory only they
+	 * were using. Shadow memories that can't do this ignore it.
+	 *
+	 * @param versions Current version of each level.
+	 */
+	virtual void clear(Addr addr, UInt64 size, Version* versions) {}
+
+	/*!
+	 * Gives every word of size bytes starting at addr the same timestamps,
+	 * as if each had been set() on its own.
+	 *
+	 * @param depth Number of levels in times.
+	 * @param versions Current version of each level.
+	 * @param times The timestamps to set, one per level.
+	 */
+	virtual void setRange(Addr addr, UInt64 size, Index depth, 
+							Version* versions, Time* times);
+
+	/*!
+	 * Sets the timestamps of every word of size bytes starting at dest to
+	 * those of the word at the same offset from src, raised to at least
+	 * min_times and then increased by cost, as if each word had been loaded
+	 * and stored on its own. The two ranges may overlap.
+	 *
+	 * @param depth Number of levels in min_times and max_times.
+	 * @param versions Current version of each level.
+	 * @param[out] max_times The largest timestamp set at each level.
+	 */
+	virtual void copyRange(Addr dest, Addr src, UInt64 size, Index depth, 
+							Version* versions, const Time* min_times, 
+							Time cost, Time* max_times);
+
+	/*!
+	 * The implementations of setRange and copyRange that go through get()
+	 * and set() one word at a time.
+	 */
+	void setRangeByWord(Addr addr, UInt64 size, Index depth, 
+						Version* versions, Time* times);
+	void copyRangeByWord(Addr dest, Addr src, UInt64 size, Index depth, 
+							Version* versions, const Time* min_times, 
+							Time cost, Time* max_times);
 };
 #endif
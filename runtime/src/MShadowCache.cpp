@@ -19,23 +19,52 @@
 //#define TVCacheDebug	0
 static const int SKADU_CACHE_DEBUG_LVL = 0;
 
+/*
+ * The cache doubles in size (up to the configured max) once the miss rate
+ * has been above RESIZE_MISS_PERCENT for RESIZE_PATIENCE consecutive windows
+ * of RESIZE_WINDOW accesses. Every resize flushes the whole cache so we
+ * want to be fairly sure it will pay off.
+ */
+static const UInt64 RESIZE_WINDOW = 1 << 18;
+static const UInt64 RESIZE_MISS_PERCENT = 10;
+static const unsigned RESIZE_PATIENCE = 4;
+
 void SkaduCache::init(int size_in_mb, bool compress, MShadowSkadu *mshadow) {
 	tag_vector_cache = new TagVectorCache();
 	if (size_in_mb == 0) {
 		MSG(0, "MShadowCache: Bypassing Cache\n"); 
 	} else {
-		tag_vector_cache->configure(size_in_mb, kremlin_config.getNumProfiledLevels());
+		tag_vector_cache->configure(size_in_mb, 
+			kremlin_config.getNumProfiledLevels(),
+			kremlin_config.getShadowMemCacheAssociativity());
 	}
 	this->use_compression = compress;
 	this->mem_shadow = mshadow;
+
+	max_size_in_mb = kremlin_config.getShadowMemCacheMaxSizeInMB();
+	if (max_size_in_mb < size_in_mb) max_size_in_mb = 0;
+
+	window_accesses = 0;
+	window_misses = 0;
+	num_high_miss_windows = 0;
+	num_accesses = 0;
+	num_misses = 0;
+	num_writebacks = 0;
+	num_invalidations = 0;
+	num_resizes = 0;
 }
 
 void SkaduCache::deinit() {
-	if (kremlin_config.getShadowMemCacheSizeInMB() > 0) {
-		// XXX: not sure of logic behind the next two lines (-sat)
-		MemPoolFreeSmall(tag_vector_cache->tagTable, sizeof(TagVectorCacheLine) * tag_vector_cache->getLineCount());
-		delete tag_vector_cache->valueTable;
+	if (tag_vector_cache->getAssociativity() > 1 || max_size_in_mb > 0) {
+		double hit_rate = (num_accesses == 0) ? 0.0 
+			: (num_accesses - num_misses) * 100.0 / num_accesses;
+		fprintf(stderr, "[kremlin] Shadow memory cache: %d MB %d-way, %.2f%% hits, %llu writebacks, %llu invalidations, %u resizes\n",
+			tag_vector_cache->getSize(), tag_vector_cache->getAssociativity(),
+			hit_rate, (unsigned long long)num_writebacks, 
+			(unsigned long long)num_invalidations, num_resizes);
 	}
+
+	tag_vector_cache->release();
 	delete tag_vector_cache;
 	tag_vector_cache = NULL;
 }
@@ -73,6 +102,9 @@ void SkaduCache::evict(int index, Version* vArray) {
 	if (addr == 0x0)
 		return;
 
+	eventLineWriteback();
+	num_writebacks++;
+
 	int lastSize = line->lastSize[0];
 	int lastVer = line->version[0];
 	int evictSize = getStartInvalidLevel(lastVer, vArray, lastSize);
@@ -97,21 +129,66 @@ void SkaduCache::flush(Version* vArray) {
 		
 }
 
-void SkaduCache::resize(int newSize, Version* vArray) {
+void SkaduCache::resize(int new_size_in_mb, int new_depth, Version* vArray) {
+	MSG(SKADU_CACHE_DEBUG_LVL, "TVCacheResize from %d MB, depth %d to %d MB, depth %d\n", 
+		tag_vector_cache->getSize(), tag_vector_cache->getDepth(),
+		new_size_in_mb, new_depth);
+
 	flush(vArray);
-	int size = tag_vector_cache->getSize();
-	int oldDepth = tag_vector_cache->getDepth();
-	int newDepth = oldDepth + 10;
+	int assoc = tag_vector_cache->getAssociativity();
+	tag_vector_cache->release();
+	tag_vector_cache->configure(new_size_in_mb, new_depth, assoc);
+
+	eventCacheResize();
+	num_resizes++;
+}
 
-	MSG(SKADU_CACHE_DEBUG_LVL, "TVCacheResize from %d to %d\n", oldDepth, newDepth);
-	MSG(SKADU_CACHE_DEBUG_LVL, "TVCacheResize from %d to %d\n", oldDepth, newDepth);
-	tag_vector_cache->configure(size, newDepth);
+void SkaduCache::invalidate(Addr start, Addr end) {
+	range_lines.clear();
+	tag_vector_cache->findLinesInRange(start, end, range_lines);
+	for (unsigned i = 0; i < range_lines.size(); ++i) {
+		tag_vector_cache->emptyLine(range_lines[i]);
+	}
+	num_invalidations += range_lines.size();
+}
+
+void SkaduCache::writeBack(Addr start, Addr end, Version* vArray) {
+	range_lines.clear();
+	tag_vector_cache->findLinesInRange(start, end, range_lines);
+	for (unsigned i = 0; i < range_lines.size(); ++i) {
+		evict(range_lines[i], vArray);
+		tag_vector_cache->emptyLine(range_lines[i]);
+	}
+}
+
+UInt64 SkaduCache::getNumLines() {
+	return tag_vector_cache->getLineCount();
 }
 
 void SkaduCache::checkResize(int size, Version* vArray) {
 	int oldDepth = tag_vector_cache->getDepth();
 	if (oldDepth < size) {
-		resize(oldDepth + 10, vArray);
+		int newDepth = oldDepth + 10;
+		if (newDepth < size) newDepth = size;
+		resize(tag_vector_cache->getSize(), newDepth, vArray);
+	}
+
+	if (window_accesses >= RESIZE_WINDOW) 
+		checkMissRate(vArray);
+}
+
+void SkaduCache::checkMissRate(Version* vArray) {
+	bool high_miss_rate = 
+		window_misses * 100 > window_accesses * RESIZE_MISS_PERCENT;
+	num_high_miss_windows = high_miss_rate ? num_high_miss_windows + 1 : 0;
+	window_accesses = 0;
+	window_misses = 0;
+
+	int new_size_in_mb = tag_vector_cache->getSize() * 2;
+	if (num_high_miss_windows >= RESIZE_PATIENCE 
+		&& new_size_in_mb <= max_size_in_mb) {
+		resize(new_size_in_mb, tag_vector_cache->getDepth(), vArray);
+		num_high_miss_windows = 0;
 	}
 }
 
@@ -137,7 +214,9 @@ Time* SkaduCache::get(Addr addr, Index size, Version* vArray, TimeTable::TableTy
 	tag_vector_cache->lookupRead(addr, type, &index, &entry, &offset, &destAddr);
 	check(addr, destAddr, entry->lastSize[offset], 0);
 
-	if (entry->isHit(addr)) {
+	bool hit = entry->isHit(addr);
+	recordAccess(hit);
+	if (hit) {
 		eventReadHit();
 		MSG(SKADU_CACHE_DEBUG_LVL, "\t cache hit at 0x%llx size = %d\n", destAddr, size);
 		entry->validateTag(destAddr, vArray, size);
@@ -188,7 +267,9 @@ void SkaduCache::set(Addr addr, Index size, Version* vArray, Time* tArray, TimeT
 #endif
 #endif
 
-	if (entry->isHit(addr)) {
+	bool hit = entry->isHit(addr);
+	recordAccess(hit);
+	if (hit) {
 		eventWriteHit();
 	} else {
 		eventWriteEvict();
@@ -1,6 +1,7 @@
 #ifndef MSHADOW_SKADUCACHE_H
 #define MSHADOW_SKADUCACHE_H
 
+#include <vector>
 #include "ktypes.h"
 #include "CacheInterface.hpp"
 
@@ -13,14 +14,40 @@ public:
 
 	void  set(Addr addr, Index size, Version* vArray, Time* tArray, TimeTable::TableType type);
 	Time* get(Addr addr, Index size, Version* vArray, TimeTable::TableType type);
+	void invalidate(Addr start, Addr end);
+	void writeBack(Addr start, Addr end, Version* vArray);
+	UInt64 getNumLines();
 
 private:
 	TagVectorCache *tag_vector_cache;
+	std::vector<int> range_lines; //!< Scratch space for lines in a range
+
+	int max_size_in_mb; //!< Size the cache may grow to (0 if it can't).
+
+	UInt64 window_accesses; //!< Accesses since the miss rate was checked.
+	UInt64 window_misses; //!< Misses since the miss rate was checked.
+	unsigned num_high_miss_windows; //!< Consecutive windows with high miss rate.
+
+	UInt64 num_accesses;
+	UInt64 num_misses;
+	UInt64 num_writebacks; //!< Evicted lines that held a valid tag vector.
+	UInt64 num_invalidations; //!< Lines dropped because their data was freed.
+	unsigned num_resizes;
 
 	void evict(int index, Version* vArray);
 	void flush(Version* vArray);
-	void resize(int newSize, Version* vArray);
+	void resize(int new_size_in_mb, int new_depth, Version* vArray);
 	void checkResize(int size, Version* vArray);
+	void checkMissRate(Version* vArray);
+
+	void recordAccess(bool hit) {
+		window_accesses++;
+		num_accesses++;
+		if (!hit) {
+			window_misses++;
+			num_misses++;
+		}
+	}
 };
 
 #endif
@@ -0,0 +1,237 @@
+#include <cassert>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "config.h"
+#include "debug.h"
+
+#include "MShadowFlat.h"
+#include "MShadowStat.h" // for event counters
+
+MShadowFlat::Chunk* MShadowFlat::allocChunk(UInt64 chunk_index) {
+	Chunk* chunk = new Chunk();
+	memset(chunk->times, 0, sizeof(chunk->times));
+	chunks[chunk_index] = chunk;
+	chunk_indices.push_back(chunk_index);
+	return chunk;
+}
+
+Time* MShadowFlat::allocTimes(Chunk* chunk, Index level) {
+	assert(level < MAX_LEVEL);
+	void* array = mmap(NULL, getArraySize(), PROT_READ | PROT_WRITE,
+						MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (array == MAP_FAILED) {
+		fprintf(stderr, "[kremlin] ERROR: couldn't reserve %llu MB for flat shadow memory\n",
+			(unsigned long long)(getArraySize() >> 20));
+		exit(1);
+	}
+	chunk->times[level] = (Time*)array;
+	++num_level_arrays;
+	eventLevelTableAlloc(PAGES_PER_CHUNK * sizeof(Version));
+	return (Time*)array;
+}
+
+void MShadowFlat::startPage(UInt64 chunk_index, Index level, Time* times,
+							UInt64 page, Version ver) {
+	Version* versions = getVersions(times);
+	if (versions[page] == 0) {
+		used_pages.push_back(packPage(chunk_index, level, page));
+		addShadowMemInUse(WORDS_PER_PAGE * sizeof(Time));
+	}
+	else {
+		memset(times + page * WORDS_PER_PAGE, 0, WORDS_PER_PAGE * sizeof(Time));
+	}
+	versions[page] = ver + 1;
+}
+
+Time* MShadowFlat::get(Addr addr, Index size, Version *curr_versions,
+						UInt32 width) {
+	assert(curr_versions != NULL);
+	assert(size <= MAX_LEVEL);
+
+	// TRICKY: returned to the caller so it must be per-thread
+	static __thread Time read_buffer[64];
+
+	if (size < 1) return NULL;
+
+	UInt64 tAddr = (UInt64)addr & ~(UInt64)0x7;
+	MSG(0, "mshadow get 0x%llx, size %u \n", tAddr, size);
+	eventRead();
+
+	// Reading memory that was never written mustn't reserve anything: its
+	// timestamps are all 0.
+	Chunk* chunk = chunks[getChunkIndex(tAddr)];
+	if (chunk == NULL) {
+		memset(read_buffer, 0, size * sizeof(Time));
+		return read_buffer;
+	}
+
+	UInt64 word = getWordIndex(tAddr);
+	UInt64 page = word / WORDS_PER_PAGE;
+	for (Index i = 0; i < size; ++i) {
+		Time* times = chunk->times[i];
+		if (times != NULL && getVersions(times)[page] == curr_versions[i] + 1)
+			read_buffer[i] = times[word];
+		else
+			read_buffer[i] = 0;
+	}
+	return read_buffer;
+}
+
+void MShadowFlat::set(Addr addr, Index size, Version *curr_versions,
+						Time *timestamps, UInt32 width) {
+	assert(curr_versions != NULL);
+	assert(timestamps != NULL);
+	assert(size <= MAX_LEVEL);
+
+	MSG(0, "mshadow set 0x%llx, size %u\n", addr, size);
+	if (size < 1) return;
+
+	if (used_pages.size() >= next_gc_pages) {
+		collectGarbage(curr_versions, size);
+		next_gc_pages = used_pages.size() + garbage_collection_period;
+		if (memory_limit > 0 && getShadowMemInUse() >= memory_limit)
+			next_gc_pages = used_pages.size() + 1;
+	}
+
+	UInt64 tAddr = (UInt64)addr & ~(UInt64)0x7;
+	eventWrite();
+
+	UInt64 chunk_index = getChunkIndex(tAddr);
+	UInt64 word = getWordIndex(tAddr);
+	UInt64 page = word / WORDS_PER_PAGE;
+	for (Index i = 0; i < size; ++i) {
+		Time* times = getTimes(chunk_index, i);
+		prepareWrite(chunk_index, i, times, page, curr_versions[i]);
+		times[word] = timestamps[i];
+	}
+}
+
+void MShadowFlat::clear(Addr addr, UInt64 size, Version *curr_versions) {
+	if (size == 0) return;
+
+	UInt64 start = (UInt64)addr & ~(UInt64)0x7;
+	UInt64 end = ((UInt64)addr + size + 7) & ~(UInt64)0x7;
+	UInt64 chunk_span = 1ULL << CHUNK_SHIFT;
+	UInt64 page_span = 1ULL << PAGE_SHIFT;
+	MSG(0, "mshadow clear 0x%llx - 0x%llx\n", start, end);
+
+	for (UInt64 base = start & ~(chunk_span - 1); base < end; base += chunk_span) {
+		Chunk* chunk = chunks[getChunkIndex(base)];
+		if (chunk == NULL) continue;
+
+		UInt64 lo = (start > base) ? start : base;
+		UInt64 hi = (end < base + chunk_span) ? end : base + chunk_span;
+
+		// The pages in [lo_page, hi_page) are covered entirely. The words
+		// before and after them only partly fill their page.
+		UInt64 lo_page = (lo + page_span - 1) & ~(page_span - 1);
+		UInt64 hi_page = hi & ~(page_span - 1);
+		if (lo_page > hi_page) lo_page = hi_page = hi;
+
+		for (Index i = 0; i < MAX_LEVEL; ++i) {
+			Time* times = chunk->times[i];
+			if (times == NULL) continue;
+			Version* versions = getVersions(times);
+
+			if (lo_page < hi_page) {
+				madvise(times + getWordIndex(lo_page),
+						hi_page - lo_page, MADV_DONTNEED);
+			}
+
+			UInt64 head_end = (lo_page < hi) ? lo_page : hi;
+			if (lo < head_end
+				&& versions[getWordIndex(lo) / WORDS_PER_PAGE] != 0) {
+				memset(times + getWordIndex(lo), 0, head_end - lo);
+			}
+			if (hi_page < hi
+				&& versions[getWordIndex(hi_page) / WORDS_PER_PAGE] != 0) {
+				memset(times + getWordIndex(hi_page), 0, hi - hi_page);
+			}
+		}
+	}
+}
+
+void MShadowFlat::collectGarbage(Version* curr_versions, Index size) {
+	eventGC();
+	UInt64 num_released = 0;
+	unsigned kept = 0;
+	for (unsigned i = 0; i < used_pages.size(); ++i) {
+		UInt64 packed = used_pages[i];
+		UInt64 chunk_index = packed >> 32;
+		Index level = (packed >> 24) & 0xFF;
+		UInt64 page = packed & 0xFFFFFF;
+
+		Time* times = chunks[chunk_index]->times[level];
+		Version* versions = getVersions(times);
+		if (level < size && versions[page] > curr_versions[level]) {
+			used_pages[kept++] = packed;
+			continue;
+		}
+
+		madvise(times + page * WORDS_PER_PAGE,
+				WORDS_PER_PAGE * sizeof(Time), MADV_DONTNEED);
+		versions[page] = 0;
+		++num_released;
+	}
+	used_pages.resize(kept);
+	num_released_pages += num_released;
+	addShadowMemInUse(-(Int64)(num_released * WORDS_PER_PAGE * sizeof(Time)));
+	MSG(3, "flat GC: released %llu pages, %u still in use\n",
+		(unsigned long long)num_released, kept);
+}
+
+UInt64 MShadowFlat::getMemoryUsage() {
+	return used_pages.size() * WORDS_PER_PAGE * sizeof(Time)
+			+ num_level_arrays * PAGES_PER_CHUNK * sizeof(Version);
+}
+
+void MShadowFlat::init() {
+	size_t table_size = NUM_CHUNKS * sizeof(Chunk*);
+	MSG(1, "MShadowFlat Init, reserving %llu MB for the chunk directory\n",
+		(unsigned long long)(table_size >> 20));
+
+	void* table = mmap(NULL, table_size, PROT_READ | PROT_WRITE,
+						MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (table == MAP_FAILED) {
+		fprintf(stderr, "[kremlin] ERROR: couldn't reserve %llu MB for flat shadow memory\n",
+			(unsigned long long)(table_size >> 20));
+		exit(1);
+	}
+	chunks = (Chunk**)table;
+
+	num_level_arrays = 0;
+	num_released_pages = 0;
+
+	// The GC period counts pages here, rather than TimeTables as in Skadu,
+	// but both cover 4KB of the program's memory at one level.
+	garbage_collection_period =
+		kremlin_config.getShadowMemGarbageCollectionPeriod();
+	next_gc_pages = garbage_collection_period;
+	if (garbage_collection_period == 0) next_gc_pages = 0xFFFFFFFFFFFFFFFF;
+
+	memory_limit = kremlin_config.getShadowMemLimitInMB() * 1024 * 1024;
+}
+
+void MShadowFlat::deinit() {
+	MShadowStatPrint();
+	MSG(1, "MShadowFlat: %llu level arrays, %llu pages released by GC\n",
+		(unsigned long long)num_level_arrays,
+		(unsigned long long)num_released_pages);
+
+	for (unsigned i = 0; i < chunk_indices.size(); ++i) {
+		Chunk* chunk = chunks[chunk_indices[i]];
+		for (unsigned j = 0; j < MAX_LEVEL; ++j) {
+			if (chunk->times[j] != NULL) munmap(chunk->times[j], getArraySize());
+		}
+		delete chunk;
+	}
+	addShadowMemInUse(-(Int64)getMemoryUsage());
+	chunk_indices.clear();
+	used_pages.clear();
+
+	munmap(chunks, NUM_CHUNKS * sizeof(Chunk*));
+	chunks = NULL;
+}
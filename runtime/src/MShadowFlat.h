@@ -0,0 +1,141 @@
+#ifndef _MSHADOW_FLAT_H
+#define _MSHADOW_FLAT_H
+
+#include <vector>
+#include "ktypes.h"
+#include "MShadow.h"
+
+/*!
+ * @brief Shadow memory that keeps the timestamps of each level in a flat
+ * array indexed directly by address.
+ *
+ * The user address space is split into 256MB chunks. The first time a
+ * level of a chunk is written, a MAP_NORESERVE array with one Time per
+ * word of the chunk is reserved for it, followed by one Version per 4KB
+ * page. The slot for an address is then a shift and an add from the start
+ * of that array, and the kernel only backs the pages actually touched.
+ * Address space is only reserved for the chunks and levels the program
+ * uses, so it grows with the working set rather than being fixed up front.
+ *
+ * A page's times are only valid if its Version matches the current version
+ * of the level; otherwise they read as 0 and are zeroed by the next write.
+ * Versions are stored plus one, so that 0 marks a page that isn't in use.
+ * Every page in use is on a list that the garbage collector walks,
+ * returning the memory of pages whose version is out of date to the
+ * kernel.
+ */
+class MShadowFlat : public MShadow {
+private:
+	static const unsigned ADDR_BITS = 47; //!< Size of user address space
+	static const unsigned CHUNK_SHIFT = 28; //!< Each chunk covers 256MB
+	static const unsigned PAGE_SHIFT = 12; //!< Versions are per 4KB page
+	static const unsigned MAX_LEVEL = 64;
+
+	static const UInt64 NUM_CHUNKS = 1ULL << (ADDR_BITS - CHUNK_SHIFT);
+	static const UInt64 WORDS_PER_CHUNK = 1ULL << (CHUNK_SHIFT - 3);
+	static const UInt64 PAGES_PER_CHUNK = 1ULL << (CHUNK_SHIFT - PAGE_SHIFT);
+	static const UInt64 WORDS_PER_PAGE = 1ULL << (PAGE_SHIFT - 3);
+
+	/*!
+	 * The arrays of one chunk, indexed by level. Each is WORDS_PER_CHUNK
+	 * times followed by PAGES_PER_CHUNK versions, or NULL if that level of
+	 * the chunk was never written.
+	 */
+	struct Chunk {
+		Time* times[MAX_LEVEL];
+	};
+
+	Chunk** chunks; //!< Reserved directory, indexed by chunk.
+	std::vector<UInt64> chunk_indices; //!< Chunks allocated, for deinit.
+
+	/*!
+	 * Pages that have a version, each packed as its chunk, level and page
+	 * within the chunk (see packPage).
+	 */
+	std::vector<UInt64> used_pages;
+
+	UInt64 num_level_arrays; //!< Arrays reserved across all chunks
+	UInt64 next_gc_pages; //!< Size of used_pages that starts a collection
+	unsigned garbage_collection_period;
+	UInt64 memory_limit; //!< In bytes, 0 if unlimited
+	UInt64 num_released_pages;
+
+	static UInt64 getChunkIndex(UInt64 addr) {
+		return (addr >> CHUNK_SHIFT) & (NUM_CHUNKS - 1);
+	}
+	static UInt64 getWordIndex(UInt64 addr) {
+		return (addr & ((1ULL << CHUNK_SHIFT) - 1)) >> 3;
+	}
+	static Version* getVersions(Time* times) {
+		return (Version*)(times + WORDS_PER_CHUNK);
+	}
+	static UInt64 getArraySize() {
+		return WORDS_PER_CHUNK * sizeof(Time)
+				+ PAGES_PER_CHUNK * sizeof(Version);
+	}
+
+	static UInt64 packPage(UInt64 chunk, Index level, UInt64 page) {
+		return (chunk << 32) | ((UInt64)level << 24) | page;
+	}
+
+	/*!
+	 * Returns the times of level in the chunk with the given index,
+	 * reserving the chunk and the array if they don't exist yet. Only
+	 * writes should call this.
+	 */
+	Time* getTimes(UInt64 chunk_index, Index level) {
+		Chunk* chunk = chunks[chunk_index];
+		if (chunk == NULL) chunk = allocChunk(chunk_index);
+		Time* times = chunk->times[level];
+		if (times == NULL) times = allocTimes(chunk, level);
+		return times;
+	}
+
+	Chunk* allocChunk(UInt64 chunk_index);
+	Time* allocTimes(Chunk* chunk, Index level);
+
+	/*!
+	 * Makes ver the version of a page, zeroing times left over from an
+	 * older one, so that it can be written.
+	 */
+	void prepareWrite(UInt64 chunk_index, Index level, Time* times,
+						UInt64 page, Version ver) {
+		Version* versions = getVersions(times);
+		if (versions[page] == ver + 1) return;
+		startPage(chunk_index, level, times, page, ver);
+	}
+
+	void startPage(UInt64 chunk_index, Index level, Time* times,
+					UInt64 page, Version ver);
+
+	/*!
+	 * Returns the memory of every page whose version is older than the
+	 * current version of its level (or whose level is at or past size) to
+	 * the kernel.
+	 */
+	void collectGarbage(Version* curr_versions, Index size);
+
+	/*!
+	 * @return Bytes of time and version arrays of this shadow memory that
+	 * may be backed. The memory limit is checked against what all threads
+	 * use together instead (see getShadowMemInUse).
+	 */
+	UInt64 getMemoryUsage();
+
+public:
+	MShadowFlat() : chunks(NULL) {}
+
+	void init();
+	void deinit();
+
+	Time* get(Addr addr, Index size, Version* versions, UInt32 width);
+	void set(Addr addr, Index size, Version* versions, Time* times, UInt32 width);
+
+	/*!
+	 * Returns the memory of every 4KB page the range covers entirely to the
+	 * kernel and zeroes the rest of it.
+	 */
+	void clear(Addr addr, UInt64 size, Version* versions);
+};
+
+#endif
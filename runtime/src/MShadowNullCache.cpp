@@ -3,7 +3,7 @@
 #include "MShadowNullCache.h"
 #include "compression.h"
 
-static Time tempArray[1000];
+static __thread Time tempArray[1000];
 
 Time* NullCache::get(Addr addr, Index size, Version* vArray, TimeTable::TableType type) {
 	LevelTable* lTable = mem_shadow->getLevelTable(addr, vArray);	
@@ -18,6 +18,9 @@ public:
 
 	void  set(Addr addr, Index size, Version* vArray, Time* tArray, TimeTable::TableType type);
 	Time* get(Addr addr, Index size, Version* vArray, TimeTable::TableType type);
+	void invalidate(Addr start, Addr end) {}
+	void writeBack(Addr start, Addr end, Version* vArray) {}
+	UInt64 getNumLines() { return 0; }
 };
 
 #endif
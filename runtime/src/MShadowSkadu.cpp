@@ -1,5 +1,6 @@
 #include <cassert>
 #include <string.h> // for memset
+#include <time.h> // for clock_gettime
 #include <vector>
 
 #include "config.h"
@@ -11,9 +12,11 @@
 #include "MShadowSkadu.h"
 #include "MShadowStat.h" // for event counters
 #include "compression.h" // for CBuffer
+#include "SpillTier.hpp"
 
 #include "MShadowCache.h"
 #include "MShadowNullCache.h"
+#include "KremlinProfiler.hpp" // for dropDeepestLevel
 
 /*!
  * @brief A sparse table that tracks 4GB memory chunks being used.
@@ -49,11 +52,14 @@ public:
 			SparseTableElement* e = &entry[i];
 			delete e->segTable;		
 			e->segTable = NULL;
-			eventSegTableFree();
+			eventSegTableFree(sizeof(MemorySegment));
 		}
 	}
 
-	SparseTableElement* getElement(Addr addr) {
+	/*!
+	 * @return The entry for addr, or NULL if there isn't one yet.
+	 */
+	SparseTableElement* findElement(Addr addr) {
 		UInt32 highAddr = (UInt32)((UInt64)addr >> 32);
 
 		// walk-through SparseTable
@@ -63,41 +69,246 @@ public:
 				return &entry[i];	
 			}
 		}
+		return NULL;
+	}
+
+	SparseTableElement* getElement(Addr addr) {
+		SparseTableElement* ret = findElement(addr);
+		if (ret != NULL) return ret;
 
 		// not found - create an entry
 		MSG(0, "SparseTable Creating a new Entry..\n");
 
-		SparseTableElement* ret = &entry[writePtr];
+		UInt32 highAddr = (UInt32)((UInt64)addr >> 32);
+		ret = &entry[writePtr];
 		ret->addrHigh = highAddr;
 		ret->segTable = new MemorySegment();
-		eventSegTableAlloc();
+		eventSegTableAlloc(sizeof(MemorySegment));
 		writePtr++;
 		return ret;
 	}
 	
 };
 
-void MShadowSkadu::initGarbageCollector(unsigned period) {
-	MSG(3, "set garbage collection period to %u\n", period);
+void MShadowSkadu::initGarbageCollector(unsigned period, unsigned step) {
+	MSG(3, "set garbage collection period to %u, step to %u\n", period, step);
 	next_gc_time = period;
 	garbage_collection_period = period;
 	if (period == 0) next_gc_time = 0xFFFFFFFFFFFFFFFF;
+	gc_step = step;
+	gc_pace = step;
+	gc_worklist_pos = 0;
+	gc_num_cycles = 0;
+}
+
+void MShadowSkadu::markDirty(LevelTable *l_table) {
+	if (garbage_collection_period == 0 || l_table->isGCDirty())
+		return;
+	l_table->setGCDirty(true);
+	gc_dirty_tables.push_back(l_table);
 }
 
-void MShadowSkadu::runGarbageCollector(Version* curr_versions, int size) {
+void MShadowSkadu::startGarbageCollection() {
 	eventGC();
-	for (unsigned i = 0; i < SparseTable::NUM_ENTRIES; ++i) {
-		MemorySegment* table = sparse_table->entry[i].segTable;	
-		if (table == NULL)
-			continue;
-		
+
+	// If the last cycle couldn't keep up, carry its remaining work over
+	// rather than finishing it in one long pause, and step faster.
+	if (garbageCollectionInProgress()) {
+		gc_dirty_tables.insert(gc_dirty_tables.end(), 
+								gc_worklist.begin() + gc_worklist_pos, 
+								gc_worklist.end());
+		if (gc_pace > 0 && gc_pace < (1U << 20))
+			gc_pace *= 2;
+	}
+	else if (gc_pace > gc_step)
+		gc_pace /= 2;
+
+	gc_worklist.clear();
+	gc_worklist.swap(gc_dirty_tables);
+	gc_worklist_pos = 0;
+
+	if (++gc_num_cycles % GC_MAJOR_PERIOD == 0) {
+		eventGCMajor();
+		// Survivors that are also dirty are on the worklist already.
+		for (unsigned i = 0; i < gc_survivor_tables.size(); ++i) {
+			LevelTable *l_table = gc_survivor_tables[i];
+			l_table->setGCSurvivor(false);
+			if (!l_table->isGCDirty())
+				gc_worklist.push_back(l_table);
+		}
+		gc_survivor_tables.clear();
+	}
+	MSG(3, "GC cycle %llu: %u level tables\n", 
+		gc_num_cycles, (unsigned)gc_worklist.size());
+}
+
+void MShadowSkadu::stepGarbageCollection(Version *curr_versions, int size, 
+											unsigned max_tables) {
+	struct timespec start, end;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	unsigned end_pos = gc_worklist.size();
+	if (max_tables > 0 && end_pos - gc_worklist_pos > max_tables)
+		end_pos = gc_worklist_pos + max_tables;
+
+	unsigned num_scanned = end_pos - gc_worklist_pos;
+	unsigned num_freed = 0;
+	for (; gc_worklist_pos < end_pos; ++gc_worklist_pos) {
+		LevelTable *l_table = gc_worklist[gc_worklist_pos];
+		l_table->setGCDirty(false);
+		// Compressed tables are collected when they are decompressed.
+		if (!l_table->isCompressed())
+			num_freed += l_table->collectGarbageWithinBounds(curr_versions, size);
+		if (!l_table->isGCSurvivor() && l_table->hasTimeTables()) {
+			l_table->setGCSurvivor(true);
+			gc_survivor_tables.push_back(l_table);
+		}
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	UInt64 ns = (end.tv_sec - start.tv_sec) * 1000000000ULL 
+				+ end.tv_nsec - start.tv_nsec;
+	eventGCPause(ns, num_scanned, num_freed);
+}
+
+void MShadowSkadu::collectSoon() {
+	next_gc_time = getActiveTimeTableSize();
+	// make the next cycle a major one
+	gc_num_cycles += GC_MAJOR_PERIOD - 1 - gc_num_cycles % GC_MAJOR_PERIOD;
+}
+
+UInt64 MShadowSkadu::getMemoryUsage() {
+	return getShadowMemInUse();
+}
+
+void MShadowSkadu::getAllLevelTables(std::vector<LevelTable*>& tables) {
+	for (int i = 0; i < sparse_table->writePtr; ++i) {
+		MemorySegment* segTable = sparse_table->entry[i].segTable;
+		if (segTable == NULL) continue; // being created by another thread
 		for (unsigned j = 0; j < MemorySegment::getNumLevelTables(); ++j) {
-			LevelTable* lTable = table->getLevelTableAtIndex(j);
-			if (lTable != NULL) {
-				lTable->collectGarbageWithinBounds(curr_versions, size);
+			LevelTable* lTable = segTable->getLevelTableAtIndex(j);
+			if (lTable != NULL) tables.push_back(lTable);
+		}
+	}
+}
+
+bool MShadowSkadu::takePressureAction(PressureAction action, UInt64 usage) {
+	const char* what = NULL;
+	char buf[64];
+	std::vector<LevelTable*> tables;
+
+	switch (action) {
+	case PRESSURE_ENABLE_COMPRESSION: {
+		if (compression_enabled) return false;
+
+		compression_enabled = true;
+		compression_buffer->enable();
+		cache->enableCompression();
+
+		getAllLevelTables(tables);
+		for (unsigned i = 0; i < tables.size(); ++i) {
+			eventCompression(compression_buffer->add(tables[i]));
+		}
+		what = "enabling compression";
+		break;
+	}
+
+	case PRESSURE_SHRINK_CBUFFER: {
+		unsigned num_entries = compression_buffer->getNumEntries();
+		if (!compression_enabled || num_entries <= MIN_CBUFFER_ENTRIES) 
+			return false;
+
+		num_entries /= 2;
+		if (num_entries < MIN_CBUFFER_ENTRIES) 
+			num_entries = MIN_CBUFFER_ENTRIES;
+		eventCompression(compression_buffer->resize(num_entries));
+		snprintf(buf, sizeof(buf), "shrinking compression buffer to %u", 
+					num_entries);
+		what = buf;
+		break;
+	}
+
+	case PRESSURE_SPILL_MORE: {
+		if (spill_tier == NULL || !compression_enabled
+			|| spill_tier->getResidentLimit() <= MIN_SPILL_THRESHOLD)
+			return false;
+
+		UInt64 threshold = spill_tier->getResidentLimit() / 2;
+		if (threshold < MIN_SPILL_THRESHOLD) 
+			threshold = MIN_SPILL_THRESHOLD;
+		spill_tier->setResidentLimit(threshold);
+		snprintf(buf, sizeof(buf), "spilling compressed tables past %.1f MB", 
+					threshold / 1048576.0);
+		what = buf;
+		break;
+	}
+
+	case PRESSURE_COLLECT_MORE: {
+		if (garbage_collection_period == 0) {
+			garbage_collection_period = 1024;
+			// nothing was marked dirty while GC was off
+			getAllLevelTables(tables);
+			for (unsigned i = 0; i < tables.size(); ++i) {
+				markDirty(tables[i]);
 			}
 		}
+		else if (garbage_collection_period > MIN_GC_PERIOD) {
+			garbage_collection_period /= 2;
+			if (garbage_collection_period < MIN_GC_PERIOD)
+				garbage_collection_period = MIN_GC_PERIOD;
+		}
+		else return false;
+
+		collectSoon();
+		snprintf(buf, sizeof(buf), "collecting garbage every %u tables", 
+					garbage_collection_period);
+		what = buf;
+		break;
+	}
+
+	case PRESSURE_DROP_LEVEL: {
+		if (!profiler->dropDeepestLevel()) return false;
+
+		collectSoon();
+		what = "dropping deepest level";
+		break;
+	}
+
+	default:
+		return false;
+	}
+
+	fprintf(stderr, "[kremlin] Shadow memory at %.2f of %.2f GB: %s\n",
+		usage / 1073741824.0, memory_limit / 1073741824.0, what);
+	return true;
+}
+
+void MShadowSkadu::relieveMemoryPressure() {
+	// Threads that share this shadow memory leave it to whichever one got
+	// here first.
+	if (__sync_lock_test_and_set(&relieving_pressure, 1)) return;
+
+	UInt64 usage = getMemoryUsage();
+	while (pressure_action != PRESSURE_EXHAUSTED) {
+		if (takePressureAction(pressure_action, usage)) break;
+		pressure_action = (PressureAction)(pressure_action + 1);
+		if (pressure_action == PRESSURE_EXHAUSTED) {
+			fprintf(stderr, "[kremlin] Shadow memory at %.2f of %.2f GB: nothing left to free\n",
+				usage / 1073741824.0, memory_limit / 1073741824.0);
+		}
 	}
+
+	if (pressure_action == PRESSURE_EXHAUSTED) {
+		next_pressure_check = 0xFFFFFFFFFFFFFFFF;
+	}
+	else {
+		// Give the action a chance to work before taking another one.
+		next_pressure_check = getMemoryUsage() + memory_limit / 16;
+		if (next_pressure_check < memory_limit / 4 * 3)
+			next_pressure_check = memory_limit / 4 * 3;
+	}
+
+	__sync_lock_release(&relieving_pressure);
 }
 
 LevelTable* MShadowSkadu::getLevelTable(Addr addr, Version *curr_versions) {
@@ -115,10 +326,11 @@ LevelTable* MShadowSkadu::getLevelTable(Addr addr, Version *curr_versions) {
 			eventCompression(compressGain);
 		}
 		segTable->setLevelTableAtIndex(lTable, segIndex);
-		eventLevelTableAlloc();
+		eventLevelTableAlloc(sizeof(LevelTable));
 	}
 	
 	if(useCompression() && lTable->isCompressed()) {
+		if (spill_tier != NULL) spill_tier->fetch(lTable);
 		lTable->collectGarbageUnbounded(curr_versions);
 		int gain = compression_buffer->decompress(lTable);
 		eventCompression(gain);
@@ -128,6 +340,46 @@ LevelTable* MShadowSkadu::getLevelTable(Addr addr, Version *curr_versions) {
 	return lTable;
 }
 
+LevelTable* MShadowSkadu::findLevelTable(Addr addr) {
+	SparseTableElement* sEntry = sparse_table->findElement(addr);
+	if (sEntry == NULL || sEntry->segTable == NULL) return NULL;
+	return sEntry->segTable->getLevelTableAtIndex(MemorySegment::GetIndex(addr));
+}
+
+void MShadowSkadu::clear(Addr addr, UInt64 size, Version *curr_versions) {
+	assert(curr_versions != NULL);
+	if (size == 0) return;
+
+	UInt64 start = (UInt64)addr & ~(UInt64)0x7;
+	UInt64 end = ((UInt64)addr + size + 7) & ~(UInt64)0x7;
+	MSG(0, "mshadow clear 0x%llx - 0x%llx\n", start, end);
+
+	cache->invalidate((Addr)start, (Addr)end);
+
+	UInt64 span = MemorySegment::getBytesPerLevelTable();
+	for (UInt64 base = start & ~(span - 1); base < end; base += span) {
+		LevelTable* lTable = findLevelTable((Addr)base);
+		if (lTable == NULL || !lTable->hasTimeTables()) continue;
+
+		UInt64 lo = (start > base) ? start : base;
+		UInt64 hi = (end < base + span) ? end : base + span;
+		if (lo == base && hi == base + span) {
+			// Nothing in the table is live any more. The LevelTable itself
+			// stays since the GC lists and compression buffer may point to
+			// it; the memory will likely be handed out again anyway.
+			if (lTable->isCompressed() && spill_tier != NULL)
+				spill_tier->remove(lTable);
+			num_cleared_time_tables += lTable->cleanTimeTablesFromLevel(0);
+		}
+		else {
+			if (lTable->isCompressed())
+				lTable = getLevelTable((Addr)base, curr_versions);
+			lTable->clearRange((Addr)lo, (Addr)hi);
+			num_partial_clears++;
+		}
+	}
+}
+
 static void check(Addr addr, Time* src, int size, int site) {
 #ifndef NDEBUG
 	int i;
@@ -180,6 +432,7 @@ void MShadowSkadu::evict(Time *new_timestamps, Addr addr, Index size, Version *c
 		MSG(0, "\t\toffset=%u, version=%llu, value=%llu\n", 
 			i, curr_versions[i], new_timestamps[i]);
 	}
+	markDirty(lTable);
 	eventCacheEvict(size, size);
 
 	if (useCompression())
@@ -205,6 +458,153 @@ void MShadowSkadu::fetch(Addr addr, Index size, Version *curr_versions,
 		compression_buffer->touch(lTable);
 }
 
+void MShadowSkadu::prepareWrite(Version *curr_versions, Index size) {
+	if (getActiveTimeTableSize() >= next_gc_time) {
+		startGarbageCollection();
+		//next_gc_time = stat.nTimeTableActive + garbage_collection_period;
+		next_gc_time += garbage_collection_period;
+	}
+
+	if (garbageCollectionInProgress())
+		stepGarbageCollection(curr_versions, size, gc_pace);
+
+	if (getMemoryUsage() >= next_pressure_check)
+		relieveMemoryPressure();
+}
+
+bool MShadowSkadu::bypassCacheForRange(UInt64 size) {
+	return (size >> 3) >= cache->getNumLines() / 2;
+}
+
+void MShadowSkadu::setRange(Addr addr, UInt64 size, Index depth, 
+							Version *curr_versions, Time *times) {
+	assert(curr_versions != NULL);
+	assert(times != NULL);
+	if (size == 0 || depth == 0) return;
+
+	if (!bypassCacheForRange(size)) {
+		setRangeByWord(addr, size, depth, curr_versions, times);
+		return;
+	}
+
+	UInt64 start = (UInt64)addr & ~(UInt64)0x7;
+	UInt64 end = ((UInt64)addr + size + 7) & ~(UInt64)0x7;
+	MSG(0, "mshadow setRange 0x%llx - 0x%llx, size %u\n", start, end, depth);
+
+	prepareWrite(curr_versions, depth);
+	cache->invalidate((Addr)start, (Addr)end);
+	check((Addr)start, times, depth, 4);
+
+	UInt64 span = MemorySegment::getBytesPerLevelTable();
+	UInt64 next;
+	for (UInt64 lo = start; lo < end; lo = next) {
+		next = (lo & ~(span - 1)) + span;
+		if (next > end) next = end;
+		unsigned num_words = (next - lo) >> 3;
+
+		LevelTable* lTable = this->getLevelTable((Addr)lo, curr_versions);
+		for (Index i = 0; i < depth; ++i) {
+			TimeTable* table = lTable->getTimeTableForWrite(i, 
+															curr_versions[i]);
+			table->fillTimeForRange((Addr)lo, num_words, times[i]);
+		}
+		markDirty(lTable);
+
+		if (useCompression())
+			compression_buffer->touch(lTable);
+	}
+}
+
+void MShadowSkadu::copyRange(Addr dest, Addr src, UInt64 size, Index depth, 
+								Version *curr_versions, const Time *min_times, 
+								Time cost, Time *max_times) {
+	assert(curr_versions != NULL);
+	assert(min_times != NULL);
+	assert(max_times != NULL);
+
+	bool overlap = (UInt64)dest < (UInt64)src + size 
+					&& (UInt64)src < (UInt64)dest + size;
+	if (overlap || (((UInt64)dest ^ (UInt64)src) & 0x7) != 0
+		|| !bypassCacheForRange(size)) {
+		copyRangeByWord(dest, src, size, depth, curr_versions, min_times, 
+						cost, max_times);
+		return;
+	}
+
+	for (Index i = 0; i < depth; ++i) {
+		max_times[i] = 0;
+	}
+	if (size == 0 || depth == 0) return;
+
+	UInt64 src_start = (UInt64)src & ~(UInt64)0x7;
+	UInt64 src_end = ((UInt64)src + size + 7) & ~(UInt64)0x7;
+	UInt64 dest_start = (UInt64)dest & ~(UInt64)0x7;
+	UInt64 dest_end = dest_start + (src_end - src_start);
+	MSG(0, "mshadow copyRange 0x%llx - 0x%llx to 0x%llx, size %u\n", 
+		src_start, src_end, dest_start, depth);
+
+	prepareWrite(curr_versions, depth);
+	// The source is read from the TimeTables, so they need whatever is
+	// newer in the cache; the destination's cached times become stale.
+	cache->writeBack((Addr)src_start, (Addr)src_end, curr_versions);
+	cache->invalidate((Addr)dest_start, (Addr)dest_end);
+
+	UInt64 span = MemorySegment::getBytesPerLevelTable();
+	UInt64 max_chunk_words = span >> 3;
+	if (range_times.size() < depth * max_chunk_words)
+		range_times.resize(depth * max_chunk_words);
+
+	UInt64 s = src_start;
+	UInt64 d = dest_start;
+	while (s < src_end) {
+		// stop at whichever page ends first
+		UInt64 num_words = (src_end - s) >> 3;
+		UInt64 src_left = ((s & ~(span - 1)) + span - s) >> 3;
+		UInt64 dest_left = ((d & ~(span - 1)) + span - d) >> 3;
+		if (src_left < num_words) num_words = src_left;
+		if (dest_left < num_words) num_words = dest_left;
+
+		// Read all of the source first: getting the destination's table
+		// may compress the source's.
+		LevelTable* src_table = findLevelTable((Addr)s);
+		if (src_table != NULL && src_table->isCompressed())
+			src_table = getLevelTable((Addr)s, curr_versions);
+
+		for (Index i = 0; i < depth; ++i) {
+			Time* row = &range_times[i * max_chunk_words];
+			if (src_table != NULL)
+				src_table->getTimesForRangeAtLevel(i, (Addr)s, num_words, 
+												curr_versions[i], row);
+			else
+				memset(row, 0, sizeof(Time) * num_words);
+
+			Time min_time = min_times[i];
+			Time max_time = max_times[i];
+			for (UInt64 w = 0; w < num_words; ++w) {
+				Time t = (row[w] > min_time ? row[w] : min_time) + cost;
+				row[w] = t;
+				max_time = (t > max_time) ? t : max_time;
+			}
+			max_times[i] = max_time;
+		}
+
+		LevelTable* dest_table = this->getLevelTable((Addr)d, curr_versions);
+		for (Index i = 0; i < depth; ++i) {
+			TimeTable* table = dest_table->getTimeTableForWrite(i, 
+														curr_versions[i]);
+			table->setTimesForRange((Addr)d, num_words, 
+									&range_times[i * max_chunk_words]);
+		}
+		markDirty(dest_table);
+
+		if (useCompression())
+			compression_buffer->touch(dest_table);
+
+		s += num_words << 3;
+		d += num_words << 3;
+	}
+}
+
 Time* MShadowSkadu::get(Addr addr, Index size, Version *curr_versions, 
 						UInt32 width) {
 	assert(curr_versions != NULL);
@@ -228,11 +628,7 @@ void MShadowSkadu::set(Addr addr, Index size, Version *curr_versions,
 	MSG(0, "mshadow set 0x%llx, size %u [", addr, size);
 	if (size < 1) return;
 
-	if (getActiveTimeTableSize() >= next_gc_time) {
-		runGarbageCollector(curr_versions, size);
-		//next_gc_time = stat.nTimeTableActive + garbage_collection_period;
-		next_gc_time += garbage_collection_period;
-	}
+	prepareWrite(curr_versions, size);
 
 	//TimeTable::TableType type = (width > 4) ? TimeTable::TYPE_64BIT: TimeTable::TYPE_32BIT;
 	TimeTable::TableType type = TimeTable::TYPE_64BIT;
@@ -254,12 +650,15 @@ void MShadowSkadu::init() {
 	else
 		cache = new NullCache();
 
-	cache->init(cacheSizeMB, kremlin_config.compressShadowMem(), this);
-
+	// the pool has to exist before the cache allocates its value Table from
+	// it, since resizing the cache frees that Table back into the pool
 	unsigned size = TimeTable::GetNumEntries(TimeTable::TYPE_64BIT);
-	MemPoolInit(1024, size * sizeof(Time));
+	MemPoolInit(1024, size * sizeof(Time), kremlin_config.useHugePages());
+
+	cache->init(cacheSizeMB, kremlin_config.compressShadowMem(), this);
 	
-	initGarbageCollector(kremlin_config.getShadowMemGarbageCollectionPeriod());
+	initGarbageCollector(kremlin_config.getShadowMemGarbageCollectionPeriod(),
+						kremlin_config.getShadowMemGarbageCollectionStep());
  
 	sparse_table = new SparseTable();
 	sparse_table->init();
@@ -267,6 +666,23 @@ void MShadowSkadu::init() {
 	compression_buffer = new CBuffer();
 	compression_buffer->init(kremlin_config.getNumCompressionBufferEntries());
 	compression_enabled = kremlin_config.compressShadowMem();
+
+	spill_tier = NULL;
+	if (kremlin_config.spillShadowMem()) {
+		spill_tier = new SpillTier();
+		spill_tier->init(kremlin_config.getSpillDir(), 
+					(UInt64)kremlin_config.getSpillThresholdInMB() << 20);
+		compression_buffer->setSpillTier(spill_tier);
+	}
+
+	memory_limit = kremlin_config.getShadowMemLimitInMB() * 1024 * 1024;
+	next_pressure_check = 0xFFFFFFFFFFFFFFFF;
+	if (memory_limit > 0) next_pressure_check = memory_limit / 4 * 3;
+	pressure_action = PRESSURE_ENABLE_COMPRESSION;
+	relieving_pressure = 0;
+
+	num_cleared_time_tables = 0;
+	num_partial_clears = 0;
 }
 
 
@@ -277,6 +693,25 @@ void MShadowSkadu::deinit() {
 	compression_buffer->deinit();
 	delete compression_buffer;
 	compression_buffer = NULL;
+	if (spill_tier != NULL) {
+		spill_tier->deinit();
+		delete spill_tier;
+		spill_tier = NULL;
+	}
 	MShadowStatPrint();
+	if (_stat.nGCStep > 0) {
+		fprintf(stderr, "[kremlin] Shadow memory GC: %llu cycles (%llu major), %llu pauses, avg %.2f us, max %.2f us\n",
+			(unsigned long long)_stat.nGC, (unsigned long long)_stat.nGCMajor, 
+			(unsigned long long)_stat.nGCStep, 
+			_stat.gcPauseTotal / 1e3 / _stat.nGCStep, _stat.gcPauseMax / 1e3);
+	}
+	if (num_cleared_time_tables > 0 || num_partial_clears > 0) {
+		fprintf(stderr, "[kremlin] Shadow memory of dead data: %llu TimeTables released, %llu partial pages zeroed\n",
+			(unsigned long long)num_cleared_time_tables, 
+			(unsigned long long)num_partial_clears);
+	}
+	gc_worklist.clear();
+	gc_dirty_tables.clear();
+	gc_survivor_tables.clear();
 	sparse_table->deinit();
 }
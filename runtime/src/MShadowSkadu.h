@@ -2,6 +2,7 @@
 #define _MSHADOW_SKADU_H
 
 #include <cassert>
+#include <vector>
 #include "ktypes.h"
 #include "MShadow.h" // for MShadow class 
 #include "TimeTable.hpp" // for TimeTable::TableType
@@ -11,6 +12,8 @@ class MemorySegment;
 class LevelTable;
 class CacheInterface;
 class CBuffer;
+class KremlinProfiler;
+class SpillTier;
 
 class MShadowSkadu : public MShadow {
 private:
@@ -19,19 +22,124 @@ private:
 	UInt64 next_gc_time;
 	unsigned garbage_collection_period;
 
-	void initGarbageCollector(unsigned period);
-	void runGarbageCollector(Version *curr_versions, int size);
+	/*
+	 * The collector is incremental: a cycle builds a worklist of LevelTables
+	 * and each set() after that collects gc_step of them until the worklist
+	 * is empty. Only LevelTables written since their last collection (dirty)
+	 * are on the worklist, except on every GC_MAJOR_PERIOD-th cycle which
+	 * also rescans those that still had TimeTables after being collected
+	 * (survivors). Every LevelTable holding TimeTables is on at least one of
+	 * the two lists, so a major cycle collects as much as a full walk of
+	 * the segments would. A cycle that hasn't finished when the next one
+	 * is due is folded into it.
+	 */
+	static const unsigned GC_MAJOR_PERIOD = 4;
+
+	unsigned gc_step; //!< LevelTables per step, 0 to run whole cycles
+	unsigned gc_pace; //!< Current step, raised while cycles fall behind
+	std::vector<LevelTable*> gc_dirty_tables;
+	std::vector<LevelTable*> gc_survivor_tables;
+	std::vector<LevelTable*> gc_worklist;
+	unsigned gc_worklist_pos; //!< Next worklist entry to collect
+	UInt64 gc_num_cycles;
+
+	void initGarbageCollector(unsigned period, unsigned step);
+	void startGarbageCollection();
+	void stepGarbageCollection(Version *curr_versions, int size, 
+								unsigned max_tables);
+	bool garbageCollectionInProgress() { 
+		return gc_worklist_pos < gc_worklist.size();
+	}
+
+	void markDirty(LevelTable *l_table);
+
+	/*
+	 * With a memory limit, shadow memory steps through these actions in
+	 * order each time its usage grows past the next threshold, moving on
+	 * to the next kind of action once one can't do any more.
+	 */
+	enum PressureAction {
+		PRESSURE_ENABLE_COMPRESSION,
+		PRESSURE_SHRINK_CBUFFER,
+		PRESSURE_SPILL_MORE,
+		PRESSURE_COLLECT_MORE,
+		PRESSURE_DROP_LEVEL,
+		PRESSURE_EXHAUSTED
+	};
+
+	static const unsigned MIN_CBUFFER_ENTRIES = 64;
+	static const unsigned MIN_GC_PERIOD = 64;
+	static const UInt64 MIN_SPILL_THRESHOLD = 1 << 20;
+
+	KremlinProfiler *profiler; //!< Profiler this shadow memory belongs to
+	UInt64 memory_limit; //!< In bytes, 0 if unlimited
+	UInt64 next_pressure_check; //!< Usage (in bytes) that triggers an action
+	PressureAction pressure_action; //!< Next kind of action to try
+	volatile int relieving_pressure; //!< Set while an action is under way
+
+	/*!
+	 * @return Bytes held by TimeTables, LevelTables and MemorySegments of
+	 * every thread (see getShadowMemInUse), not just this shadow memory.
+	 */
+	UInt64 getMemoryUsage();
+
+	/*!
+	 * Takes the next action that can still free something, then moves the
+	 * threshold for the next one up.
+	 */
+	void relieveMemoryPressure();
+
+	/*!
+	 * @param usage Memory usage that called for the action, for logging.
+	 * @return False if the action can't free any more memory.
+	 */
+	bool takePressureAction(PressureAction action, UInt64 usage);
+
+	void getAllLevelTables(std::vector<LevelTable*>& tables);
+
+	/*!
+	 * Starts a major GC cycle on the next set().
+	 */
+	void collectSoon();
+
+	UInt64 num_cleared_time_tables; //!< Released because their page died
+	UInt64 num_partial_clears; //!< Tables partly zeroed by clear()
+
+	/*!
+	 * @return The LevelTable for addr, or NULL if there isn't one yet.
+	 */
+	LevelTable* findLevelTable(Addr addr);
+
+	/*!
+	 * Runs the garbage collector and checks the memory limit, as is done
+	 * before every write.
+	 */
+	void prepareWrite(Version *curr_versions, Index size);
+
+	std::vector<Time> range_times; //!< Timestamps of a chunk of a range
+
+	/*!
+	 * Ranges that take up no more than half the cache are set and copied
+	 * through it a word at a time, the same as separate stores would be, so
+	 * that data just written (and likely about to be read) stays cached.
+	 * Writing larger ones straight to the TimeTables saves both the
+	 * per-word overhead and flushing the rest of the cache.
+	 */
+	bool bypassCacheForRange(UInt64 size);
 
 	CacheInterface *cache; //!< The cache associated with shadow mem
 
 	bool compression_enabled; //!< Indicates whether we should use compression
 	CBuffer *compression_buffer;
+	SpillTier *spill_tier; //!< Where cold compressed tables go, may be NULL
 
 	bool useCompression() {
 		return compression_enabled;
 	}
 
 public:
+	MShadowSkadu(KremlinProfiler *owner) : profiler(owner) {}
+
 	void init();
 	void deinit();
 
@@ -43,6 +151,34 @@ public:
 	void set(Addr addr, Index size, Version *curr_versions, 
 				Time *timestamps, UInt32 width);
 
+	/*!
+	 * Drops the cached timestamps of the range, releases the TimeTables of
+	 * every 4KB page it covers entirely and zeroes the rest of it.
+	 *
+	 * @pre curr_versions is non-NULL.
+	 */
+	void clear(Addr addr, UInt64 size, Version *curr_versions);
+
+	/*!
+	 * Writes a large range straight to the TimeTables of each 4KB page it
+	 * covers a page at a time, bypassing the cache.
+	 *
+	 * @pre curr_versions and times are non-NULL.
+	 */
+	void setRange(Addr addr, UInt64 size, Index depth, 
+					Version *curr_versions, Time *times);
+
+	/*!
+	 * Copies large ranges between their TimeTables a page at a time,
+	 * bypassing the cache. Ranges that overlap or are aligned differently
+	 * within a word are copied word by word.
+	 *
+	 * @pre curr_versions, min_times and max_times are non-NULL.
+	 */
+	void copyRange(Addr dest, Addr src, UInt64 size, Index depth, 
+					Version *curr_versions, const Time *min_times, 
+					Time cost, Time *max_times);
+
 	CBuffer* getCompressionBuffer() { return compression_buffer; }
 
 	/*!
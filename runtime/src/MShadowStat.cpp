@@ -7,8 +7,10 @@
 #include "MShadowStat.h"
 #include "MShadowSkadu.h"
 
-MemStat _stat;
-L1Stat _cacheStat;
+__thread MemStat _stat;
+__thread L1Stat _cacheStat;
+volatile Int64 _shadowMemInUse = 0;
+__thread Int64 _shadowMemUnflushed = 0;
 
 
 
@@ -40,10 +42,38 @@ void printCacheStat() {
 		_cacheStat.nCacheEvict, 
 		(double)_cacheStat.nCacheEvictLevelTotal / _cacheStat.nCacheEvict, 
 		(double)_cacheStat.nCacheEvictLevelEffective / _cacheStat.nCacheEvict);
+	MSG(0, "\tLine writebacks / resizes = %llu / %llu\n", 
+		_cacheStat.nLineWriteback, _cacheStat.nResize);
 
 	MSG(0, "\tnGC = %llu\n", _stat.nGC);
 }
 
+static void printGCStat() {
+	MSG(0, "\nShadow Memory Garbage Collection Stat\n");
+	MSG(0, "\tcycles (all / major) = %llu / %llu\n", 
+		_stat.nGC, _stat.nGCMajor);
+	MSG(0, "\tLevelTables scanned / TimeTables freed = %llu / %llu\n", 
+		_stat.nGCScanned, _stat.nGCFreed);
+	MSG(0, "\tpauses (count / total ms / avg us / max us) = %llu / %.2f / %.2f / %.2f\n", 
+		_stat.nGCStep, _stat.gcPauseTotal / 1e6, 
+		_stat.nGCStep ? _stat.gcPauseTotal / 1e3 / _stat.nGCStep : 0.0, 
+		_stat.gcPauseMax / 1e3);
+
+#ifndef NDEBUG
+	for (unsigned i = 0; i < GC_PAUSE_BUCKETS; ++i) {
+		if (_stat.gcPauseHist[i] == 0) continue;
+		UInt64 lo = (i == 0) ? 0 : 1ULL << (i - 1);
+		if (i == GC_PAUSE_BUCKETS - 1) {
+			MSG(0, "\t\t>= %llu us: %llu\n", lo, _stat.gcPauseHist[i]);
+		}
+		else {
+			MSG(0, "\t\t[%llu, %llu) us: %llu\n", 
+				lo, 1ULL << i, _stat.gcPauseHist[i]);
+		}
+	}
+#endif
+}
+
 
 void printMemReqStat() {
 	//fprintf(stderr, "Overall allocated = %d, converted = %d, realloc = %d\n", 
@@ -135,6 +165,7 @@ void MShadowStatPrint() {
 	printMemStatAllocation();
 	//printLevelStat();
 	printCacheStat();
+	printGCStat();
 	printMemReqStat();
 }
 
@@ -63,6 +63,8 @@ typedef struct _LevelStat {
  */
 
 
+#define GC_PAUSE_BUCKETS 24
+
 typedef struct _MemStat {
 	LStat levels[128];	
 
@@ -71,7 +73,14 @@ typedef struct _MemStat {
 
 	AStat lTable;
 
-	UInt64 nGC;
+	UInt64 nGC; // collection cycles started
+	UInt64 nGCMajor; // cycles that also rescanned the survivors
+	UInt64 nGCStep;
+	UInt64 nGCScanned; // LevelTables scanned
+	UInt64 nGCFreed; // TimeTables freed
+	UInt64 gcPauseTotal; // in ns
+	UInt64 gcPauseMax; // in ns
+	UInt64 gcPauseHist[GC_PAUSE_BUCKETS]; // bucket b > 0: [2^(b-1), 2^b) us
 
 	// tracking overhead of timetables (in bytes) with compression
 	UInt64 timeTableOverhead;
@@ -79,11 +88,39 @@ typedef struct _MemStat {
 
 } MemStat;
 
-extern MemStat _stat;
+// Per-thread so each thread's shadow memory keeps its own counters (the GC
+// trigger reads them) when profiling multithreaded programs.
+extern __thread MemStat _stat;
+
+/*
+ * Bytes of shadow memory in use by all threads together, which is what
+ * --kremlin-shadow-mem-limit limits. Each thread adds up its own changes
+ * and only folds them into the total once they pass
+ * SHADOW_MEM_FLUSH_BYTES, so the total is off by less than that per thread
+ * and threads rarely touch the shared counter.
+ */
+extern volatile Int64 _shadowMemInUse;
+extern __thread Int64 _shadowMemUnflushed;
+static const Int64 SHADOW_MEM_FLUSH_BYTES = 64 * 1024;
+
+static inline void addShadowMemInUse(Int64 bytes) {
+	_shadowMemUnflushed += bytes;
+	if (_shadowMemUnflushed >= SHADOW_MEM_FLUSH_BYTES 
+		|| _shadowMemUnflushed <= -SHADOW_MEM_FLUSH_BYTES) {
+		__sync_fetch_and_add(&_shadowMemInUse, _shadowMemUnflushed);
+		_shadowMemUnflushed = 0;
+	}
+}
+
+static inline UInt64 getShadowMemInUse() {
+	Int64 bytes = _shadowMemInUse;
+	return (bytes < 0) ? 0 : (UInt64)bytes;
+}
 
-static inline void eventLevelTableAlloc() {
+static inline void eventLevelTableAlloc(int size) {
 	//_stat.nLevelTableAlloc++;
 	AStatAlloc(&_stat.lTable);
+	addShadowMemInUse(size);
 }
 
 static inline void eventTimeTableNewAlloc(int level, int type) {
@@ -111,10 +148,12 @@ static inline void increaseTimeTableMemSize(int size) {
 	_stat.timeTableOverhead += size;
 	if(_stat.timeTableOverhead > _stat.timeTableOverheadMax)
 		_stat.timeTableOverheadMax = _stat.timeTableOverhead;
+	addShadowMemInUse(size);
 }
 
 static inline void decreaseTimeTableMemSize(int size) {
 	_stat.timeTableOverhead -= size;
+	addShadowMemInUse(-size);
 }
 
 static inline void eventCompression(int gain) {
@@ -131,18 +170,39 @@ static inline void eventTimeTableFree(int type, int size) {
 	decreaseTimeTableMemSize(size);
 }
 
-static inline void eventSegTableAlloc() {
+static inline void eventSegTableAlloc(int size) {
 	AStatAlloc(&_stat.segTable);
+	addShadowMemInUse(size);
 }
 
-static inline void eventSegTableFree() {
+static inline void eventSegTableFree(int size) {
 	AStatDealloc(&_stat.segTable);
+	addShadowMemInUse(-size);
 }
 
 static inline void eventGC() {
 	_stat.nGC++;
 }
 
+static inline void eventGCMajor() {
+	_stat.nGCMajor++;
+}
+
+static inline void eventGCPause(UInt64 ns, unsigned num_scanned, 
+								unsigned num_freed) {
+	_stat.nGCStep++;
+	_stat.nGCScanned += num_scanned;
+	_stat.nGCFreed += num_freed;
+	_stat.gcPauseTotal += ns;
+	if (_stat.gcPauseMax < ns)
+		_stat.gcPauseMax = ns;
+
+	UInt64 us = ns / 1000;
+	unsigned bucket = (us == 0) ? 0 : 64 - __builtin_clzll(us);
+	if (bucket >= GC_PAUSE_BUCKETS) bucket = GC_PAUSE_BUCKETS - 1;
+	_stat.gcPauseHist[bucket]++;
+}
+
 
 static inline UInt64 getActiveTimeTableSize() {
 	return _stat.tTable[0].nActive + _stat.tTable[1].nActive;
@@ -166,10 +226,12 @@ typedef struct _L1Stat {
 	UInt64 nCacheEvictLevelEffective;
 	UInt64 nCacheEvict;
 
+	UInt64 nLineWriteback; // misses that had to write a valid line back
+	UInt64 nResize;
 
 } L1Stat;
 
-extern L1Stat _cacheStat;
+extern __thread L1Stat _cacheStat;
 
 
 static inline void eventRead() {
@@ -202,6 +264,14 @@ static inline void eventCacheEvict(int total, int effective) {
 	_cacheStat.nCacheEvict++;
 }
 
+static inline void eventLineWriteback() {
+	_cacheStat.nLineWriteback++;
+}
+
+static inline void eventCacheResize() {
+	_cacheStat.nResize++;
+}
+
 static inline void eventEvict(int level) {
 	_cacheStat.nEvictLevel[level]++;
 	_cacheStat.nEvictTotal++;
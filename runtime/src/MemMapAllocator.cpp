@@ -1,130 +1,426 @@
 /**
- * @file MemMapMemMapAllocator.cpp
- * @brief Defines a pool of memory backed by mmap.
+ * @file MemMapAllocator.cpp
+ * @brief Defines a size-class slab allocator backed by mmap.
+ *
+ * Small objects are rounded up to one of NUM_SMALL_CLASSES size classes.
+ * Each class carves its objects out of slabs with a bump pointer and keeps
+ * freed objects on an intrusive free list, i.e. the link to the next free
+ * object is stored in the freed object itself, so neither allocating nor
+ * freeing needs any bookkeeping memory. Slabs come out of large arenas and
+ * are never returned to the system.
+ *
+ * TimeTable arrays (MemPoolAlloc) get a class of their own whose slabs are
+ * large reservations, 2MB aligned so they can be backed by transparent
+ * huge pages. Objects larger than MAX_SMALL_SIZE go to malloc.
+ *
+ * Each thread keeps a short free list of its own per class (ThreadCache)
+ * and only takes the class's lock to refill it or to hand back half of it
+ * when it gets too long, so most allocations and frees take no lock.
  */
 
 #include <cstdlib>
 #include <cstdio>
+#include <cstring> // for memset
+#include <climits> // for INT_MAX
 #include <sys/mman.h>
+#include <pthread.h>
 
 #include "debug.h"
 #include "MemMapAllocator.h"
-#include "mpool.h"
-
-typedef struct _MChunk {
-	Addr addr;
-	struct _MChunk* next;
-} MChunk;
-
-static int chunkSize;
-static int mmapSizeMB;
-static MChunk* freeList;
-static mpool_t* poolSmall;
-
-
-void MemPoolInit(int nMB, int sizeEach) {
-	mmapSizeMB = nMB;
-	chunkSize = sizeEach;
-	freeList = NULL;	
-	int error;
-	poolSmall = mpool_open(0, 0, (void*)0x100000000000, &error);
-	if (error != 1) {
-		fprintf(stderr, "ERROR (mpool_open): %s\n", mpool_strerror(error)); 
-		assert(0);
-	}
 
+/* MAC OS X doesn't have MAP_ANONYMOUS, it uses MAP_ANON instead */
+#ifndef MAP_ANONYMOUS
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+
+static const unsigned MIN_SIZE = 16;
+static const unsigned MAX_SMALL_SIZE = 32768;
+// 8 classes 16 bytes apart up to 128, then 4 classes per power of two
+static const unsigned NUM_SMALL_CLASSES = 8 + 4 * 8;
+static const UInt64 MIN_SLAB_SIZE = 64 * 1024;
+static const UInt64 ARENA_SIZE = 64 * 1024 * 1024;
+static const UInt64 HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+typedef struct _FreeObject {
+	struct _FreeObject* next;
+} FreeObject;
+
+typedef struct _SizeClass {
+	unsigned index; // into ThreadCache
+	unsigned size;
+	unsigned batch; // objects moved to or from a thread cache at a time
+	UInt64 slab_size;
+	FreeObject* free_list;
+	char* bump; // next never used object in the current slab
+	char* bump_end;
+	pthread_mutex_t lock;
+
+	// Objects sitting in thread caches count as allocated.
+	UInt64 num_allocs;
+	UInt64 num_active;
+	UInt64 max_active;
+	UInt64 num_slabs;
+} SizeClass;
+
+static const unsigned NUM_CLASSES = NUM_SMALL_CLASSES + 1; // + chunk_class
+static const UInt64 CACHE_BATCH_BYTES = 32 * 1024;
+static const unsigned MAX_CACHE_BATCH = 32;
+
+typedef struct _ThreadCache {
+	FreeObject* objects[NUM_CLASSES];
+	unsigned count[NUM_CLASSES];
+	bool registered; // with thread_cache_key, to be flushed on exit
+	bool disabled; // the thread is exiting and its cache was flushed
+} ThreadCache;
+
+static __thread ThreadCache thread_cache;
+static pthread_key_t thread_cache_key;
+static pthread_once_t thread_cache_key_once = PTHREAD_ONCE_INIT;
+
+static SizeClass small_classes[NUM_SMALL_CLASSES];
+static UInt8 class_of_size[MAX_SMALL_SIZE / MIN_SIZE + 1]; // by (size+15)/16
+static pthread_once_t small_classes_once = PTHREAD_ONCE_INIT;
+
+static SizeClass chunk_class; // TimeTable arrays
+static bool chunk_class_ready = false;
+static bool use_huge_pages = false;
+static pthread_mutex_t init_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Arena that small slabs are cut from.
+static char* arena_bump;
+static char* arena_end;
+static UInt64 arena_bytes_mapped;
+static pthread_mutex_t arena_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static UInt64 num_large_allocs;
+static UInt64 num_large_active;
+static UInt64 max_large_active;
+static pthread_mutex_t large_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static unsigned getClassSize(unsigned index) {
+	if (index < 8) return (index + 1) * 16;
+	unsigned group = (index - 8) / 4; // 0 for (128, 256]
+	unsigned step = (index - 8) % 4 + 1;
+	return (128 << group) + step * (32 << group);
 }
 
-void MemPoolDeinit() {
-	mpool_close(poolSmall);
+static void initSizeClass(SizeClass* c, unsigned index, unsigned size, 
+							UInt64 slab_size) {
+	c->index = index;
+	c->size = size;
+	c->batch = CACHE_BATCH_BYTES / size;
+	if (c->batch < 1) c->batch = 1;
+	if (c->batch > MAX_CACHE_BATCH) c->batch = MAX_CACHE_BATCH;
+	c->slab_size = slab_size;
+	c->free_list = NULL;
+	c->bump = NULL;
+	c->bump_end = NULL;
+	pthread_mutex_init(&c->lock, NULL);
+	c->num_allocs = 0;
+	c->num_active = 0;
+	c->max_active = 0;
+	c->num_slabs = 0;
 }
 
-Addr MemPoolAllocSmall(int size) {
-	//assert(size <= chunkSize);
-	//return MemPoolAlloc();
-	int error;
-	return mpool_alloc(poolSmall, size, &error);
+static void initSmallClasses() {
+	unsigned index = 0;
+	for (unsigned i = 0; i < NUM_SMALL_CLASSES; ++i) {
+		unsigned size = getClassSize(i);
+		// a multiple of MIN_SLAB_SIZE, so that what is left of an arena is
+		// always at least MIN_SLAB_SIZE (see allocSmallSlab)
+		UInt64 slab_size = (UInt64)size * 8;
+		slab_size = (slab_size + MIN_SLAB_SIZE - 1) & ~(MIN_SLAB_SIZE - 1);
+		initSizeClass(&small_classes[i], i, size, slab_size);
+
+		for (; index * MIN_SIZE <= size && index <= MAX_SMALL_SIZE / MIN_SIZE;
+				++index) {
+			class_of_size[index] = i;
+		}
+	}
+	assert(getClassSize(NUM_SMALL_CLASSES - 1) == MAX_SMALL_SIZE);
 }
 
-Addr MemPoolCallocSmall(int num, int size) {
-	int error;
-	return mpool_calloc(poolSmall, num, size, &error);
+static char* mapMemory(UInt64 size) {
+	int protection = PROT_READ | PROT_WRITE;
+	int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+
+	void* data = mmap(NULL, size, protection, flags, -1, 0);
+	if (data == MAP_FAILED) {
+		perror("mmap");
+		exit(1);
+	}
+	return (char*)data;
 }
 
-void MemPoolFreeSmall(Addr addr, int size) {
-	int error = mpool_free(poolSmall, addr, size);
-	assert(error = MPOOL_ERROR_NONE);
-	//MemPoolFree(addr);
+/*!
+ * Maps size bytes aligned to a huge page, asking for them to be backed by
+ * huge pages if enabled.
+ */
+static char* mapHugeAligned(UInt64 size) {
+	char* data = mapMemory(size + HUGE_PAGE_SIZE);
+	UInt64 misalign = (UInt64)data & (HUGE_PAGE_SIZE - 1);
+	UInt64 head = misalign ? HUGE_PAGE_SIZE - misalign : 0;
+	if (head > 0) munmap(data, head);
+	if (HUGE_PAGE_SIZE - head > 0)
+		munmap(data + head + size, HUGE_PAGE_SIZE - head);
+	data += head;
+
+#ifdef MADV_HUGEPAGE
+	if (use_huge_pages && madvise(data, size, MADV_HUGEPAGE) != 0) {
+		MSG(1, "MemPool: madvise(MADV_HUGEPAGE) failed\n");
+	}
+#endif
+	return data;
+}
+
+/*!
+ * Cuts a slab of up to size bytes out of the current arena. If less than
+ * that is left, the slab is whatever is left (which is at least
+ * MIN_SLAB_SIZE since every slab size is a multiple of it), so no part of
+ * an arena goes unused.
+ *
+ * @param size Size of the slab wanted.
+ * @param slab_size Set to the size of the slab returned.
+ */
+static char* allocSmallSlab(UInt64 size, UInt64* slab_size) {
+	pthread_mutex_lock(&arena_lock);
+	if (arena_bump == NULL || arena_bump == arena_end) {
+		arena_bump = mapMemory(ARENA_SIZE);
+		arena_end = arena_bump + ARENA_SIZE;
+		arena_bytes_mapped += ARENA_SIZE;
+	}
+	if (size > (UInt64)(arena_end - arena_bump)) 
+		size = arena_end - arena_bump;
+	char* ret = arena_bump;
+	arena_bump += size;
+	pthread_mutex_unlock(&arena_lock);
+
+	*slab_size = size;
+	return ret;
 }
 
-MChunk* MChunkAlloc(Addr addr) {
-	//MChunk* ret = malloc(sizeof(MChunk));
-	MChunk* ret = (MChunk*)MemPoolAllocSmall(sizeof(MChunk));
-	ret->addr = addr;
+/*!
+ * Takes an object off a class's free list, or out of its current slab.
+ * The class's lock must be held.
+ */
+static FreeObject* takeFromClass(SizeClass* c) {
+	FreeObject* ret;
+	if (c->free_list != NULL) {
+		ret = c->free_list;
+		c->free_list = c->free_list->next;
+	}
+	else {
+		if (c->bump + c->size > c->bump_end) {
+			UInt64 slab_size = c->slab_size;
+			if (c == &chunk_class)
+				c->bump = mapHugeAligned(slab_size);
+			else
+				c->bump = allocSmallSlab(slab_size, &slab_size);
+			c->bump_end = c->bump + slab_size;
+			c->num_slabs++;
+			MSG(1, "MemPool: new slab of %llu bytes for size %u at 0x%p\n",
+				slab_size, c->size, c->bump);
+		}
+		ret = (FreeObject*)c->bump;
+		c->bump += c->size;
+	}
+
+	c->num_allocs++;
+	if (++c->num_active > c->max_active) c->max_active = c->num_active;
 	return ret;
 }
 
-void MChunkFree(MChunk* target) {
-	MemPoolFreeSmall(target, sizeof(MChunk));
+static void giveToClass(SizeClass* c, FreeObject* obj) {
+	obj->next = c->free_list;
+	c->free_list = obj;
+	c->num_active--;
 }
 
-void addMChunk(MChunk* toAdd) {
-	MChunk* head = freeList;
-	toAdd->next = head;
-	freeList = toAdd;
+static SizeClass* getClassByIndex(unsigned index) {
+	return (index == NUM_SMALL_CLASSES) ? &chunk_class : &small_classes[index];
 }
 
-static void FillFreeList() {
-	int protection = PROT_READ | PROT_WRITE;
-    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
-
-    // Allocate mmapped data.
-	unsigned char* data;
-// Mac OS X doesn't have mmap64... not sure if it's really needed
-#ifdef __MACH__
-    data = (unsigned char*)mmap(NULL, mmapSizeMB * 1024 * 1024, protection,
-								flags, -1, 0);
-#else
-    data = (unsigned char*)mmap64(NULL, mmapSizeMB * 1024 * 1024, protection,
-								flags, -1, 0);
-#endif
-	
-	if (data == MAP_FAILED) {
-		perror("mmap");
-		exit(1);
-	} else {
-		assert(freeList == NULL);
+/*!
+ * Hands everything in the exiting thread's cache back to the classes.
+ */
+static void flushThreadCache(void* arg) {
+	ThreadCache* tc = &thread_cache;
+	for (unsigned i = 0; i < NUM_CLASSES; ++i) {
+		if (tc->objects[i] == NULL) continue;
+
+		SizeClass* c = getClassByIndex(i);
+		pthread_mutex_lock(&c->lock);
+		while (tc->objects[i] != NULL) {
+			FreeObject* obj = tc->objects[i];
+			tc->objects[i] = obj->next;
+			giveToClass(c, obj);
+		}
+		pthread_mutex_unlock(&c->lock);
+		tc->count[i] = 0;
+	}
+	// anything freed later in the thread's exit goes straight to the class
+	tc->disabled = true;
+}
+
+static void createThreadCacheKey() {
+	pthread_key_create(&thread_cache_key, flushThreadCache);
+}
+
+static Addr allocFromClass(SizeClass* c) {
+	ThreadCache* tc = &thread_cache;
+	if (tc->disabled) {
+		pthread_mutex_lock(&c->lock);
+		FreeObject* ret = takeFromClass(c);
+		pthread_mutex_unlock(&c->lock);
+		return ret;
+	}
+
+	FreeObject* ret = tc->objects[c->index];
+	if (ret == NULL) {
+		if (!tc->registered) {
+			pthread_once(&thread_cache_key_once, createThreadCacheKey);
+			pthread_setspecific(thread_cache_key, tc);
+			tc->registered = true;
+		}
+
+		pthread_mutex_lock(&c->lock);
+		for (unsigned i = 0; i < c->batch; ++i) {
+			FreeObject* obj = takeFromClass(c);
+			obj->next = ret;
+			ret = obj;
+		}
+		pthread_mutex_unlock(&c->lock);
+		tc->count[c->index] = c->batch;
+	}
+
+	tc->objects[c->index] = ret->next;
+	tc->count[c->index]--;
+	return ret;
+}
+
+static void freeToClass(SizeClass* c, Addr addr) {
+	FreeObject* obj = (FreeObject*)addr;
+	ThreadCache* tc = &thread_cache;
+	if (tc->disabled) {
+		pthread_mutex_lock(&c->lock);
+		giveToClass(c, obj);
+		pthread_mutex_unlock(&c->lock);
+		return;
 	}
 
-	unsigned char* current = data;
-	unsigned cnt = 0;	
-	while ((current + chunkSize) < (data + mmapSizeMB * 1024 * 1024)) {
-		//fprintf(stderr, "current = 0x%llx\n", current);
-		MChunk* toAdd = MChunkAlloc(current);		
-		addMChunk(toAdd);	
-		current += chunkSize;
-		cnt++;
+	obj->next = tc->objects[c->index];
+	tc->objects[c->index] = obj;
+	if (++tc->count[c->index] < 2 * c->batch) return;
+
+	// keep the batch freed most recently and hand back the older one
+	FreeObject* last_kept = obj;
+	for (unsigned i = 1; i < c->batch; ++i) last_kept = last_kept->next;
+	FreeObject* rest = last_kept->next;
+	last_kept->next = NULL;
+
+	pthread_mutex_lock(&c->lock);
+	while (rest != NULL) {
+		FreeObject* next = rest->next;
+		giveToClass(c, rest);
+		rest = next;
 	}
-	MSG(1, "Allocated %u chunks starting at 0x%p\n", cnt, data);
-	MSG(1, "last = 0x%p\n", current - chunkSize);
+	pthread_mutex_unlock(&c->lock);
+	tc->count[c->index] = c->batch;
 }
 
+void MemPoolInit(int nMB, int sizeEach, bool huge_pages) {
+	pthread_mutex_lock(&init_lock);
+
+	// Each thread's shadow memory calls this; only the first call sets up
+	// the shared pool.
+	if (chunk_class_ready) {
+		assert(chunk_class.size == (unsigned)sizeEach);
+		pthread_mutex_unlock(&init_lock);
+		return;
+	}
+
+	assert(sizeEach >= (int)sizeof(FreeObject));
+	use_huge_pages = huge_pages;
+	UInt64 slab_size = (UInt64)nMB * 1024 * 1024;
+	slab_size = (slab_size + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+	initSizeClass(&chunk_class, NUM_SMALL_CLASSES, sizeEach, slab_size);
+	chunk_class_ready = true;
+
+	pthread_mutex_unlock(&init_lock);
+}
 
 Addr MemPoolAlloc() {
-	if (freeList == NULL) {
-		FillFreeList();
+	assert(chunk_class_ready);
+	return allocFromClass(&chunk_class);
+}
+
+void MemPoolFree(Addr addr) {
+	assert(addr != NULL);
+	freeToClass(&chunk_class, addr);
+}
+
+Addr MemPoolAllocSmall(int size) {
+	if (size > (int)MAX_SMALL_SIZE) {
+		pthread_mutex_lock(&large_lock);
+		num_large_allocs++;
+		if (++num_large_active > max_large_active)
+			max_large_active = num_large_active;
+		pthread_mutex_unlock(&large_lock);
+		return malloc(size);
 	}
-	MChunk* head = freeList;
-	void* ret = freeList->addr;
-	freeList = freeList->next;
-	MChunkFree(head);
 
-	//bzero(ret, chunkSize);
-	//fprintf(stderr, "Returning addr 0x%llx\n", ret);
+	pthread_once(&small_classes_once, initSmallClasses);
+	if (size < 1) size = 1;
+	return allocFromClass(&small_classes[class_of_size[(size + 15) / 16]]);
+}
+
+Addr MemPoolCallocSmall(int num, int size) {
+	if (num < 0 || size < 0) return NULL;
+
+	// The total has to fit in the int that MemPoolAllocSmall (and the
+	// matching MemPoolFreeSmall) takes.
+	size_t total = (size_t)num * (size_t)size;
+	if (total > INT_MAX) return NULL;
+
+	Addr ret = MemPoolAllocSmall((int)total);
+	if (ret != NULL) memset(ret, 0, total);
 	return ret;
 }
 
-void MemPoolFree(Addr addr) {
-	MChunk* toAdd = MChunkAlloc(addr);
-	addMChunk(toAdd);
+void MemPoolFreeSmall(Addr addr, int size) {
+	if (addr == NULL) return;
+
+	if (size > (int)MAX_SMALL_SIZE) {
+		pthread_mutex_lock(&large_lock);
+		num_large_active--;
+		pthread_mutex_unlock(&large_lock);
+		free(addr);
+		return;
+	}
+
+	if (size < 1) size = 1;
+	freeToClass(&small_classes[class_of_size[(size + 15) / 16]], addr);
+}
+
+void MemPoolPrintStats() {
+	UInt64 small_peak = 0;
+	UInt64 small_slabs = 0;
+	for (unsigned i = 0; i < NUM_SMALL_CLASSES; ++i) {
+		SizeClass* c = &small_classes[i];
+		if (c->num_allocs == 0) continue;
+
+		MSG(0, "MemPool class %u bytes: %llu allocs, %llu active, peak %llu, %llu slabs\n",
+			c->size, c->num_allocs, c->num_active, c->max_active,
+			c->num_slabs);
+		small_peak += c->max_active * c->size;
+		small_slabs += c->num_slabs;
+	}
+
+	fprintf(stderr, "[kremlin] Allocator: peak %llu TimeTable chunks (%.1f MB%s), "
+		"%.1f MB of small objects in %llu slabs, %llu large allocations\n",
+		(unsigned long long)chunk_class.max_active,
+		chunk_class.max_active * chunk_class.size / 1048576.0,
+		use_huge_pages ? " on huge pages" : "",
+		small_peak / 1048576.0, (unsigned long long)small_slabs, 
+		(unsigned long long)num_large_allocs);
 }
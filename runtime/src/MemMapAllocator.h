@@ -4,11 +4,26 @@
 #include <stdlib.h>
 #include "ktypes.h"
 
-void MemPoolInit(int, int);
+/*
+ * Fixed-size chunks for TimeTable arrays. MemPoolInit sets the chunk size
+ * (only the first call has any effect); chunks are reserved nMB at a time,
+ * on transparent huge pages if huge_pages is set.
+ */
+void MemPoolInit(int nMB, int sizeEach, bool huge_pages);
 Addr MemPoolAlloc(void);
 void MemPoolFree(Addr addr);
 
+/*
+ * Small objects, served from per-size-class slabs. The size passed to
+ * MemPoolFreeSmall must be the one the object was allocated with.
+ */
 Addr MemPoolAllocSmall(int);
 Addr MemPoolCallocSmall(int, int);
 void MemPoolFreeSmall(Addr addr, int size);
+
+/*
+ * Prints how much each kind of allocation peaked at. Objects cached by
+ * threads for reuse count as allocated.
+ */
+void MemPoolPrintStats();
 #endif /* MEM_MAP_ALLOCATOR_H */
@@ -48,13 +48,14 @@ public:
 	 * @pre table is non-NULL.
 	 * @pre index < NUM_ENTRIES
 	 */
-	LevelTable* setLevelTableAtIndex(LevelTable *table, unsigned index) { 
+	void setLevelTableAtIndex(LevelTable *table, unsigned index) { 
 		assert(table != NULL);
 		assert(index < NUM_ENTRIES);
 		level_tables[index] = table;
 	}
 
 	static unsigned getNumLevelTables() { return NUM_ENTRIES; }
+	static UInt64 getBytesPerLevelTable() { return 1ULL << SEGMENT_SHIFT; }
 	static unsigned GetIndex(Addr addr) {
 		return ((UInt64)addr >> SEGMENT_SHIFT) & SEGMENT_MASK;
 	}
@@ -0,0 +1,136 @@
+#ifndef _PROFILE_FORMAT_H_
+#define _PROFILE_FORMAT_H_
+
+#include "ktypes.h"
+
+/*
+ * Layout of the profile (kremlin.bin) written by CRegion.cpp.
+ *
+ * Version 2 (current):
+ *
+ *  - ProfileFileHeader
+ *  - num_nodes node records, in pre-order of the region tree
+ *  - num_nodes ProfileIndexEntry, sorted by node ID
+ *  - if PROFILE_FLAG_SKETCHES is set, a sketch section (see below)
+ *
+ * The header and the index are fixed size and use the byte order of the
+ * machine that wrote them; readers check byte_order to find out which one
+ * that was. Node records are byte order independent: every field is an
+ * unsigned LEB128 varint (7 bits per byte, least significant group first,
+ * high bit set on all bytes but the last). Fields marked "signed" are
+ * zigzag encoded first ((v << 1) ^ (v >> 63)) so small negative values stay
+ * small. A node record is:
+ *
+ *  - signed   ID minus the ID of the previous node record (or minus 0 for
+ *             the first one)
+ *  - unsigned static region ID
+ *  - unsigned callsite ID (0 unless a function region)
+ *  - unsigned node type (NORMAL, R_INIT or R_SINK), or'ed with
+ *             SAMPLED_NODE_FLAG if the stats are extrapolated from a sample
+ *  - signed   recursion target ID minus this node's ID, or 0 if not
+ *             recursive (a node is never its own target)
+ *  - unsigned number of instances
+ *  - unsigned DOALL flag
+ *  - unsigned number of children (C)
+ *  - C * signed child ID minus this node's ID
+ *  - unsigned number of stats (N), one per recursion depth
+ *  - N * the following 9 unsigned fields:
+ *    - number of instances
+ *    - total work
+ *    - total_par_per_work (critical path length)
+ *    - self_par_per_work (work after self-parallelism is applied)
+ *    - minimum self-parallelism * 100
+ *    - maximum self-parallelism * 100
+ *    - total, minimum and maximum number of dynamic child regions
+ *
+ * The sketch section is written when stats are summarized
+ * (--kremlin-stats-memory-cap). It is all unsigned varints:
+ *
+ *  - number of sketches (S)
+ *  - S * the following:
+ *    - node ID
+ *    - minimum and maximum work of any instance
+ *    - minimum and maximum critical path length of any instance
+ *    - 3 * 32 bucket counts, for work, critical path length and
+ *      self-parallelism * 100, in that order. Bucket 0 counts zeros and
+ *      bucket b > 0 counts values in [2^(b-1), 2^b); the last bucket also
+ *      counts everything larger. Counts are not scaled for sampling.
+ *
+ * Version 1 (no header) is a sequence of node records made of raw 64-bit
+ * little endian fields:
+ *
+ *  - ID, static ID, callsite ID, node type, recursion target ID (or 0),
+ *    number of instances, DOALL flag, number of children (C)
+ *  - C * child ID (in reverse order of creation)
+ *  - number of stats (N)
+ *  - N * the same 9 stat fields as version 2
+ *
+ * Checkpoint file (<output>.checkpoint, see startCheckpoints in CRegion.h),
+ * version 1. It is only ever appended to while the program runs:
+ *
+ *  - ProfileCheckpointHeader
+ *  - any number of epochs, each a ProfileCheckpointEpoch followed by
+ *    num_nodes checkpoint records taking up size bytes
+ *
+ * Epochs are numbered from 0. The first one has a record for every node
+ * that existed when it was taken; each later one only has the nodes that
+ * changed since the epoch before, so the latest record of each node ID
+ * across all epochs gives the tree as of the last epoch. If the program
+ * died while an epoch was being appended, the file ends before size bytes
+ * of its records; readers should ignore that epoch.
+ *
+ * A checkpoint record is a version 2 node record with these differences:
+ *
+ *  - IDs are relative to the previous record in the same epoch, and the
+ *    records are in no particular order
+ *  - the root of the tree (which the final profile leaves out) has no
+ *    record, and neither the depth limits nor sampling leave nodes out, so
+ *    children may have no stats
+ *  - counts aren't extrapolated for sampling and SAMPLED_NODE_FLAG is
+ *    never set; instead the record ends with two more unsigned fields, the
+ *    number of skipped instances and their total work
+ *
+ * Sketches aren't checkpointed.
+ */
+
+#define PROFILE_MAGIC				"KREMPROF"
+#define PROFILE_MAGIC_SIZE			8
+#define PROFILE_FORMAT_VERSION		2
+#define PROFILE_BYTE_ORDER_MARK		0x01020304
+
+#define CHECKPOINT_MAGIC			"KREMCKPT"
+#define CHECKPOINT_FORMAT_VERSION	1
+
+// Set in ProfileFileHeader::flags if any node has sampled stats.
+#define PROFILE_FLAG_SAMPLED		0x1
+// Set in ProfileFileHeader::flags if there is a sketch section.
+#define PROFILE_FLAG_SKETCHES		0x2
+
+struct ProfileFileHeader {
+	char magic[PROFILE_MAGIC_SIZE]; //!< PROFILE_MAGIC, not NUL terminated
+	UInt32 version; //!< PROFILE_FORMAT_VERSION
+	UInt32 byte_order; //!< PROFILE_BYTE_ORDER_MARK
+	UInt64 flags;
+	UInt64 num_nodes;
+	UInt64 index_offset; //!< File offset of the index.
+};
+
+struct ProfileIndexEntry {
+	UInt64 id; //!< Node ID.
+	UInt64 offset; //!< File offset of the node's record.
+};
+
+struct ProfileCheckpointHeader {
+	char magic[PROFILE_MAGIC_SIZE]; //!< CHECKPOINT_MAGIC, not NUL terminated
+	UInt32 version; //!< CHECKPOINT_FORMAT_VERSION
+	UInt32 byte_order; //!< PROFILE_BYTE_ORDER_MARK
+	UInt64 flags; //!< PROFILE_FLAG_SAMPLED if regions are sampled
+};
+
+struct ProfileCheckpointEpoch {
+	UInt64 epoch; //!< Number of epochs before this one.
+	UInt64 num_nodes;
+	UInt64 size; //!< Bytes of node records that follow.
+};
+
+#endif // _PROFILE_FORMAT_H_
@@ -2,11 +2,26 @@
 
 #include "ProfileNode.hpp"
 #include "ProfileNodeStats.hpp"
+#include "ProfileNodeSketch.hpp"
+#include "config.h"
 #include "MemMapAllocator.h"
 #include "debug.h"
 
 static UInt64 lastId = 0; // FIXME: change to member variable?
-UInt64 ProfileNode::allocId() { return ++lastId; }
+
+// TRICKY: ids must stay unique across threads so that per-thread trees can be
+// merged into one profile.
+UInt64 ProfileNode::allocId() { return __sync_add_and_fetch(&lastId, 1); }
+
+static volatile unsigned num_folded_nodes = 0;
+
+unsigned ProfileNode::getNumFoldedNodes() { return num_folded_nodes; }
+
+bool ProfileNode::canAllocateStats(size_t size) {
+	if (!kremlin_config.summarizeStats()) return true;
+	UInt64 cap = (UInt64)kremlin_config.getStatsMemoryCapInMB() * 1024 * 1024;
+	return ProfileNodeStats::getMemoryInUse() + size <= cap;
+}
 
 void* ProfileNode::operator new(size_t size) {
 	return MemPoolAllocSmall(sizeof(ProfileNode));
@@ -19,7 +34,11 @@ void ProfileNode::operator delete(void* ptr) {
 ProfileNode::ProfileNode(SID static_id, CID callsite_id, RegionType type) : parent(NULL),
 	node_type(NORMAL), region_type(type), static_id(static_id), 
 	id(ProfileNode::allocId()), callsite_id(callsite_id), recursion(NULL),
-	num_instances(0), is_doall(1), curr_stat_index(-1) {
+	num_instances(0), num_skipped(0), skipped_work(0),
+	instance_scale(1.0), work_scale(1.0),
+	is_doall(1), curr_stat_index(-1), sketch(NULL), checkpoint_dirty(false),
+	last_child(NULL),
+	stats_folded(false) {
 
 	new(&this->children) std::vector<ProfileNode*, MPoolLib::PoolAllocator<ProfileNode*> >();
 	new(&this->stats) std::vector<ProfileNodeStats*, MPoolLib::PoolAllocator<ProfileNodeStats*> >();
@@ -32,7 +51,8 @@ ProfileNode::~ProfileNode() {
 	for(unsigned i = 0; i < stats.size(); ++i) {
 		delete stats[i];
 	}
-	children.clear();
+	delete sketch;
+	releaseChildren();
 	stats.clear();
 	/*
 	this->children.~vector<ProfileNode*, MPoolLib::PoolAllocator<ProfileNode*> >();
@@ -41,16 +61,26 @@ ProfileNode::~ProfileNode() {
 }
 
 ProfileNode* ProfileNode::getChild(UInt64 static_id, UInt64 callsite_id) {
-	for (unsigned i = 0; i < this->children.size(); ++i) {
-		ProfileNode* child = this->children[i];
-		if ( child->static_id == static_id
-			&& (child->getRegionType() != RegionFunc || child->callsite_id == callsite_id)
-		   ) {
-			return child;
+	// loop bodies and calls in a loop usually enter the same child again
+	if (last_child != NULL && last_child->matches(static_id, callsite_id)) {
+		return last_child;
+	}
+
+	ProfileNode* found = NULL;
+	if (!child_index.empty()) {
+		found = findIndexedChild(static_id, callsite_id);
+	}
+	else {
+		for (unsigned i = 0; i < this->children.size(); ++i) {
+			if (this->children[i]->matches(static_id, callsite_id)) {
+				found = this->children[i];
+				break;
+			}
 		}
 	}
 
-	return NULL;
+	if (found != NULL) last_child = found;
+	return found;
 }
 
 void ProfileNode::addChild(ProfileNode *child) {
@@ -58,10 +88,75 @@ void ProfileNode::addChild(ProfileNode *child) {
 	// TODO: add pre-condition to make sure child isn't already in list?
 	this->children.push_back(child);
 	child->parent = this;
+
+	if (!child_index.empty() && 2 * children.size() <= child_index.size()) {
+		indexChild(child);
+	}
+	else if (children.size() > MIN_INDEXED_CHILDREN) {
+		rebuildChildIndex();
+	}
+
 	assert(!children.empty());
 	assert(child->parent == this);
 }
 
+void ProfileNode::releaseChildren() {
+	children.clear();
+	child_index.clear();
+	last_child = NULL;
+}
+
+unsigned ProfileNode::getChildIndexSlot(UInt64 static_id, 
+										UInt64 callsite_id) {
+	assert(!child_index.empty());
+	UInt64 h = (static_id * 0x9E3779B97F4A7C15ULL) ^ callsite_id;
+	h ^= h >> 29;
+	h *= 0xBF58476D1CE4E5B9ULL;
+	h ^= h >> 32;
+	return h & (child_index.size() - 1);
+}
+
+ProfileNode* ProfileNode::findIndexedChild(UInt64 static_id, 
+											UInt64 callsite_id) {
+	// We don't know whether the child is a function, so if it isn't found
+	// under its callsite ID try again without one.
+	unsigned mask = child_index.size() - 1;
+	UInt64 cid = callsite_id;
+	while (true) {
+		unsigned slot = getChildIndexSlot(static_id, cid);
+		for (ProfileNode* child = child_index[slot]; child != NULL; 
+				slot = (slot + 1) & mask, child = child_index[slot]) {
+			if (child->matches(static_id, callsite_id)) return child;
+		}
+
+		if (cid == 0) return NULL;
+		cid = 0;
+	}
+}
+
+void ProfileNode::indexChild(ProfileNode *child) {
+	UInt64 cid = (child->region_type == RegionFunc) ? child->callsite_id : 0;
+	unsigned mask = child_index.size() - 1;
+	unsigned slot = getChildIndexSlot(child->static_id, cid);
+	while (child_index[slot] != NULL) {
+		slot = (slot + 1) & mask;
+	}
+	child_index[slot] = child;
+}
+
+void ProfileNode::rebuildChildIndex() {
+	unsigned new_size = 16;
+	while (new_size < 2 * children.size()) new_size *= 2;
+
+	MSG(DEBUG_CREGION, "rebuildChildIndex: node %llu, %u children, %u slots\n", 
+		this->id, children.size(), new_size);
+
+	child_index.assign(new_size, NULL);
+	for (unsigned i = 0; i < children.size(); ++i) {
+		indexChild(children[i]);
+	}
+}
+
 void ProfileNode::addStats(RegionStats *new_stats) {
 	assert(new_stats != NULL);
 
@@ -74,6 +169,11 @@ void ProfileNode::addStats(RegionStats *new_stats) {
 	// (converse isn't true)
 	if (new_stats->is_doall == 0) { this->is_doall = 0; }
 
+	if (this->sketch == NULL && kremlin_config.summarizeStats()
+		&& canAllocateStats(sizeof(ProfileNodeSketch))) {
+		this->sketch = new ProfileNodeSketch();
+	}
+
 	this->num_instances++;
 	this->updateCurrentStats(new_stats);
 	assert(this->num_instances > 0);
@@ -95,10 +195,16 @@ void ProfileNode::updateCurrentStats(RegionStats *new_stats) {
 
 	MSG(DEBUG_CREGION, "ProfileNodeStatsUpdate: work = %d, spWork = %d\n", new_stats->work, new_stats->spWork);
 
-	ProfileNodeStats *stat = this->stats[this->curr_stat_index];
+	// past the end if stats are being folded (see moveToNextStats)
+	unsigned stat_index = this->curr_stat_index;
+	if (stat_index >= this->stats.size()) stat_index = this->stats.size() - 1;
+	ProfileNodeStats *stat = this->stats[stat_index];
 	stat->num_instances++;
 	
 	double new_self_par = (double)new_stats->work / (double)new_stats->spWork;
+	if (this->sketch != NULL) {
+		this->sketch->add(new_stats->work, new_stats->cp, new_self_par);
+	}
 	if (stat->min_self_par > new_self_par) stat->min_self_par = new_self_par;
 	if (stat->max_self_par < new_self_par) stat->max_self_par = new_self_par;
 	stat->total_work += new_stats->work;
@@ -140,8 +246,16 @@ void ProfileNode::moveToNextStats() {
 	MSG(DEBUG_CREGION, "ProfileNodeStatsForward id %d to page %d\n", this->id, stat_index);
 
 	if (stat_index >= this->stats.size()) {
-		ProfileNodeStats *new_stat = new ProfileNodeStats(); // FIXME: memory leak
-		this->stats.push_back(new_stat);
+		if (this->stats.empty() || canAllocateStats(sizeof(ProfileNodeStats))) {
+			ProfileNodeStats *new_stat = new ProfileNodeStats(); // FIXME: memory leak
+			this->stats.push_back(new_stat);
+		}
+		else if (!this->stats_folded) {
+			MSG(DEBUG_CREGION, "ProfileNodeStatsForward id %d: folding stats past page %d\n", 
+				this->id, this->stats.size() - 1);
+			this->stats_folded = true;
+			__sync_add_and_fetch(&num_folded_nodes, 1);
+		}
 	}
 
 	assert(this->curr_stat_index >= 0);
@@ -193,3 +307,71 @@ void ProfileNode::handleRecursion() {
 		return;
 	}
 }
+
+void ProfileNode::mergeFrom(ProfileNode *other, 
+							std::map<ProfileNode*, ProfileNode*> &merged) {
+	assert(other != NULL);
+	assert(other != this);
+	assert(other->static_id == this->static_id);
+
+	MSG(DEBUG_CREGION, "mergeFrom: folding node %llu into %llu\n", 
+		other->id, this->id);
+
+	merged[other] = this;
+	this->num_instances += other->num_instances;
+	this->num_skipped += other->num_skipped;
+	this->skipped_work += other->skipped_work;
+	if (other->is_doall == 0) { this->is_doall = 0; }
+	if (other->node_type == R_INIT) { this->node_type = R_INIT; }
+
+	if (other->sketch != NULL) {
+		if (this->sketch == NULL) {
+			this->sketch = other->sketch;
+		}
+		else {
+			this->sketch->merge(other->sketch);
+			delete other->sketch;
+		}
+		other->sketch = NULL;
+	}
+
+	for (unsigned i = 0; i < other->stats.size(); ++i) {
+		if (i < this->stats.size()) {
+			this->stats[i]->merge(other->stats[i]);
+			delete other->stats[i];
+		}
+		else {
+			this->stats.push_back(other->stats[i]);
+		}
+	}
+	other->stats.clear();
+
+	for (unsigned i = 0; i < other->children.size(); ++i) {
+		ProfileNode *other_child = other->children[i];
+		ProfileNode *child = this->getChild(other_child->static_id, 
+											other_child->callsite_id);
+		if (child == NULL) {
+			this->addChild(other_child);
+		}
+		else {
+			child->mergeFrom(other_child, merged);
+			delete other_child;
+		}
+	}
+	other->releaseChildren();
+}
+
+void ProfileNode::redirectRecursionTargets(
+						std::map<ProfileNode*, ProfileNode*> &merged) {
+	if (this->recursion != NULL) {
+		std::map<ProfileNode*, ProfileNode*>::iterator it;
+		// follow the chain in case the target was folded more than once
+		while ((it = merged.find(this->recursion)) != merged.end()) {
+			this->recursion = it->second;
+		}
+	}
+
+	for (unsigned i = 0; i < this->children.size(); ++i) {
+		this->children[i]->redirectRecursionTargets(merged);
+	}
+}
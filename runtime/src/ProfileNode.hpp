@@ -1,6 +1,7 @@
 #ifndef _PROFILENODE_HPP_
 #define _PROFILENODE_HPP_
 
+#include <map>
 #include <vector>
 #include "PoolAllocator.hpp"
 #include "CRegion.h"
@@ -13,7 +14,12 @@
 // R_SINK - recursion sink node that connects to a R_INIT
 enum ProfileNodeType {NORMAL, R_INIT, R_SINK};
 
+// Or'ed into the node type written to kremlin.bin when a node's stats were
+// extrapolated from a sample of its instances.
+#define SAMPLED_NODE_FLAG	0x100
+
 class ProfileNodeStats;
+class ProfileNodeSketch;
 
 /*!
  * @brief A class to represent a profiled program region.
@@ -32,6 +38,14 @@ public:
 									region). */
 	UInt64 num_instances; /*!< The number of dynamic instances of
 								the region associated with this node. */
+	UInt64 num_skipped; /*!< The number of dynamic instances that were
+								not sampled (see skipRegionContext). */
+	UInt64 skipped_work; /*!< Total work of the instances that were not
+								sampled. */
+	double instance_scale; /*!< Factor by which instance counts are scaled
+								when written to account for unsampled instances
+								(see extrapolateSampledStats). */
+	double work_scale; /*!< Same as instance_scale, but for work. */
 	UInt64 is_doall; /*!< Indicates whether the region associated with this
 							node is a DOALL region (i.e. completely parallel) */
 
@@ -41,18 +55,40 @@ public:
 
 	// statistics for node
 	std::vector<ProfileNodeStats*, MPoolLib::PoolAllocator<ProfileNodeStats*> > stats;
-	int curr_stat_index;
+	int curr_stat_index; /*!< Index of the stats being updated. When stats
+								are summarized this can be past the end of
+								stats, in which case the last one is used
+								(see moveToNextStats). */
+	ProfileNodeSketch *sketch; /*!< Distribution of per-instance stats, or
+									NULL if stats aren't summarized. */
+	bool checkpoint_dirty; /*!< True if the node changed since the last
+								checkpoint (see takeCheckpoint). */
 
 	// management of tree
 	ProfileNode *parent; /*!< The parent node of this node. */
 	std::vector<ProfileNode*, MPoolLib::PoolAllocator<ProfileNode*> > children;
 
+private:
+	// Nodes with more than this many children get a child_index.
+	static const unsigned MIN_INDEXED_CHILDREN = 8;
+
+	/*!
+	 * Open addressing hash table of children (NULL in empty slots) used by
+	 * getChild. Its size is zero or a power of two, at least twice the
+	 * number of children.
+	 */
+	std::vector<ProfileNode*, MPoolLib::PoolAllocator<ProfileNode*> > child_index;
+	ProfileNode *last_child; /*!< Child most recently found by getChild. */
+
+public:
+
 	ProfileNode(SID static_id, CID callsite_id, RegionType type);
 	~ProfileNode();
 
 	const RegionType getRegionType() { return region_type; }
 	unsigned getStatSize() { return stats.size(); }
 	unsigned getNumChildren() { return children.size(); }
+	bool isSampled() { return instance_scale != 1.0 || work_scale != 1.0; }
 
 	/*!
 	 * Returns a string representation of this node.
@@ -66,6 +102,10 @@ public:
 	 * @remark Only function regions have a callsite_id. If a region is not a
 	 * function, the match will only be based on the static_id.
 	 *
+	 * @remark This is called on every region entry so it is O(1) on average:
+	 * the last child found is checked first, then a hash table of the
+	 * children if there are enough of them to have one.
+	 *
 	 * @param static_id The static region ID of the child to find.
 	 * @param callsite_id The callsite ID of the child to find. This is ignored if
 	 * the child is not a function region.
@@ -85,11 +125,23 @@ public:
 	 */
 	void addChild(ProfileNode *child); 
 
+	/*!
+	 * Removes all children from this node without deleting them, e.g.
+	 * after they have been moved elsewhere.
+	 */
+	void releaseChildren();
+
 	/*
 	 * Move on to the next ProfileNodeStats for this node. If the stat index for this
 	 * node was already at the end of the list of this node's ProfileNodeStatss, a new
 	 * ProfileNodeStats will be created and appended to the end of the list.
 	 *
+	 * When stats are summarized (see KremlinConfiguration::summarizeStats)
+	 * and the stats memory cap has been reached, no new ProfileNodeStats is
+	 * created: instances at deeper recursion levels are folded into the last
+	 * existing one instead. Every field of a ProfileNodeStats is a count,
+	 * sum, min or max, so the totals over all levels stay exact.
+	 *
 	 * @pre There will be either no ProfileNodeStatss or the curr_stat_index will be -1
 	 * @post The current stat index will be non-negative.
 	 */
@@ -129,12 +181,66 @@ public:
 	 */
 	void handleRecursion(); 
 
+	/*!
+	 * @return The number of nodes that have had stats folded by
+	 * moveToNextStats.
+	 */
+	static unsigned getNumFoldedNodes();
+
+	/*!
+	 * Folds another node (and its subtree) into this one. Stats are merged
+	 * index by index and children are matched by static and callsite ID;
+	 * unmatched children are moved under this node. Every node that gets
+	 * folded away is recorded in merged so that recursion targets pointing
+	 * to it can be redirected afterwards (see redirectRecursionTargets).
+	 *
+	 * @param other The node to fold into this one. It will have no children
+	 * or stats left afterwards and can be deleted.
+	 * @param merged Map from folded-away nodes to the node they became.
+	 * @pre other is non-NULL and is not this node.
+	 * @pre other has the same static ID as this node.
+	 */
+	void mergeFrom(ProfileNode *other, 
+					std::map<ProfileNode*, ProfileNode*> &merged);
+
+	/*!
+	 * Updates recursion targets in this subtree that point to nodes which
+	 * were folded away by mergeFrom.
+	 *
+	 * @param merged Map from folded-away nodes to the node they became.
+	 */
+	void redirectRecursionTargets(std::map<ProfileNode*, ProfileNode*> &merged);
+
 	static void* operator new(size_t size);
 	static void operator delete(void* ptr);
 	
 private:
 	void updateCurrentStats(RegionStats *info);
 	static UInt64 allocId();
+
+	/*!
+	 * @return True if another size bytes of stats can be allocated without
+	 * going over the stats memory cap.
+	 */
+	static bool canAllocateStats(size_t size);
+
+	bool stats_folded; /*!< True if moveToNextStats ever had to fold. */
+
+	bool matches(UInt64 static_id, UInt64 callsite_id) {
+		return this->static_id == static_id
+			&& (this->region_type != RegionFunc 
+				|| this->callsite_id == callsite_id);
+	}
+
+	/*!
+	 * Returns the slot to start probing child_index at for a child with
+	 * the given IDs. Non-function children are hashed with a callsite ID
+	 * of 0 since that is not part of their identity.
+	 */
+	unsigned getChildIndexSlot(UInt64 static_id, UInt64 callsite_id);
+	ProfileNode* findIndexedChild(UInt64 static_id, UInt64 callsite_id);
+	void indexChild(ProfileNode *child);
+	void rebuildChildIndex();
 };
 
 #endif // _PROFILENODE_HPP_
@@ -0,0 +1,70 @@
+#include <cstddef> // for size_t
+#include <cstring> // for memset
+#include "ProfileNodeSketch.hpp"
+#include "ProfileNodeStats.hpp"
+#include "MemMapAllocator.h"
+#include "debug.h"
+
+void* ProfileNodeSketch::operator new(size_t size) {
+	ProfileNodeStats::addMemoryInUse(sizeof(ProfileNodeSketch));
+	return MemPoolAllocSmall(sizeof(ProfileNodeSketch));
+}
+
+void ProfileNodeSketch::operator delete(void *ptr) {
+	ProfileNodeStats::addMemoryInUse(-(Int64)sizeof(ProfileNodeSketch));
+	MemPoolFreeSmall(ptr, sizeof(ProfileNodeSketch));
+}
+
+ProfileNodeSketch::ProfileNodeSketch() : min_work(-1), max_work(0),
+											min_cp(-1), max_cp(0) {
+	memset(buckets, 0, sizeof(buckets));
+}
+
+unsigned ProfileNodeSketch::getBucket(UInt64 value) {
+	if (value == 0) return 0;
+	unsigned bucket = 64 - __builtin_clzll(value);
+	return (bucket < NUM_BUCKETS) ? bucket : NUM_BUCKETS - 1;
+}
+
+void ProfileNodeSketch::addToBucket(Metric metric, unsigned bucket,
+									UInt64 count) {
+	UInt32* counts = buckets[metric];
+	while (counts[bucket] + count > 0xFFFFFFFFULL) {
+		for (unsigned i = 0; i < NUM_BUCKETS; ++i) {
+			counts[i] = (counts[i] + 1) / 2;
+		}
+		count = (count + 1) / 2;
+	}
+	counts[bucket] += count;
+}
+
+void ProfileNodeSketch::add(UInt64 work, UInt64 cp, double self_par) {
+	if (work < min_work) min_work = work;
+	if (work > max_work) max_work = work;
+	if (cp < min_cp) min_cp = cp;
+	if (cp > max_cp) max_cp = cp;
+
+	addToBucket(WORK, getBucket(work), 1);
+	addToBucket(CRITICAL_PATH, getBucket(cp), 1);
+	// self_par is inf or NaN for instances without any self-parallel work
+	UInt64 scaled_par = 0;
+	if (self_par > 1e17) scaled_par = (UInt64)-1;
+	else if (self_par > 0) scaled_par = (UInt64)(self_par * 100.0);
+	addToBucket(SELF_PAR, getBucket(scaled_par), 1);
+}
+
+void ProfileNodeSketch::merge(ProfileNodeSketch *other) {
+	assert(other != NULL);
+
+	if (other->min_work < min_work) min_work = other->min_work;
+	if (other->max_work > max_work) max_work = other->max_work;
+	if (other->min_cp < min_cp) min_cp = other->min_cp;
+	if (other->max_cp > max_cp) max_cp = other->max_cp;
+
+	for (unsigned m = 0; m < NUM_METRICS; ++m) {
+		for (unsigned i = 0; i < NUM_BUCKETS; ++i) {
+			if (other->buckets[m][i] > 0)
+				addToBucket((Metric)m, i, other->buckets[m][i]);
+		}
+	}
+}
@@ -0,0 +1,65 @@
+#ifndef _PROFILENODESKETCH_HPP_
+#define _PROFILENODESKETCH_HPP_
+
+#include "ktypes.h"
+
+/*!
+ * @brief Fixed-size summary of the distribution of per-instance work,
+ * critical path length and self-parallelism of a profiled region.
+ *
+ * Each metric is kept as a histogram with power-of-two buckets: bucket 0
+ * counts zeros and bucket b > 0 counts values in [2^(b-1), 2^b), with
+ * everything larger landing in the last bucket. That is enough to estimate
+ * any quantile to within a factor of two no matter how many instances
+ * there are. Self-parallelism is recorded times 100, like in the profile.
+ */
+class ProfileNodeSketch {
+public:
+	enum Metric { WORK, CRITICAL_PATH, SELF_PAR, NUM_METRICS };
+	static const unsigned NUM_BUCKETS = 32;
+
+	UInt64 min_work; //!< Minimum work in any instance.
+	UInt64 max_work; //!< Maximum work in any instance.
+	UInt64 min_cp; //!< Minimum critical path length in any instance.
+	UInt64 max_cp; //!< Maximum critical path length in any instance.
+
+	/*!
+	 * Bucket counts. When a bucket would overflow, all buckets of that
+	 * metric are halved, which roughly keeps the shape of the
+	 * distribution.
+	 */
+	UInt32 buckets[NUM_METRICS][NUM_BUCKETS];
+
+	ProfileNodeSketch();
+	~ProfileNodeSketch() {}
+
+	/*!
+	 * Records one instance.
+	 *
+	 * @param work The instance's work.
+	 * @param cp The instance's critical path length.
+	 * @param self_par The instance's self-parallelism.
+	 */
+	void add(UInt64 work, UInt64 cp, double self_par);
+
+	/*!
+	 * Folds another sketch (e.g. from another thread) into this one.
+	 *
+	 * @param other The sketch to fold into this one.
+	 * @pre other is non-NULL.
+	 */
+	void merge(ProfileNodeSketch *other);
+
+	/*!
+	 * @return The bucket that value is counted in.
+	 */
+	static unsigned getBucket(UInt64 value);
+
+	static void* operator new(size_t size);
+	static void operator delete(void *ptr);
+
+private:
+	void addToBucket(Metric metric, unsigned bucket, UInt64 count);
+};
+
+#endif // _PROFILENODESKETCH_HPP_
@@ -1,11 +1,82 @@
+#include <cassert>
 #include <cstddef> // for size_t and
 #include "ProfileNodeStats.hpp"
 #include "MemMapAllocator.h"
+#include "debug.h"
+
+static volatile Int64 memory_in_use = 0;
+
+UInt64 ProfileNodeStats::getMemoryInUse() { return memory_in_use; }
+
+void ProfileNodeStats::addMemoryInUse(Int64 bytes) {
+	__sync_add_and_fetch(&memory_in_use, bytes);
+}
 
 void* ProfileNodeStats::operator new(size_t size) {
+	addMemoryInUse(sizeof(ProfileNodeStats));
 	return MemPoolAllocSmall(sizeof(ProfileNodeStats));
 }
 
 void ProfileNodeStats::operator delete(void *ptr) {
+	addMemoryInUse(-(Int64)sizeof(ProfileNodeStats));
 	MemPoolFreeSmall(ptr, sizeof(ProfileNodeStats));
 }
+
+void ProfileNodeStats::merge(ProfileNodeStats *other) {
+	assert(other != NULL);
+
+	total_work += other->total_work;
+	self_par_per_work += other->self_par_per_work;
+	total_par_per_work += other->total_par_per_work;
+	num_dynamic_child_regions += other->num_dynamic_child_regions;
+	num_instances += other->num_instances;
+
+	// min_self_par starts out as -1 to indicate it hasn't been set
+	if (min_self_par < 0 
+		|| (other->min_self_par >= 0 && other->min_self_par < min_self_par))
+		min_self_par = other->min_self_par;
+	if (max_self_par < other->max_self_par) 
+		max_self_par = other->max_self_par;
+
+	if (min_dynamic_child_regions > other->min_dynamic_child_regions)
+		min_dynamic_child_regions = other->min_dynamic_child_regions;
+	if (max_dynamic_child_regions < other->max_dynamic_child_regions)
+		max_dynamic_child_regions = other->max_dynamic_child_regions;
+
+#ifdef EXTRA_STATS
+	readCnt += other->readCnt;
+	writeCnt += other->writeCnt;
+	loadCnt += other->loadCnt;
+	storeCnt += other->storeCnt;
+#endif
+}
+
+void ProfileNodeStats::addConcurrentChild(ProfileNodeStats *child) {
+	assert(child != NULL);
+	assert(num_instances == 1);
+
+	// self_par_per_work is work / self-parallelism, where self-parallelism
+	// is (work - children's work + children's cp) / cp (see
+	// handleRegionExit). Undo that to get the serialized length, add the
+	// child's cp to it and recompute with the new work and cp.
+	double cp = (double)total_par_per_work;
+	double serial_len = (self_par_per_work > 0) 
+						? (double)total_work * cp / self_par_per_work : cp;
+
+	total_work += child->total_work;
+	serial_len += child->total_par_per_work;
+	if (child->total_par_per_work > total_par_per_work)
+		total_par_per_work = child->total_par_per_work;
+	cp = (double)total_par_per_work;
+
+	if (cp > 0 && serial_len > 0) {
+		double self_par = serial_len / cp;
+		self_par_per_work = (UInt64)(total_work / self_par);
+		if (self_par_per_work > total_work) self_par_per_work = total_work;
+		min_self_par = max_self_par = self_par;
+	}
+
+	num_dynamic_child_regions += child->num_instances;
+	min_dynamic_child_regions = num_dynamic_child_regions;
+	max_dynamic_child_regions = num_dynamic_child_regions;
+}
@@ -37,6 +37,40 @@ public:
 				max_dynamic_child_regions(0), num_instances(0) {}
 	~ProfileNodeStats() {}
 
+	/*!
+	 * Folds another set of stats (e.g. from another thread) into this one.
+	 *
+	 * @param other The stats to fold into this one.
+	 * @pre other is non-NULL.
+	 */
+	void merge(ProfileNodeStats *other);
+
+	/*!
+	 * Adds a child that ran concurrently with this region rather than
+	 * inside its critical path (e.g. the top region of another thread).
+	 * The child's work is added and its critical path counts toward the
+	 * self-parallelism like any other child's, but the critical path of
+	 * this region only grows if the child's is longer.
+	 *
+	 * @param child The stats of the concurrent child.
+	 * @pre child is non-NULL.
+	 * @pre These stats are for a single instance.
+	 */
+	void addConcurrentChild(ProfileNodeStats *child);
+
+	/*!
+	 * @return Number of bytes currently allocated for ProfileNodeStats and
+	 * ProfileNodeSketch objects, across all threads.
+	 */
+	static UInt64 getMemoryInUse();
+
+	/*!
+	 * Adjusts the number returned by getMemoryInUse.
+	 *
+	 * @param bytes Number of bytes allocated (or freed, if negative).
+	 */
+	static void addMemoryInUse(Int64 bytes);
+
 	static void* operator new(size_t size);
 	static void operator delete(void *ptr);
 };
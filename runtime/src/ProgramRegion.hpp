@@ -1,36 +1,141 @@
 #ifndef PROGRAM_REGION_H
 #define PROGRAM_REGION_H
 
+#include <vector>
 #include "ktypes.h"
+#include "PoolAllocator.hpp"
 
-class ProgramRegion {
-  private:
-	static const UInt32 ERROR_CHECK_CODE = 0xDEADBEEF;
+/*!
+ * @brief The state of the program regions at every level, stored as one
+ * array per field (indexed by level) rather than as an array of objects.
+ *
+ * Every timestamp update touches the critical path length of each
+ * instrumented level, so keeping those in one dense array lets that update
+ * be a vectorized max rather than a pointer chase per level. Use
+ * ProgramRegion for convenient access to all fields of one level.
+ */
+class ProgramRegionTable {
+private:
+	template <typename T>
+	struct LevelArray {
+		typedef std::vector<T, MPoolLib::PoolAllocator<T> > Type;
+	};
+
+public:
+	LevelArray<SID>::Type region_ids;
+	LevelArray<RegionType>::Type region_types;
+	LevelArray<Version>::Type versions;
+	LevelArray<Time>::Type starts;
+	LevelArray<Time>::Type cps;
+	LevelArray<Time>::Type children_work;
+	LevelArray<Time>::Type children_cp;
+	LevelArray<Time>::Type child_max_cps;
+	LevelArray<UInt64>::Type child_counts;
+#ifdef EXTRA_STATS
+	LevelArray<UInt64>::Type load_counts;
+	LevelArray<UInt64>::Type store_counts;
+	LevelArray<UInt64>::Type read_counts;
+	LevelArray<UInt64>::Type write_counts;
+	LevelArray<UInt64>::Type read_line_counts;
+	LevelArray<UInt64>::Type write_line_counts;
+#endif
+
+	unsigned size() { return cps.size(); }
+	bool empty() { return cps.empty(); }
+
+	/*!
+	 * Adds num_new levels, all zeroed.
+	 * @remark This may move the arrays so it invalidates any ProgramRegion
+	 * or pointer into the table.
+	 */
+	void grow(unsigned num_new) {
+		unsigned new_size = size() + num_new;
+		region_ids.resize(new_size, 0);
+		region_types.resize(new_size, RegionFunc);
+		versions.resize(new_size, 0);
+		starts.resize(new_size, 0);
+		cps.resize(new_size, 0);
+		children_work.resize(new_size, 0);
+		children_cp.resize(new_size, 0);
+		child_max_cps.resize(new_size, 0);
+		child_counts.resize(new_size, 0);
+#ifdef EXTRA_STATS
+		load_counts.resize(new_size, 0);
+		store_counts.resize(new_size, 0);
+		read_counts.resize(new_size, 0);
+		write_counts.resize(new_size, 0);
+		read_line_counts.resize(new_size, 0);
+		write_line_counts.resize(new_size, 0);
+#endif
+	}
+
+	void clear() {
+		region_ids.clear();
+		region_types.clear();
+		versions.clear();
+		starts.clear();
+		cps.clear();
+		children_work.clear();
+		children_cp.clear();
+		child_max_cps.clear();
+		child_counts.clear();
+#ifdef EXTRA_STATS
+		load_counts.clear();
+		store_counts.clear();
+		read_counts.clear();
+		write_counts.clear();
+		read_line_counts.clear();
+		write_line_counts.clear();
+#endif
+	}
+};
 
+/*!
+ * @brief A view of the region at one level of a ProgramRegionTable.
+ *
+ * Each member refers to that level's entry in the table, so a ProgramRegion
+ * can be used like the region itself. It must not be kept across a call
+ * that grows the table.
+ */
+class ProgramRegion {
   public:
-	UInt32 code;
-	Version version;
-	SID	regionId;
-	RegionType regionType;
-	Time start;
-	Time cp;
-	Time childrenWork;
-	Time childrenCP;
-	Time childMaxCP;
-	UInt64 childCount;
+	SID& regionId;
+	RegionType& regionType;
+	Version& version;
+	Time& start;
+	Time& cp;
+	Time& childrenWork;
+	Time& childrenCP;
+	Time& childMaxCP;
+	UInt64& childCount;
 #ifdef EXTRA_STATS
-	UInt64 loadCnt;
-	UInt64 storeCnt;
-	UInt64 readCnt;
-	UInt64 writeCnt;
-	UInt64 readLineCnt;
-	UInt64 writeLineCnt;
+	UInt64& loadCnt;
+	UInt64& storeCnt;
+	UInt64& readCnt;
+	UInt64& writeCnt;
+	UInt64& readLineCnt;
+	UInt64& writeLineCnt;
 #endif
 
-	ProgramRegion() : code(ProgramRegion::ERROR_CHECK_CODE), version(0), regionId(0), 
-				regionType(RegionFunc), start(0), cp(0), 
-				childrenWork(0), childrenCP(0), childMaxCP(0), 
-				childCount(0) {}
+	ProgramRegion(ProgramRegionTable& table, Level level) :
+		regionId(table.region_ids[level]),
+		regionType(table.region_types[level]),
+		version(table.versions[level]),
+		start(table.starts[level]),
+		cp(table.cps[level]),
+		childrenWork(table.children_work[level]),
+		childrenCP(table.children_cp[level]),
+		childMaxCP(table.child_max_cps[level]),
+		childCount(table.child_counts[level])
+#ifdef EXTRA_STATS
+		, loadCnt(table.load_counts[level]),
+		storeCnt(table.store_counts[level]),
+		readCnt(table.read_counts[level]),
+		writeCnt(table.write_counts[level]),
+		readLineCnt(table.read_line_counts[level]),
+		writeLineCnt(table.write_line_counts[level])
+#endif
+		{}
 
 	void init(SID sid, RegionType regionType, Level level, Time start_time) {
 		regionId = sid;
@@ -50,12 +155,6 @@ class ProgramRegion {
 		writeLineCnt = 0LL;
 #endif
 	}
-
-	void sanityCheck() {
-		assert(code == ProgramRegion::ERROR_CHECK_CODE);
-	}
-
-	void updateCriticalPathLength(Timestamp value);
 };
 
 #endif
@@ -0,0 +1,129 @@
+#ifndef REGISTER_FRAME_ARENA_HPP
+#define REGISTER_FRAME_ARENA_HPP
+
+#include <cstdlib> // for malloc/calloc/free
+#include <vector>
+#include "ktypes.h"
+#include "debug.h"
+#include "PoolAllocator.hpp"
+
+/*!
+ * @brief Stack-discipline allocator for the timestamp and version stamp
+ * arrays of shadow register tables.
+ *
+ * Function regions are strictly nested, so their register tables can be
+ * carved out of a few large chunks with a bump pointer and released by
+ * resetting that pointer on function exit. Chunks are kept around once
+ * allocated so steady-state calls never touch malloc.
+ *
+ * Times and version stamps live in separate, parallel chunks so that stamp
+ * memory only ever holds stamps: fresh stamps are zero and reused ones were
+ * issued before the frame was allocated. Times are not cleared at all;
+ * callers are responsible for clearing whatever part of them will be read
+ * before being written.
+ */
+class RegisterFrameArena {
+public:
+	/*!
+	 * Position of the arena's top, as returned by getTop(). Releasing to a
+	 * mark frees everything allocated after it was taken.
+	 */
+	struct Mark {
+		unsigned chunk;
+		size_t offset;
+	};
+
+private:
+	// Number of entries in a regular chunk (512KB each of times and stamps).
+	static const size_t CHUNK_SIZE = 1 << 16;
+
+	struct Chunk {
+		Time* times;
+		Version* versions;
+		size_t size;
+	};
+
+	std::vector<Chunk, MPoolLib::PoolAllocator<Chunk> > chunks;
+	unsigned curr_chunk; //!< Index into chunks of the chunk being used.
+	size_t curr_offset; //!< Number of timestamps used in the current chunk.
+
+	/*!
+	 * Moves the top to the first chunk after the current one that can hold
+	 * num_entries entries, allocating a new chunk if none can.
+	 */
+	void advanceChunk(size_t num_entries) {
+		unsigned next = chunks.empty() ? 0 : curr_chunk + 1;
+		while (next < chunks.size() && chunks[next].size < num_entries) {
+			++next;
+		}
+
+		if (next == chunks.size()) {
+			Chunk c;
+			c.size = (num_entries > CHUNK_SIZE) ? num_entries : CHUNK_SIZE;
+			c.times = (Time*)malloc(c.size * sizeof(Time));
+			c.versions = (Version*)calloc(c.size, sizeof(Version));
+			if (c.times == NULL || c.versions == NULL) {
+				fprintf(stderr, "[kremlin] ERROR: could not allocate shadow register frame of %zu entries\n", c.size);
+				assert(0);
+				exit(1);
+			}
+			chunks.push_back(c);
+			MSG(1, "RegisterFrameArena: new chunk %u of %zu entries\n",
+				next, c.size);
+		}
+
+		curr_chunk = next;
+		curr_offset = 0;
+	}
+
+public:
+	RegisterFrameArena() : curr_chunk(0), curr_offset(0) {}
+
+	~RegisterFrameArena() {
+		for (unsigned i = 0; i < chunks.size(); ++i) {
+			free(chunks[i].times);
+			free(chunks[i].versions);
+		}
+	}
+
+	Mark getTop() {
+		Mark m;
+		m.chunk = curr_chunk;
+		m.offset = curr_offset;
+		return m;
+	}
+
+	/*!
+	 * Allocates num_entries timestamps and as many version stamps on top
+	 * of the arena.
+	 *
+	 * @param[out] versions Set to the version stamps.
+	 * @return Pointer to the timestamps, which are not cleared.
+	 */
+	Time* alloc(size_t num_entries, Version*& versions) {
+		if (chunks.empty()
+			|| curr_offset + num_entries > chunks[curr_chunk].size) {
+			advanceChunk(num_entries);
+		}
+
+		Chunk& c = chunks[curr_chunk];
+		Time* ret = c.times + curr_offset;
+		versions = c.versions + curr_offset;
+		curr_offset += num_entries;
+		return ret;
+	}
+
+	/*!
+	 * Frees everything allocated since mark was taken.
+	 *
+	 * @pre mark is at or below the current top.
+	 */
+	void release(Mark mark) {
+		assert(mark.chunk < curr_chunk
+			|| (mark.chunk == curr_chunk && mark.offset <= curr_offset));
+		curr_chunk = mark.chunk;
+		curr_offset = mark.offset;
+	}
+};
+
+#endif // REGISTER_FRAME_ARENA_HPP
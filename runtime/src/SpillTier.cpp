@@ -0,0 +1,253 @@
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <fcntl.h> // for open
+#include <sys/mman.h> // for mmap
+#include <unistd.h> // for ftruncate, unlink
+
+#include "SpillTier.hpp"
+#include "LevelTable.hpp"
+#include "MShadowStat.h" // for TimeTable memory accounting
+#include "debug.h"
+
+SpillTier::SpillTier() : fd(-1), map(NULL), map_size(0), file_end(0),
+							num_resident(0), resident_bytes(0),
+							resident_limit(0), num_spills(0),
+							num_fetches(0), bytes_spilled(0),
+							max_file_end(0) {}
+
+void SpillTier::init(const char *dir, UInt64 resident_limit) {
+	std::string path(dir);
+	path.append("/kremlin-spill-XXXXXX");
+
+	fd = mkstemp(&path[0]);
+	if (fd == -1) {
+		fprintf(stderr, "[kremlin] ERROR: could not create spill file in %s\n", dir);
+		assert(0);
+		exit(1);
+	}
+	unlink(path.c_str());
+
+	this->resident_limit = resident_limit;
+	MSG(1, "SpillTier: spilling past %llu bytes to %s\n",
+		resident_limit, path.c_str());
+}
+
+void SpillTier::deinit() {
+	if (num_spills > 0) {
+		fprintf(stderr, "[kremlin] Spill tier: %llu tables spilled (%.1f MB), %llu read back, file peaked at %.1f MB\n",
+			(unsigned long long)num_spills, bytes_spilled / 1048576.0, 
+			(unsigned long long)num_fetches,
+			max_file_end / 1048576.0);
+	}
+
+	if (map != NULL) munmap(map, map_size);
+	map = NULL;
+	map_size = 0;
+	if (fd != -1) close(fd);
+	fd = -1;
+
+	cold_tables.clear();
+	free_by_offset.clear();
+	free_by_size.clear();
+}
+
+bool SpillTier::isResident(const std::pair<LevelTable*, UInt32>& entry) {
+	LevelTable *table = entry.first;
+	return table->isCompressed() && !table->isSpilled()
+			&& table->getSpillSeq() == entry.second;
+}
+
+void SpillTier::add(LevelTable *table) {
+	assert(table != NULL);
+	assert(table->isCompressed());
+	assert(!table->isSpilled());
+
+	UInt64 size = table->getCompressedSize();
+	if (size == 0) return; // nothing to spill
+
+	table->setSpillSeq(table->getSpillSeq() + 1);
+	cold_tables.push_back(std::make_pair(table, table->getSpillSeq()));
+	num_resident++;
+	resident_bytes += size;
+
+	while (resident_bytes > resident_limit && num_resident > 0)
+		spillColdest();
+
+	if (cold_tables.size() > 2 * num_resident + 1024)
+		compact();
+}
+
+void SpillTier::fetch(LevelTable *table) {
+	assert(table != NULL);
+	assert(table->isCompressed());
+
+	UInt64 size = table->getCompressedSize();
+
+	if (!table->isSpilled()) {
+		// Its entry in cold_tables is stale once it is decompressed.
+		if (size > 0) {
+			num_resident--;
+			resident_bytes -= size;
+		}
+		return;
+	}
+
+	UInt64 offset = table->getSpillOffset();
+	table->unspill(map + offset);
+	freeExtent(offset, size);
+	increaseTimeTableMemSize(size);
+	num_fetches++;
+}
+
+void SpillTier::remove(LevelTable *table) {
+	assert(table != NULL);
+	assert(table->isCompressed());
+
+	UInt64 size = table->getCompressedSize();
+
+	if (!table->isSpilled()) {
+		if (size > 0) {
+			num_resident--;
+			resident_bytes -= size;
+			// it stays compressed, so its entry has to be told apart
+			table->setSpillSeq(table->getSpillSeq() + 1);
+		}
+		return;
+	}
+
+	freeExtent(table->getSpillOffset(), size);
+	table->discardSpilled();
+	// deleting the TimeTables counts their compressed size as freed again
+	increaseTimeTableMemSize(size);
+}
+
+void SpillTier::setResidentLimit(UInt64 limit) {
+	resident_limit = limit;
+	while (resident_bytes > resident_limit && num_resident > 0)
+		spillColdest();
+}
+
+void SpillTier::spillColdest() {
+	while (!isResident(cold_tables.front()))
+		cold_tables.pop_front();
+
+	LevelTable *table = cold_tables.front().first;
+	cold_tables.pop_front();
+	num_resident--;
+
+	UInt64 size = table->getCompressedSize();
+	UInt64 offset = allocExtent(size);
+	table->spill(map + offset, offset);
+	resident_bytes -= size;
+	decreaseTimeTableMemSize(size);
+
+	num_spills++;
+	bytes_spilled += size;
+}
+
+void SpillTier::compact() {
+	std::deque<std::pair<LevelTable*, UInt32> > live;
+	for (unsigned i = 0; i < cold_tables.size(); ++i) {
+		if (isResident(cold_tables[i]))
+			live.push_back(cold_tables[i]);
+	}
+	cold_tables.swap(live);
+	assert(cold_tables.size() == num_resident);
+}
+
+UInt64 SpillTier::allocExtent(UInt64 size) {
+	size = (size + SPILL_ALIGN - 1) & ~(SPILL_ALIGN - 1);
+
+	// best fit among the free extents
+	std::multimap<UInt64, UInt64>::iterator fit = free_by_size.lower_bound(size);
+	if (fit != free_by_size.end()) {
+		UInt64 offset = fit->second;
+		UInt64 extent_size = fit->first;
+		removeFreeExtent(free_by_offset.find(offset));
+		if (extent_size > size) {
+			free_by_offset[offset + size] = extent_size - size;
+			free_by_size.insert(std::make_pair(extent_size - size,
+												offset + size));
+		}
+		return offset;
+	}
+
+	if (file_end + size > map_size)
+		grow(file_end + size);
+
+	UInt64 offset = file_end;
+	file_end += size;
+	if (file_end > max_file_end) max_file_end = file_end;
+	return offset;
+}
+
+void SpillTier::freeExtent(UInt64 offset, UInt64 size) {
+	size = (size + SPILL_ALIGN - 1) & ~(SPILL_ALIGN - 1);
+
+	// merge with the free extents on either side
+	std::map<UInt64, UInt64>::iterator next = free_by_offset.lower_bound(offset);
+	if (next != free_by_offset.begin()) {
+		std::map<UInt64, UInt64>::iterator prev = next;
+		--prev;
+		if (prev->first + prev->second == offset) {
+			offset = prev->first;
+			size += prev->second;
+			removeFreeExtent(prev);
+		}
+	}
+	if (next != free_by_offset.end() && offset + size == next->first) {
+		size += next->second;
+		removeFreeExtent(next);
+	}
+
+	if (offset + size == file_end) {
+		file_end = offset;
+		return;
+	}
+
+	free_by_offset[offset] = size;
+	free_by_size.insert(std::make_pair(size, offset));
+}
+
+void SpillTier::removeFreeExtent(std::map<UInt64, UInt64>::iterator it) {
+	assert(it != free_by_offset.end());
+
+	std::pair<std::multimap<UInt64, UInt64>::iterator,
+				std::multimap<UInt64, UInt64>::iterator> range
+		= free_by_size.equal_range(it->second);
+	for (std::multimap<UInt64, UInt64>::iterator s = range.first;
+			s != range.second; ++s) {
+		if (s->second == it->first) {
+			free_by_size.erase(s);
+			break;
+		}
+	}
+	free_by_offset.erase(it);
+}
+
+void SpillTier::grow(UInt64 min_size) {
+	UInt64 new_size = map_size * 2;
+	if (new_size < MIN_FILE_SIZE) new_size = MIN_FILE_SIZE;
+	while (new_size < min_size) new_size *= 2;
+
+	// Nothing keeps pointers into the map, so it can simply be remapped.
+	if (map != NULL) munmap(map, map_size);
+	if (ftruncate(fd, new_size) != 0) {
+		fprintf(stderr, "[kremlin] ERROR: could not grow spill file to %llu bytes\n",
+			(unsigned long long)new_size);
+		assert(0);
+		exit(1);
+	}
+
+	map = (UInt8*)mmap(NULL, new_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+						fd, 0);
+	if (map == MAP_FAILED) {
+		fprintf(stderr, "[kremlin] ERROR: could not map spill file of %llu bytes\n",
+			(unsigned long long)new_size);
+		assert(0);
+		exit(1);
+	}
+	map_size = new_size;
+	MSG(1, "SpillTier: grew file to %llu bytes\n", new_size);
+}
@@ -0,0 +1,120 @@
+#ifndef _SPILLTIER_HPP_
+#define _SPILLTIER_HPP_
+
+#include <deque>
+#include <map>
+#include <utility> // for std::pair
+#include "ktypes.h"
+
+class LevelTable;
+
+/*!
+ * @brief Keeps cold compressed LevelTables in a scratch file.
+ *
+ * Tables evicted from the compression buffer are handed to the tier once
+ * they have been compressed. Once the compressed TimeTables held in memory
+ * pass a threshold, those of the tables compressed longest ago are copied
+ * into a memory-mapped file and freed. The kernel can then write them out
+ * and reclaim their pages like any other file data.
+ *
+ * Space in the file is handed out in SPILL_ALIGN byte units from a map of
+ * free extents (best fit, coalesced on free), and the file grows when none
+ * is large enough. The file is unlinked as soon as it is created so it goes
+ * away with the process.
+ */
+class SpillTier {
+public:
+	SpillTier();
+	~SpillTier() {}
+
+	/*!
+	 * Creates the scratch file.
+	 *
+	 * @param dir Directory to create the file in.
+	 * @param resident_limit Bytes of compressed tables to keep in memory.
+	 */
+	void init(const char *dir, UInt64 resident_limit);
+
+	/*!
+	 * Unmaps and closes the scratch file and reports how much was spilled.
+	 * Spilled tables keep only their metadata; they must not be unspilled
+	 * afterwards.
+	 */
+	void deinit();
+
+	/*!
+	 * Takes a table that was just compressed, spilling older tables if
+	 * that puts too many compressed bytes in memory.
+	 *
+	 * @param table The table that was compressed.
+	 * @pre table is non-NULL, compressed and not spilled.
+	 */
+	void add(LevelTable *table);
+
+	/*!
+	 * Takes a compressed table back out of the tier before it is
+	 * decompressed, reading it back in from the file if it was spilled.
+	 *
+	 * @param table The table about to be decompressed.
+	 * @pre table is non-NULL and compressed.
+	 */
+	void fetch(LevelTable *table);
+
+	/*!
+	 * Takes a compressed table out of the tier without reading it back, for
+	 * when its TimeTables are about to be deleted. Its space in the file is
+	 * freed.
+	 *
+	 * @param table The table whose TimeTables are going away.
+	 * @pre table is non-NULL and compressed.
+	 */
+	void remove(LevelTable *table);
+
+	UInt64 getResidentLimit() { return resident_limit; }
+
+	/*!
+	 * Changes how many bytes of compressed tables are kept in memory,
+	 * spilling tables right away if needed.
+	 */
+	void setResidentLimit(UInt64 limit);
+
+private:
+	static const UInt64 SPILL_ALIGN = 64;
+	static const UInt64 MIN_FILE_SIZE = 64 << 20;
+
+	int fd;
+	UInt8 *map; //!< The whole file, mapped shared
+	UInt64 map_size;
+	UInt64 file_end; //!< Everything from here on is free
+
+	std::map<UInt64, UInt64> free_by_offset; //!< offset -> size
+	std::multimap<UInt64, UInt64> free_by_size; //!< size -> offset
+
+	/*!
+	 * Compressed tables held in memory, oldest first, each with the
+	 * sequence number it had when it was added. Tables decompressed since
+	 * are left in place and skipped when they reach the front; their
+	 * number no longer matches (or they are no longer compressed).
+	 */
+	std::deque<std::pair<LevelTable*, UInt32> > cold_tables;
+	UInt64 num_resident; //!< Entries in cold_tables that are still valid
+
+	UInt64 resident_bytes; //!< Compressed bytes of tables in cold_tables
+	UInt64 resident_limit;
+
+	UInt64 num_spills;
+	UInt64 num_fetches; //!< Tables read back in from the file
+	UInt64 bytes_spilled;
+	UInt64 max_file_end;
+
+	bool isResident(const std::pair<LevelTable*, UInt32>& entry);
+	void spillColdest();
+	void compact();
+
+	UInt64 allocExtent(UInt64 size);
+	void freeExtent(UInt64 offset, UInt64 size);
+	void removeFreeExtent(std::map<UInt64, UInt64>::iterator it);
+	void grow(UInt64 min_size);
+};
+
+#endif // _SPILLTIER_HPP_
@@ -6,28 +6,66 @@
 #include "MemMapAllocator.h"
 
 #include <cstdlib> // for calloc
+#include <cstring> // for memset, memcpy
 
 class Table {
 private:
 	int	row;
 	int col;
 	Time* array;
+	Version* versions; // version stamp of each entry, or NULL if not versioned
+	bool owns_array; // false if array belongs to someone else (e.g. an arena)
 
 	inline int getOffset(int row, int col);
 
 public:
 
-	Table(int row, int col) : row(row), col(col) {
+	Table(int row, int col) : row(row), col(col), versions(NULL), 
+								owns_array(true) {
 		// TRICKY: time array should be initialized with zero
 		this->array = (Time*) calloc(row * col, sizeof(Time)); // TODO: use custom mem allocator
 		MSG(3, "TableCreate: this = 0x%llx row = %d, col = %d\n", this, row, col);
 		MSG(3, "TableCreate: this->array = 0x%llx \n", this->array);
 	}
 
+	/*!
+	 * Creates an empty table that doesn't own any storage. Use attach to
+	 * give it some.
+	 */
+	Table() : row(0), col(0), array(NULL), versions(NULL), 
+				owns_array(false) {}
+
 	~Table() {
-		free(this->array);
+		if (owns_array) free(this->array);
 	}
 
+	/*!
+	 * Makes this table use the given row * col arrays of times and version
+	 * stamps, which it does not take ownership of. Neither is cleared.
+	 *
+	 * An entry of a versioned table is only valid if its stamp matches the
+	 * current version of its column (i.e. of the region at that level);
+	 * getValidRow and getValidValue read stale entries as 0.
+	 *
+	 * @pre This table doesn't own its current array.
+	 */
+	void attach(int row, int col, Time* array, Version* versions) {
+		assert(!owns_array);
+		this->row = row;
+		this->col = col;
+		this->array = array;
+		this->versions = versions;
+		MSG(3, "TableAttach: this = 0x%llx row = %d, col = %d, array = 0x%llx\n", 
+			this, row, col, array);
+	}
+
+	/*!
+	 * Sets the times in the first num_cols columns of every row to zero.
+	 * Version stamps are left alone, so those times read as 0 whether or
+	 * not their stamps are current.
+	 */
+	inline void zeroLeadingColumns(int num_cols);
+
 	inline int	getRow() { return this->row; }
 	inline int	getCol() { return this->col; }
 
@@ -36,7 +74,31 @@ public:
 	inline void setValue(Time time, int row, int col);
 
 	/*!
-	 * Copy values of a register to another table
+	 * Returns the first num_cols times of a row after setting any stale
+	 * ones to 0, so the row can be read directly.
+	 *
+	 * @param curr_versions Current version of each column.
+	 * @pre This table is versioned.
+	 */
+	inline Time* getValidRow(int row, const Version* curr_versions, 
+								int num_cols);
+
+	/*!
+	 * Marks the first num_cols times of a row as valid, e.g. after they have
+	 * all been written.
+	 *
+	 * @param curr_versions Current version of each column.
+	 * @pre This table is versioned.
+	 */
+	inline void stampRow(int row, const Version* curr_versions, int num_cols);
+
+	inline Time getValidValue(int row, int col, Version curr_version);
+	inline void setValidValue(Time time, int row, int col, 
+								Version curr_version);
+
+	/*!
+	 * Copy values of a register to another table. Version stamps are
+	 * copied along with them if both tables are versioned.
 	 *
 	 * @pre dest_table is non-NULL
 	 * @pre start is less than number of columns in both this table and the
@@ -88,6 +150,58 @@ void Table::setValue(Time time, int row, int col) {
 	this->array[offset] = time;
 }
 
+Time* Table::getValidRow(int row, const Version* curr_versions, 
+							int num_cols) {
+	assert(this->versions != NULL);
+	assert(num_cols <= this->col);
+	int offset = this->getOffset(row, 0);
+	Time* times = &(this->array[offset]);
+	Version* stamps = &(this->versions[offset]);
+
+	// written without branches so it vectorizes
+	for (int i = 0; i < num_cols; ++i) {
+		times[i] = (stamps[i] == curr_versions[i]) ? times[i] : 0;
+		stamps[i] = curr_versions[i];
+	}
+	return times;
+}
+
+void Table::stampRow(int row, const Version* curr_versions, int num_cols) {
+	assert(this->versions != NULL);
+	assert(num_cols <= this->col);
+	if (num_cols == 0) return;
+	int offset = this->getOffset(row, 0);
+	memcpy(&(this->versions[offset]), curr_versions, num_cols * sizeof(Version));
+}
+
+Time Table::getValidValue(int row, int col, Version curr_version) {
+	assert(this->versions != NULL);
+	int offset = this->getOffset(row, col);
+	return (this->versions[offset] == curr_version) ? this->array[offset] : 0;
+}
+
+void Table::setValidValue(Time time, int row, int col, Version curr_version) {
+	assert(this->versions != NULL);
+	int offset = this->getOffset(row, col);
+	this->array[offset] = time;
+	this->versions[offset] = curr_version;
+}
+
+void Table::zeroLeadingColumns(int num_cols) {
+	assert(num_cols <= this->col);
+	if (num_cols <= 0) return;
+
+	if (num_cols == this->col) {
+		memset(this->array, 0, this->row * this->col * sizeof(Time));
+		return;
+	}
+
+	Time* row_start = this->array;
+	for (int r = 0; r < this->row; ++r, row_start += this->col) {
+		memset(row_start, 0, num_cols * sizeof(Time));
+	}
+}
+
 void Table::copyToDest(Table* dest_table, Reg dest_reg, Reg src_reg, 
 						unsigned start, unsigned size) {
 	Table* src_table = this;
@@ -104,6 +218,13 @@ void Table::copyToDest(Table* dest_table, Reg dest_reg, Reg src_reg,
 	Time* srcAddr = src_table->getElementAddr(src_reg, start);
 	Time* destAddr = dest_table->getElementAddr(dest_reg, start);
 	memcpy(destAddr, srcAddr, size * sizeof(Time));
+
+	if (src_table->versions != NULL && dest_table->versions != NULL) {
+		int src_offset = src_table->getOffset(src_reg, start);
+		int dest_offset = dest_table->getOffset(dest_reg, start);
+		memcpy(&(dest_table->versions[dest_offset]), 
+				&(src_table->versions[src_offset]), size * sizeof(Version));
+	}
 }
 
 #endif
@@ -1,4 +1,5 @@
 #include <cassert>
+#include <cstdlib> // for calloc/free
 #include "config.h"
 #include "Table.h"
 #include "TagVectorCache.h"
@@ -26,40 +27,134 @@ Time* TagVectorCache::getData(int index, int offset) {
 	return valueTable->getElementAddr(index*2 + offset, 0);
 }
 
-void TagVectorCache::configure(int new_size_in_mb, int new_depth) {
-	// TODO: make sure we haven't configured before
+void TagVectorCache::configure(int new_size_in_mb, int new_depth, int new_assoc) {
+	assert(tagTable == NULL && valueTable == NULL);
 	const int new_line_size = 8;
 	int new_line_count = new_size_in_mb * 1024 * 1024 / new_line_size;
+	assert(new_assoc == 1 || new_assoc == 2 || new_assoc == 4 || new_assoc == 8);
+	assert(new_assoc <= new_line_count);
+
 	this->size_in_mb = new_size_in_mb;
 	this->line_count = new_line_count;
 	this->line_shift = getFirstOnePosition(new_line_count);
 	this->depth = new_depth;
+	this->assoc = new_assoc;
+	this->assoc_shift = getFirstOnePosition(new_assoc);
+	this->set_count = new_line_count / new_assoc;
+	this->set_shift = getFirstOnePosition(this->set_count);
 
-	MSG(0, "TagVectorCache: size: %d MB, lineNum %d, lineShift %d, depth %d\n", 
-		new_size_in_mb, new_line_count, this->line_shift, this->depth);
+	MSG(0, "TagVectorCache: size: %d MB, lineNum %d, lineShift %d, depth %d, %d-way\n", 
+		new_size_in_mb, new_line_count, this->line_shift, this->depth, new_assoc);
 
-	tagTable = (TagVectorCacheLine*)MemPoolCallocSmall(new_line_count, sizeof(TagVectorCacheLine)); // 64bit granularity
+	tagTable = (TagVectorCacheLine*)calloc(new_line_count, sizeof(TagVectorCacheLine)); // 64bit granularity
 	valueTable = new Table(new_line_count * 2, this->depth);  // 32bit granularity
+	plru = (new_assoc > 1) ? (UInt8*)calloc(this->set_count, sizeof(UInt8)) : NULL;
 
 	MSG(TV_CACHE_DEBUG_LVL, "MShadowCacheInit: value Table created row %d col %d\n", 
 		new_line_count, kremlin_config.getNumProfiledLevels());
 }
 
-int TagVectorCache::getLineIndex(Addr addr) {
+void TagVectorCache::release() {
+	free(tagTable);
+	tagTable = NULL;
+	free(plru);
+	plru = NULL;
+	delete valueTable;
+	valueTable = NULL;
+}
+
+int TagVectorCache::getSetIndex(Addr addr) {
 #if 0
 	int nShift = 3; 	// 8 byte 
 	int ret = (((UInt64)addr) >> nShift) & lineMask;
 	assert(ret >= 0 && ret < lineNum);
 #endif
 	int nShift = 3;	
-	int lineMask = getLineMask();
-	int lineShift = getLineShift();
-	int val0 = (((UInt64)addr) >> nShift) & lineMask;
-	int val1 = (((UInt64)addr) >> (nShift + lineShift)) & lineMask;
+	int setMask = set_count - 1;
+	int val0 = (((UInt64)addr) >> nShift) & setMask;
+	int val1 = (((UInt64)addr) >> (nShift + set_shift)) & setMask;
 	return val0 ^ val1;
 }
 
+int TagVectorCache::getVictimWay(int set) {
+	UInt8 bits = plru[set];
+	int node = 0;
+	int way = 0;
+	for (int i = 0; i < assoc_shift; ++i) {
+		int dir = (bits >> node) & 0x1;
+		way = (way << 1) | dir;
+		node = 2 * node + 1 + dir;
+	}
+	return way;
+}
 
+void TagVectorCache::touch(int set, int way) {
+	UInt8 bits = plru[set];
+	int node = 0;
+	for (int i = assoc_shift - 1; i >= 0; --i) {
+		int dir = (way >> i) & 0x1;
+		// point this node at the other half
+		if (dir) bits &= ~(1 << node);
+		else bits |= (1 << node);
+		node = 2 * node + 1 + dir;
+	}
+	plru[set] = bits;
+}
+
+int TagVectorCache::getLineIndex(Addr addr) {
+	int set = getSetIndex(addr);
+	if (assoc == 1)
+		return set;
+
+	TagVectorCacheLine* lines = &tagTable[set << assoc_shift];
+	int empty = -1;
+	int way;
+	for (way = 0; way < assoc; ++way) {
+		Addr tag = lines[way].tag;
+		if ((((UInt64)tag ^ (UInt64)addr) >> 3) == 0)
+			break;
+		if (tag == NULL && empty < 0)
+			empty = way;
+	}
+
+	if (way == assoc)
+		way = (empty >= 0) ? empty : getVictimWay(set);
+
+	touch(set, way);
+	return (set << assoc_shift) + way;
+}
+
+void TagVectorCache::findLinesInRange(Addr start, Addr end, 
+										std::vector<int>& lines) {
+	if (tagTable == NULL) return;
+
+	UInt64 lo = (UInt64)start & ~(UInt64)0x7;
+	UInt64 hi = (UInt64)end;
+
+	// Past one word per line it is cheaper to check every line.
+	if (((hi - lo) >> 3) >= (UInt64)line_count) {
+		for (int i = 0; i < line_count; ++i) {
+			UInt64 tag = (UInt64)tagTable[i].tag;
+			if (tag != 0 && tag >= lo && tag < hi)
+				lines.push_back(i);
+		}
+		return;
+	}
+
+	for (UInt64 word = lo; word < hi; word += 8) {
+		int first = getSetIndex((Addr)word) << assoc_shift;
+		for (int way = 0; way < assoc; ++way) {
+			TagVectorCacheLine* line = &tagTable[first + way];
+			if (line->tag != NULL && line->isHit((Addr)word))
+				lines.push_back(first + way);
+		}
+	}
+}
+
+void TagVectorCache::emptyLine(int index) {
+	tagTable[index].tag = NULL;
+	tagTable[index].type = TimeTable::TYPE_64BIT;
+}
 
 void TagVectorCache::lookupRead(Addr addr, int type, int* pIndex, TagVectorCacheLine** pLine, int* pOffset, Time** pTArray) {
 	int index = this->getLineIndex(addr);
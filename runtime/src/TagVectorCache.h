@@ -1,34 +1,98 @@
 #ifndef TAG_VECTOR_CACHE_H
 #define TAG_VECTOR_CACHE_H
 
+#include <vector>
 #include "ktypes.h"
 
 class TagVectorCacheLine;
 class Table;
 
-/*! \brief Cache for tag vectors */ 
+/*! \brief Cache for tag vectors
+ *
+ * The cache is split into sets of 1, 2, 4 or 8 lines (ways). An address can
+ * be cached in any way of its set, which is the XOR of two slices of the
+ * address (see getSetIndex) whatever the number of ways. When none of them
+ * holds the address, an empty way or else the tree pseudo-LRU way of the
+ * set is handed out to be evicted and refilled. With 1 way per set this is the
+ * original direct-mapped cache.
+ */
 class TagVectorCache {
 private:
 	int  size_in_mb;
 	int  line_count;
 	int  line_shift;
 	int  depth;
+	int  assoc; //!< Number of ways per set.
+	int  assoc_shift; //!< log2(assoc)
+	int  set_count;
+	int  set_shift; //!< log2(set_count)
+
+	/*!
+	 * Pseudo-LRU tree of each set (NULL if direct-mapped). Bit n is node n
+	 * of an implicit binary tree over the ways (children of n are 2n+1 and
+	 * 2n+2) and points towards the less recently used half.
+	 */
+	UInt8* plru;
+
+	int getSetIndex(Addr addr);
+	int getVictimWay(int set);
+	void touch(int set, int way);
 
 public:
 	TagVectorCacheLine* tagTable;
 	Table* valueTable;
 
+	TagVectorCache() : size_in_mb(0), line_count(0), line_shift(0), depth(0),
+						assoc(1), assoc_shift(0), set_count(0), set_shift(0),
+						plru(NULL), tagTable(NULL), valueTable(NULL) {}
+
 	int getSize() { return size_in_mb; }
 	int getLineCount() { return line_count; }
 	int getLineMask() { return line_count - 1; }
 	int getDepth() { return depth; }
 	int getLineShift() { return line_shift; }
+	int getAssociativity() { return assoc; }
 
 	TagVectorCacheLine* getTag(int index);
 	Time* getData(int index, int offset);
+
+	/*!
+	 * Finds the line that addr should use and marks it as most recently
+	 * used in its set.
+	 *
+	 * @return Index of the line holding addr if there is one, otherwise of
+	 * the line that should be evicted to make room for it.
+	 */
 	int getLineIndex(Addr addr);
 
-	void configure(int size_in_mb, int depth);
+	/*!
+	 * Allocates the tag and value tables. Tables from any previous
+	 * configuration must have been released.
+	 *
+	 * @param size_in_mb Size of the tag table.
+	 * @param depth Number of levels of timestamps per line.
+	 * @param assoc Number of ways per set: 1, 2, 4 or 8.
+	 */
+	void configure(int size_in_mb, int depth, int assoc);
+
+	/*!
+	 * Frees the tag and value tables.
+	 */
+	void release();
+
+	/*!
+	 * Finds every line holding an address in [start, end). Doesn't change
+	 * the replacement order.
+	 *
+	 * @param[out] lines Where to append the indices of those lines.
+	 */
+	void findLinesInRange(Addr start, Addr end, std::vector<int>& lines);
+
+	/*!
+	 * Empties a line, discarding its timestamps.
+	 */
+	void emptyLine(int index);
+
 	void lookupRead(Addr addr, int type, int* pIndex, TagVectorCacheLine** pLine, int* pOffset, Time** pTArray);
 	void lookupWrite(Addr addr, int type, int *pIndex, TagVectorCacheLine** pLine, int* pOffset, Time** pTArray);
 };
@@ -12,16 +12,6 @@ void TimeTable::operator delete(void* ptr) {
 	MemPoolFreeSmall(ptr, sizeof(TimeTable));
 }
 
-unsigned TimeTable::getIndex(Addr addr) {
-	const int WORD_SHIFT = 2;
-	int ret = ((UInt64)addr >> WORD_SHIFT) & TimeTable::TIMETABLE_MASK;
-	if (this->type == TYPE_64BIT) ret >>= 1;
-
-	assert((this->type == TYPE_64BIT && ret < TimeTable::TIMETABLE_SIZE/2) 
-			|| ret < TimeTable::TIMETABLE_SIZE);
-	return ret;
-}
-
 TimeTable::TimeTable(TimeTable::TableType size_type) : type(size_type) {
 	this->array = (Time*)MemPoolAlloc();
 	unsigned size = TimeTable::GetNumEntries(size_type);
@@ -38,7 +28,9 @@ TimeTable::TimeTable(TimeTable::TableType size_type) : type(size_type) {
 TimeTable::~TimeTable() {
 	eventTimeTableFree(this->type, this->size);
 
-	MemPoolFree(this->array);
+	// NULL if the owning LevelTable already freed a compressed array
+	if (this->array != NULL)
+		MemPoolFree(this->array);
 	this->array = NULL;
 }
 
@@ -72,3 +64,59 @@ void TimeTable::setTimeAtAddr(Addr addr,
 		array[index+1] = time;
 	}
 }
+
+void TimeTable::getTimesForRange(Addr start, unsigned num_words, 
+									Time* times) {
+	assert(((UInt64)start & 0x7) == 0);
+	unsigned index = this->getIndex(start);
+
+	if (this->type == TimeTable::TYPE_64BIT) {
+		assert(index + num_words <= TIMETABLE_SIZE/2);
+		memcpy(times, &array[index], sizeof(Time) * num_words);
+		return;
+	}
+
+	// a 64-bit read of a 32-bit table sees the lower half (see getTimeAtAddr)
+	assert(index + num_words * 2 <= TIMETABLE_SIZE);
+	for (unsigned i = 0; i < num_words; ++i) {
+		times[i] = array[index + i*2];
+	}
+}
+
+void TimeTable::setTimesForRange(Addr start, unsigned num_words, 
+									const Time* times) {
+	assert(((UInt64)start & 0x7) == 0);
+	unsigned index = this->getIndex(start);
+
+	if (this->type == TimeTable::TYPE_64BIT) {
+		assert(index + num_words <= TIMETABLE_SIZE/2);
+		memcpy(&array[index], times, sizeof(Time) * num_words);
+		return;
+	}
+
+	assert(index + num_words * 2 <= TIMETABLE_SIZE);
+	for (unsigned i = 0; i < num_words; ++i) {
+		array[index + i*2] = times[i];
+		array[index + i*2 + 1] = times[i];
+	}
+}
+
+void TimeTable::fillTimeForRange(Addr start, unsigned num_words, Time time) {
+	assert(((UInt64)start & 0x7) == 0);
+	unsigned index = this->getIndex(start);
+
+	if (this->type == TimeTable::TYPE_64BIT) {
+		assert(index + num_words <= TIMETABLE_SIZE/2);
+		Time* dest = &array[index];
+		for (unsigned i = 0; i < num_words; ++i) {
+			dest[i] = time;
+		}
+		return;
+	}
+
+	assert(index + num_words * 2 <= TIMETABLE_SIZE);
+	Time* dest = &array[index];
+	for (unsigned i = 0; i < num_words * 2; ++i) {
+		dest[i] = time;
+	}
+}
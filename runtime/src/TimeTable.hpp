@@ -1,6 +1,7 @@
 #ifndef _TIMETABLE_HPP_
 #define _TIMETABLE_HPP_
 
+#include <cassert>
 #include <cstddef> // for size_t
 #include <cstring>
 
@@ -59,6 +60,33 @@ public:
 	 */
 	void setTimeAtAddr(Addr addr, Time time, TableType access_type);
 
+	/*!
+	 * Copies the timestamps of consecutive 64-bit words into times.
+	 *
+	 * @param start The address of the first word, 8-byte aligned.
+	 * @param num_words The number of words, all of them in this table.
+	 * @param[out] times Where to put the num_words timestamps.
+	 */
+	void getTimesForRange(Addr start, unsigned num_words, Time* times);
+
+	/*!
+	 * Sets the timestamps of consecutive 64-bit words.
+	 *
+	 * @param start The address of the first word, 8-byte aligned.
+	 * @param num_words The number of words, all of them in this table.
+	 * @param times The num_words new timestamps.
+	 */
+	void setTimesForRange(Addr start, unsigned num_words, const Time* times);
+
+	/*!
+	 * Sets the timestamps of consecutive 64-bit words to the same value.
+	 *
+	 * @param start The address of the first word, 8-byte aligned.
+	 * @param num_words The number of words, all of them in this table.
+	 * @param time The new timestamp.
+	 */
+	void fillTimeForRange(Addr start, unsigned num_words, Time time);
+
 	/*!
 	 * @brief Construct a 32-bit version of this 64-bit TimeTable.
 	 *
@@ -89,7 +117,15 @@ public:
 	 * @post The index returned is less than TIMETABLE_SIZE (for 32-bit) or
 	 * TIMETABLE_SIZE/2 (for 64-bit)
 	 */
-	unsigned getIndex(Addr addr);
+	unsigned getIndex(Addr addr) {
+		const int WORD_SHIFT = 2;
+		unsigned ret = ((UInt64)addr >> WORD_SHIFT) & TimeTable::TIMETABLE_MASK;
+		if (this->type == TYPE_64BIT) ret >>= 1;
+
+		assert((this->type == TYPE_64BIT && ret < TimeTable::TIMETABLE_SIZE/2) 
+				|| ret < TimeTable::TIMETABLE_SIZE);
+		return ret;
+	}
 
 	static void* operator new(size_t size);
 	static void operator delete(void* ptr);
@@ -0,0 +1,85 @@
+#include "debug.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define TIME_VECTOR_RUNTIME_DISPATCH
+#endif
+
+#include "TimeVector.h"
+
+#ifdef TIME_VECTOR_RUNTIME_DISPATCH
+
+TIME_VECTOR_TARGET("sse4.2")
+void TimeVectorMaxSSE(Time* dest, const Time* const* srcs,
+						const Time* offsets, unsigned num_srcs,
+						Time post_add, unsigned n) {
+	timeVectorMaxSSE(dest, srcs, offsets, num_srcs, post_add, n);
+}
+
+TIME_VECTOR_TARGET("avx2")
+void TimeVectorMaxAVX2(Time* dest, const Time* const* srcs,
+						const Time* offsets, unsigned num_srcs,
+						Time post_add, unsigned n) {
+	timeVectorMaxAVX2(dest, srcs, offsets, num_srcs, post_add, n);
+}
+
+TIME_VECTOR_TARGET("avx512f")
+void TimeVectorMaxAVX512(Time* dest, const Time* const* srcs,
+						const Time* offsets, unsigned num_srcs,
+						Time post_add, unsigned n) {
+	timeVectorMaxAVX512(dest, srcs, offsets, num_srcs, post_add, n);
+}
+
+#else
+
+// TimeVectorInit never picks these off x86
+void TimeVectorMaxSSE(Time* dest, const Time* const* srcs,
+						const Time* offsets, unsigned num_srcs,
+						Time post_add, unsigned n) {
+	TimeVectorMaxRange(dest, srcs, offsets, num_srcs, post_add, 0, n);
+}
+
+void TimeVectorMaxAVX2(Time* dest, const Time* const* srcs,
+						const Time* offsets, unsigned num_srcs,
+						Time post_add, unsigned n) {
+	TimeVectorMaxRange(dest, srcs, offsets, num_srcs, post_add, 0, n);
+}
+
+void TimeVectorMaxAVX512(Time* dest, const Time* const* srcs,
+						const Time* offsets, unsigned num_srcs,
+						Time post_add, unsigned n) {
+	TimeVectorMaxRange(dest, srcs, offsets, num_srcs, post_add, 0, n);
+}
+
+#endif /* TIME_VECTOR_RUNTIME_DISPATCH */
+
+TimeVectorImpl time_vector_impl = TimeVectorImplScalar;
+static const char* time_vector_impl_name = "scalar";
+
+void TimeVectorInit() {
+#if defined(__AVX512F__)
+	time_vector_impl_name = "avx512 (built in)";
+#elif defined(__AVX2__)
+	time_vector_impl_name = "avx2 (built in)";
+#elif defined(__SSE4_2__)
+	time_vector_impl_name = "sse4.2 (built in)";
+#elif defined(TIME_VECTOR_RUNTIME_DISPATCH)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f")) {
+		time_vector_impl = TimeVectorImplAVX512;
+		time_vector_impl_name = "avx512";
+	}
+	else if (__builtin_cpu_supports("avx2")) {
+		time_vector_impl = TimeVectorImplAVX2;
+		time_vector_impl_name = "avx2";
+	}
+	else if (__builtin_cpu_supports("sse4.2")) {
+		time_vector_impl = TimeVectorImplSSE;
+		time_vector_impl_name = "sse4.2";
+	}
+#endif
+	MSG(1, "TimeVectorInit: using %s implementation\n", time_vector_impl_name);
+}
+
+const char* TimeVectorGetImplName() {
+	return time_vector_impl_name;
+}
@@ -0,0 +1,204 @@
+#ifndef _TIME_VECTOR_H
+#define _TIME_VECTOR_H
+
+#include "ktypes.h"
+
+/*
+ * TimeVectorMax computes, for each of n levels,
+ *
+ *   dest[i] = max(srcs[0][i] + offsets[0], ..., srcs[k-1][i] + offsets[k-1])
+ *             + post_add
+ *
+ * where k is num_srcs (the max is 0 if there are no sources). dest may be
+ * the same array as one of the sources.
+ *
+ * If the runtime is compiled for a CPU with AVX-512, AVX2 or SSE4.2 (e.g.
+ * built with march=native, see SConstruct), the kernel for it is compiled
+ * into every caller. Otherwise TimeVectorInit picks the widest one the CPU
+ * supports when the program starts and TimeVectorMax switches on that to
+ * call it. TimeVector.cpp defines TIME_VECTOR_RUNTIME_DISPATCH to get all of
+ * the kernels, each compiled for its own ISA.
+ */
+
+#if defined(__x86_64__) || defined(__i386__)
+#if defined(TIME_VECTOR_RUNTIME_DISPATCH) || defined(__SSE4_2__)
+#include <immintrin.h>
+#endif
+#endif
+
+#ifdef TIME_VECTOR_RUNTIME_DISPATCH
+#define TIME_VECTOR_TARGET(isa) __attribute__((target(isa)))
+#else
+#define TIME_VECTOR_TARGET(isa)
+#endif
+
+enum TimeVectorImpl {
+	TimeVectorImplScalar = 0,
+	TimeVectorImplSSE = 1,
+	TimeVectorImplAVX2 = 2,
+	TimeVectorImplAVX512 = 3
+};
+
+extern TimeVectorImpl time_vector_impl;
+
+/*!
+ * Picks the widest implementation of TimeVectorMax the CPU supports
+ * (AVX-512, AVX2, SSE4.2, or plain C++). Safe to call more than once.
+ */
+void TimeVectorInit();
+
+/*!
+ * @return The name of the implementation picked by TimeVectorInit.
+ */
+const char* TimeVectorGetImplName();
+
+/*!
+ * The kernels for each ISA, compiled out of line for that ISA. Only called
+ * when the ISA wasn't compiled in.
+ */
+void TimeVectorMaxSSE(Time* dest, const Time* const* srcs,
+						const Time* offsets, unsigned num_srcs,
+						Time post_add, unsigned n);
+void TimeVectorMaxAVX2(Time* dest, const Time* const* srcs,
+						const Time* offsets, unsigned num_srcs,
+						Time post_add, unsigned n);
+void TimeVectorMaxAVX512(Time* dest, const Time* const* srcs,
+						const Time* offsets, unsigned num_srcs,
+						Time post_add, unsigned n);
+
+/*!
+ * Fewer levels than this are done with TimeVectorMaxRange inline rather
+ * than through an out-of-line kernel: the call costs more than the vector
+ * code saves for shallow nests.
+ */
+static const unsigned TIME_VECTOR_MIN_LEVELS = 4;
+
+/*!
+ * The plain C++ version of TimeVectorMax for levels [begin, end).
+ */
+static inline void TimeVectorMaxRange(Time* dest, const Time* const* srcs,
+									const Time* offsets, unsigned num_srcs,
+									Time post_add, unsigned begin,
+									unsigned end) {
+	for (unsigned i = begin; i < end; ++i) {
+		Time t = 0;
+		for (unsigned s = 0; s < num_srcs; ++s) {
+			Time src_time = srcs[s][i] + offsets[s];
+			if (src_time > t) t = src_time;
+		}
+		dest[i] = t + post_add;
+	}
+}
+
+/*
+ * Each kernel works on a block of levels at a time: it keeps the running
+ * max for the block in registers while walking over the sources, then adds
+ * post_add and stores the block. Since lane i only ever reads index i of
+ * each source, dest can alias a source.
+ *
+ * Times are unsigned. AVX-512 has an unsigned 64-bit max, but SSE4.2 and
+ * AVX2 only have a signed compare, so they flip the sign bit of every time
+ * (subtract 2^63) before comparing and flip it back before storing.
+ */
+
+#if defined(TIME_VECTOR_RUNTIME_DISPATCH) || defined(__SSE4_2__)
+TIME_VECTOR_TARGET("sse4.2")
+static inline void timeVectorMaxSSE(Time* dest, const Time* const* srcs,
+									const Time* offsets, unsigned num_srcs,
+									Time post_add, unsigned n) {
+	const __m128i bias = _mm_set1_epi64x(0x8000000000000000LL);
+	const __m128i add = _mm_set1_epi64x(post_add);
+	unsigned i = 0;
+	for (; i + 2 <= n; i += 2) {
+		__m128i t = bias; // biased 0
+		for (unsigned s = 0; s < num_srcs; ++s) {
+			__m128i v = _mm_loadu_si128((const __m128i*)(srcs[s] + i));
+			v = _mm_add_epi64(v, _mm_set1_epi64x(offsets[s]));
+			v = _mm_xor_si128(v, bias);
+			t = _mm_blendv_epi8(t, v, _mm_cmpgt_epi64(v, t));
+		}
+		t = _mm_xor_si128(t, bias);
+		_mm_storeu_si128((__m128i*)(dest + i), _mm_add_epi64(t, add));
+	}
+	TimeVectorMaxRange(dest, srcs, offsets, num_srcs, post_add, i, n);
+}
+#endif
+
+#if defined(TIME_VECTOR_RUNTIME_DISPATCH) || defined(__AVX2__)
+TIME_VECTOR_TARGET("avx2")
+static inline void timeVectorMaxAVX2(Time* dest, const Time* const* srcs,
+									const Time* offsets, unsigned num_srcs,
+									Time post_add, unsigned n) {
+	const __m256i bias = _mm256_set1_epi64x(0x8000000000000000LL);
+	const __m256i add = _mm256_set1_epi64x(post_add);
+	unsigned i = 0;
+	for (; i + 4 <= n; i += 4) {
+		__m256i t = bias; // biased 0
+		for (unsigned s = 0; s < num_srcs; ++s) {
+			__m256i v = _mm256_loadu_si256((const __m256i*)(srcs[s] + i));
+			v = _mm256_add_epi64(v, _mm256_set1_epi64x(offsets[s]));
+			v = _mm256_xor_si256(v, bias);
+			t = _mm256_blendv_epi8(t, v, _mm256_cmpgt_epi64(v, t));
+		}
+		t = _mm256_xor_si256(t, bias);
+		_mm256_storeu_si256((__m256i*)(dest + i), _mm256_add_epi64(t, add));
+	}
+	TimeVectorMaxRange(dest, srcs, offsets, num_srcs, post_add, i, n);
+}
+#endif
+
+#if defined(TIME_VECTOR_RUNTIME_DISPATCH) || defined(__AVX512F__)
+TIME_VECTOR_TARGET("avx512f")
+static inline void timeVectorMaxAVX512(Time* dest, const Time* const* srcs,
+									const Time* offsets, unsigned num_srcs,
+									Time post_add, unsigned n) {
+	const __m512i add = _mm512_set1_epi64(post_add);
+	for (unsigned i = 0; i < n; i += 8) {
+		// masked loads/stores take care of the last partial block
+		__mmask8 mask = (n - i >= 8) ? (__mmask8)0xFF
+									: (__mmask8)((1U << (n - i)) - 1);
+		__m512i t = _mm512_setzero_si512();
+		for (unsigned s = 0; s < num_srcs; ++s) {
+			__m512i v = _mm512_maskz_loadu_epi64(mask, srcs[s] + i);
+			v = _mm512_add_epi64(v, _mm512_set1_epi64(offsets[s]));
+			// the masked form passes t through rather than reading an
+			// undefined register, which gcc warns about
+			t = _mm512_mask_max_epu64(t, mask, t, v);
+		}
+		_mm512_mask_storeu_epi64(dest + i, mask, _mm512_add_epi64(t, add));
+	}
+}
+#endif
+
+static inline void TimeVectorMax(Time* dest, const Time* const* srcs,
+									const Time* offsets, unsigned num_srcs,
+									Time post_add, unsigned n) {
+	if (n < TIME_VECTOR_MIN_LEVELS) {
+		TimeVectorMaxRange(dest, srcs, offsets, num_srcs, post_add, 0, n);
+		return;
+	}
+
+#if defined(__AVX512F__)
+	timeVectorMaxAVX512(dest, srcs, offsets, num_srcs, post_add, n);
+#elif defined(__AVX2__)
+	timeVectorMaxAVX2(dest, srcs, offsets, num_srcs, post_add, n);
+#elif defined(__SSE4_2__)
+	timeVectorMaxSSE(dest, srcs, offsets, num_srcs, post_add, n);
+#else
+	switch (time_vector_impl) {
+		case TimeVectorImplAVX512:
+			TimeVectorMaxAVX512(dest, srcs, offsets, num_srcs, post_add, n);
+			break;
+		case TimeVectorImplAVX2:
+			TimeVectorMaxAVX2(dest, srcs, offsets, num_srcs, post_add, n);
+			break;
+		case TimeVectorImplSSE:
+			TimeVectorMaxSSE(dest, srcs, offsets, num_srcs, post_add, n);
+			break;
+		default:
+			TimeVectorMaxRange(dest, srcs, offsets, num_srcs, post_add, 0, n);
+	}
+#endif
+}
+
+#endif
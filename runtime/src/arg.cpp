@@ -43,7 +43,10 @@ void parseKremlinOptions(KremlinConfiguration &config,
 	opterr = 0; // unknown opt isn't an error: it's a native program opt
 
 	int disable_rs = 0;
+	int disable_stack_reclaim = 0;
 	int enable_sm_compress = 0;
+	int enable_threads = 0;
+	int enable_huge_pages = 0;
 #ifdef KREMLIN_DEBUG
 	int enable_idbg;
 #endif
@@ -53,7 +56,10 @@ void parseKremlinOptions(KremlinConfiguration &config,
 		static struct option long_options[] =
 		{
 			{"kremlin-disable-rsummary", no_argument, &disable_rs, 1},
+			{"kremlin-disable-stack-reclaim", no_argument, &disable_stack_reclaim, 1},
 			{"kremlin-compress-shadow-mem", no_argument, &enable_sm_compress, 1},
+			{"kremlin-profile-threads", no_argument, &enable_threads, 1},
+			{"kremlin-huge-pages", no_argument, &enable_huge_pages, 1},
 #ifdef KREMLIN_DEBUG
 			{"kremlin-idbg", no_argument, &enable_idbg, 1},
 #endif
@@ -66,6 +72,18 @@ void parseKremlinOptions(KremlinConfiguration &config,
 			{"kremlin-cbuffer-size", required_argument, NULL, 'f'},
 			{"kremlin-min-level", required_argument, NULL, 'g'},
 			{"kremlin-max-level", required_argument, NULL, 'h'},
+			{"kremlin-sample", required_argument, NULL, 'i'},
+			{"kremlin-sample-unit", required_argument, NULL, 'j'},
+			{"kremlin-sample-first", required_argument, NULL, 'k'},
+			{"kremlin-checkpoint-period", required_argument, NULL, 'l'},
+			{"kremlin-stats-memory-cap", required_argument, NULL, 'm'},
+			{"kremlin-shadow-mem-cache-assoc", required_argument, NULL, 'n'},
+			{"kremlin-shadow-mem-cache-max-size", required_argument, NULL, 'o'},
+			{"kremlin-shadow-mem-gc-step", required_argument, NULL, 'p'},
+			{"kremlin-compression-codec", required_argument, NULL, 'q'},
+			{"kremlin-shadow-mem-limit", required_argument, NULL, 'r'},
+			{"kremlin-spill-dir", required_argument, NULL, 's'},
+			{"kremlin-spill-threshold", required_argument, NULL, 't'},
 			{NULL, 0, NULL, 0} // indicates end of options
 		};
 
@@ -100,9 +118,11 @@ void parseKremlinOptions(KremlinConfiguration &config,
 					config.setShadowMemType(ShadowMemorySkadu);
 				else if (strcmp(optarg, "dummy") == 0)
 					config.setShadowMemType(ShadowMemoryDummy);
+				else if (strcmp(optarg, "flat") == 0)
+					config.setShadowMemType(ShadowMemoryFlat);
 				else {
 					std::cerr << "ERROR: Invalid shadow memory type: " << optarg << std::endl;
-					std::cerr << "Valid options are: {skadu, stv, base, dummy}" << std::endl;
+					std::cerr << "Valid options are: {skadu, stv, base, dummy, flat}" << std::endl;
 					exit(1);
 				}
 
@@ -128,6 +148,86 @@ void parseKremlinOptions(KremlinConfiguration &config,
 				config.setMaxProfiledLevel(atoi(optarg));
 				break;
 
+			case 'i': {
+				// format is ON:OFF, e.g. 1000:19000
+				char* off_str = strchr(optarg, ':');
+				long long on = atoll(optarg);
+				long long off = (off_str == NULL) ? 0 : atoll(off_str + 1);
+				if (on <= 0 || off <= 0) {
+					std::cerr << "ERROR: Invalid sample lengths: " << optarg << std::endl;
+					std::cerr << "Expected ON:OFF, where both are positive" << std::endl;
+					exit(1);
+				}
+				config.setSampleLengths(on, off);
+				break;
+			}
+
+			case 'j':
+				if (strcmp(optarg, "time") == 0)
+					config.enableSamplingInVirtualTime();
+				else if (strcmp(optarg, "regions") != 0) {
+					std::cerr << "ERROR: Invalid sample unit: " << optarg << std::endl;
+					std::cerr << "Valid options are: {regions, time}" << std::endl;
+					exit(1);
+				}
+				break;
+
+			case 'k':
+				config.setSampleFirstInstances(atoll(optarg));
+				break;
+
+			case 'l':
+				config.setCheckpointPeriod(atoi(optarg));
+				break;
+
+			case 'm':
+				config.setStatsMemoryCapInMB(atoi(optarg));
+				break;
+
+			case 'n': {
+				int assoc = atoi(optarg);
+				if (assoc != 1 && assoc != 2 && assoc != 4 && assoc != 8) {
+					std::cerr << "ERROR: Invalid cache associativity: " << optarg << std::endl;
+					std::cerr << "Valid options are: {1, 2, 4, 8}" << std::endl;
+					exit(1);
+				}
+				config.setShadowMemCacheAssociativity(assoc);
+				break;
+			}
+
+			case 'o':
+				config.setShadowMemCacheMaxSizeInMB(atoi(optarg));
+				break;
+
+			case 'p':
+				config.setShadowMemGarbageCollectionStep(atoi(optarg));
+				break;
+
+			case 'q':
+				if (strcmp(optarg, "lzo") == 0)
+					config.setCompressionCodec(CompressionCodecLZO);
+				else if (strcmp(optarg, "bitpack") == 0)
+					config.setCompressionCodec(CompressionCodecBitPack);
+				else {
+					std::cerr << "ERROR: Invalid compression codec: " << optarg << std::endl;
+					std::cerr << "Valid options are: {lzo, bitpack}" << std::endl;
+					exit(1);
+				}
+				break;
+
+			case 'r':
+				// in GB, but fractions are allowed
+				config.setShadowMemLimitInMB((UInt64)(atof(optarg) * 1024));
+				break;
+
+			case 's':
+				config.setSpillDir(optarg);
+				break;
+
+			case 't':
+				config.setSpillThresholdInMB(atoi(optarg));
+				break;
+
 			case '?':
 				if (optopt) {
 					native_args.push_back(strdup((char*)(&c)));
@@ -149,6 +249,23 @@ void parseKremlinOptions(KremlinConfiguration &config,
 	if (disable_rs)
 		config.disableRecursiveRegionSummarization();
 
+	if (disable_stack_reclaim)
+		config.disableStackShadowMemReclamation();
+
+	if (enable_huge_pages)
+		config.enableHugePages();
+
+	if (enable_threads) {
+		// Base and STV keep their tables in file-level statics, so they
+		// can't have one instance per thread.
+		if (config.getShadowMemType() == ShadowMemoryBase
+			|| config.getShadowMemType() == ShadowMemorySTV) {
+			std::cerr << "ERROR: --kremlin-profile-threads requires skadu, flat or dummy shadow memory" << std::endl;
+			exit(1);
+		}
+		config.enableThreadProfiling();
+	}
+
 #ifdef KREMLIN_DEBUG
 	if (enable_idbg) {
 		__kremlin_idbg = 1;
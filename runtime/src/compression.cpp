@@ -1,38 +1,297 @@
-#include <map>
+#include <string.h> // for memset/memcpy
+#include <time.h> // for clock_gettime
 
 #include "kremlin.h"
 #include "compression.h"
 #include "MShadowSkadu.h"
 #include "LevelTable.hpp"
+#include "SpillTier.hpp"
 #include "config.h"
 #include "minilzo.h"
 #include "debug.h"
 
-static UInt64 _compSrcSize;
-static UInt64 _compDestSize;
-static UInt64 totalAccess;
-static UInt64 totalEvict;
+static __thread UInt64 _compSrcSize;
+static __thread UInt64 _compDestSize;
+static __thread UInt64 _compTime; // in ns
+static __thread UInt64 _decompSize;
+static __thread UInt64 _decompTime; // in ns
 
-#define HEAP_ALLOC(var,size) \
-    lzo_align_t __LZO_MMODEL var [ ((size) + (sizeof(lzo_align_t) - 1)) / sizeof(lzo_align_t) ]
+// Codec used by this thread. Threads sharing a shadow memory each get their
+// own the first time they compress.
+static __thread TimestampCodec *codec;
 
-static HEAP_ALLOC(wrkmem, LZO1X_1_MEM_COMPRESS);
+static void initCodec() {
+	if (kremlin_config.getCompressionCodec() == CompressionCodecLZO)
+		codec = new LZOCodec();
+	else
+		codec = new BitPackCodec();
 
+	// TODO: make this an exception
+	if (!codec->init()) {
+		fprintf(stderr, "[kremlin] ERROR: could not initialize compression codec %s\n",
+			codec->getName());
+		assert(0);
+		exit(1);
+	}
+}
+
+static UInt64 getTimeInNS() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+#define WRKMEM_NUM_ALIGNS \
+	((LZO1X_1_MEM_COMPRESS + (sizeof(lzo_align_t) - 1)) / sizeof(lzo_align_t))
+
+// LZO scratch space; allocated on first use by each compressing thread.
+static __thread lzo_align_t *wrkmem;
+static __thread UInt8 *lzo_out;
+static __thread lzo_uint lzo_out_size;
+
+bool LZOCodec::init() {
+	if (lzo_init() != LZO_E_OK) {
+		printf("internal error - lzo_init() failed !!!\n");
+	    printf("(this usually indicates a compiler bug - try recompiling\nwithout optimizations, and enable '-DLZO_DEBUG' for diagnostics)\n");
+		return false;
+	}
+	return true;
+}
+
+UInt8* LZOCodec::compress(Time* src, unsigned num_times, UInt64* comp_size) {
+	lzo_uint src_size = num_times * sizeof(Time);
+	if (wrkmem == NULL)
+		wrkmem = (lzo_align_t*)malloc(WRKMEM_NUM_ALIGNS * sizeof(lzo_align_t));
+
+	// LZO can expand incompressible input by up to 1/16 + 67 bytes, so
+	// compress into scratch space and keep only what was used.
+	lzo_uint max_out_size = src_size + src_size / 16 + 64 + 3;
+	if (lzo_out_size < max_out_size) {
+		free(lzo_out);
+		lzo_out = (UInt8*)malloc(max_out_size);
+		lzo_out_size = max_out_size;
+	}
+
+	lzo_uint out_size = 0;
+	int result = lzo1x_1_compress((UInt8*)src, src_size, lzo_out, &out_size, 
+									wrkmem);
+	if (result != LZO_E_OK) {
+		fprintf(stderr, "[kremlin] ERROR: LZO compression failed (%d)\n", 
+				result);
+		exit(1);
+	}
+
+	UInt8 *comp_data = (UInt8*)malloc(out_size);
+	memcpy(comp_data, lzo_out, out_size);
+	*comp_size = out_size;
+	return comp_data;
+}
+
+void LZOCodec::decompress(Time* dest, unsigned num_times, UInt8* comp_data, 
+							UInt64 comp_size) {
+	lzo_uint out_size = num_times * sizeof(Time);
+	int result = lzo1x_decompress(comp_data, comp_size, (UInt8*)dest, 
+									&out_size, NULL);
+	if (result != LZO_E_OK || out_size != num_times * sizeof(Time)) {
+		fprintf(stderr, "[kremlin] ERROR: LZO decompression failed (%d)\n", 
+				result);
+		exit(1);
+	}
+}
+
+/*
+ * Values are zigzag coded first so that small negative deltas stay small.
+ * Each block is then laid out as:
+ *   base, the smallest zigzag coded value in the block
+ *   width | (num_exceptions << 8)
+ *   width * NUM_LANES words holding the low width bits of each offset
+ *   num_exceptions words holding the high bits of offsets that don't fit
+ *   num_exceptions bytes of exception indices, padded to a whole word
+ * Exceptions let a block with a few large values (e.g. the +x/-x pair a
+ * single store leaves after delta coding) use a narrow width for the rest.
+ */
+static inline UInt64 zigzag(Time v) {
+	return ((UInt64)v << 1) ^ (UInt64)((Int64)v >> 63);
+}
+
+static inline Time unzigzag(UInt64 v) {
+	return (Time)((v >> 1) ^ -(v & 1));
+}
+
+static inline unsigned getBitWidth(UInt64 v) {
+	return (v == 0) ? 0 : 64 - __builtin_clzll(v);
+}
+
+static inline unsigned getExceptionWords(unsigned num_exceptions) {
+	return num_exceptions + (num_exceptions + 7) / 8;
+}
+
+void BitPackCodec::packBlock(UInt64* offsets, unsigned width, UInt64* out) {
+	if (width == 0) return;
+
+	// the bits above width belong to exceptions
+	UInt64 mask = (width == 64) ? ~0ULL : (1ULL << width) - 1;
+	memset(out, 0, width * NUM_LANES * sizeof(UInt64));
+	for (unsigned i = 0; i < BLOCK_SIZE / NUM_LANES; ++i) {
+		unsigned bit = i * width;
+		unsigned shift = bit & 63;
+		UInt64* word = out + (bit >> 6) * NUM_LANES;
+		UInt64* vals = offsets + i * NUM_LANES;
+
+		for (unsigned lane = 0; lane < NUM_LANES; ++lane) {
+			UInt64 v = vals[lane] & mask;
+			word[lane] |= v << shift;
+			if (shift + width > 64)
+				word[lane + NUM_LANES] |= v >> (64 - shift);
+		}
+	}
+}
+
+void BitPackCodec::unpackBlock(UInt64* in, UInt64 base, unsigned width, 
+								UInt64* dest) {
+	if (width == 0) {
+		for (unsigned i = 0; i < BLOCK_SIZE; ++i)
+			dest[i] = base;
+		return;
+	}
+
+	UInt64 mask = (width == 64) ? ~0ULL : (1ULL << width) - 1;
+	for (unsigned i = 0; i < BLOCK_SIZE / NUM_LANES; ++i) {
+		unsigned bit = i * width;
+		unsigned shift = bit & 63;
+		UInt64* word = in + (bit >> 6) * NUM_LANES;
+		UInt64* vals = dest + i * NUM_LANES;
+
+		for (unsigned lane = 0; lane < NUM_LANES; ++lane) {
+			UInt64 v = word[lane] >> shift;
+			if (shift + width > 64)
+				v |= word[lane + NUM_LANES] << (64 - shift);
+			vals[lane] = base + (v & mask);
+		}
+	}
+}
+
+UInt8* BitPackCodec::compress(Time* src, unsigned num_times, 
+								UInt64* comp_size) {
+	assert(num_times % BLOCK_SIZE == 0);
+	assert(num_times <= MAX_TIMES);
+	unsigned num_blocks = num_times / BLOCK_SIZE;
+
+	// First pass: turn each block into offsets from its smallest zigzag
+	// coded value and pick its width, which sizes the output.
+	UInt64 offsets[MAX_TIMES];
+	UInt64 bases[MAX_TIMES / BLOCK_SIZE];
+	unsigned widths[MAX_TIMES / BLOCK_SIZE];
+	unsigned num_exceptions[MAX_TIMES / BLOCK_SIZE];
+	unsigned num_words = 0;
+	for (unsigned b = 0; b < num_blocks; ++b) {
+		UInt64* block = offsets + b * BLOCK_SIZE;
+		UInt64 min = ~0ULL;
+		for (unsigned i = 0; i < BLOCK_SIZE; ++i) {
+			block[i] = zigzag(src[b * BLOCK_SIZE + i]);
+			if (block[i] < min) min = block[i];
+		}
+
+		unsigned width_count[65];
+		memset(width_count, 0, sizeof(width_count));
+		for (unsigned i = 0; i < BLOCK_SIZE; ++i) {
+			block[i] -= min;
+			width_count[getBitWidth(block[i])]++;
+		}
+
+		// Use the width that minimizes packed words plus exception words.
+		unsigned best_width = 64, best_exceptions = 0;
+		unsigned best_words = 64 * NUM_LANES;
+		unsigned exceptions = 0;
+		for (int w = 63; w >= 0; --w) {
+			exceptions += width_count[w + 1];
+			unsigned words = w * NUM_LANES + getExceptionWords(exceptions);
+			if (words < best_words) {
+				best_words = words;
+				best_width = w;
+				best_exceptions = exceptions;
+			}
+		}
+
+		bases[b] = min;
+		widths[b] = best_width;
+		num_exceptions[b] = best_exceptions;
+		num_words += 2 + best_words;
+	}
+
+	UInt64* out = (UInt64*)malloc(num_words * sizeof(UInt64));
+	UInt64* pos = out;
+	for (unsigned b = 0; b < num_blocks; ++b) {
+		UInt64* block = offsets + b * BLOCK_SIZE;
+		unsigned width = widths[b];
+		*pos++ = bases[b];
+		*pos++ = width | (num_exceptions[b] << 8);
+		packBlock(block, width, pos);
+		pos += width * NUM_LANES;
+
+		if (num_exceptions[b] == 0) continue;
+
+		UInt64* highs = pos;
+		UInt8* indices = (UInt8*)(pos + num_exceptions[b]);
+		memset(indices, 0, (num_exceptions[b] + 7) / 8 * sizeof(UInt64));
+		unsigned e = 0;
+		for (unsigned i = 0; i < BLOCK_SIZE; ++i) {
+			if (getBitWidth(block[i]) > width) {
+				highs[e] = block[i] >> width;
+				indices[e] = i;
+				++e;
+			}
+		}
+		assert(e == num_exceptions[b]);
+		pos += getExceptionWords(e);
+	}
+	assert(pos == out + num_words);
+
+	*comp_size = num_words * sizeof(UInt64);
+	return (UInt8*)out;
+}
+
+void BitPackCodec::decompress(Time* dest, unsigned num_times, 
+								UInt8* comp_data, UInt64 comp_size) {
+	assert(num_times % BLOCK_SIZE == 0);
+	unsigned num_blocks = num_times / BLOCK_SIZE;
+
+	UInt64* pos = (UInt64*)comp_data;
+	for (unsigned b = 0; b < num_blocks; ++b) {
+		UInt64* block = (UInt64*)(dest + b * BLOCK_SIZE);
+		UInt64 base = *pos++;
+		unsigned width = *pos & 0xff;
+		unsigned exceptions = *pos >> 8;
+		++pos;
+
+		unpackBlock(pos, base, width, block);
+		pos += width * NUM_LANES;
+
+		UInt64* highs = pos;
+		UInt8* indices = (UInt8*)(pos + exceptions);
+		for (unsigned e = 0; e < exceptions; ++e)
+			block[indices[e]] += highs[e] << width;
+		pos += getExceptionWords(exceptions);
+
+		for (unsigned i = 0; i < BLOCK_SIZE; ++i)
+			block[i] = unzigzag(block[i]);
+	}
+	assert((UInt8*)pos == comp_data + comp_size);
+}
 
-UInt8* compressData(UInt8* decomp_data, lzo_uint decomp_size, 
-					lzo_uintp comp_size) {
+UInt8* compressData(Time* decomp_data, UInt64 decomp_size, 
+					UInt64* comp_size) {
 	assert(decomp_data != NULL);
 	assert(decomp_size > 0);
+	assert(decomp_size % sizeof(Time) == 0);
 	assert(comp_size != NULL);
 
-	//XXX need a specialized memory allocator, for now, just check the 
+	if (codec == NULL) initCodec();
 
-	//UInt8 *comp_data = MemPoolAlloc();
-	UInt8 *comp_data = (UInt8*)malloc(decomp_size);
-	int result = lzo1x_1_compress(decomp_data, decomp_size, comp_data, comp_size, wrkmem);
-	assert(result == LZO_E_OK);
-	//memcpy(comp_data, decomp_data, decomp_size);
-	//*comp_size  = decomp_size;
+	UInt64 start = getTimeInNS();
+	UInt8 *comp_data = codec->compress(decomp_data, 
+									decomp_size / sizeof(Time), comp_size);
+	_compTime += getTimeInNS() - start;
 
 	//MSG(3, "compressed from %d to %d\n", decomp_size, *comp_size);
 	_compSrcSize += decomp_size;
@@ -42,139 +301,136 @@ UInt8* compressData(UInt8* decomp_data, lzo_uint decomp_size,
 	return comp_data;
 }
 
-void decompressData(UInt8* decomp_data, UInt8* comp_data, 
-					lzo_uint comp_size, lzo_uintp decomp_size) {
+void decompressData(Time* decomp_data, UInt8* comp_data, 
+					UInt64 comp_size, UInt64 decomp_size) {
 	assert(comp_data != NULL);
 	assert(decomp_data != NULL);
 	assert(comp_size > 0);
-	assert(decomp_size != NULL);
 
-	int result = lzo1x_decompress(comp_data, comp_size, decomp_data, decomp_size, NULL);
-	assert(result == LZO_E_OK);
-	//memcpy(decomp_data, comp_data, comp_size);
-	//*decomp_size = comp_size;
+	if (codec == NULL) initCodec();
+
+	UInt64 start = getTimeInNS();
+	codec->decompress(decomp_data, decomp_size / sizeof(Time), comp_data, 
+						comp_size);
+	_decompTime += getTimeInNS() - start;
+	_decompSize += decomp_size;
 
 	//MSG(3, "decompressed from %d to %d\n", comp_size, *decomp_size);
-	//MemPoolFree(comp_data);
 	free(comp_data);
-	comp_data = NULL;
-	assert(comp_data == NULL);
 }
 
 /*
  * BEGIN ACTIVE SET MAINTENANCE CODE.
  */
 
-/*!
- * An entry in the active set of uncompressed level tables.
- */
-class ActiveSetEntry {
-public:
-	UInt16 r_bit;
-	UInt32 code; // TODO: make this debug mode only
-	ActiveSetEntry() : r_bit(1), code(0xDEADBEEF) {}
-	~ActiveSetEntry() {}
-
-	void* operator new(size_t size) {
-		return MemPoolAllocSmall(sizeof(ActiveSetEntry));
-	}
-	void operator delete(void *ptr) {
-		MemPoolFreeSmall(ptr, sizeof(ActiveSetEntry));
-	}
-};
-
-typedef std::map<LevelTable*, ActiveSetEntry*>::iterator active_set_iterator;
-
-static std::map<LevelTable*, ActiveSetEntry*> active_set;
-static active_set_iterator active_set_clock_hand;
-
-/*! \brief Move "clockhand" to next entry in active set */
-static inline void advanceClockHand() {
-	++active_set_clock_hand;
-	if (active_set_clock_hand == active_set.end())
-		active_set_clock_hand = active_set.begin();
+void CBuffer::advanceClockHand() {
+	++clock_hand;
+	if (clock_hand == ring.size())
+		clock_hand = 0;
 }
 
-/*! \brief Prints all entries in the active set.  */
-static inline void printActiveSet() {
-	unsigned i = 0;
-	for(active_set_iterator it = active_set.begin(); 
-			it != active_set.end(); ++it, ++i) {
-		if (it == active_set_clock_hand) MSG(3,"*");
-		MSG(3,"%u: key = %p, r_bit = %hu\n", i, it->first, it->second->r_bit);
+void CBuffer::printActiveSet() {
+	for (unsigned i = 0; i < ring.size(); ++i) {
+		if (i == clock_hand) {
+			MSG(3,"*");
+		}
+		MSG(3,"%u: key = %p, r_bit = %d\n", i, ring[i], 
+			ring[i]->isCBufferReferenced());
 	}
 }
 
 void CBuffer::init(unsigned size) {
 	assert(size > 0);
-	if (!kremlin_config.compressShadowMem()) return;
+	this->num_entries = size;
+	clock_hand = 0;
+	num_accesses = 0;
+	num_evictions = 0;
+	spill_tier = NULL;
+	enabled = false;
+	if (kremlin_config.compressShadowMem()) enable();
+}
 
-	MSG(2,"Initializing compression buffer to size %d\n",size);
-	
-	// TODO: make this an exception
-	if (lzo_init() != LZO_E_OK) {
-		printf("internal error - lzo_init() failed !!!\n");
-	    printf("(this usually indicates a compiler bug - try recompiling\nwithout optimizations, and enable '-DLZO_DEBUG' for diagnostics)\n");
-	    return;
-	}
+void CBuffer::enable() {
+	if (enabled) return;
+
+	MSG(2,"Initializing compression buffer to size %d\n",num_entries);
+
+	if (codec == NULL) initCodec();
 
+	ring.reserve(num_entries);
+	enabled = true;
+}
+
+int CBuffer::resize(unsigned size) {
+	assert(size > 0);
 	this->num_entries = size;
+
+	int bytes_gained = 0;
+	while (ring.size() > size) {
+		unsigned victim = getVictim();
+		bytes_gained += ring[victim]->compress();
+		num_evictions++;
+		if (spill_tier != NULL) spill_tier->add(ring[victim]);
+
+		// fill the victim's slot from the end of the ring
+		LevelTable* last = ring.back();
+		ring.pop_back();
+		if (victim < ring.size()) {
+			ring[victim] = last;
+			last->setCBufferSlot(victim);
+		}
+		if (clock_hand >= ring.size()) clock_hand = 0;
+	}
+	return bytes_gained;
 }
 
 void CBuffer::deinit() {
 	MSG(2, "CBuffer (evict / access / ratio) = %llu, %llu, %.2f\n",
-		totalEvict, totalAccess, ((double)totalEvict / totalAccess) * 100.0);
+		num_evictions, num_accesses, 
+		((double)num_evictions / num_accesses) * 100.0);
 	MSG(2, "Compression Overall Rate = %.2f X\n", (double)_compSrcSize / _compDestSize);
+
+	if (codec == NULL) return;
+	if (_compSrcSize > 0) {
+		// bytes per ns is GB/s; report MB/s of uncompressed data
+		fprintf(stderr, "[kremlin] Compression codec %s: ratio %.2f X, compress %.1f MB/s, decompress %.1f MB/s\n",
+			codec->getName(), (double)_compSrcSize / _compDestSize,
+			_compTime ? _compSrcSize * 1e3 / _compTime : 0.0,
+			_decompTime ? _decompSize * 1e3 / _decompTime : 0.0);
+	}
+	delete codec;
+	codec = NULL;
 }
 
-/*! \brief Find an entry to remove from active set.
- *
- * \return The active set entry that should be removed.
- * \remark This simply returns an entry that should be removed. It does not
- * actually remove the entry.
- */
-active_set_iterator getVictim() {
-	// set active_set_clock_hand to entry that will be removed
-	while(active_set_clock_hand->second->r_bit == 1) {
-		active_set_clock_hand->second->r_bit = 0;
+unsigned CBuffer::getVictim() {
+	// set clock_hand to entry that will be removed
+	while(ring[clock_hand]->isCBufferReferenced()) {
+		ring[clock_hand]->setCBufferReferenced(false);
 		// TODO: these asserts need to go bye-bye
-		assert(active_set_clock_hand->second->code == 0xDEADBEEF);
-		assert(active_set_clock_hand->first->code == 0xDEADBEEF);
+		assert(ring[clock_hand]->code == 0xDEADBEEF);
 		advanceClockHand();
 	}
 
 	// TODO: these asserts need to go bye-bye
-	assert(active_set_clock_hand->first->code == 0xDEADBEEF);
-	assert(active_set_clock_hand->second->code == 0xDEADBEEF);
+	assert(ring[clock_hand]->code == 0xDEADBEEF);
 
-	active_set_iterator ret = active_set_clock_hand;
+	unsigned ret = clock_hand;
 	advanceClockHand();
 	return ret;
 }
 
-void CBuffer::addToBuffer(LevelTable *l_table) {
-	assert(l_table != NULL);
-
-	//fprintf(stderr, "adding l_table 0x%llx\n", l_table);
-	ActiveSetEntry *as = new ActiveSetEntry();
-	active_set.insert( std::pair<LevelTable*, ActiveSetEntry*>(l_table, as) );
+int CBuffer::evictFromBuffer(LevelTable *replacement) {
+	assert(replacement != NULL);
 
-	// TRICKY: size will only be 1 the first time we add something to the
-	// buffer so we'll go ahead and initialize the clock hand to that first
-	// entry
-	if (active_set.size() == 1) active_set_clock_hand = active_set.begin();
-	// TODO: assert active_size size is less than num_entries
-}
-
-int CBuffer::evictFromBuffer() {
-	active_set_iterator victim = getVictim();
-	assert(victim->second->code == 0xDEADBEEF);
-	LevelTable* lTable = victim->first;
+	unsigned victim = getVictim();
+	LevelTable* lTable = ring[victim];
 	int bytes_gained = lTable->compress();
-	totalEvict++;
-	delete victim->second;
-	victim->second = NULL;
-	active_set.erase(victim);
+	num_evictions++;
+	if (spill_tier != NULL) spill_tier->add(lTable);
+
+	ring[victim] = replacement;
+	replacement->setCBufferSlot(victim);
+	replacement->setCBufferReferenced(true);
 	return bytes_gained;
 }
 
@@ -190,29 +446,14 @@ int CBuffer::add(LevelTable *table) {
 	assert(table != NULL);
 	assert(table->code == 0xDEADBEEF);
 
-	if (!kremlin_config.compressShadowMem()) return 0;
+	if (!enabled) return 0;
 
-	int bytes_gained = 0;
 	// XXX: is next line really >=. Why not just >? (-sat)
-	if(active_set.size() >= this->num_entries) {
-		bytes_gained = evictFromBuffer();
-	}
+	if(ring.size() >= this->num_entries)
+		return evictFromBuffer(table);
 
-	addToBuffer(table);
-	return bytes_gained;
-}
-
-void CBuffer::touch(LevelTable *table) {
-	assert(table != NULL);
-	if (!kremlin_config.compressShadowMem()) return;
-
-	active_set_iterator it = active_set.find(table);
-	if (it == active_set.end()) {
-		fprintf(stderr, "[1] as not found for lTable 0x%p\n", table);
-	}
-	assert(it != active_set.end());
-	ActiveSetEntry *as = it->second;
-	assert(as->code == 0xDEADBEEF);
-	as->r_bit = 1;
-	totalAccess++;
+	table->setCBufferSlot(ring.size());
+	table->setCBufferReferenced(true);
+	ring.push_back(table);
+	return 0;
 }
@@ -1,20 +1,128 @@
 #ifndef _CBUFFER_H
 #define _CBUFFER_H
 
-#include "lzoconf.h"
+#include <vector>
+#include "ktypes.h"
+#include "LevelTable.hpp"
 
-class LevelTable;
+/*!
+ * @brief Interface of the codecs used to compress TimeTable arrays.
+ *
+ * The arrays handed to a codec have already been delta coded by LevelTable
+ * (against the level above and along the array), so they mostly hold small
+ * values that may be negative.
+ */
+class TimestampCodec {
+public:
+	virtual ~TimestampCodec() {}
+
+	virtual const char* getName() = 0;
+
+	/*!
+	 * Sets up the codec.
+	 *
+	 * @return False if the codec can't be used.
+	 */
+	virtual bool init() { return true; }
+
+	/*!
+	 * @param src The timestamps to compress.
+	 * @param num_times The number of timestamps in src.
+	 * @param[out] comp_size The size of the compressed data (in bytes).
+	 * @return Compressed data, allocated with malloc.
+	 */
+	virtual UInt8* compress(Time* src, unsigned num_times, 
+							UInt64* comp_size) = 0;
+
+	/*!
+	 * @param dest Where to write the timestamps.
+	 * @param num_times The number of timestamps that were compressed.
+	 * @param comp_data The compressed data, which is left alone.
+	 * @param comp_size The size of the compressed data (in bytes).
+	 */
+	virtual void decompress(Time* dest, unsigned num_times, UInt8* comp_data, 
+							UInt64 comp_size) = 0;
+};
+
+/*!
+ * @brief The LZO1X-1 general purpose compressor.
+ */
+class LZOCodec : public TimestampCodec {
+public:
+	const char* getName() { return "lzo"; }
+	bool init();
+	UInt8* compress(Time* src, unsigned num_times, UInt64* comp_size);
+	void decompress(Time* dest, unsigned num_times, UInt8* comp_data, 
+					UInt64 comp_size);
+};
+
+/*!
+ * @brief Frame-of-reference bit packing with exceptions.
+ *
+ * The input is split into blocks of BLOCK_SIZE values. Each block stores
+ * its minimum and a bit width, then every value's offset from the minimum
+ * using that many bits. Offsets too wide for it are patched in afterwards
+ * from a short exception list; the width is chosen to minimize the total.
+ * The offsets are spread round-robin over NUM_LANES independent bit
+ * streams whose words are interleaved, so each step packs or unpacks one
+ * value per lane with the same shifts in every lane and the lane loop can
+ * be vectorized.
+ */
+class BitPackCodec : public TimestampCodec {
+public:
+	static const unsigned NUM_LANES = 4;
+	static const unsigned BLOCK_SIZE = 64 * NUM_LANES;
+	static const unsigned MAX_TIMES = 4 * BLOCK_SIZE; //!< Per compress() call
+
+	const char* getName() { return "bitpack"; }
+	UInt8* compress(Time* src, unsigned num_times, UInt64* comp_size);
+	void decompress(Time* dest, unsigned num_times, UInt8* comp_data, 
+					UInt64 comp_size);
+
+private:
+	static void packBlock(UInt64* offsets, unsigned width, UInt64* out);
+	static void unpackBlock(UInt64* in, UInt64 base, unsigned width, 
+							UInt64* dest);
+};
+
+class SpillTier;
 
 class CBuffer {
 public:
-	/*! @brief Initializes the compression buffer.
+	/*! @brief Initializes the compression buffer and the codec it uses.
 	 *
 	 * @param size The number of entries allowed in the compression buffer.
 	 * @pre size is positive.
 	 */
 	void init(unsigned size);
 
-	/*! \brief De-initializes the compression buffer. */
+	/*! @brief Starts compressing if it wasn't already.
+	 *
+	 * @remark Tables that aren't in the buffer yet have to be added to it.
+	 */
+	void enable();
+
+	bool isEnabled() { return enabled; }
+
+	/*! @brief Hands every table compressed from now on to a spill tier.
+	 *
+	 * @param tier The tier to use, NULL for none.
+	 */
+	void setSpillTier(SpillTier *tier) { spill_tier = tier; }
+
+	unsigned getNumEntries() { return num_entries; }
+
+	/*! @brief Changes the number of entries allowed in the buffer,
+	 * compressing tables until they fit.
+	 *
+	 * @param size The new number of entries.
+	 * @return The number of bytes saved by compressing.
+	 * @pre size is positive.
+	 */
+	int resize(unsigned size);
+
+	/*! \brief De-initializes the compression buffer and reports how the
+	 * codec performed. */
 	void deinit();
 
 	/*! @brief Adds a level table entry to the compression buffer.
@@ -30,7 +138,13 @@ public:
 	 * \param table The level table to mark as accessed.
 	 * \pre The table to mark must be valid and in the compression buffer.
 	 */
-	void touch(LevelTable *table);
+	void touch(LevelTable *table) {
+		assert(table != NULL);
+		assert(table->getCBufferSlot() < ring.size() 
+				&& ring[table->getCBufferSlot()] == table);
+		table->setCBufferReferenced(true);
+		num_accesses++;
+	}
 
 	// TODO: change name to something like "getDecompressed"?
 	/*! @brief Decompress a level table and adds it to compression buffer.
@@ -42,45 +156,69 @@ public:
 	int decompress(LevelTable *table);
 
 private:
+	bool enabled;
 	unsigned num_entries; //!< number of entries in the compression buffer
-	
-	/*! \brief Adds a level table entry to the compression buffer.
+
+	/*!
+	 * Uncompressed tables, in CLOCK order. Each table knows its slot and
+	 * holds its own reference bit, so touching a table doesn't need a
+	 * lookup. A table added to a full ring takes the slot of the victim.
+	 */
+	std::vector<LevelTable*> ring;
+	unsigned clock_hand; //!< Slot the next victim search starts from
+
+	UInt64 num_accesses;
+	UInt64 num_evictions;
+
+	SpillTier *spill_tier; //!< Takes tables once compressed, may be NULL
+
+	/*! \brief Move "clockhand" to next entry in active set */
+	void advanceClockHand();
+
+	/*! \brief Prints all entries in the active set.  */
+	void printActiveSet();
+
+	/*! \brief Find an entry to remove from active set.
 	 *
-	 * \param l_table The level table to add to the buffer.
-	 * \pre l_table is non-NULL.
+	 * \return The slot of the entry that should be removed.
+	 * \remark This simply returns an entry that should be removed. It does not
+	 * actually remove the entry.
 	 */
-	void addToBuffer(LevelTable *l_table);
+	unsigned getVictim();
 
-	/*! \brief Removes a suitable entry from the compression buffer.
+	/*! \brief Compresses a suitable entry of the compression buffer and
+	 * gives its slot to another table.
 	 *
+	 * \param replacement The level table to put in the victim's slot.
 	 * \return The number of bytes saved by removing from the buffer.
+	 * \pre replacement is non-NULL.
 	 */
-	int evictFromBuffer();
+	int evictFromBuffer(LevelTable *replacement);
 };
 
-/*! @brief Compress data using LZO library
+/*! @brief Compress data using the codec selected in the configuration.
  *
- * @param decomp_data The data to be compressed
+ * @param decomp_data The timestamps to be compressed
  * @param decomp_size The size of input data (in bytes)
  * @param[out] comp_size The size data after compressed
  * @return Pointer to the beginning of compressed data
  * @pre decomp_data is non-NULL.
- * @pre decomp_size is positive.
+ * @pre decomp_size is a positive multiple of sizeof(Time).
  * @pre comp_size is non-NULL.
  * @post Returned pointer is non-NULL.
  */
-UInt8* compressData(UInt8* decomp_data, lzo_uint decomp_size, lzo_uintp comp_size);
+UInt8* compressData(Time* decomp_data, UInt64 decomp_size, UInt64* comp_size);
 
-/*! @brief Decompress data using LZO library
+/*! @brief Decompress data using the codec selected in the configuration.
  *
  * @param decomp_data Chunk of memory where decompressed data is written.
- * @param comp_data Pointer to the data to be decompressed.
+ * @param comp_data Pointer to the data to be decompressed, which is freed.
  * @param comp_size Size of the compressed data (in bytes)
- * @param[out] decomp_size Size of the decompressed data (in bytes)
- * @pre comp_data, decomp_data, and decomp_size are all non-NULL.
+ * @param decomp_size Size of the decompressed data (in bytes)
+ * @pre comp_data and decomp_data are non-NULL.
  * @pre comp_size is positive.
- * @post comp_data will point to NULL.
  */
-void decompressData(UInt8* decomp_data, UInt8* comp_data, lzo_uint comp_size, lzo_uintp decomp_size);
+void decompressData(Time* decomp_data, UInt8* comp_data, UInt64 comp_size, 
+					UInt64 decomp_size);
 
 #endif
@@ -20,36 +20,89 @@ void KremlinConfiguration::print() {
 			std::cerr << "Skadu" << "\n";
 			if (shadow_mem_cache_size_in_mb > 0) {
 				std::cerr << "\t\tCache size: " 
-					<< shadow_mem_cache_size_in_mb << "MB\n";
+					<< shadow_mem_cache_size_in_mb << "MB, "
+					<< shadow_mem_cache_assoc << "-way\n";
+				if (shadow_mem_cache_max_size_in_mb > shadow_mem_cache_size_in_mb) {
+					std::cerr << "\t\tCache grows on high miss rate, up to " 
+						<< shadow_mem_cache_max_size_in_mb << "MB\n";
+				}
 			}
 
 			if (compress_shadow_mem) {
 				std::cerr << "\t\tCompression enabled: ";
 				std::cerr << num_compression_buffer_entries
-					<< " compression buffer entries\n";
+					<< " compression buffer entries, "
+					<< (compression_codec == CompressionCodecLZO 
+						? "lzo" : "bitpack") << " codec\n";
 			}
 			else
 				std::cerr << "\t\tCompression disabled\n";
 
+			if (!spill_dir.empty()) {
+				std::cerr << "\t\tCompressed tables past " 
+					<< spill_threshold_in_mb << "MB spill to " 
+					<< spill_dir << "\n";
+			}
+
 			if (garbage_collection_period > 0) {
 				std::cerr << "\t\tGarbage collection enabled, period = "
-					<< garbage_collection_period << "\n";
+					<< garbage_collection_period << ", step = ";
+				if (garbage_collection_step > 0)
+					std::cerr << garbage_collection_step << " level tables\n";
+				else
+					std::cerr << "whole cycle\n";
 			}
 			else
 				std::cerr << "\t\tGarbage collection disabled.\n";
 
+			if (shadow_mem_limit_in_mb > 0) {
+				std::cerr << "\t\tMemory limit: " 
+					<< shadow_mem_limit_in_mb / 1024.0 << "GB for all threads\n";
+			}
+
 			break;
 		}
 		case ShadowMemoryDummy: {
 			std::cerr << "Dummy" << "\n";
 			break;
 		}
+		case ShadowMemoryFlat: {
+			std::cerr << "Flat" << "\n";
+			break;
+		}
 		default: assert(0);
 	}
 
+	std::cerr << "\tReclaim shadow memory of returned stack frames? "
+		<< (reclaim_stack_shadow_mem ? "YES" : "NO") << "\n";
+
 	std::cerr << "\tSummarize recursive regions? "
 		<< (summarize_recursive_regions ? "YES" : "NO") << "\n";
+	std::cerr << "\tProfile threads separately? "
+		<< (profile_threads ? "YES" : "NO") << "\n";
+
+	std::cerr << "\tHuge pages for shadow memory? "
+		<< (use_huge_pages ? "YES" : "NO") << "\n";
+
+	if (sample_off_length > 0) {
+		std::cerr << "\tSampling bursts: " << sample_on_length << " on, "
+			<< sample_off_length << " off ("
+			<< (sample_in_virtual_time ? "virtual time" : "region instances")
+			<< ")\n";
+	}
+	if (sample_first_instances > 0) {
+		std::cerr << "\tSampling first " << sample_first_instances
+			<< " instances of each region\n";
+	}
+
+	if (stats_memory_cap_in_mb > 0) {
+		std::cerr << "\tSummarized stats memory cap: " 
+			<< stats_memory_cap_in_mb << " MB\n";
+	}
 
 	std::cerr << "\tProfile output file: " << profile_output_filename << "\n";
+	if (checkpoint_period > 0) {
+		std::cerr << "\tCheckpoint period: " << checkpoint_period << "s\n";
+	}
 	std::cerr << "\tDebug output file: " << debug_output_filename << "\n";
 }
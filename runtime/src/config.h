@@ -8,7 +8,13 @@ enum ShadowMemoryType {
 	ShadowMemoryBase = 0,
 	ShadowMemorySTV = 1,
 	ShadowMemorySkadu = 2,
-	ShadowMemoryDummy = 3
+	ShadowMemoryDummy = 3,
+	ShadowMemoryFlat = 4
+};
+
+enum CompressionCodec {
+	CompressionCodecLZO = 0,
+	CompressionCodecBitPack = 1
 };
 
 class KremlinConfiguration {
@@ -19,14 +25,36 @@ private:
 	ShadowMemoryType shadow_mem_type;
 
 	UInt32 shadow_mem_cache_size_in_mb;
+	UInt32 shadow_mem_cache_assoc; // ways per set, 1 for direct-mapped
+	UInt32 shadow_mem_cache_max_size_in_mb; // 0 if the cache never grows
 
 	UInt32 garbage_collection_period;
+	UInt32 garbage_collection_step; // LevelTables per step, 0 for whole cycles
+
+	UInt64 shadow_mem_limit_in_mb; // for all threads together, 0 if unlimited
 
 	bool compress_shadow_mem;
 	UInt32 num_compression_buffer_entries;
+	CompressionCodec compression_codec;
+	std::string spill_dir; // empty if compressed tables are never spilled
+	UInt32 spill_threshold_in_mb; // compressed tables kept in memory
+	bool reclaim_stack_shadow_mem; // clear shadow of returned stack frames
 
 	bool summarize_recursive_regions;
 
+	bool profile_threads;
+
+	bool use_huge_pages; // for TimeTable arrays
+
+	UInt64 sample_on_length;
+	UInt64 sample_off_length;
+	bool sample_in_virtual_time;
+	UInt64 sample_first_instances;
+
+	UInt32 checkpoint_period; // in seconds, 0 if checkpoints are disabled
+
+	UInt32 stats_memory_cap_in_mb; // 0 if stats aren't summarized
+
 	std::string profile_output_filename;
 	std::string debug_output_filename;
 	
@@ -37,10 +65,24 @@ public:
 	KremlinConfiguration() : compress_shadow_mem(false),
 							min_profiled_level(0), max_profiled_level(32), 
 							num_compression_buffer_entries(4096),
+							compression_codec(CompressionCodecBitPack),
+							spill_threshold_in_mb(256),
+							reclaim_stack_shadow_mem(true),
 							shadow_mem_cache_size_in_mb(4), 
+							shadow_mem_cache_assoc(1),
+							shadow_mem_cache_max_size_in_mb(0),
 							shadow_mem_type(ShadowMemorySkadu),
 							garbage_collection_period(1024), 
+							garbage_collection_step(64),
+							shadow_mem_limit_in_mb(0),
 							summarize_recursive_regions(true), 
+							profile_threads(false),
+							use_huge_pages(false),
+							sample_on_length(0), sample_off_length(0),
+							sample_in_virtual_time(false),
+							sample_first_instances(0),
+							checkpoint_period(0),
+							stats_memory_cap_in_mb(0),
 							profile_output_filename("kremlin.bin"),
 							debug_output_filename("kremlin.debug.log") {}
 
@@ -54,14 +96,39 @@ public:
 	Level getNumProfiledLevels() { return max_profiled_level - min_profiled_level + 1; }
 	ShadowMemoryType getShadowMemType() { return shadow_mem_type; }
 	UInt32 getShadowMemCacheSizeInMB() { return shadow_mem_cache_size_in_mb; }
+	UInt32 getShadowMemCacheAssociativity() { return shadow_mem_cache_assoc; }
+	UInt32 getShadowMemCacheMaxSizeInMB() { 
+		return shadow_mem_cache_max_size_in_mb;
+	}
 	UInt32 getShadowMemGarbageCollectionPeriod() { 
 		return garbage_collection_period;
 	}
+	UInt32 getShadowMemGarbageCollectionStep() { 
+		return garbage_collection_step;
+	}
+	UInt64 getShadowMemLimitInMB() { return shadow_mem_limit_in_mb; }
 	bool compressShadowMem() { return compress_shadow_mem; }
 	UInt32 getNumCompressionBufferEntries() { 
 		return num_compression_buffer_entries;
 	}
+	CompressionCodec getCompressionCodec() { return compression_codec; }
+	bool spillShadowMem() { return !spill_dir.empty(); }
+	const char* getSpillDir() { return spill_dir.c_str(); }
+	UInt32 getSpillThresholdInMB() { return spill_threshold_in_mb; }
+	bool reclaimStackShadowMem() { return reclaim_stack_shadow_mem; }
 	bool summarizeRecursiveRegions() { return summarize_recursive_regions; }
+	bool profileThreads() { return profile_threads; }
+	bool useHugePages() { return use_huge_pages; }
+	UInt64 getSampleOnLength() { return sample_on_length; }
+	UInt64 getSampleOffLength() { return sample_off_length; }
+	bool sampleInVirtualTime() { return sample_in_virtual_time; }
+	UInt64 getSampleFirstInstances() { return sample_first_instances; }
+	UInt32 getCheckpointPeriod() { return checkpoint_period; }
+	UInt32 getStatsMemoryCapInMB() { return stats_memory_cap_in_mb; }
+	bool summarizeStats() { return stats_memory_cap_in_mb > 0; }
+	bool sampleRegions() { 
+		return sample_off_length > 0 || sample_first_instances > 0;
+	}
 	const char* getProfileOutputFilename() { 
 		return profile_output_filename.c_str();
 	}
@@ -76,16 +143,43 @@ public:
 	void setShadowMemCacheSizeInMB(UInt32 s) {
 		shadow_mem_cache_size_in_mb = s;
 	}
+	void setShadowMemCacheAssociativity(UInt32 a) { shadow_mem_cache_assoc = a; }
+	void setShadowMemCacheMaxSizeInMB(UInt32 s) {
+		shadow_mem_cache_max_size_in_mb = s;
+	}
 	void setShadowMemGarbageCollectionPeriod(UInt32 p) { 
 		garbage_collection_period = p;
 	}
+	void setShadowMemGarbageCollectionStep(UInt32 s) { 
+		garbage_collection_step = s;
+	}
+	void setShadowMemLimitInMB(UInt64 l) { shadow_mem_limit_in_mb = l; }
 	void enableShadowMemCompression() { compress_shadow_mem = true; }
 	void setNumCompressionBufferEntries(UInt32 n) { 
 		num_compression_buffer_entries = n;
 	}
+	void setCompressionCodec(CompressionCodec c) { compression_codec = c; }
+	void setSpillDir(const char* dir) { 
+		spill_dir.clear();
+		spill_dir.append(dir);
+	}
+	void setSpillThresholdInMB(UInt32 t) { spill_threshold_in_mb = t; }
+	void disableStackShadowMemReclamation() { 
+		reclaim_stack_shadow_mem = false;
+	}
 	void disableRecursiveRegionSummarization() { 
 		summarize_recursive_regions = false;
 	}
+	void enableThreadProfiling() { profile_threads = true; }
+	void enableHugePages() { use_huge_pages = true; }
+	void setSampleLengths(UInt64 on, UInt64 off) {
+		sample_on_length = on;
+		sample_off_length = off;
+	}
+	void enableSamplingInVirtualTime() { sample_in_virtual_time = true; }
+	void setSampleFirstInstances(UInt64 n) { sample_first_instances = n; }
+	void setCheckpointPeriod(UInt32 p) { checkpoint_period = p; }
+	void setStatsMemoryCapInMB(UInt32 s) { stats_memory_cap_in_mb = s; }
 	void setProfileOutputFilename(const char* name) { 
 		profile_output_filename.clear();
 		profile_output_filename.append(name);
@@ -22,8 +22,8 @@ void _KDeinit();
 void _KTurnOn();
 void _KTurnOff();
 
-void _KEnterRegion(SID region_id, RegionType region_type);
-void _KExitRegion(SID region_id, RegionType region_type);
+void _KEnterRegion(SID region_id, RegionType region_type, void* stack_ptr);
+void _KExitRegion(SID region_id, RegionType region_type, void* stack_ptr);
 void _KLandingPad(SID regionId, RegionType regionType);
 
 /* The following funcs are inserted by the critical path instrumentation pass */
@@ -36,14 +36,17 @@ void _KTimestamp4(UInt32 dest_reg, UInt32 src1_reg, UInt32 src1_offset, UInt32 s
 void _KTimestamp5(UInt32 dest_reg, UInt32 src1_reg, UInt32 src1_offset, UInt32
 src2_reg, UInt32 src2_offset, UInt32 src3_reg, UInt32 src3_offset, UInt32
 src4_reg, UInt32 src4_offset, UInt32 src5_reg, UInt32 src5_offset);
-void _KTimestamp6(UInt32 dest_reg, UInt32 src1_reg, UInt32 src1_offset, UInt32
-src2_reg, UInt32 src2_offset, UInt32 src3_reg, UInt32 src3_offset, UInt32
-src4_reg, UInt32 src4_offset, UInt32 src5_reg, UInt32 src5_offset, UInt32
-src6_reg, UInt32 src6_offset);
-void _KTimestamp7(UInt32 dest_reg, UInt32 src1_reg, UInt32 src1_offset, UInt32
-src2_reg, UInt32 src2_offset, UInt32 src3_reg, UInt32 src3_offset, UInt32
-src4_reg, UInt32 src4_offset, UInt32 src5_reg, UInt32 src5_offset, UInt32
-src6_reg, UInt32 src6_offset, UInt32 src7_reg, UInt32 src7_offset);
+void _KTimestamp6(UInt32 dest_reg, UInt32 src1_reg, UInt32 src1_offset, UInt32 src2_reg, UInt32 src2_offset, UInt32 src3_reg, UInt32 src3_offset, UInt32 src4_reg, UInt32 src4_offset, UInt32 src5_reg, UInt32 src5_offset, UInt32 src6_reg, UInt32 src6_offset);
+void _KTimestamp7(UInt32 dest_reg, UInt32 src1_reg, UInt32 src1_offset, UInt32 src2_reg, UInt32 src2_offset, UInt32 src3_reg, UInt32 src3_offset, UInt32 src4_reg, UInt32 src4_offset, UInt32 src5_reg, UInt32 src5_offset, UInt32 src6_reg, UInt32 src6_offset, UInt32 src7_reg, UInt32 src7_offset);
+void _KTimestamp8(UInt32 dest_reg, UInt32 src1_reg, UInt32 src1_offset, UInt32 src2_reg, UInt32 src2_offset, UInt32 src3_reg, UInt32 src3_offset, UInt32 src4_reg, UInt32 src4_offset, UInt32 src5_reg, UInt32 src5_offset, UInt32 src6_reg, UInt32 src6_offset, UInt32 src7_reg, UInt32 src7_offset, UInt32 src8_reg, UInt32 src8_offset);
+void _KTimestamp9(UInt32 dest_reg, UInt32 src1_reg, UInt32 src1_offset, UInt32 src2_reg, UInt32 src2_offset, UInt32 src3_reg, UInt32 src3_offset, UInt32 src4_reg, UInt32 src4_offset, UInt32 src5_reg, UInt32 src5_offset, UInt32 src6_reg, UInt32 src6_offset, UInt32 src7_reg, UInt32 src7_offset, UInt32 src8_reg, UInt32 src8_offset, UInt32 src9_reg, UInt32 src9_offset);
+void _KTimestamp10(UInt32 dest_reg, UInt32 src1_reg, UInt32 src1_offset, UInt32 src2_reg, UInt32 src2_offset, UInt32 src3_reg, UInt32 src3_offset, UInt32 src4_reg, UInt32 src4_offset, UInt32 src5_reg, UInt32 src5_offset, UInt32 src6_reg, UInt32 src6_offset, UInt32 src7_reg, UInt32 src7_offset, UInt32 src8_reg, UInt32 src8_offset, UInt32 src9_reg, UInt32 src9_offset, UInt32 src10_reg, UInt32 src10_offset);
+void _KTimestamp11(UInt32 dest_reg, UInt32 src1_reg, UInt32 src1_offset, UInt32 src2_reg, UInt32 src2_offset, UInt32 src3_reg, UInt32 src3_offset, UInt32 src4_reg, UInt32 src4_offset, UInt32 src5_reg, UInt32 src5_offset, UInt32 src6_reg, UInt32 src6_offset, UInt32 src7_reg, UInt32 src7_offset, UInt32 src8_reg, UInt32 src8_offset, UInt32 src9_reg, UInt32 src9_offset, UInt32 src10_reg, UInt32 src10_offset, UInt32 src11_reg, UInt32 src11_offset);
+void _KTimestamp12(UInt32 dest_reg, UInt32 src1_reg, UInt32 src1_offset, UInt32 src2_reg, UInt32 src2_offset, UInt32 src3_reg, UInt32 src3_offset, UInt32 src4_reg, UInt32 src4_offset, UInt32 src5_reg, UInt32 src5_offset, UInt32 src6_reg, UInt32 src6_offset, UInt32 src7_reg, UInt32 src7_offset, UInt32 src8_reg, UInt32 src8_offset, UInt32 src9_reg, UInt32 src9_offset, UInt32 src10_reg, UInt32 src10_offset, UInt32 src11_reg, UInt32 src11_offset, UInt32 src12_reg, UInt32 src12_offset);
+void _KTimestamp13(UInt32 dest_reg, UInt32 src1_reg, UInt32 src1_offset, UInt32 src2_reg, UInt32 src2_offset, UInt32 src3_reg, UInt32 src3_offset, UInt32 src4_reg, UInt32 src4_offset, UInt32 src5_reg, UInt32 src5_offset, UInt32 src6_reg, UInt32 src6_offset, UInt32 src7_reg, UInt32 src7_offset, UInt32 src8_reg, UInt32 src8_offset, UInt32 src9_reg, UInt32 src9_offset, UInt32 src10_reg, UInt32 src10_offset, UInt32 src11_reg, UInt32 src11_offset, UInt32 src12_reg, UInt32 src12_offset, UInt32 src13_reg, UInt32 src13_offset);
+void _KTimestamp14(UInt32 dest_reg, UInt32 src1_reg, UInt32 src1_offset, UInt32 src2_reg, UInt32 src2_offset, UInt32 src3_reg, UInt32 src3_offset, UInt32 src4_reg, UInt32 src4_offset, UInt32 src5_reg, UInt32 src5_offset, UInt32 src6_reg, UInt32 src6_offset, UInt32 src7_reg, UInt32 src7_offset, UInt32 src8_reg, UInt32 src8_offset, UInt32 src9_reg, UInt32 src9_offset, UInt32 src10_reg, UInt32 src10_offset, UInt32 src11_reg, UInt32 src11_offset, UInt32 src12_reg, UInt32 src12_offset, UInt32 src13_reg, UInt32 src13_offset, UInt32 src14_reg, UInt32 src14_offset);
+void _KTimestamp15(UInt32 dest_reg, UInt32 src1_reg, UInt32 src1_offset, UInt32 src2_reg, UInt32 src2_offset, UInt32 src3_reg, UInt32 src3_offset, UInt32 src4_reg, UInt32 src4_offset, UInt32 src5_reg, UInt32 src5_offset, UInt32 src6_reg, UInt32 src6_offset, UInt32 src7_reg, UInt32 src7_offset, UInt32 src8_reg, UInt32 src8_offset, UInt32 src9_reg, UInt32 src9_offset, UInt32 src10_reg, UInt32 src10_offset, UInt32 src11_reg, UInt32 src11_offset, UInt32 src12_reg, UInt32 src12_offset, UInt32 src13_reg, UInt32 src13_offset, UInt32 src14_reg, UInt32 src14_offset, UInt32 src15_reg, UInt32 src15_offset);
+void _KTimestamp16(UInt32 dest_reg, UInt32 src1_reg, UInt32 src1_offset, UInt32 src2_reg, UInt32 src2_offset, UInt32 src3_reg, UInt32 src3_offset, UInt32 src4_reg, UInt32 src4_offset, UInt32 src5_reg, UInt32 src5_offset, UInt32 src6_reg, UInt32 src6_offset, UInt32 src7_reg, UInt32 src7_offset, UInt32 src8_reg, UInt32 src8_offset, UInt32 src9_reg, UInt32 src9_offset, UInt32 src10_reg, UInt32 src10_offset, UInt32 src11_reg, UInt32 src11_offset, UInt32 src12_reg, UInt32 src12_offset, UInt32 src13_reg, UInt32 src13_offset, UInt32 src14_reg, UInt32 src14_offset, UInt32 src15_reg, UInt32 src15_offset, UInt32 src16_reg, UInt32 src16_offset);
 
 void _KWork(UInt32 work);
 
@@ -59,9 +62,21 @@ void _KReduction(UInt op_cost, UInt dest_reg);
 void _KLoad(Addr src_addr, Reg dest_reg, UInt32 mem_access_size, UInt32 num_srcs, ...); 
 void _KLoad0(Addr src_addr, Reg dest_reg, UInt32 memory_access_size); 
 void _KLoad1(Addr src_addr, Reg dest_reg, Reg src_reg, UInt32 memory_access_size);
-void _KLoad2(Addr src_addr, Reg dest_reg, Reg src1_reg, Reg src2_reg, UInt32 memory_access_size);
+void _KLoad2(Addr src_addr, Reg dest_reg, Reg src1_reg, Reg src2_reg, UInt32 mem_access_size);
 void _KLoad3(Addr src_addr, Reg dest_reg, Reg src1_reg, Reg src2_reg, Reg src3_reg, UInt32 mem_access_size);
 void _KLoad4(Addr src_addr, Reg dest_reg, Reg src1_reg, Reg src2_reg, Reg src3_reg, Reg src4_reg, UInt32 mem_access_size);
+void _KLoad5(Addr src_addr, Reg dest_reg, Reg src1_reg, Reg src2_reg, Reg src3_reg, Reg src4_reg, Reg src5_reg, UInt32 mem_access_size);
+void _KLoad6(Addr src_addr, Reg dest_reg, Reg src1_reg, Reg src2_reg, Reg src3_reg, Reg src4_reg, Reg src5_reg, Reg src6_reg, UInt32 mem_access_size);
+void _KLoad7(Addr src_addr, Reg dest_reg, Reg src1_reg, Reg src2_reg, Reg src3_reg, Reg src4_reg, Reg src5_reg, Reg src6_reg, Reg src7_reg, UInt32 mem_access_size);
+void _KLoad8(Addr src_addr, Reg dest_reg, Reg src1_reg, Reg src2_reg, Reg src3_reg, Reg src4_reg, Reg src5_reg, Reg src6_reg, Reg src7_reg, Reg src8_reg, UInt32 mem_access_size);
+void _KLoad9(Addr src_addr, Reg dest_reg, Reg src1_reg, Reg src2_reg, Reg src3_reg, Reg src4_reg, Reg src5_reg, Reg src6_reg, Reg src7_reg, Reg src8_reg, Reg src9_reg, UInt32 mem_access_size);
+void _KLoad10(Addr src_addr, Reg dest_reg, Reg src1_reg, Reg src2_reg, Reg src3_reg, Reg src4_reg, Reg src5_reg, Reg src6_reg, Reg src7_reg, Reg src8_reg, Reg src9_reg, Reg src10_reg, UInt32 mem_access_size);
+void _KLoad11(Addr src_addr, Reg dest_reg, Reg src1_reg, Reg src2_reg, Reg src3_reg, Reg src4_reg, Reg src5_reg, Reg src6_reg, Reg src7_reg, Reg src8_reg, Reg src9_reg, Reg src10_reg, Reg src11_reg, UInt32 mem_access_size);
+void _KLoad12(Addr src_addr, Reg dest_reg, Reg src1_reg, Reg src2_reg, Reg src3_reg, Reg src4_reg, Reg src5_reg, Reg src6_reg, Reg src7_reg, Reg src8_reg, Reg src9_reg, Reg src10_reg, Reg src11_reg, Reg src12_reg, UInt32 mem_access_size);
+void _KLoad13(Addr src_addr, Reg dest_reg, Reg src1_reg, Reg src2_reg, Reg src3_reg, Reg src4_reg, Reg src5_reg, Reg src6_reg, Reg src7_reg, Reg src8_reg, Reg src9_reg, Reg src10_reg, Reg src11_reg, Reg src12_reg, Reg src13_reg, UInt32 mem_access_size);
+void _KLoad14(Addr src_addr, Reg dest_reg, Reg src1_reg, Reg src2_reg, Reg src3_reg, Reg src4_reg, Reg src5_reg, Reg src6_reg, Reg src7_reg, Reg src8_reg, Reg src9_reg, Reg src10_reg, Reg src11_reg, Reg src12_reg, Reg src13_reg, Reg src14_reg, UInt32 mem_access_size);
+void _KLoad15(Addr src_addr, Reg dest_reg, Reg src1_reg, Reg src2_reg, Reg src3_reg, Reg src4_reg, Reg src5_reg, Reg src6_reg, Reg src7_reg, Reg src8_reg, Reg src9_reg, Reg src10_reg, Reg src11_reg, Reg src12_reg, Reg src13_reg, Reg src14_reg, Reg src15_reg, UInt32 mem_access_size);
+void _KLoad16(Addr src_addr, Reg dest_reg, Reg src1_reg, Reg src2_reg, Reg src3_reg, Reg src4_reg, Reg src5_reg, Reg src6_reg, Reg src7_reg, Reg src8_reg, Reg src9_reg, Reg src10_reg, Reg src11_reg, Reg src12_reg, Reg src13_reg, Reg src14_reg, Reg src15_reg, Reg src16_reg, UInt32 mem_access_size);
 void _KStore(Reg src_reg, Addr dest_addr, UInt32 memory_access_size); 
 void _KStoreConst(Addr dest_addr, UInt32 memory_access_size); 
 
@@ -70,6 +85,18 @@ void _KPhi1To1(Reg dest_reg, Reg src_reg, Reg ctrl_reg);
 void _KPhi2To1(Reg dest_reg, Reg src_reg, Reg ctrl1_reg, Reg ctrl2_reg); 
 void _KPhi3To1(Reg dest_reg, Reg src_reg, Reg ctrl1_reg, Reg ctrl2_reg, Reg ctrl3_reg); 
 void _KPhi4To1(Reg dest_reg, Reg src_reg, Reg ctrl1_reg, Reg ctrl2_reg, Reg ctrl3_reg, Reg ctrl4_reg); 
+void _KPhi5To1(Reg dest_reg, Reg src_reg, Reg ctrl1_reg, Reg ctrl2_reg, Reg ctrl3_reg, Reg ctrl4_reg, Reg ctrl5_reg);
+void _KPhi6To1(Reg dest_reg, Reg src_reg, Reg ctrl1_reg, Reg ctrl2_reg, Reg ctrl3_reg, Reg ctrl4_reg, Reg ctrl5_reg, Reg ctrl6_reg);
+void _KPhi7To1(Reg dest_reg, Reg src_reg, Reg ctrl1_reg, Reg ctrl2_reg, Reg ctrl3_reg, Reg ctrl4_reg, Reg ctrl5_reg, Reg ctrl6_reg, Reg ctrl7_reg);
+void _KPhi8To1(Reg dest_reg, Reg src_reg, Reg ctrl1_reg, Reg ctrl2_reg, Reg ctrl3_reg, Reg ctrl4_reg, Reg ctrl5_reg, Reg ctrl6_reg, Reg ctrl7_reg, Reg ctrl8_reg);
+void _KPhi9To1(Reg dest_reg, Reg src_reg, Reg ctrl1_reg, Reg ctrl2_reg, Reg ctrl3_reg, Reg ctrl4_reg, Reg ctrl5_reg, Reg ctrl6_reg, Reg ctrl7_reg, Reg ctrl8_reg, Reg ctrl9_reg);
+void _KPhi10To1(Reg dest_reg, Reg src_reg, Reg ctrl1_reg, Reg ctrl2_reg, Reg ctrl3_reg, Reg ctrl4_reg, Reg ctrl5_reg, Reg ctrl6_reg, Reg ctrl7_reg, Reg ctrl8_reg, Reg ctrl9_reg, Reg ctrl10_reg);
+void _KPhi11To1(Reg dest_reg, Reg src_reg, Reg ctrl1_reg, Reg ctrl2_reg, Reg ctrl3_reg, Reg ctrl4_reg, Reg ctrl5_reg, Reg ctrl6_reg, Reg ctrl7_reg, Reg ctrl8_reg, Reg ctrl9_reg, Reg ctrl10_reg, Reg ctrl11_reg);
+void _KPhi12To1(Reg dest_reg, Reg src_reg, Reg ctrl1_reg, Reg ctrl2_reg, Reg ctrl3_reg, Reg ctrl4_reg, Reg ctrl5_reg, Reg ctrl6_reg, Reg ctrl7_reg, Reg ctrl8_reg, Reg ctrl9_reg, Reg ctrl10_reg, Reg ctrl11_reg, Reg ctrl12_reg);
+void _KPhi13To1(Reg dest_reg, Reg src_reg, Reg ctrl1_reg, Reg ctrl2_reg, Reg ctrl3_reg, Reg ctrl4_reg, Reg ctrl5_reg, Reg ctrl6_reg, Reg ctrl7_reg, Reg ctrl8_reg, Reg ctrl9_reg, Reg ctrl10_reg, Reg ctrl11_reg, Reg ctrl12_reg, Reg ctrl13_reg);
+void _KPhi14To1(Reg dest_reg, Reg src_reg, Reg ctrl1_reg, Reg ctrl2_reg, Reg ctrl3_reg, Reg ctrl4_reg, Reg ctrl5_reg, Reg ctrl6_reg, Reg ctrl7_reg, Reg ctrl8_reg, Reg ctrl9_reg, Reg ctrl10_reg, Reg ctrl11_reg, Reg ctrl12_reg, Reg ctrl13_reg, Reg ctrl14_reg);
+void _KPhi15To1(Reg dest_reg, Reg src_reg, Reg ctrl1_reg, Reg ctrl2_reg, Reg ctrl3_reg, Reg ctrl4_reg, Reg ctrl5_reg, Reg ctrl6_reg, Reg ctrl7_reg, Reg ctrl8_reg, Reg ctrl9_reg, Reg ctrl10_reg, Reg ctrl11_reg, Reg ctrl12_reg, Reg ctrl13_reg, Reg ctrl14_reg, Reg ctrl15_reg);
+void _KPhi16To1(Reg dest_reg, Reg src_reg, Reg ctrl1_reg, Reg ctrl2_reg, Reg ctrl3_reg, Reg ctrl4_reg, Reg ctrl5_reg, Reg ctrl6_reg, Reg ctrl7_reg, Reg ctrl8_reg, Reg ctrl9_reg, Reg ctrl10_reg, Reg ctrl11_reg, Reg ctrl12_reg, Reg ctrl13_reg, Reg ctrl14_reg, Reg ctrl15_reg, Reg ctrl16_reg);
 void _KPhiCond4To1(Reg dest_reg, Reg ctrl1_reg, Reg ctrl2_reg, Reg ctrl3_reg, Reg ctrl4_reg);
 void _KPhiAddCond(Reg dest_reg, Reg src_reg);
 
@@ -77,6 +104,10 @@ void _KMalloc(Addr addr, size_t size, UInt dest);
 void _KRealloc(Addr old_addr, Addr new_addr, size_t size, UInt dest);
 void _KFree(Addr addr);
 
+void _KMemCopy(Addr dest_addr, Addr src_addr, UInt64 size);
+void _KMemSet(Reg src_reg, Addr dest_addr, UInt64 size);
+void _KMemSetConst(Addr dest_addr, UInt64 size);
+
 void _KPushCDep(Reg cond);
 void _KPopCDep();
 
@@ -90,7 +121,7 @@ void _KEnqArg(Reg src);
 void _KEnqArgConst(void);
 void _KDeqArg(UInt dest); 
 
-void _KCallLib(UInt cost, UInt dest, UInt num_in, ...); 
+void _KCallLib(UInt64 cost, UInt dest, UInt num_in, UInt num_reads, UInt num_writes, ...); 
 
 // the following two functions are part of our plans for c++ support
 void cppEntry();
@@ -2,6 +2,7 @@
 
 #include <assert.h>
 #include <limits.h>
+#include <pthread.h>
 #include <stdarg.h> /* for variable length args */
 #include <stdio.h>
 #include <stdlib.h>
@@ -18,6 +19,7 @@
 #include "MShadowBase.h"
 #include "MShadowSTV.h"
 #include "MShadowSkadu.h"
+#include "MShadowFlat.h"
 
 #include "Table.h"
 #include "RShadow.h"
@@ -32,15 +34,55 @@
 #include <signal.h> // for catching CTRL-V during debug
 
 
-static KremlinProfiler *profiler;
+// Profiler for the calling thread. Unless threads are profiled separately,
+// every thread shares the main thread's profiler.
+static __thread KremlinProfiler *profiler;
+static KremlinProfiler *main_profiler;
+static volatile bool main_profiler_running = false;
+
+// Used to deinit a worker thread's profiler when that thread exits.
+static pthread_key_t worker_profiler_key;
+static pthread_once_t worker_profiler_key_once = PTHREAD_ONCE_INIT;
+
 KremlinConfiguration kremlin_config;
 
 extern "C" int __main(int argc, char** argv);
 
+static void deinitWorkerProfiler(void* worker) {
+	assert(worker != NULL);
+	KremlinProfiler* worker_profiler = static_cast<KremlinProfiler*>(worker);
+	worker_profiler->deinit();
+	delete worker_profiler;
+	profiler = NULL;
+}
+
+static void createWorkerProfilerKey() {
+	pthread_key_create(&worker_profiler_key, deinitWorkerProfiler);
+}
+
 static void initProfiler() {
+	if (main_profiler != NULL && !kremlin_config.profileThreads()) {
+		profiler = main_profiler;
+		return;
+	}
+
 	profiler = new KremlinProfiler(kremlin_config.getMinProfiledLevel(), 
 					kremlin_config.getMaxProfiledLevel());
+
+	// The first profiler created belongs to the thread running main; any
+	// others belong to worker threads.
+	if (main_profiler == NULL) {
+		main_profiler = profiler;
+		profiler->init();
+		return;
+	}
+
+	profiler->markAsWorkerThread();
 	profiler->init();
+	if (main_profiler_running) profiler->enable();
+
+	pthread_once(&worker_profiler_key_once, createWorkerProfilerKey);
+	pthread_setspecific(worker_profiler_key, profiler);
 }
 
 
@@ -83,12 +125,20 @@ int main(int argc, char* argv[]) {
 
 	if (profiler == NULL) initProfiler();
 	profiler->enable();
+	main_profiler_running = true;
 
 	__main(program_args.size(), &program_args[0]);
 
+	// TRICKY: worker threads that are still running at this point won't be
+	// included in the profile.
+	main_profiler_running = false;
 	profiler->deinit();
 	delete profiler;
 	profiler = NULL;
+
+	// Instrumented code run after this (static destructors, atexit
+	// handlers) gets a fresh profiler rather than the one just deleted.
+	main_profiler = NULL;
 }
 
 // XXX: hacky... badness!
@@ -128,7 +178,8 @@ FunctionRegion* KremlinProfiler::getCallingFunction() {
 }
 
 void KremlinProfiler::initShadowMemory() {
-	switch(kremlin_config.getShadowMemType()) {
+	shadow_mem_type = kremlin_config.getShadowMemType();
+	switch(shadow_mem_type) {
 		case ShadowMemoryBase:
 			shadow_mem = new MShadowBase();
 			break;
@@ -136,7 +187,10 @@ void KremlinProfiler::initShadowMemory() {
 			shadow_mem = new MShadowSTV();
 			break;
 		case ShadowMemorySkadu:
-			shadow_mem = new MShadowSkadu();
+			shadow_mem = new MShadowSkadu(this);
+			break;
+		case ShadowMemoryFlat:
+			shadow_mem = new MShadowFlat();
 			break;
 		default:
 			shadow_mem = new MShadowDummy();
@@ -203,25 +257,6 @@ void _KWork(UInt32 work) {
  * Region Management
  *****************************************************************/
 
-ProgramRegion* KremlinProfiler::getRegionAtLevel(Level l) {
-	assert(l < program_regions.size());
-	ProgramRegion* ret = program_regions[l];
-	ret->sanityCheck();
-	return ret;
-}
-
-void KremlinProfiler::increaseNumRegions(unsigned num_new) {
-	for (unsigned i = 0; i < num_new; ++i) {
-		program_regions.push_back(new ProgramRegion());
-	}
-}
-
-void KremlinProfiler::deinitProgramRegions() { 
-	for (unsigned i = 0; i < program_regions.size(); ++i)
-		delete program_regions[i];
-	program_regions.clear();
-}
-
 void checkRegion() {
 #if 0
 	int bug = 0;
@@ -267,14 +302,14 @@ void _KPopCDep() {
  *      - _KLinkReturn(ret);
  *		
  *   b) start of the callee:
- *		- _KEnterRegion(sid);
+ *		- _KEnterRegion(sid, RegionFunc, sp);
  *      - _KPrepRTable(regSize, maxDepth);
  *		- _KUnlinkArg(a);
  *		- _KUnlinkArg(b);
  *
  *   c) end of the callee:
  *		- _KReturn(..);
- *      - _KExitRegion();
+ *      - _KExitRegion(sid, RegionFunc, sp);
  *
  * 
  *****************************************************************/
@@ -347,7 +382,7 @@ void _KTurnOff() {
  * KEnterRegion / KExitRegion
  *****************************************************************/
 
-void _KEnterRegion(SID regionId, RegionType regionType) {
+void _KEnterRegion(SID regionId, RegionType regionType, void* stackPtr) {
 	// @TRICKY: In C++ some instrumented object constructors may be called
 	// before main. We need to make sure that profiler is not NULL whenever we
 	// have an API call. Luckily, we are guaranteed that KEnterRegion will be
@@ -358,7 +393,7 @@ void _KEnterRegion(SID regionId, RegionType regionType) {
 	// profile any of the code in the pre-main constructors (just like we
 	// won't profile any code in post-main destructors)
 	if (profiler == NULL) initProfiler();
-	profiler->handleRegionEntry(regionId, regionType);
+	profiler->handleRegionEntry(regionId, regionType, stackPtr);
 }
 
 /**
@@ -366,9 +401,11 @@ void _KEnterRegion(SID regionId, RegionType regionType) {
  * statistics, and logging region statistics.
  * @param regionID		ID of region that is being exited.
  * @param regionType	Type of region being exited.
+ * @param stackPtr		Stack pointer of the instrumented function for
+ * 						function regions, NULL otherwise.
  */
-void _KExitRegion(SID regionId, RegionType regionType) {
-	profiler->handleRegionExit(regionId, regionType);
+void _KExitRegion(SID regionId, RegionType regionType, void* stackPtr) {
+	profiler->handleRegionExit(regionId, regionType, stackPtr);
 }
 
 void _KLandingPad(SID regionId, RegionType regionType) {
@@ -413,17 +450,191 @@ void _KTimestamp4(UInt32 dest_reg, UInt32 src1_reg, UInt32 src1_offset, UInt32 s
 void _KTimestamp5(UInt32 dest_reg, UInt32 src1_reg, UInt32 src1_offset, UInt32 src2_reg, UInt32 src2_offset, UInt32 src3_reg, UInt32 src3_offset, UInt32 src4_reg, UInt32 src4_offset, UInt32 src5_reg, UInt32 src5_offset) {
 	profiler->handleTimestamp5(dest_reg, src1_reg, src1_offset, src2_reg, src2_offset, src3_reg, src3_offset, src4_reg, src4_offset, src5_reg, src5_offset);
 }
-void _KTimestamp6(UInt32 dest_reg, UInt32 src1_reg, UInt32 src1_offset, UInt32 src2_reg, UInt32 src2_offset, UInt32 src3_reg, UInt32 src3_offset, UInt32 src4_reg, UInt32 src4_offset, UInt32 src5_reg, UInt32 src5_offset, UInt32 src6_reg, UInt32 src6_offset) {
-	profiler->handleTimestamp6(dest_reg, src1_reg, src1_offset, src2_reg, src2_offset, src3_reg, src3_offset, src4_reg, src4_offset, src5_reg, src5_offset, src6_reg, src6_offset);
+void _KTimestamp6(UInt32 dest_reg, 
+					UInt32 src1_reg, UInt32 src1_offset, 
+					UInt32 src2_reg, UInt32 src2_offset, 
+					UInt32 src3_reg, UInt32 src3_offset, 
+					UInt32 src4_reg, UInt32 src4_offset, 
+					UInt32 src5_reg, UInt32 src5_offset, 
+					UInt32 src6_reg, UInt32 src6_offset) {
+	UInt32 src_regs[6] = {src1_reg, src2_reg, src3_reg, src4_reg, src5_reg, src6_reg};
+	UInt32 src_offsets[6] = {src1_offset, src2_offset, src3_offset, src4_offset, src5_offset, src6_offset};
+	profiler->handleTimestampN<6>(dest_reg, src_regs, src_offsets);
 }
-void _KTimestamp7(UInt32 dest_reg, UInt32 src1_reg, UInt32 src1_offset, 
+
+void _KTimestamp7(UInt32 dest_reg, 
+					UInt32 src1_reg, UInt32 src1_offset, 
 					UInt32 src2_reg, UInt32 src2_offset, 
 					UInt32 src3_reg, UInt32 src3_offset, 
 					UInt32 src4_reg, UInt32 src4_offset, 
 					UInt32 src5_reg, UInt32 src5_offset, 
 					UInt32 src6_reg, UInt32 src6_offset, 
 					UInt32 src7_reg, UInt32 src7_offset) {
-	profiler->handleTimestamp7(dest_reg, src1_reg, src1_offset, src2_reg, src2_offset, src3_reg, src3_offset, src4_reg, src4_offset, src5_reg, src5_offset, src6_reg, src6_offset, src7_reg, src7_offset);
+	UInt32 src_regs[7] = {src1_reg, src2_reg, src3_reg, src4_reg, src5_reg, src6_reg, src7_reg};
+	UInt32 src_offsets[7] = {src1_offset, src2_offset, src3_offset, src4_offset, src5_offset, src6_offset, src7_offset};
+	profiler->handleTimestampN<7>(dest_reg, src_regs, src_offsets);
+}
+
+void _KTimestamp8(UInt32 dest_reg, 
+					UInt32 src1_reg, UInt32 src1_offset, 
+					UInt32 src2_reg, UInt32 src2_offset, 
+					UInt32 src3_reg, UInt32 src3_offset, 
+					UInt32 src4_reg, UInt32 src4_offset, 
+					UInt32 src5_reg, UInt32 src5_offset, 
+					UInt32 src6_reg, UInt32 src6_offset, 
+					UInt32 src7_reg, UInt32 src7_offset, 
+					UInt32 src8_reg, UInt32 src8_offset) {
+	UInt32 src_regs[8] = {src1_reg, src2_reg, src3_reg, src4_reg, src5_reg, src6_reg, src7_reg, src8_reg};
+	UInt32 src_offsets[8] = {src1_offset, src2_offset, src3_offset, src4_offset, src5_offset, src6_offset, src7_offset, src8_offset};
+	profiler->handleTimestampN<8>(dest_reg, src_regs, src_offsets);
+}
+
+void _KTimestamp9(UInt32 dest_reg, 
+					UInt32 src1_reg, UInt32 src1_offset, 
+					UInt32 src2_reg, UInt32 src2_offset, 
+					UInt32 src3_reg, UInt32 src3_offset, 
+					UInt32 src4_reg, UInt32 src4_offset, 
+					UInt32 src5_reg, UInt32 src5_offset, 
+					UInt32 src6_reg, UInt32 src6_offset, 
+					UInt32 src7_reg, UInt32 src7_offset, 
+					UInt32 src8_reg, UInt32 src8_offset, 
+					UInt32 src9_reg, UInt32 src9_offset) {
+	UInt32 src_regs[9] = {src1_reg, src2_reg, src3_reg, src4_reg, src5_reg, src6_reg, src7_reg, src8_reg, src9_reg};
+	UInt32 src_offsets[9] = {src1_offset, src2_offset, src3_offset, src4_offset, src5_offset, src6_offset, src7_offset, src8_offset, src9_offset};
+	profiler->handleTimestampN<9>(dest_reg, src_regs, src_offsets);
+}
+
+void _KTimestamp10(UInt32 dest_reg, 
+					UInt32 src1_reg, UInt32 src1_offset, 
+					UInt32 src2_reg, UInt32 src2_offset, 
+					UInt32 src3_reg, UInt32 src3_offset, 
+					UInt32 src4_reg, UInt32 src4_offset, 
+					UInt32 src5_reg, UInt32 src5_offset, 
+					UInt32 src6_reg, UInt32 src6_offset, 
+					UInt32 src7_reg, UInt32 src7_offset, 
+					UInt32 src8_reg, UInt32 src8_offset, 
+					UInt32 src9_reg, UInt32 src9_offset, 
+					UInt32 src10_reg, UInt32 src10_offset) {
+	UInt32 src_regs[10] = {src1_reg, src2_reg, src3_reg, src4_reg, src5_reg, src6_reg, src7_reg, src8_reg, src9_reg, src10_reg};
+	UInt32 src_offsets[10] = {src1_offset, src2_offset, src3_offset, src4_offset, src5_offset, src6_offset, src7_offset, src8_offset, src9_offset, src10_offset};
+	profiler->handleTimestampN<10>(dest_reg, src_regs, src_offsets);
+}
+
+void _KTimestamp11(UInt32 dest_reg, 
+					UInt32 src1_reg, UInt32 src1_offset, 
+					UInt32 src2_reg, UInt32 src2_offset, 
+					UInt32 src3_reg, UInt32 src3_offset, 
+					UInt32 src4_reg, UInt32 src4_offset, 
+					UInt32 src5_reg, UInt32 src5_offset, 
+					UInt32 src6_reg, UInt32 src6_offset, 
+					UInt32 src7_reg, UInt32 src7_offset, 
+					UInt32 src8_reg, UInt32 src8_offset, 
+					UInt32 src9_reg, UInt32 src9_offset, 
+					UInt32 src10_reg, UInt32 src10_offset, 
+					UInt32 src11_reg, UInt32 src11_offset) {
+	UInt32 src_regs[11] = {src1_reg, src2_reg, src3_reg, src4_reg, src5_reg, src6_reg, src7_reg, src8_reg, src9_reg, src10_reg, src11_reg};
+	UInt32 src_offsets[11] = {src1_offset, src2_offset, src3_offset, src4_offset, src5_offset, src6_offset, src7_offset, src8_offset, src9_offset, src10_offset, src11_offset};
+	profiler->handleTimestampN<11>(dest_reg, src_regs, src_offsets);
+}
+
+void _KTimestamp12(UInt32 dest_reg, 
+					UInt32 src1_reg, UInt32 src1_offset, 
+					UInt32 src2_reg, UInt32 src2_offset, 
+					UInt32 src3_reg, UInt32 src3_offset, 
+					UInt32 src4_reg, UInt32 src4_offset, 
+					UInt32 src5_reg, UInt32 src5_offset, 
+					UInt32 src6_reg, UInt32 src6_offset, 
+					UInt32 src7_reg, UInt32 src7_offset, 
+					UInt32 src8_reg, UInt32 src8_offset, 
+					UInt32 src9_reg, UInt32 src9_offset, 
+					UInt32 src10_reg, UInt32 src10_offset, 
+					UInt32 src11_reg, UInt32 src11_offset, 
+					UInt32 src12_reg, UInt32 src12_offset) {
+	UInt32 src_regs[12] = {src1_reg, src2_reg, src3_reg, src4_reg, src5_reg, src6_reg, src7_reg, src8_reg, src9_reg, src10_reg, src11_reg, src12_reg};
+	UInt32 src_offsets[12] = {src1_offset, src2_offset, src3_offset, src4_offset, src5_offset, src6_offset, src7_offset, src8_offset, src9_offset, src10_offset, src11_offset, src12_offset};
+	profiler->handleTimestampN<12>(dest_reg, src_regs, src_offsets);
+}
+
+void _KTimestamp13(UInt32 dest_reg, 
+					UInt32 src1_reg, UInt32 src1_offset, 
+					UInt32 src2_reg, UInt32 src2_offset, 
+					UInt32 src3_reg, UInt32 src3_offset, 
+					UInt32 src4_reg, UInt32 src4_offset, 
+					UInt32 src5_reg, UInt32 src5_offset, 
+					UInt32 src6_reg, UInt32 src6_offset, 
+					UInt32 src7_reg, UInt32 src7_offset, 
+					UInt32 src8_reg, UInt32 src8_offset, 
+					UInt32 src9_reg, UInt32 src9_offset, 
+					UInt32 src10_reg, UInt32 src10_offset, 
+					UInt32 src11_reg, UInt32 src11_offset, 
+					UInt32 src12_reg, UInt32 src12_offset, 
+					UInt32 src13_reg, UInt32 src13_offset) {
+	UInt32 src_regs[13] = {src1_reg, src2_reg, src3_reg, src4_reg, src5_reg, src6_reg, src7_reg, src8_reg, src9_reg, src10_reg, src11_reg, src12_reg, src13_reg};
+	UInt32 src_offsets[13] = {src1_offset, src2_offset, src3_offset, src4_offset, src5_offset, src6_offset, src7_offset, src8_offset, src9_offset, src10_offset, src11_offset, src12_offset, src13_offset};
+	profiler->handleTimestampN<13>(dest_reg, src_regs, src_offsets);
+}
+
+void _KTimestamp14(UInt32 dest_reg, 
+					UInt32 src1_reg, UInt32 src1_offset, 
+					UInt32 src2_reg, UInt32 src2_offset, 
+					UInt32 src3_reg, UInt32 src3_offset, 
+					UInt32 src4_reg, UInt32 src4_offset, 
+					UInt32 src5_reg, UInt32 src5_offset, 
+					UInt32 src6_reg, UInt32 src6_offset, 
+					UInt32 src7_reg, UInt32 src7_offset, 
+					UInt32 src8_reg, UInt32 src8_offset, 
+					UInt32 src9_reg, UInt32 src9_offset, 
+					UInt32 src10_reg, UInt32 src10_offset, 
+					UInt32 src11_reg, UInt32 src11_offset, 
+					UInt32 src12_reg, UInt32 src12_offset, 
+					UInt32 src13_reg, UInt32 src13_offset, 
+					UInt32 src14_reg, UInt32 src14_offset) {
+	UInt32 src_regs[14] = {src1_reg, src2_reg, src3_reg, src4_reg, src5_reg, src6_reg, src7_reg, src8_reg, src9_reg, src10_reg, src11_reg, src12_reg, src13_reg, src14_reg};
+	UInt32 src_offsets[14] = {src1_offset, src2_offset, src3_offset, src4_offset, src5_offset, src6_offset, src7_offset, src8_offset, src9_offset, src10_offset, src11_offset, src12_offset, src13_offset, src14_offset};
+	profiler->handleTimestampN<14>(dest_reg, src_regs, src_offsets);
+}
+
+void _KTimestamp15(UInt32 dest_reg, 
+					UInt32 src1_reg, UInt32 src1_offset, 
+					UInt32 src2_reg, UInt32 src2_offset, 
+					UInt32 src3_reg, UInt32 src3_offset, 
+					UInt32 src4_reg, UInt32 src4_offset, 
+					UInt32 src5_reg, UInt32 src5_offset, 
+					UInt32 src6_reg, UInt32 src6_offset, 
+					UInt32 src7_reg, UInt32 src7_offset, 
+					UInt32 src8_reg, UInt32 src8_offset, 
+					UInt32 src9_reg, UInt32 src9_offset, 
+					UInt32 src10_reg, UInt32 src10_offset, 
+					UInt32 src11_reg, UInt32 src11_offset, 
+					UInt32 src12_reg, UInt32 src12_offset, 
+					UInt32 src13_reg, UInt32 src13_offset, 
+					UInt32 src14_reg, UInt32 src14_offset, 
+					UInt32 src15_reg, UInt32 src15_offset) {
+	UInt32 src_regs[15] = {src1_reg, src2_reg, src3_reg, src4_reg, src5_reg, src6_reg, src7_reg, src8_reg, src9_reg, src10_reg, src11_reg, src12_reg, src13_reg, src14_reg, src15_reg};
+	UInt32 src_offsets[15] = {src1_offset, src2_offset, src3_offset, src4_offset, src5_offset, src6_offset, src7_offset, src8_offset, src9_offset, src10_offset, src11_offset, src12_offset, src13_offset, src14_offset, src15_offset};
+	profiler->handleTimestampN<15>(dest_reg, src_regs, src_offsets);
+}
+
+void _KTimestamp16(UInt32 dest_reg, 
+					UInt32 src1_reg, UInt32 src1_offset, 
+					UInt32 src2_reg, UInt32 src2_offset, 
+					UInt32 src3_reg, UInt32 src3_offset, 
+					UInt32 src4_reg, UInt32 src4_offset, 
+					UInt32 src5_reg, UInt32 src5_offset, 
+					UInt32 src6_reg, UInt32 src6_offset, 
+					UInt32 src7_reg, UInt32 src7_offset, 
+					UInt32 src8_reg, UInt32 src8_offset, 
+					UInt32 src9_reg, UInt32 src9_offset, 
+					UInt32 src10_reg, UInt32 src10_offset, 
+					UInt32 src11_reg, UInt32 src11_offset, 
+					UInt32 src12_reg, UInt32 src12_offset, 
+					UInt32 src13_reg, UInt32 src13_offset, 
+					UInt32 src14_reg, UInt32 src14_offset, 
+					UInt32 src15_reg, UInt32 src15_offset, 
+					UInt32 src16_reg, UInt32 src16_offset) {
+	UInt32 src_regs[16] = {src1_reg, src2_reg, src3_reg, src4_reg, src5_reg, src6_reg, src7_reg, src8_reg, src9_reg, src10_reg, src11_reg, src12_reg, src13_reg, src14_reg, src15_reg, src16_reg};
+	UInt32 src_offsets[16] = {src1_offset, src2_offset, src3_offset, src4_offset, src5_offset, src6_offset, src7_offset, src8_offset, src9_offset, src10_offset, src11_offset, src12_offset, src13_offset, src14_offset, src15_offset, src16_offset};
+	profiler->handleTimestampN<16>(dest_reg, src_regs, src_offsets);
 }
 
 
@@ -441,20 +652,79 @@ void _KLoad1(Addr src_addr, Reg dest_reg, Reg src_reg, UInt32 mem_access_size) {
 }
 
 
-// XXX: KLoad{2,3,4} will soon be deprecated
 void _KLoad2(Addr src_addr, Reg dest_reg, Reg src1_reg, Reg src2_reg, UInt32 mem_access_size) {
-	_KLoad0(src_addr,dest_reg,mem_access_size);
-	//_KLoad(src_addr,dest_reg,mem_access_size,2,src1_reg,src2_reg);
+	Reg src_regs[2] = {src1_reg, src2_reg};
+	profiler->handleLoadN<2>(src_addr, dest_reg, src_regs, mem_access_size);
 }
 
-void _KLoad3(Addr src_addr, Reg dest_reg, Reg src1_reg, Reg src2_reg, Reg src3_reg, UInt32 mem_access_size){
-	_KLoad0(src_addr,dest_reg,mem_access_size);
-	//_KLoad(src_addr,dest_reg,mem_access_size,3,src1_reg,src2_reg,src3_reg);
+void _KLoad3(Addr src_addr, Reg dest_reg, Reg src1_reg, Reg src2_reg, Reg src3_reg, UInt32 mem_access_size) {
+	Reg src_regs[3] = {src1_reg, src2_reg, src3_reg};
+	profiler->handleLoadN<3>(src_addr, dest_reg, src_regs, mem_access_size);
 }
 
-void _KLoad4(Addr src_addr, Reg dest_reg, Reg src1_reg, Reg src2_reg, Reg src3_reg, Reg src4_reg, UInt32 mem_access_size) { 
-	_KLoad0(src_addr,dest_reg,mem_access_size);
-	//_KLoad(src_addr,dest_reg,mem_access_size,4,src1_reg,src2_reg,src3_reg,src4_reg);
+void _KLoad4(Addr src_addr, Reg dest_reg, Reg src1_reg, Reg src2_reg, Reg src3_reg, Reg src4_reg, UInt32 mem_access_size) {
+	Reg src_regs[4] = {src1_reg, src2_reg, src3_reg, src4_reg};
+	profiler->handleLoadN<4>(src_addr, dest_reg, src_regs, mem_access_size);
+}
+
+void _KLoad5(Addr src_addr, Reg dest_reg, Reg src1_reg, Reg src2_reg, Reg src3_reg, Reg src4_reg, Reg src5_reg, UInt32 mem_access_size) {
+	Reg src_regs[5] = {src1_reg, src2_reg, src3_reg, src4_reg, src5_reg};
+	profiler->handleLoadN<5>(src_addr, dest_reg, src_regs, mem_access_size);
+}
+
+void _KLoad6(Addr src_addr, Reg dest_reg, Reg src1_reg, Reg src2_reg, Reg src3_reg, Reg src4_reg, Reg src5_reg, Reg src6_reg, UInt32 mem_access_size) {
+	Reg src_regs[6] = {src1_reg, src2_reg, src3_reg, src4_reg, src5_reg, src6_reg};
+	profiler->handleLoadN<6>(src_addr, dest_reg, src_regs, mem_access_size);
+}
+
+void _KLoad7(Addr src_addr, Reg dest_reg, Reg src1_reg, Reg src2_reg, Reg src3_reg, Reg src4_reg, Reg src5_reg, Reg src6_reg, Reg src7_reg, UInt32 mem_access_size) {
+	Reg src_regs[7] = {src1_reg, src2_reg, src3_reg, src4_reg, src5_reg, src6_reg, src7_reg};
+	profiler->handleLoadN<7>(src_addr, dest_reg, src_regs, mem_access_size);
+}
+
+void _KLoad8(Addr src_addr, Reg dest_reg, Reg src1_reg, Reg src2_reg, Reg src3_reg, Reg src4_reg, Reg src5_reg, Reg src6_reg, Reg src7_reg, Reg src8_reg, UInt32 mem_access_size) {
+	Reg src_regs[8] = {src1_reg, src2_reg, src3_reg, src4_reg, src5_reg, src6_reg, src7_reg, src8_reg};
+	profiler->handleLoadN<8>(src_addr, dest_reg, src_regs, mem_access_size);
+}
+
+void _KLoad9(Addr src_addr, Reg dest_reg, Reg src1_reg, Reg src2_reg, Reg src3_reg, Reg src4_reg, Reg src5_reg, Reg src6_reg, Reg src7_reg, Reg src8_reg, Reg src9_reg, UInt32 mem_access_size) {
+	Reg src_regs[9] = {src1_reg, src2_reg, src3_reg, src4_reg, src5_reg, src6_reg, src7_reg, src8_reg, src9_reg};
+	profiler->handleLoadN<9>(src_addr, dest_reg, src_regs, mem_access_size);
+}
+
+void _KLoad10(Addr src_addr, Reg dest_reg, Reg src1_reg, Reg src2_reg, Reg src3_reg, Reg src4_reg, Reg src5_reg, Reg src6_reg, Reg src7_reg, Reg src8_reg, Reg src9_reg, Reg src10_reg, UInt32 mem_access_size) {
+	Reg src_regs[10] = {src1_reg, src2_reg, src3_reg, src4_reg, src5_reg, src6_reg, src7_reg, src8_reg, src9_reg, src10_reg};
+	profiler->handleLoadN<10>(src_addr, dest_reg, src_regs, mem_access_size);
+}
+
+void _KLoad11(Addr src_addr, Reg dest_reg, Reg src1_reg, Reg src2_reg, Reg src3_reg, Reg src4_reg, Reg src5_reg, Reg src6_reg, Reg src7_reg, Reg src8_reg, Reg src9_reg, Reg src10_reg, Reg src11_reg, UInt32 mem_access_size) {
+	Reg src_regs[11] = {src1_reg, src2_reg, src3_reg, src4_reg, src5_reg, src6_reg, src7_reg, src8_reg, src9_reg, src10_reg, src11_reg};
+	profiler->handleLoadN<11>(src_addr, dest_reg, src_regs, mem_access_size);
+}
+
+void _KLoad12(Addr src_addr, Reg dest_reg, Reg src1_reg, Reg src2_reg, Reg src3_reg, Reg src4_reg, Reg src5_reg, Reg src6_reg, Reg src7_reg, Reg src8_reg, Reg src9_reg, Reg src10_reg, Reg src11_reg, Reg src12_reg, UInt32 mem_access_size) {
+	Reg src_regs[12] = {src1_reg, src2_reg, src3_reg, src4_reg, src5_reg, src6_reg, src7_reg, src8_reg, src9_reg, src10_reg, src11_reg, src12_reg};
+	profiler->handleLoadN<12>(src_addr, dest_reg, src_regs, mem_access_size);
+}
+
+void _KLoad13(Addr src_addr, Reg dest_reg, Reg src1_reg, Reg src2_reg, Reg src3_reg, Reg src4_reg, Reg src5_reg, Reg src6_reg, Reg src7_reg, Reg src8_reg, Reg src9_reg, Reg src10_reg, Reg src11_reg, Reg src12_reg, Reg src13_reg, UInt32 mem_access_size) {
+	Reg src_regs[13] = {src1_reg, src2_reg, src3_reg, src4_reg, src5_reg, src6_reg, src7_reg, src8_reg, src9_reg, src10_reg, src11_reg, src12_reg, src13_reg};
+	profiler->handleLoadN<13>(src_addr, dest_reg, src_regs, mem_access_size);
+}
+
+void _KLoad14(Addr src_addr, Reg dest_reg, Reg src1_reg, Reg src2_reg, Reg src3_reg, Reg src4_reg, Reg src5_reg, Reg src6_reg, Reg src7_reg, Reg src8_reg, Reg src9_reg, Reg src10_reg, Reg src11_reg, Reg src12_reg, Reg src13_reg, Reg src14_reg, UInt32 mem_access_size) {
+	Reg src_regs[14] = {src1_reg, src2_reg, src3_reg, src4_reg, src5_reg, src6_reg, src7_reg, src8_reg, src9_reg, src10_reg, src11_reg, src12_reg, src13_reg, src14_reg};
+	profiler->handleLoadN<14>(src_addr, dest_reg, src_regs, mem_access_size);
+}
+
+void _KLoad15(Addr src_addr, Reg dest_reg, Reg src1_reg, Reg src2_reg, Reg src3_reg, Reg src4_reg, Reg src5_reg, Reg src6_reg, Reg src7_reg, Reg src8_reg, Reg src9_reg, Reg src10_reg, Reg src11_reg, Reg src12_reg, Reg src13_reg, Reg src14_reg, Reg src15_reg, UInt32 mem_access_size) {
+	Reg src_regs[15] = {src1_reg, src2_reg, src3_reg, src4_reg, src5_reg, src6_reg, src7_reg, src8_reg, src9_reg, src10_reg, src11_reg, src12_reg, src13_reg, src14_reg, src15_reg};
+	profiler->handleLoadN<15>(src_addr, dest_reg, src_regs, mem_access_size);
+}
+
+void _KLoad16(Addr src_addr, Reg dest_reg, Reg src1_reg, Reg src2_reg, Reg src3_reg, Reg src4_reg, Reg src5_reg, Reg src6_reg, Reg src7_reg, Reg src8_reg, Reg src9_reg, Reg src10_reg, Reg src11_reg, Reg src12_reg, Reg src13_reg, Reg src14_reg, Reg src15_reg, Reg src16_reg, UInt32 mem_access_size) {
+	Reg src_regs[16] = {src1_reg, src2_reg, src3_reg, src4_reg, src5_reg, src6_reg, src7_reg, src8_reg, src9_reg, src10_reg, src11_reg, src12_reg, src13_reg, src14_reg, src15_reg, src16_reg};
+	profiler->handleLoadN<16>(src_addr, dest_reg, src_regs, mem_access_size);
 }
 
 void _KStore(Reg src_reg, Addr dest_addr, UInt32 mem_access_size) {
@@ -492,6 +762,66 @@ void _KPhi4To1(Reg dest_reg, Reg src_reg, Reg ctrl1_reg, Reg ctrl2_reg, Reg ctrl
 	profiler->handlePhi4To1(dest_reg, src_reg, ctrl1_reg, ctrl2_reg, ctrl3_reg, ctrl4_reg);
 }
 
+void _KPhi5To1(Reg dest_reg, Reg src_reg, Reg ctrl1_reg, Reg ctrl2_reg, Reg ctrl3_reg, Reg ctrl4_reg, Reg ctrl5_reg) {
+	Reg ctrl_regs[5] = {ctrl1_reg, ctrl2_reg, ctrl3_reg, ctrl4_reg, ctrl5_reg};
+	profiler->handlePhiNTo1<5>(dest_reg, src_reg, ctrl_regs);
+}
+
+void _KPhi6To1(Reg dest_reg, Reg src_reg, Reg ctrl1_reg, Reg ctrl2_reg, Reg ctrl3_reg, Reg ctrl4_reg, Reg ctrl5_reg, Reg ctrl6_reg) {
+	Reg ctrl_regs[6] = {ctrl1_reg, ctrl2_reg, ctrl3_reg, ctrl4_reg, ctrl5_reg, ctrl6_reg};
+	profiler->handlePhiNTo1<6>(dest_reg, src_reg, ctrl_regs);
+}
+
+void _KPhi7To1(Reg dest_reg, Reg src_reg, Reg ctrl1_reg, Reg ctrl2_reg, Reg ctrl3_reg, Reg ctrl4_reg, Reg ctrl5_reg, Reg ctrl6_reg, Reg ctrl7_reg) {
+	Reg ctrl_regs[7] = {ctrl1_reg, ctrl2_reg, ctrl3_reg, ctrl4_reg, ctrl5_reg, ctrl6_reg, ctrl7_reg};
+	profiler->handlePhiNTo1<7>(dest_reg, src_reg, ctrl_regs);
+}
+
+void _KPhi8To1(Reg dest_reg, Reg src_reg, Reg ctrl1_reg, Reg ctrl2_reg, Reg ctrl3_reg, Reg ctrl4_reg, Reg ctrl5_reg, Reg ctrl6_reg, Reg ctrl7_reg, Reg ctrl8_reg) {
+	Reg ctrl_regs[8] = {ctrl1_reg, ctrl2_reg, ctrl3_reg, ctrl4_reg, ctrl5_reg, ctrl6_reg, ctrl7_reg, ctrl8_reg};
+	profiler->handlePhiNTo1<8>(dest_reg, src_reg, ctrl_regs);
+}
+
+void _KPhi9To1(Reg dest_reg, Reg src_reg, Reg ctrl1_reg, Reg ctrl2_reg, Reg ctrl3_reg, Reg ctrl4_reg, Reg ctrl5_reg, Reg ctrl6_reg, Reg ctrl7_reg, Reg ctrl8_reg, Reg ctrl9_reg) {
+	Reg ctrl_regs[9] = {ctrl1_reg, ctrl2_reg, ctrl3_reg, ctrl4_reg, ctrl5_reg, ctrl6_reg, ctrl7_reg, ctrl8_reg, ctrl9_reg};
+	profiler->handlePhiNTo1<9>(dest_reg, src_reg, ctrl_regs);
+}
+
+void _KPhi10To1(Reg dest_reg, Reg src_reg, Reg ctrl1_reg, Reg ctrl2_reg, Reg ctrl3_reg, Reg ctrl4_reg, Reg ctrl5_reg, Reg ctrl6_reg, Reg ctrl7_reg, Reg ctrl8_reg, Reg ctrl9_reg, Reg ctrl10_reg) {
+	Reg ctrl_regs[10] = {ctrl1_reg, ctrl2_reg, ctrl3_reg, ctrl4_reg, ctrl5_reg, ctrl6_reg, ctrl7_reg, ctrl8_reg, ctrl9_reg, ctrl10_reg};
+	profiler->handlePhiNTo1<10>(dest_reg, src_reg, ctrl_regs);
+}
+
+void _KPhi11To1(Reg dest_reg, Reg src_reg, Reg ctrl1_reg, Reg ctrl2_reg, Reg ctrl3_reg, Reg ctrl4_reg, Reg ctrl5_reg, Reg ctrl6_reg, Reg ctrl7_reg, Reg ctrl8_reg, Reg ctrl9_reg, Reg ctrl10_reg, Reg ctrl11_reg) {
+	Reg ctrl_regs[11] = {ctrl1_reg, ctrl2_reg, ctrl3_reg, ctrl4_reg, ctrl5_reg, ctrl6_reg, ctrl7_reg, ctrl8_reg, ctrl9_reg, ctrl10_reg, ctrl11_reg};
+	profiler->handlePhiNTo1<11>(dest_reg, src_reg, ctrl_regs);
+}
+
+void _KPhi12To1(Reg dest_reg, Reg src_reg, Reg ctrl1_reg, Reg ctrl2_reg, Reg ctrl3_reg, Reg ctrl4_reg, Reg ctrl5_reg, Reg ctrl6_reg, Reg ctrl7_reg, Reg ctrl8_reg, Reg ctrl9_reg, Reg ctrl10_reg, Reg ctrl11_reg, Reg ctrl12_reg) {
+	Reg ctrl_regs[12] = {ctrl1_reg, ctrl2_reg, ctrl3_reg, ctrl4_reg, ctrl5_reg, ctrl6_reg, ctrl7_reg, ctrl8_reg, ctrl9_reg, ctrl10_reg, ctrl11_reg, ctrl12_reg};
+	profiler->handlePhiNTo1<12>(dest_reg, src_reg, ctrl_regs);
+}
+
+void _KPhi13To1(Reg dest_reg, Reg src_reg, Reg ctrl1_reg, Reg ctrl2_reg, Reg ctrl3_reg, Reg ctrl4_reg, Reg ctrl5_reg, Reg ctrl6_reg, Reg ctrl7_reg, Reg ctrl8_reg, Reg ctrl9_reg, Reg ctrl10_reg, Reg ctrl11_reg, Reg ctrl12_reg, Reg ctrl13_reg) {
+	Reg ctrl_regs[13] = {ctrl1_reg, ctrl2_reg, ctrl3_reg, ctrl4_reg, ctrl5_reg, ctrl6_reg, ctrl7_reg, ctrl8_reg, ctrl9_reg, ctrl10_reg, ctrl11_reg, ctrl12_reg, ctrl13_reg};
+	profiler->handlePhiNTo1<13>(dest_reg, src_reg, ctrl_regs);
+}
+
+void _KPhi14To1(Reg dest_reg, Reg src_reg, Reg ctrl1_reg, Reg ctrl2_reg, Reg ctrl3_reg, Reg ctrl4_reg, Reg ctrl5_reg, Reg ctrl6_reg, Reg ctrl7_reg, Reg ctrl8_reg, Reg ctrl9_reg, Reg ctrl10_reg, Reg ctrl11_reg, Reg ctrl12_reg, Reg ctrl13_reg, Reg ctrl14_reg) {
+	Reg ctrl_regs[14] = {ctrl1_reg, ctrl2_reg, ctrl3_reg, ctrl4_reg, ctrl5_reg, ctrl6_reg, ctrl7_reg, ctrl8_reg, ctrl9_reg, ctrl10_reg, ctrl11_reg, ctrl12_reg, ctrl13_reg, ctrl14_reg};
+	profiler->handlePhiNTo1<14>(dest_reg, src_reg, ctrl_regs);
+}
+
+void _KPhi15To1(Reg dest_reg, Reg src_reg, Reg ctrl1_reg, Reg ctrl2_reg, Reg ctrl3_reg, Reg ctrl4_reg, Reg ctrl5_reg, Reg ctrl6_reg, Reg ctrl7_reg, Reg ctrl8_reg, Reg ctrl9_reg, Reg ctrl10_reg, Reg ctrl11_reg, Reg ctrl12_reg, Reg ctrl13_reg, Reg ctrl14_reg, Reg ctrl15_reg) {
+	Reg ctrl_regs[15] = {ctrl1_reg, ctrl2_reg, ctrl3_reg, ctrl4_reg, ctrl5_reg, ctrl6_reg, ctrl7_reg, ctrl8_reg, ctrl9_reg, ctrl10_reg, ctrl11_reg, ctrl12_reg, ctrl13_reg, ctrl14_reg, ctrl15_reg};
+	profiler->handlePhiNTo1<15>(dest_reg, src_reg, ctrl_regs);
+}
+
+void _KPhi16To1(Reg dest_reg, Reg src_reg, Reg ctrl1_reg, Reg ctrl2_reg, Reg ctrl3_reg, Reg ctrl4_reg, Reg ctrl5_reg, Reg ctrl6_reg, Reg ctrl7_reg, Reg ctrl8_reg, Reg ctrl9_reg, Reg ctrl10_reg, Reg ctrl11_reg, Reg ctrl12_reg, Reg ctrl13_reg, Reg ctrl14_reg, Reg ctrl15_reg, Reg ctrl16_reg) {
+	Reg ctrl_regs[16] = {ctrl1_reg, ctrl2_reg, ctrl3_reg, ctrl4_reg, ctrl5_reg, ctrl6_reg, ctrl7_reg, ctrl8_reg, ctrl9_reg, ctrl10_reg, ctrl11_reg, ctrl12_reg, ctrl13_reg, ctrl14_reg, ctrl15_reg, ctrl16_reg};
+	profiler->handlePhiNTo1<16>(dest_reg, src_reg, ctrl_regs);
+}
+
 void _KPhiCond4To1(Reg dest_reg, Reg ctrl1_reg, Reg ctrl2_reg, Reg ctrl3_reg, Reg ctrl4_reg) {
 	profiler->handlePhiCond4To1(dest_reg, ctrl1_reg, ctrl2_reg, ctrl3_reg, ctrl4_reg);
 }
@@ -514,130 +844,47 @@ void _KDeinit() {}
 
 /***********************************************
  * Library Call
- * DJ: will be optimized later..
  ************************************************/
 
-
-#define MAX_ENTRY 10
-
 // use estimated cost for a callee function we cannot instrument
-// TODO: implement new shadow mem interface
-void _KCallLib(UInt cost, UInt dest, UInt num_in, ...) {
-	idbgAction(KREM_CD_TO_PHI,"## KCallLib(cost=%u,dest=%u,num_in=%u,...)\n",cost,dest,num_in);
-
-#if 0
-    if (!profiler->isEnabled())
-        return;
-
-    MSG(1, "KCallLib to ts[%u] with cost %u\n", dest, cost);
-    _KWork(cost);
-
-    TEntry* entrySrc[MAX_ENTRY];
-    TEntry* entryDest = getLTEntry(dest);
-
-    va_list ap;
-    va_start(ap, num_in);
-
-    int i;
-    for (i = 0; i < num_in; i++) {
-        UInt src = va_arg(ap, UInt);
-        entrySrc[i] = getLTEntry(src);
-        assert(entrySrc[i] != NULL);
-    }   
-    va_end(ap);
-
-    int minLevel = profiler->getMinLevel();
-    int maxLevel = getEndLevel();
-
-    TEntryRealloc(entryDest, maxLevel);
-    for (i = minLevel; i <= maxLevel; i++) {
-        UInt version = *ProgramRegion::getVersionAtLevel(i);
-        UInt64 max = 0;
-        
-		/*
-        int j;
-        for (j = 0; j < num_in; j++) {
-            UInt64 ts = profiler->getCurrentTime(entrySrc[j], i, version);
-            if (ts > max)
-                max = ts;
-        } */  
-        
-		UInt64 value = max + cost;
-
-		updateCP(value, i);
-    }
-    return;
-#endif
-    
+void _KCallLib(UInt64 cost, UInt dest, UInt num_in, UInt num_reads, 
+				UInt num_writes, ...) {
+	va_list args;
+	va_start(args, num_writes);
+	profiler->handleCallLib(cost, dest, num_in, num_reads, num_writes, args);
+	va_end(args);
 }
 
 /***********************************************
  * Dynamic Memory Allocation / Deallocation
- * DJ: will be optimized later..
  ************************************************/
 
-
-// FIXME: support 64 bit address
 void _KMalloc(Addr addr, size_t size, UInt dest) {
-	// TODO: idbgAction
-#if 0
-    if (!profiler->isEnabled()) return;
-    
-    MSG(1, "KMalloc addr=0x%x size=%llu\n", addr, (UInt64)size);
-
-    // Don't do anything if malloc returned NULL
-    if(!addr) { return; }
-
-    createMEntry(addr,size);
-#endif
+	profiler->handleMalloc(addr, size, dest);
 }
 
-// TODO: implement for new shadow mem interface
 void _KFree(Addr addr) {
-	// TODO: idbgAction
-#if 0
-    if (!profiler->isEnabled()) return;
-
-    MSG(1, "KFree addr=0x%x\n", addr);
-
-    // Calls to free with NULL just return.
-    if(addr == NULL) return;
-
-    size_t mem_size = getMEntry(addr);
-
-    Addr a;
-    for(a = addr; a < addr + mem_size; a++) {
-        GTableDeleteTEntry(gTable, a);
-	}
+	profiler->handleFree(addr);
+}
 
-    freeMEntry(addr);
-	_KWork(FREE_COST);
-	// make sure CP is at least the time needed to complete the free
-    int minLevel = profiler->getMinLevel();
-    int maxLevel = getEndLevel();
+void _KRealloc(Addr old_addr, Addr new_addr, size_t size, UInt dest) {
+	profiler->handleRealloc(old_addr, new_addr, size, dest);
+}
 
-    int i;
-    for (i = minLevel; i <= maxLevel; i++) {
-        UInt64 value = profiler->getControlDependenceAtIndex(i) + FREE_COST;
+/***********************************************
+ * Bulk Memory Operations (memcpy, memmove, memset)
+ ************************************************/
 
-        updateCP(value, i);
-    }
-#endif
+void _KMemCopy(Addr dest_addr, Addr src_addr, UInt64 size) {
+	profiler->handleMemCopy(dest_addr, src_addr, size);
 }
 
-// TODO: more efficient implementation (if old_addr = new_addr)
-// XXX: This is wrong. Values in the realloc'd location should still have the
-// same timestamp.
-void _KRealloc(Addr old_addr, Addr new_addr, size_t size, UInt dest) {
-	// TODO: idbgAction
-#if 0
-    if (!profiler->isEnabled())
-        return;
+void _KMemSet(Reg src_reg, Addr dest_addr, UInt64 size) {
+	profiler->handleMemSet(src_reg, dest_addr, size);
+}
 
-    MSG(1, "KRealloc old_addr=0x%x new_addr=0x%x size=%llu\n", old_addr, new_addr, (UInt64)size);
-    _KFree(old_addr);
-    _KMalloc(new_addr,size,dest);
-#endif
+void _KMemSetConst(Addr dest_addr, UInt64 size) {
+	profiler->handleMemSetConst(dest_addr, size);
 }
 
 /***********************************************
@@ -812,7 +1059,7 @@ void _KInvokeThrew(UInt64 id)
         {
             UInt64 lastLevel = profiler->getCurrentLevel();
             ProgramRegion* region = regionInfo + getLevelOffset(profiler->getCurrentLevel()); // FIXME: regionInfo is vector now
-            _KExitRegion(region->regionId, region->regionType);
+            _KExitRegion(region->regionId, region->regionType, NULL);
             assert(profiler->getCurrentLevel() < lastLevel);
             assert(profiler->getCurrentLevel() >= 0);
         }
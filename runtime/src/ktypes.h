@@ -23,6 +23,9 @@ typedef UInt 				Reg;
 typedef UInt64				SID; 	// static region ID
 typedef UInt64				CID;	// callsite ID
 
+// destination register of a library call that doesn't return a value
+#define KREM_NO_DEST_REG ((Reg)-1)
+
 
 typedef enum RegionType {RegionFunc, RegionLoop, RegionLoopBody} RegionType;
 
@@ -45,5 +48,11 @@ typedef enum RegionType {RegionFunc, RegionLoop, RegionLoopBody} RegionType;
 #define KREM_PREP_REG_TABLE 16
 #define KREM_REDUCTION 17
 #define KREM_INDUCTION 18
+#define KREM_MALLOC 19
+#define KREM_FREE 20
+#define KREM_REALLOC 21
+#define KREM_MEMCOPY 22
+#define KREM_MEMSET 23
+#define KREM_CALL_LIB 24
 
 #endif
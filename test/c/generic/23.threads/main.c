@@ -0,0 +1,42 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NUM_THREADS 4
+#define N 1000
+
+static int arrays[NUM_THREADS][N];
+
+static void* worker(void* arg) {
+	int* array = (int*)arg;
+	int i;
+	for(i = 0; i < N; ++i) {
+		array[i] = i * 3;
+	}
+
+	int sum = 0;
+	for(i = 0; i < N; ++i) {
+		sum += array[i];
+	}
+	array[0] = sum;
+	return NULL;
+}
+
+int main() {
+	pthread_t threads[NUM_THREADS];
+	int t;
+	for(t = 0; t < NUM_THREADS; ++t) {
+		pthread_create(&threads[t], NULL, worker, arrays[t]);
+	}
+	for(t = 0; t < NUM_THREADS; ++t) {
+		pthread_join(threads[t], NULL);
+	}
+
+	int total = 0;
+	for(t = 0; t < NUM_THREADS; ++t) {
+		total += arrays[t][0];
+	}
+	printf("total: %d\n", total);
+
+	return 0;
+}
@@ -0,0 +1,44 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#define N 256
+
+static char src[N + 8];
+static char dst[N + 8];
+
+static unsigned checksum(const char* buf, int size) {
+	unsigned sum = 0;
+	int i;
+	for(i = 0; i < size; ++i) {
+		sum = sum * 31 + buf[i];
+	}
+	return sum;
+}
+
+int main() {
+	int i;
+	for(i = 0; i < N + 8; ++i) {
+		src[i] = rand();
+	}
+
+	// aligned and misaligned copies, some not a multiple of the word size
+	memcpy(dst, src, N);
+	memcpy(dst + 1, src + 3, 61);
+	memcpy(dst + 7, src, 9);
+
+	// overlapping moves in both directions
+	memmove(dst + 5, dst, 100);
+	memmove(dst, dst + 3, 100);
+	memmove(src + 1, src, N);
+
+	// set a misaligned range, then one that ends part way through a word
+	memset(dst + 3, rand() & 0x7f, 77);
+	memset(dst + 128, 0, 13);
+
+	// read everything back so the copied and set values are used
+	printf("src: %u\n", checksum(src, N + 8));
+	printf("dst: %u\n", checksum(dst, N + 8));
+
+	return 0;
+}
@@ -0,0 +1,60 @@
+#include <stdlib.h>
+#include <stdio.h>
+
+#define NUM_BLOCKS 64
+
+int main() {
+	int* blocks[NUM_BLOCKS];
+	int sizes[NUM_BLOCKS];
+	int i, j;
+
+	for(i = 0; i < NUM_BLOCKS; ++i) {
+		sizes[i] = 1 + rand() % 100;
+		blocks[i] = (i % 4 == 0) ? calloc(sizes[i], sizeof(int))
+								 : malloc(sizes[i] * sizeof(int));
+		for(j = 0; j < sizes[i]; ++j) {
+			// calloc'd blocks start out zeroed
+			if(i % 4 == 0) blocks[i][j] += rand() % 1000;
+			else blocks[i][j] = rand() % 1000;
+		}
+	}
+
+	// free every other block so later allocations can reuse their memory
+	for(i = 0; i < NUM_BLOCKS; i += 2) {
+		free(blocks[i]);
+		blocks[i] = malloc(sizes[i] * sizeof(int));
+		for(j = 0; j < sizes[i]; ++j) {
+			blocks[i][j] = i + j;
+		}
+	}
+
+	// grow and shrink blocks; growing may move them
+	for(i = 1; i < NUM_BLOCKS; i += 2) {
+		int new_size = (i % 3 == 0) ? sizes[i] / 2 + 1 : sizes[i] * 4;
+		blocks[i] = realloc(blocks[i], new_size * sizeof(int));
+		for(j = sizes[i]; j < new_size; ++j) {
+			blocks[i][j] = blocks[i][j - 1] + 1;
+		}
+		sizes[i] = new_size;
+	}
+
+	// realloc of NULL is a malloc and free of NULL does nothing
+	int* extra = realloc(NULL, 10 * sizeof(int));
+	for(j = 0; j < 10; ++j) {
+		extra[j] = j;
+	}
+	free(NULL);
+
+	int sum = extra[9];
+	for(i = 0; i < NUM_BLOCKS; ++i) {
+		for(j = 0; j < sizes[i]; ++j) {
+			sum += blocks[i][j];
+		}
+		free(blocks[i]);
+	}
+	free(extra);
+
+	printf("sum: %d\n", sum);
+
+	return 0;
+}
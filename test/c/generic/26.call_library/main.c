@@ -0,0 +1,28 @@
+#include <math.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+int main() {
+	double x = rand();
+	double y = sqrt(x);
+
+	char str[32];
+	int i;
+	int len = 1 + rand() % 30;
+	for(i = 0; i < len; ++i) {
+		str[i] = 'a' + i;
+	}
+	str[len] = '\0';
+
+	// the cost of strnlen depends on its size argument, and it reads str
+	size_t n = strnlen(str, sizeof(str));
+
+	// strncpy writes copy from what it reads in str
+	char copy[32];
+	strncpy(copy, str, sizeof(copy));
+
+	printf("y = %f, n = %d, copy = %s\n", y, (int)n, copy);
+
+	return 0;
+}